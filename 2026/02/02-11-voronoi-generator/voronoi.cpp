@@ -6,6 +6,12 @@
 #include <algorithm>
 #include <iostream>
 #include <limits>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
 
 struct Point {
     float x, y;
@@ -66,6 +72,201 @@ void generateVoronoi(unsigned char* image, int width, int height, const std::vec
     }
 }
 
+// ============================================================
+// 快速最近种子搜索：跳跃泛洪（JFA）和均匀网格索引
+// 两者都输出每个像素最近种子的下标，距离一律用平方比较；距离相同时取下标小的，与暴力法一致
+// ============================================================
+
+using Labels = std::vector<int>;
+
+inline float distance2(float x, float y, float sx, float sy) {
+    float dx = x - sx;
+    float dy = y - sy;
+    return dx * dx + dy * dy;
+}
+
+int defaultThreads() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// 按行分给多个线程：每次用原子计数器领取 kRowBlock 行，fn(y0, y1) 处理 [y0, y1)
+template <typename Fn>
+void parallelRows(int height, int threads, Fn&& fn) {
+    const int kRowBlock = 8;
+    std::atomic<int> next{0};
+    auto worker = [&] {
+        for (int y0; (y0 = next.fetch_add(kRowBlock)) < height;) fn(y0, std::min(height, y0 + kRowBlock));
+    };
+    threads = std::max(1, std::min(threads, (height + kRowBlock - 1) / kRowBlock));
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+}
+
+// 暴力法的单像素版本（平方距离），基准中用来抽样校验
+int nearestSeedBrute(float x, float y, const std::vector<Point>& seeds) {
+    float best = std::numeric_limits<float>::max();
+    int bestId = 0;
+    for (size_t i = 0; i < seeds.size(); ++i) {
+        float d = distance2(x, y, seeds[i].x, seeds[i].y);
+        if (d < best) {
+            best = d;
+            bestId = int(i);
+        }
+    }
+    return bestId;
+}
+
+// 跳跃泛洪（Rong & Tan 2006）：种子先写进所在像素，然后步长 k = N/2, N/4, ..., 1 各做一遍，
+// 每个像素查看自己和 8 个相距 k 的邻居记录的种子，保留最近的。共 log2(N) 遍，与种子数无关。
+// 最后再补一遍 k = 1（JFA+1），进一步减少少量错误像素；结果是近似的
+Labels voronoiJFA(int width, int height, const std::vector<Point>& seeds, int threads) {
+    Labels cur(size_t(width) * height, -1), next(cur.size());
+    for (size_t i = 0; i < seeds.size(); ++i) {
+        int x = std::clamp(int(std::floor(seeds[i].x)), 0, width - 1);
+        int y = std::clamp(int(std::floor(seeds[i].y)), 0, height - 1);
+        int& slot = cur[size_t(y) * width + x];
+        if (slot < 0 || distance2(x, y, seeds[i].x, seeds[i].y) < distance2(x, y, seeds[slot].x, seeds[slot].y))
+            slot = int(i);
+    }
+
+    std::vector<int> steps;
+    int n = 1;
+    while (n < std::max(width, height)) n <<= 1;
+    for (int k = n / 2; k >= 1; k /= 2) steps.push_back(k);
+    steps.push_back(1);
+
+    for (int k : steps) {
+        parallelRows(height, threads, [&](int y0, int y1) {
+            for (int y = y0; y < y1; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    int bestId = cur[size_t(y) * width + x];
+                    float best = bestId >= 0 ? distance2(x, y, seeds[bestId].x, seeds[bestId].y)
+                                             : std::numeric_limits<float>::max();
+                    for (int dy = -k; dy <= k; dy += k) {
+                        int qy = y + dy;
+                        if (qy < 0 || qy >= height) continue;
+                        const int* row = &cur[size_t(qy) * width];
+                        for (int dx = -k; dx <= k; dx += k) {
+                            int qx = x + dx;
+                            if (qx < 0 || qx >= width) continue;
+                            int id = row[qx];
+                            // 自己格子里的种子（dx = dy = 0）就是 bestId，这里直接跳过
+                            if (id < 0 || id == bestId) continue;
+                            float d = distance2(x, y, seeds[id].x, seeds[id].y);
+                            if (d < best || (d == best && id < bestId)) {
+                                best = d;
+                                bestId = id;
+                            }
+                        }
+                    }
+                    next[size_t(y) * width + x] = bestId;
+                }
+            }
+        });
+        cur.swap(next);
+    }
+    return cur;
+}
+
+// 均匀网格索引：平均每格约 2 个种子，种子按格子排序后连续存放（CSR）。
+// 查询从像素所在格子开始一圈圈向外扫描；已扫描方块到边界的最短距离就是未扫描种子距离的下界，
+// 当前最近距离小于这个下界就可以停止——结果是精确的
+class SeedGrid {
+public:
+    SeedGrid(const std::vector<Point>& seeds, int width, int height) {
+        cell = std::max(1.0f, std::sqrt(2.0f * width * height / std::max<size_t>(1, seeds.size())));
+        cols = std::max(1, int(std::ceil(width / cell)));
+        rows = std::max(1, int(std::ceil(height / cell)));
+        std::vector<int> cellOf(seeds.size());
+        start.assign(size_t(cols) * rows + 1, 0);
+        for (size_t i = 0; i < seeds.size(); ++i) {
+            cellOf[i] = cellIndex(seeds[i].x, seeds[i].y);
+            start[cellOf[i] + 1]++;
+        }
+        for (size_t c = 1; c < start.size(); ++c) start[c] += start[c - 1];
+        std::vector<int> fill(start.begin(), start.end() - 1);
+        xs.resize(seeds.size());
+        ys.resize(seeds.size());
+        ids.resize(seeds.size());
+        for (size_t i = 0; i < seeds.size(); ++i) {
+            int slot = fill[cellOf[i]]++;
+            xs[slot] = seeds[i].x;
+            ys[slot] = seeds[i].y;
+            ids[slot] = int(i);
+        }
+    }
+
+    int nearest(float px, float py) const {
+        int cx = std::clamp(int(px / cell), 0, cols - 1);
+        int cy = std::clamp(int(py / cell), 0, rows - 1);
+        float best = std::numeric_limits<float>::max();
+        int bestId = -1;
+        auto scanCell = [&](int i, int j) {
+            if (i < 0 || i >= cols) return;
+            int c = j * cols + i;
+            for (int k = start[c]; k < start[c + 1]; ++k) {
+                float d = distance2(px, py, xs[k], ys[k]);
+                if (d < best || (d == best && ids[k] < bestId)) {
+                    best = d;
+                    bestId = ids[k];
+                }
+            }
+        };
+        for (int r = 0;; ++r) {
+            // 扫描与 (cx, cy) 的切比雪夫距离恰好为 r 的一圈格子
+            int x0 = cx - r, x1 = cx + r, y0 = cy - r, y1 = cy + r;
+            for (int j = std::max(y0, 0); j <= std::min(y1, rows - 1); ++j) {
+                if (j == y0 || j == y1) {
+                    for (int i = std::max(x0, 0); i <= std::min(x1, cols - 1); ++i) scanCell(i, j);
+                } else {
+                    scanCell(x0, j);
+                    scanCell(x1, j);
+                }
+            }
+            // 方块到网格边界为止的方向上外面没有种子（越界种子被归到边缘格子，已扫描过）
+            float inf = std::numeric_limits<float>::max();
+            float margin = std::min(std::min(x0 > 0 ? px - x0 * cell : inf, x1 < cols - 1 ? (x1 + 1) * cell - px : inf),
+                                    std::min(y0 > 0 ? py - y0 * cell : inf, y1 < rows - 1 ? (y1 + 1) * cell - py : inf));
+            if (margin == inf) break;
+            if (bestId >= 0 && best < margin * margin) break;
+        }
+        return bestId;
+    }
+
+private:
+    float cell;
+    int cols, rows;
+    std::vector<int> start, ids;
+    std::vector<float> xs, ys;
+
+    int cellIndex(float x, float y) const {
+        int i = std::clamp(int(x / cell), 0, cols - 1);
+        int j = std::clamp(int(y / cell), 0, rows - 1);
+        return j * cols + i;
+    }
+};
+
+Labels voronoiGrid(int width, int height, const std::vector<Point>& seeds, int threads) {
+    SeedGrid grid(seeds, width, height);
+    Labels labels(size_t(width) * height);
+    parallelRows(height, threads, [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y)
+            for (int x = 0; x < width; ++x) labels[size_t(y) * width + x] = grid.nearest(x, y);
+    });
+    return labels;
+}
+
+void colorize(unsigned char* image, const Labels& labels, const std::vector<Point>& seeds) {
+    for (size_t i = 0; i < labels.size(); ++i) {
+        const Point& s = seeds[labels[i]];
+        image[i * 3 + 0] = s.r;
+        image[i * 3 + 1] = s.g;
+        image[i * 3 + 2] = s.b;
+    }
+}
+
 // 绘制种子点（用白色标记）
 void drawSeeds(unsigned char* image, int width, int height, const std::vector<Point>& seeds) {
     for (const auto& seed : seeds) {
@@ -88,25 +289,112 @@ void drawSeeds(unsigned char* image, int width, int height, const std::vector<Po
     }
 }
 
-int main() {
-    const int WIDTH = 800;
-    const int HEIGHT = 600;
-    const int SEED_COUNT = 50;
+// 基准：大量种子的高分辨率图，暴力法只在随机抽样的像素上运行（用于校验和估算整图耗时）
+int runBenchmark(int width, int height, int seedCount, int threads) {
+    using Clock = std::chrono::steady_clock;
+    auto ms = [](Clock::time_point t0) { return std::chrono::duration<double, std::milli>(Clock::now() - t0).count(); };
+
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<float> disX(0, float(width)), disY(0, float(height));
+    std::vector<Point> seeds(seedCount);
+    for (auto& p : seeds) p = Point{disX(gen), disY(gen), 0, 0, 0};
+    std::cout << "基准: " << width << "x" << height << ", " << seedCount << " 个种子, " << threads << " 线程" << std::endl;
+
+    const int kSamples = 20000;
+    std::vector<int> sx(kSamples), sy(kSamples), truth(kSamples);
+    std::uniform_int_distribution<int> px(0, width - 1), py(0, height - 1);
+    auto t0 = Clock::now();
+    for (int i = 0; i < kSamples; ++i) {
+        sx[i] = px(gen);
+        sy[i] = py(gen);
+        truth[i] = nearestSeedBrute(sx[i], sy[i], seeds);
+    }
+    double bruteMs = ms(t0) * (double(width) * height / kSamples);
+    std::cout << "暴力法 (单线程，按 " << kSamples << " 个抽样像素估算整图): " << bruteMs / 1000 << " s" << std::endl;
+
+    // 抽样像素上选中种子的距离与真实最近距离不同就算错（距离相同、下标不同不算）
+    auto report = [&](const char* name, const Labels& labels, double elapsed) {
+        int wrong = 0;
+        for (int i = 0; i < kSamples; ++i) {
+            const Point &a = seeds[labels[size_t(sy[i]) * width + sx[i]]], &b = seeds[truth[i]];
+            wrong += distance2(sx[i], sy[i], a.x, a.y) != distance2(sx[i], sy[i], b.x, b.y);
+        }
+        std::cout << name << ": " << elapsed << " ms, x" << bruteMs / elapsed << ", 抽样错误率 "
+                  << 100.0 * wrong / kSamples << "%" << std::endl;
+        return wrong;
+    };
+
+    t0 = Clock::now();
+    Labels grid = voronoiGrid(width, height, seeds, threads);
+    int gridWrong = report("网格索引", grid, ms(t0));
+
+    t0 = Clock::now();
+    Labels jfa = voronoiJFA(width, height, seeds, threads);
+    report("JFA", jfa, ms(t0));
+
+    // 网格是精确的：整图再与 JFA 对照一下差异比例
+    size_t differ = 0;
+    for (size_t i = 0; i < grid.size(); ++i) {
+        if (grid[i] == jfa[i]) continue;
+        int x = int(i % width), y = int(i / width);
+        const Point &a = seeds[grid[i]], &b = seeds[jfa[i]];
+        differ += distance2(x, y, a.x, a.y) != distance2(x, y, b.x, b.y);
+    }
+    std::cout << "JFA 与网格结果不同的像素: " << 100.0 * differ / grid.size() << "%" << std::endl;
+    return gridWrong == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    int WIDTH = 800;
+    int HEIGHT = 600;
+    int SEED_COUNT = 50;
+    std::string engine = "grid";
+    int threads = defaultThreads();
+    bool bench = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--engine" && i + 1 < argc) engine = argv[++i];
+        else if (arg == "--seeds" && i + 1 < argc) SEED_COUNT = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--size" && i + 2 < argc) {
+            WIDTH = std::max(1, std::atoi(argv[++i]));
+            HEIGHT = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--threads" && i + 1 < argc) threads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--bench") bench = true;
+        else {
+            std::cerr << "用法: " << argv[0]
+                      << " [--engine brute|jfa|grid] [--seeds N] [--size W H] [--threads N] [--bench]" << std::endl;
+            return 1;
+        }
+    }
+    if (engine != "brute" && engine != "jfa" && engine != "grid") {
+        std::cerr << "未知引擎: " << engine << std::endl;
+        return 1;
+    }
+    if (bench) return runBenchmark(WIDTH, HEIGHT, SEED_COUNT, threads);
     
     std::cout << "生成Voronoi图..." << std::endl;
     std::cout << "图像尺寸: " << WIDTH << "x" << HEIGHT << std::endl;
     std::cout << "种子点数量: " << SEED_COUNT << std::endl;
     
     // 分配图像内存
-    std::vector<unsigned char> image(WIDTH * HEIGHT * 3);
+    std::vector<unsigned char> image(size_t(WIDTH) * HEIGHT * 3);
     
     // 生成种子点
     auto seeds = generateSeeds(SEED_COUNT, WIDTH, HEIGHT);
     std::cout << "种子点生成完成" << std::endl;
     
     // 生成Voronoi图
-    generateVoronoi(image.data(), WIDTH, HEIGHT, seeds);
-    std::cout << "Voronoi图计算完成" << std::endl;
+    auto t0 = std::chrono::steady_clock::now();
+    if (engine == "brute") {
+        generateVoronoi(image.data(), WIDTH, HEIGHT, seeds);
+    } else {
+        Labels labels = engine == "jfa" ? voronoiJFA(WIDTH, HEIGHT, seeds, threads)
+                                        : voronoiGrid(WIDTH, HEIGHT, seeds, threads);
+        colorize(image.data(), labels, seeds);
+    }
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "Voronoi图计算完成 (" << engine << ", " << elapsed << " ms)" << std::endl;
     
     // 绘制种子点
     drawSeeds(image.data(), WIDTH, HEIGHT, seeds);
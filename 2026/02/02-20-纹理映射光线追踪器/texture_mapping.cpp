@@ -1,11 +1,15 @@
 // 纹理映射光线追踪器
 // 功能: 球面UV映射 + 棋盘格纹理采样
+//       图像纹理：Morton 顺序存储 + mipmap + 光线微分选择 LOD（1 spp 抗锯齿）
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 #include <cmath>
 #include <vector>
 #include <algorithm>
 #include <iostream>
+#include <cstdint>
+#include <string>
+#include <chrono>
 
 struct Vec3 {
     double x, y, z;
@@ -14,6 +18,7 @@ struct Vec3 {
     Vec3 operator-(const Vec3& v) const { return Vec3(x-v.x, y-v.y, z-v.z); }
     Vec3 operator*(double s) const { return Vec3(x*s, y*s, z*s); }
     double dot(const Vec3& v) const { return x*v.x + y*v.y + z*v.z; }
+    double length() const { return sqrt(x*x + y*y + z*z); }
     Vec3 normalize() const {
         double len = sqrt(x*x + y*y + z*z);
         return (len > 0) ? Vec3(x/len, y/len, z/len) : Vec3(0,0,0);
@@ -48,11 +53,142 @@ Vec3 checkerboardTexture(const UV& uv, int scale = 10) {
     return isEven ? Vec3(0.9, 0.9, 0.9) : Vec3(0.2, 0.2, 0.8);
 }
 
+// ==================== 图像纹理 ====================
+// 纹素按 Morton（Z 序）排列：相邻的 (x, y) 在内存中也相邻，
+// 双线性取的 2×2 纹素和相邻像素的足迹大多落在同一条缓存行里。
+// 每一级 mipmap 由上一级 2×2 盒式滤波得到。
+// 寻址方式按轴单独设置：球面的 u 绕一圈回到起点（重复），v 从北极到南极（夹取）
+
+// 把 16 位整数的各位隔位展开：b15..b0 → 0 b15 0 b14 ... 0 b0
+inline uint32_t spreadBits(uint32_t v) {
+    v &= 0xFFFF;
+    v = (v | (v << 8)) & 0x00FF00FF;
+    v = (v | (v << 4)) & 0x0F0F0F0F;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+}
+
+inline uint32_t mortonIndex(uint32_t x, uint32_t y) {
+    return spreadBits(x) | (spreadBits(y) << 1);
+}
+
+class ImageTexture {
+public:
+    struct Texel { float r, g, b; };
+    enum class Wrap { Repeat, Clamp };
+
+    // 以 fn(UV) 在每个纹素中心求值生成 size×size 的纹理（size 为 2 的幂）
+    template <typename Fn>
+    static ImageTexture fromFunction(int size, const Fn& fn, Wrap wrapU = Wrap::Repeat, Wrap wrapV = Wrap::Repeat) {
+        ImageTexture tex;
+        tex.wrapU = wrapU;
+        tex.wrapV = wrapV;
+        Level base{size, std::vector<Texel>(size_t(size) * size)};
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                Vec3 c = fn(UV((x + 0.5) / size, (y + 0.5) / size));
+                base.texels[mortonIndex(x, y)] = {float(c.x), float(c.y), float(c.z)};
+            }
+        }
+        tex.levels.push_back(std::move(base));
+
+        while (tex.levels.back().size > 1) {
+            const Level& src = tex.levels.back();
+            int n = src.size / 2;
+            Level dst{n, std::vector<Texel>(size_t(n) * n)};
+            for (int y = 0; y < n; y++) {
+                for (int x = 0; x < n; x++) {
+                    // Morton 顺序下 2×2 子块的 4 个纹素正好连续
+                    const Texel* q = &src.texels[mortonIndex(2 * x, 2 * y)];
+                    dst.texels[mortonIndex(x, y)] = {
+                        0.25f * (q[0].r + q[1].r + q[2].r + q[3].r),
+                        0.25f * (q[0].g + q[1].g + q[2].g + q[3].g),
+                        0.25f * (q[0].b + q[1].b + q[2].b + q[3].b)};
+                }
+            }
+            tex.levels.push_back(std::move(dst));
+        }
+        return tex;
+    }
+
+    int size() const { return levels.empty() ? 0 : levels[0].size; }
+    int levelCount() const { return static_cast<int>(levels.size()); }
+
+    // 三线性采样：lod = log2(足迹覆盖的 0 级纹素数)
+    Vec3 sample(const UV& uv, double lod) const {
+        lod = std::max(0.0, std::min(double(levelCount() - 1), lod));
+        int l0 = static_cast<int>(lod);
+        int l1 = std::min(l0 + 1, levelCount() - 1);
+        double w = lod - l0;
+        Vec3 a = bilinear(levels[l0], uv);
+        if (w == 0.0) return a;
+        return a * (1.0 - w) + bilinear(levels[l1], uv) * w;
+    }
+
+    // n 为 2 的幂：重复用按位与（负数同样适用），夹取限制在 [0, n-1]
+    static uint32_t address(int i, int n, Wrap wrap) {
+        if (wrap == Wrap::Repeat) return static_cast<uint32_t>(i & (n - 1));
+        return static_cast<uint32_t>(std::max(0, std::min(n - 1, i)));
+    }
+
+private:
+    struct Level {
+        int size;
+        std::vector<Texel> texels;  // Morton 顺序
+    };
+    std::vector<Level> levels;
+    Wrap wrapU = Wrap::Repeat, wrapV = Wrap::Repeat;
+
+    Vec3 bilinear(const Level& level, const UV& uv) const {
+        int n = level.size;
+        double fx = uv.u * n - 0.5, fy = uv.v * n - 0.5;
+        double x0 = floor(fx), y0 = floor(fy);
+        double wx = fx - x0, wy = fy - y0;
+        int ix = static_cast<int>(x0), iy = static_cast<int>(y0);
+        uint32_t xa = address(ix, n, wrapU), xb = address(ix + 1, n, wrapU);
+        uint32_t ya = address(iy, n, wrapV), yb = address(iy + 1, n, wrapV);
+        const Texel& t00 = level.texels[mortonIndex(xa, ya)];
+        const Texel& t10 = level.texels[mortonIndex(xb, ya)];
+        const Texel& t01 = level.texels[mortonIndex(xa, yb)];
+        const Texel& t11 = level.texels[mortonIndex(xb, yb)];
+        double w00 = (1 - wx) * (1 - wy), w10 = wx * (1 - wy), w01 = (1 - wx) * wy, w11 = wx * wy;
+        return Vec3(t00.r * w00 + t10.r * w10 + t01.r * w01 + t11.r * w11,
+                    t00.g * w00 + t10.g * w10 + t01.g * w01 + t11.g * w11,
+                    t00.b * w00 + t10.b * w10 + t01.b * w01 + t11.b * w11);
+    }
+};
+
+// ==================== 光线微分 ====================
+// 相邻像素光线方向对屏幕 x / y 的偏导（针孔相机的原点微分为 0）。
+// 在交点处把微分光线转移到切平面上，得到交点位置的偏导 dP/dx、dP/dy（Igehy 1999）
+struct RayDifferential {
+    Vec3 dDdx, dDdy;
+};
+
+// 交点沿切平面的位置微分
+inline void transferDifferential(const Ray& ray, const RayDifferential& rd, double t, const Vec3& normal,
+                                 Vec3& dPdx, Vec3& dPdy) {
+    double dn = ray.direction.dot(normal);
+    if (std::abs(dn) < 1e-8) dn = dn < 0 ? -1e-8 : 1e-8;
+    Vec3 px = rd.dDdx * t, py = rd.dDdy * t;
+    dPdx = px - ray.direction * (px.dot(normal) / dn);
+    dPdy = py - ray.direction * (py.dot(normal) / dn);
+}
+
+// 球面 UV 对单位球面上点的偏导：du = (x·dz − z·dx) / (2π(x² + z²))，dv = −dy / (π·√(1 − y²))
+inline UV sphereUVDifferential(const Vec3& p, const Vec3& dp) {
+    double rxz = std::max(1e-8, p.x * p.x + p.z * p.z);
+    double cosLat = std::max(1e-4, sqrt(std::max(0.0, 1.0 - p.y * p.y)));
+    return UV((p.x * dp.z - p.z * dp.x) / (2 * M_PI * rxz), -dp.y / (M_PI * cosLat));
+}
+
 struct Sphere {
     Vec3 center;
     double radius;
     Vec3 color;
     bool hasTexture;
+    const ImageTexture* texture = nullptr;  // 为空时直接点采样程序化棋盘格
     
     Sphere(const Vec3& c, double r, const Vec3& col, bool tex = false)
         : center(c), radius(r), color(col), hasTexture(tex) {}
@@ -86,13 +222,33 @@ struct Sphere {
         UV uv = sphereUV(localPoint);
         return checkerboardTexture(uv, 10);
     }
+
+    // 带足迹的取色：dPdx / dPdy 为交点位置对屏幕的偏导，用来选择 mip 级别
+    Vec3 getColor(const Vec3& point, const Vec3& dPdx, const Vec3& dPdy) const {
+        if (!hasTexture) return color;
+        if (!texture) return getColor(point);
+
+        Vec3 localPoint = (point - center) * (1.0 / radius);
+        UV uv = sphereUV(localPoint);
+        Vec3 p = localPoint.normalize();
+        UV dx = sphereUVDifferential(p, dPdx * (1.0 / radius));
+        UV dy = sphereUVDifferential(p, dPdy * (1.0 / radius));
+
+        // 足迹取两个方向中较长的一边（与 GPU 的各向同性过滤一致）
+        double footprint = std::max(sqrt(dx.u * dx.u + dx.v * dx.v), sqrt(dy.u * dy.u + dy.v * dy.v));
+        double texels = footprint * texture->size();
+        double lod = texels > 1.0 ? log2(texels) : 0.0;
+        return texture->sample(uv, lod);
+    }
 };
 
 struct Scene {
     std::vector<Sphere> spheres;
     Vec3 lightPos;
     
-    Scene() {
+    ImageTexture checker;  // 烘焙后的棋盘格图像纹理
+    
+    explicit Scene(bool useImageTexture = true) {
         lightPos = Vec3(5, 5, -5);
         
         // 中心大球 - 带纹理
@@ -106,7 +262,18 @@ struct Scene {
         
         // 地面大球 - 带纹理（模拟平面）
         spheres.push_back(Sphere(Vec3(0, -1001, 0), 1000, Vec3(0,0,0), true));
+
+        if (useImageTexture) {
+            checker = ImageTexture::fromFunction(1024, [](const UV& uv) { return checkerboardTexture(uv, 10); },
+                                                 ImageTexture::Wrap::Repeat, ImageTexture::Wrap::Clamp);
+            for (auto& sphere : spheres) {
+                if (sphere.hasTexture) sphere.texture = &checker;
+            }
+        }
     }
+
+    Scene(const Scene&) = delete;  // 球体持有指向 checker 的指针
+    Scene& operator=(const Scene&) = delete;
     
     bool trace(const Ray& ray, int& hitIdx, double& hitT) const {
         hitIdx = -1;
@@ -146,7 +313,8 @@ struct Scene {
     }
 };
 
-Vec3 render(const Ray& ray, const Scene& scene, int depth = 0) {
+// rd 为主光线的光线微分；为空时点采样纹理
+Vec3 render(const Ray& ray, const Scene& scene, int depth = 0, const RayDifferential* rd = nullptr) {
     if (depth > 3) return Vec3(0, 0, 0);
     
     int hitIdx;
@@ -163,17 +331,45 @@ Vec3 render(const Ray& ray, const Scene& scene, int depth = 0) {
     const Sphere& sphere = scene.spheres[hitIdx];
     Vec3 hitPoint = ray.origin + ray.direction * hitT;
     Vec3 normal = sphere.normal(hitPoint);
-    Vec3 color = sphere.getColor(hitPoint);
+    Vec3 color;
+    if (rd) {
+        Vec3 dPdx, dPdy;
+        transferDifferential(ray, *rd, hitT, normal, dPdx, dPdy);
+        color = sphere.getColor(hitPoint, dPdx, dPdy);
+    } else {
+        color = sphere.getColor(hitPoint);
+    }
     
     return scene.shade(hitPoint, normal, color);
 }
 
-int main() {
+// 归一化方向 d = w / |w| 的微分：dd = (dw − d (d·dw)) / |w|
+Vec3 normalizedDifferential(const Vec3& w, const Vec3& dw) {
+    double len = w.length();
+    Vec3 d = w * (1.0 / len);
+    return (dw - d * d.dot(dw)) * (1.0 / len);
+}
+
+int main(int argc, char** argv) {
+    // --point：关闭图像纹理，回到程序化棋盘格点采样；--spp N：每像素 N×N 抖动超采样（对照用）
+    bool useMip = true;
+    int sppAxis = 1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--point") useMip = false;
+        else if (arg == "--spp" && i + 1 < argc) sppAxis = std::max(1, static_cast<int>(sqrt(atoi(argv[++i]))));
+        else {
+            std::cerr << "用法: " << argv[0] << " [--point] [--spp N]" << std::endl;
+            return 1;
+        }
+    }
+
     const int width = 800;
     const int height = 600;
     std::vector<unsigned char> image(width * height * 3);
     
-    Scene scene;
+    auto start = std::chrono::steady_clock::now();
+    Scene scene(useMip);
     Vec3 cameraPos(0, 2, -8);
     Vec3 cameraTarget(0, 0, 0);
     Vec3 cameraUp(0, 1, 0);
@@ -191,22 +387,46 @@ int main() {
     
     std::cout << "开始渲染 " << width << "x" << height << " ..." << std::endl;
     
+    double tanHalf = tan(fov/2);
+    // 屏幕坐标 (sx, sy)（像素为单位）对应的未归一化光线方向
+    auto rayDirection = [&](double sx, double sy) {
+        double px = (2.0 * sx / width - 1.0) * tanHalf * aspectRatio;
+        double py = (1.0 - 2.0 * sy / height) * tanHalf;
+        
+        // ✅ 修复：up向量指向下方（-Y），需要翻转py
+        py = -py;
+        
+        return forward + right * px + up * py;
+    };
+    // 方向对屏幕 x / y 移动一个像素的偏导（未归一化）
+    Vec3 dWdx = right * (2.0 * tanHalf * aspectRatio / width);
+    Vec3 dWdy = up * (2.0 * tanHalf / height);
+    
     for (int y = 0; y < height; y++) {
         if (y % 100 == 0) {
             std::cout << "进度: " << (100*y/height) << "%" << std::endl;
         }
         
         for (int x = 0; x < width; x++) {
-            double px = (2.0 * (x + 0.5) / width - 1.0) * tan(fov/2) * aspectRatio;
-            double py = (1.0 - 2.0 * (y + 0.5) / height) * tan(fov/2);
-            
-            // ✅ 修复：up向量指向下方（-Y），需要翻转py
-            py = -py;
-            
-            Vec3 rayDir = (forward + right * px + up * py).normalize();
-            Ray ray(cameraPos, rayDir);
-            
-            Vec3 color = render(ray, scene);
+            Vec3 color(0, 0, 0);
+            for (int sy = 0; sy < sppAxis; sy++) {
+                for (int sx = 0; sx < sppAxis; sx++) {
+                    // 单采样时取像素中心；超采样时在子格内按固定哈希抖动
+                    double jx = 0.5, jy = 0.5;
+                    if (sppAxis > 1) {
+                        uint32_t h = mortonIndex(x, y) * 2654435761u + (sy * sppAxis + sx) * 40503u;
+                        jx = (sx + ((h >> 8) & 0xFF) / 256.0) / sppAxis;
+                        jy = (sy + ((h >> 16) & 0xFF) / 256.0) / sppAxis;
+                    }
+                    Vec3 w = rayDirection(x + jx, y + jy);
+                    Ray ray(cameraPos, w);
+                    // 超采样时每个子样本只覆盖 1/sppAxis 个像素
+                    RayDifferential rd{normalizedDifferential(w, dWdx * (1.0 / sppAxis)),
+                                       normalizedDifferential(w, dWdy * (1.0 / sppAxis))};
+                    color = color + render(ray, scene, 0, useMip ? &rd : nullptr);
+                }
+            }
+            color = color * (1.0 / (sppAxis * sppAxis));
             
             int idx = (y * width + x) * 3;
             image[idx + 0] = static_cast<unsigned char>(std::min(255.0, color.x * 255));
@@ -215,6 +435,10 @@ int main() {
         }
     }
     
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "纹理: " << (useMip ? "mipmap + 光线微分" : "点采样") << "，"
+              << sppAxis * sppAxis << " spp，耗时 " << ms << " ms" << std::endl;
+    
     std::cout << "渲染完成，保存图片..." << std::endl;
     stbi_write_png("texture_output.png", width, height, 3, image.data(), width * 3);
     std::cout << "✅ 图片已保存: texture_output.png" << std::endl;
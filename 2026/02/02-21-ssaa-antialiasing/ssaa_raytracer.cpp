@@ -4,6 +4,9 @@
 #include <cmath>
 #include <algorithm>
 #include <random>
+#include <string>
+#include <chrono>
+#include <cstring>
 
 // 向量结构
 struct Vec3 {
@@ -84,8 +87,14 @@ struct Light {
 std::vector<Sphere> scene;
 std::vector<Light> lights;
 
+// 主光线命中信息，供自适应模式做边缘检测
+struct HitInfo {
+    double depth = 1e10;  // 主光线命中距离（未命中为 1e10）
+    int id = -1;          // 命中球体在 scene 中的下标（背景为 -1）
+};
+
 // 递归光线追踪（支持反射）
-Vec3 trace(const Ray& ray, int depth = 0) {
+Vec3 trace(const Ray& ray, int depth = 0, HitInfo* info = nullptr) {
     if (depth > 3) return Vec3(0.1, 0.1, 0.15);  // 背景色
     
     double closest_t = 1e10;
@@ -105,6 +114,11 @@ Vec3 trace(const Ray& ray, int depth = 0) {
         return Vec3(0.1, 0.1, 0.15);
     }
     
+    if (info) {
+        info->depth = closest_t;
+        info->id = int(hit_sphere - scene.data());
+    }
+    
     // 计算交点和法线
     Vec3 hit_point = ray.origin + ray.direction * closest_t;
     Vec3 normal = (hit_point - hit_sphere->center).normalize();
@@ -156,76 +170,207 @@ int to_int(double x) {
     return std::min(255, std::max(0, int(x * 255)));
 }
 
-int main() {
-    // 图像设置
-    const int render_width = 1600;   // 渲染分辨率（4倍）
-    const int render_height = 1200;
-    const int output_width = 800;    // 输出分辨率
-    const int output_height = 600;
-    const int samples_per_pixel = 4; // SSAA 2x2 (每个像素采样4次)
-    
-    // 场景设置
-    scene.push_back(Sphere(Vec3(0, 0, -5), 1.0, Vec3(0.8, 0.3, 0.3), 0.5));     // 红色镜面球
-    scene.push_back(Sphere(Vec3(-2, 0, -6), 1.0, Vec3(0.3, 0.8, 0.3), 0.3));    // 绿色半镜面球
-    scene.push_back(Sphere(Vec3(2, 0, -4), 0.8, Vec3(0.3, 0.3, 0.8), 0.7));     // 蓝色高反射球
-    scene.push_back(Sphere(Vec3(0, -1001, 0), 1000, Vec3(0.6, 0.6, 0.6), 0.1)); // 地面
-    
-    // 光源
-    lights.push_back(Light(Vec3(5, 5, -2), Vec3(1, 1, 1), 1.0));
-    lights.push_back(Light(Vec3(-5, 3, -3), Vec3(0.7, 0.7, 1.0), 0.6));
-    
-    // 相机设置
-    Vec3 camera_pos(0, 0, 0);
-    double aspect_ratio = double(output_width) / output_height;
-    double viewport_height = 2.0;
-    double viewport_width = viewport_height * aspect_ratio;
-    double focal_length = 1.0;
+// ============================================================
+// 相机与三种渲染模式
+// ============================================================
+
+const int output_width = 800;    // 输出分辨率
+const int output_height = 600;
+const int ssaa_factor = 2;       // SSAA 2x2 (每个像素采样4次)
+
+struct Camera {
+    Vec3 position;
+    double viewport_width, viewport_height, focal_length;
     
-    // 渲染到高分辨率缓冲区
+    // (px, py) 为输出分辨率下的连续像素坐标
+    Ray generate(double px, double py) const {
+        double x = (px / output_width - 0.5) * viewport_width;
+        double y = (0.5 - py / output_height) * viewport_height;
+        return Ray(position, Vec3(x, y, -focal_length));
+    }
+};
+
+// 与原始 1600x1200 缓冲区完全相同的 2x2 子采样位置求平均
+Vec3 supersample_pixel(const Camera& camera, int i, int j) {
+    Vec3 sum(0, 0, 0);
+    for (int dy = 0; dy < ssaa_factor; dy++) {
+        for (int dx = 0; dx < ssaa_factor; dx++) {
+            double px = i + (dx + 0.5) / ssaa_factor;
+            double py = j + (dy + 0.5) / ssaa_factor;
+            sum = sum + trace(camera.generate(px, py));
+        }
+    }
+    return sum / double(ssaa_factor * ssaa_factor);
+}
+
+// 原始路径：整幅渲染到高分辨率缓冲区再下采样
+void render_full(const Camera& camera, std::vector<Vec3>& output_buffer, long long& rays) {
+    const int render_width = output_width * ssaa_factor;
+    const int render_height = output_height * ssaa_factor;
     std::vector<Vec3> render_buffer(render_width * render_height);
     
-    std::cout << "渲染中 (SSAA 2x2, " << render_width << "x" << render_height 
-              << " -> " << output_width << "x" << output_height << ")..." << std::endl;
-    
     for (int j = 0; j < render_height; j++) {
-        if (j % 100 == 0) {
-            std::cout << "进度: " << (100 * j / render_height) << "%" << std::endl;
-        }
         for (int i = 0; i < render_width; i++) {
-            double u = (i + 0.5) / render_width;
-            double v = (j + 0.5) / render_height;
-            
-            double x = (u - 0.5) * viewport_width;
-            double y = (0.5 - v) * viewport_height;
-            
-            Vec3 direction = Vec3(x, y, -focal_length);
-            Ray ray(camera_pos, direction);
-            
-            render_buffer[j * render_width + i] = trace(ray);
+            double px = (i + 0.5) / ssaa_factor;
+            double py = (j + 0.5) / ssaa_factor;
+            render_buffer[j * render_width + i] = trace(camera.generate(px, py));
         }
     }
-    
-    std::cout << "下采样中..." << std::endl;
+    rays += (long long)render_width * render_height;
     
     // 下采样到输出分辨率（2x2 box filter）
-    std::vector<Vec3> output_buffer(output_width * output_height);
-    
     for (int j = 0; j < output_height; j++) {
         for (int i = 0; i < output_width; i++) {
             Vec3 sum(0, 0, 0);
-            
-            // 采样2x2区域
-            for (int dy = 0; dy < 2; dy++) {
-                for (int dx = 0; dx < 2; dx++) {
-                    int x = i * 2 + dx;
-                    int y = j * 2 + dy;
+            for (int dy = 0; dy < ssaa_factor; dy++) {
+                for (int dx = 0; dx < ssaa_factor; dx++) {
+                    int x = i * ssaa_factor + dx;
+                    int y = j * ssaa_factor + dy;
                     sum = sum + render_buffer[y * render_width + x];
                 }
             }
+            output_buffer[j * output_width + i] = sum / double(ssaa_factor * ssaa_factor);
+        }
+    }
+}
+
+// 流式分块：每个 tile 渲染完立即下采样，只需一个 tile 大小的高分辨率缓冲
+void render_tiled(const Camera& camera, std::vector<Vec3>& output_buffer, long long& rays) {
+    const int tile = 32;  // 输出像素为单位
+    const int tile_res = tile * ssaa_factor;
+    std::vector<Vec3> tile_buffer(tile_res * tile_res);
+    
+    for (int ty = 0; ty < output_height; ty += tile) {
+        for (int tx = 0; tx < output_width; tx += tile) {
+            int tw = std::min(tile, output_width - tx);
+            int th = std::min(tile, output_height - ty);
+            
+            for (int j = 0; j < th * ssaa_factor; j++) {
+                for (int i = 0; i < tw * ssaa_factor; i++) {
+                    double px = tx + (i + 0.5) / ssaa_factor;
+                    double py = ty + (j + 0.5) / ssaa_factor;
+                    tile_buffer[j * tile_res + i] = trace(camera.generate(px, py));
+                }
+            }
+            rays += (long long)tw * th * ssaa_factor * ssaa_factor;
             
-            output_buffer[j * output_width + i] = sum / 4.0;
+            for (int j = 0; j < th; j++) {
+                for (int i = 0; i < tw; i++) {
+                    Vec3 sum(0, 0, 0);
+                    for (int dy = 0; dy < ssaa_factor; dy++)
+                        for (int dx = 0; dx < ssaa_factor; dx++)
+                            sum = sum + tile_buffer[(j * ssaa_factor + dy) * tile_res + i * ssaa_factor + dx];
+                    output_buffer[(ty + j) * output_width + tx + i] = sum / double(ssaa_factor * ssaa_factor);
+                }
+            }
+        }
+    }
+}
+
+// 两个 1spp 样本之间是否存在需要超采样的不连续
+bool is_discontinuous(const Vec3& ca, const HitInfo& ha, const Vec3& cb, const HitInfo& hb) {
+    const double color_threshold = 0.04;   // 任一通道差（线性 [0,1]）
+    const double depth_threshold = 0.05;   // 相对深度差
+    if (ha.id != hb.id) return true;
+    if (ha.id >= 0 && std::abs(ha.depth - hb.depth) > depth_threshold * std::min(ha.depth, hb.depth)) return true;
+    return std::abs(ca.x - cb.x) > color_threshold ||
+           std::abs(ca.y - cb.y) > color_threshold ||
+           std::abs(ca.z - cb.z) > color_threshold;
+}
+
+// 自适应：先 1spp 于像素中心，只对颜色/深度/物体 ID 存在不连续的像素补 2x2 采样
+void render_adaptive(const Camera& camera, std::vector<Vec3>& output_buffer, long long& rays,
+                     int& refined_pixels) {
+    std::vector<HitInfo> hits(output_width * output_height);
+    for (int j = 0; j < output_height; j++) {
+        for (int i = 0; i < output_width; i++) {
+            int idx = j * output_width + i;
+            output_buffer[idx] = trace(camera.generate(i + 0.5, j + 0.5), 0, &hits[idx]);
+        }
+    }
+    rays += (long long)output_width * output_height;
+    
+    // 与右、下邻居比较，不连续时两侧像素都标记
+    std::vector<unsigned char> refine(output_width * output_height, 0);
+    for (int j = 0; j < output_height; j++) {
+        for (int i = 0; i < output_width; i++) {
+            int idx = j * output_width + i;
+            if (i + 1 < output_width &&
+                is_discontinuous(output_buffer[idx], hits[idx], output_buffer[idx + 1], hits[idx + 1])) {
+                refine[idx] = refine[idx + 1] = 1;
+            }
+            if (j + 1 < output_height &&
+                is_discontinuous(output_buffer[idx], hits[idx],
+                                 output_buffer[idx + output_width], hits[idx + output_width])) {
+                refine[idx] = refine[idx + output_width] = 1;
+            }
+        }
+    }
+    
+    refined_pixels = 0;
+    for (int j = 0; j < output_height; j++) {
+        for (int i = 0; i < output_width; i++) {
+            int idx = j * output_width + i;
+            if (!refine[idx]) continue;
+            output_buffer[idx] = supersample_pixel(camera, i, j);
+            refined_pixels++;
         }
     }
+    rays += (long long)refined_pixels * ssaa_factor * ssaa_factor;
+}
+
+int main(int argc, char** argv) {
+    enum class Mode { Full, Tiled, Adaptive } mode = Mode::Adaptive;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--full") == 0) mode = Mode::Full;
+        else if (std::strcmp(argv[i], "--tiled") == 0) mode = Mode::Tiled;
+        else if (std::strcmp(argv[i], "--adaptive") == 0) mode = Mode::Adaptive;
+        else {
+            std::cerr << "用法: " << argv[0] << " [--full | --tiled | --adaptive]" << std::endl;
+            return 1;
+        }
+    }
+    
+    // 场景设置
+    scene.push_back(Sphere(Vec3(0, 0, -5), 1.0, Vec3(0.8, 0.3, 0.3), 0.5));     // 红色镜面球
+    scene.push_back(Sphere(Vec3(-2, 0, -6), 1.0, Vec3(0.3, 0.8, 0.3), 0.3));    // 绿色半镜面球
+    scene.push_back(Sphere(Vec3(2, 0, -4), 0.8, Vec3(0.3, 0.3, 0.8), 0.7));     // 蓝色高反射球
+    scene.push_back(Sphere(Vec3(0, -1001, 0), 1000, Vec3(0.6, 0.6, 0.6), 0.1)); // 地面
+    
+    // 光源
+    lights.push_back(Light(Vec3(5, 5, -2), Vec3(1, 1, 1), 1.0));
+    lights.push_back(Light(Vec3(-5, 3, -3), Vec3(0.7, 0.7, 1.0), 0.6));
+    
+    // 相机设置
+    double aspect_ratio = double(output_width) / output_height;
+    Camera camera;
+    camera.position = Vec3(0, 0, 0);
+    camera.viewport_height = 2.0;
+    camera.viewport_width = camera.viewport_height * aspect_ratio;
+    camera.focal_length = 1.0;
+    
+    std::vector<Vec3> output_buffer(output_width * output_height);
+    long long rays = 0;
+    auto start = std::chrono::steady_clock::now();
+    
+    if (mode == Mode::Full) {
+        std::cout << "渲染中 (SSAA 2x2 全缓冲, " << output_width * ssaa_factor << "x" << output_height * ssaa_factor
+                  << " -> " << output_width << "x" << output_height << ")..." << std::endl;
+        render_full(camera, output_buffer, rays);
+    } else if (mode == Mode::Tiled) {
+        std::cout << "渲染中 (SSAA 2x2 流式分块, " << output_width << "x" << output_height << ")..." << std::endl;
+        render_tiled(camera, output_buffer, rays);
+    } else {
+        std::cout << "渲染中 (自适应 SSAA 2x2, " << output_width << "x" << output_height << ")..." << std::endl;
+        int refined = 0;
+        render_adaptive(camera, output_buffer, rays, refined);
+        std::cout << "超采样像素: " << refined << " / " << output_width * output_height
+                  << " (" << 100.0 * refined / (output_width * output_height) << "%)" << std::endl;
+    }
+    
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "渲染耗时: " << ms << " ms, 主光线: " << rays
+              << " (" << double(rays) / (output_width * output_height) << " /像素)" << std::endl;
     
     // 写入PNG文件
     std::cout << "保存图片..." << std::endl;
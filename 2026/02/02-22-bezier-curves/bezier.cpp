@@ -4,12 +4,21 @@
 #include <cmath>
 #include <algorithm>
 #include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <random>
+#include <cassert>
 
 struct Vec2 {
     double x, y;
     Vec2(double x = 0, double y = 0) : x(x), y(y) {}
     Vec2 operator+(const Vec2& v) const { return Vec2(x + v.x, y + v.y); }
+    Vec2 operator-(const Vec2& v) const { return Vec2(x - v.x, y - v.y); }
     Vec2 operator*(double s) const { return Vec2(x * s, y * s); }
+    Vec2& operator+=(const Vec2& v) { x += v.x; y += v.y; return *this; }
+    double length() const { return std::sqrt(x * x + y * y); }
 };
 
 // De Casteljau 递归算法
@@ -26,6 +35,120 @@ Vec2 deCasteljau(const std::vector<Vec2>& points, double t) {
     return temp[0];
 }
 
+// ============================================================
+// 曲线引擎：定长控制点 + 前向差分求值 + 按误差上界自适应分段
+// ============================================================
+
+// 最多 8 个控制点（7 阶），控制点存在对象内部，求值时不分配；字体/矢量图形只用 2、3 阶
+constexpr int kMaxBezierPoints = 8;
+// 自适应分段时折线与曲线的默认最大距离（像素）
+constexpr double kDefaultTolerance = 0.25;
+// 单条曲线的分段上限，防止退化输入（极大坐标）把时间耗在一条曲线上
+constexpr int kMaxSegments = 4096;
+
+// 控制点数必须在 [1, kMaxBezierPoints] 内：没有默认构造（空曲线会让求值读到 p[-1]），
+// 超过上限的曲线不能截断成另一条曲线，由调用方先用 fits() 判断，不合适的改走 deCasteljau
+// （见 Canvas::drawBezier）。违反约定时调试版断言；发布版把点数夹到 [1, kMaxBezierPoints]，
+// 曲线虽然不对，但不会越界写 p[]
+struct Bezier {
+    Vec2 p[kMaxBezierPoints];
+    int count;  // 控制点数 = 阶数 + 1
+
+    static bool fits(const std::vector<Vec2>& points) {
+        return !points.empty() && points.size() <= (size_t)kMaxBezierPoints;
+    }
+
+    explicit Bezier(const std::vector<Vec2>& points)
+        : count((int)std::min(points.size(), (size_t)kMaxBezierPoints)) {
+        assert(fits(points));
+        for (int i = 0; i < count; i++) p[i] = points[i];
+        if (count == 0) count = 1;  // p[0] 为默认的原点，退化成一个点
+    }
+    Bezier(Vec2 a, Vec2 b, Vec2 c) : count(3) { p[0] = a; p[1] = b; p[2] = c; }
+    Bezier(Vec2 a, Vec2 b, Vec2 c, Vec2 d) : count(4) { p[0] = a; p[1] = b; p[2] = c; p[3] = d; }
+};
+
+// 栈上的 De Casteljau，用于构造差分表和误差检查
+Vec2 evalBezier(const Bezier& c, double t) {
+    Vec2 temp[kMaxBezierPoints];
+    for (int i = 0; i < c.count; i++) temp[i] = c.p[i];
+    for (int k = 1; k < c.count; k++) {
+        for (int i = 0; i < c.count - k; i++) {
+            temp[i] = temp[i] * (1 - t) + temp[i + 1] * t;
+        }
+    }
+    return temp[0];
+}
+
+// Wang 公式：n 阶曲线按参数均匀分成 N 段时，折线与曲线的最大距离不超过
+//   n(n-1)/8 · max|P[i+2] - 2P[i+1] + P[i]| / N²
+// 由此直接得到满足误差 tolerance 的最少段数：屏幕上短的曲线段少，长而弯的曲线段多
+int flattenSegments(const Bezier& c, double tolerance) {
+    int n = c.count - 1;
+    if (n <= 1) return 1;
+    double m = 0;
+    for (int i = 0; i + 2 < c.count; i++) {
+        m = std::max(m, (c.p[i + 2] - c.p[i + 1] * 2 + c.p[i]).length());
+    }
+    double segments = std::ceil(std::sqrt(n * (n - 1) * m / (8 * tolerance)));
+    return (int)std::min<double>(std::max(segments, 1.0), kMaxSegments);
+}
+
+// 前向差分：n 阶多项式在等距参数上的 n 阶差分是常数。
+// 先用 n+1 个起始采样建差分表，之后每前进一步只做 n 次向量加法，没有乘法也不分配
+class ForwardDifferencer {
+public:
+    ForwardDifferencer(const Bezier& c, int segments) : order(c.count - 1), remaining(segments), last(c.p[c.count - 1]) {
+        double h = 1.0 / segments;
+        for (int k = 0; k <= order; k++) d[k] = evalBezier(c, std::min(1.0, k * h));
+        // 原地把采样值变成 Δ^k f(0)
+        for (int level = 1; level <= order; level++) {
+            for (int k = order; k >= level; k--) d[k] = d[k] - d[k - 1];
+        }
+    }
+
+    Vec2 current() const { return d[0]; }
+
+    // 前进一步；最后一步直接落在终点，消除累加误差
+    void step() {
+        if (--remaining == 0) { d[0] = last; return; }
+        for (int k = 0; k < order; k++) d[k] += d[k + 1];
+    }
+
+private:
+    Vec2 d[kMaxBezierPoints];
+    int order, remaining;
+    Vec2 last;
+};
+
+// 批量展平的结果：所有折线顶点放在同一个数组里，第 i 条是 points[offsets[i], offsets[i+1])
+struct Polylines {
+    std::vector<Vec2> points;
+    std::vector<uint32_t> offsets{0};
+
+    void clear() {
+        points.clear();
+        offsets.assign(1, 0);
+    }
+    size_t size() const { return offsets.size() - 1; }
+};
+
+// 把一批曲线展平到 out（复用 out 的容量，稳态下不分配）
+void flattenBeziers(const std::vector<Bezier>& curves, double tolerance, Polylines& out) {
+    out.clear();
+    out.offsets.reserve(curves.size() + 1);
+    for (const Bezier& c : curves) {
+        int segments = flattenSegments(c, tolerance);
+        ForwardDifferencer fd(c, segments);
+        out.points.push_back(fd.current());
+        for (int i = 0; i < segments; i++) {
+            fd.step();
+            out.points.push_back(fd.current());
+        }
+        out.offsets.push_back(uint32_t(out.points.size()));
+    }
+}
+
 // 简单的画布类
 class Canvas {
 public:
@@ -83,17 +206,64 @@ public:
         }
     }
     
-    // 绘制 Bezier 曲线
-    void drawBezier(const std::vector<Vec2>& controlPoints, unsigned char r, unsigned char g, unsigned char b, int samples = 100) {
-        Vec2 prev = deCasteljau(controlPoints, 0);
-        
+    // 绘制 Bezier 曲线；samples = 0 时按 kDefaultTolerance 自适应分段
+    void drawBezier(const std::vector<Vec2>& controlPoints, unsigned char r, unsigned char g, unsigned char b, int samples = 0) {
+        if (controlPoints.empty()) return;
+        if (!Bezier::fits(controlPoints)) {
+            // 超过定长上限的高阶曲线走通用的 De Casteljau
+            if (samples <= 0) samples = 100;
+            Vec2 prev = deCasteljau(controlPoints, 0);
+            for (int i = 1; i <= samples; i++) {
+                double t = (double)i / samples;
+                Vec2 curr = deCasteljau(controlPoints, t);
+                drawThickLine((int)prev.x, (int)prev.y, (int)curr.x, (int)curr.y, 3, r, g, b);
+                prev = curr;
+            }
+            return;
+        }
+
+        Bezier curve(controlPoints);
+        if (samples > 0) {
+            // 指定段数时逐点用栈上的 De Casteljau 求值：与原来的结果逐位相同。
+            // 前向差分的累加误差虽只有 1e-12 量级，但整数控制点的采样常落在整数坐标上，
+            // 截断取整时会有个别像素偏移一格
+            Vec2 prev = evalBezier(curve, 0);
+            for (int i = 1; i <= samples; i++) {
+                Vec2 curr = evalBezier(curve, (double)i / samples);
+                drawThickLine((int)prev.x, (int)prev.y, (int)curr.x, (int)curr.y, 3, r, g, b);
+                prev = curr;
+            }
+            return;
+        }
+
+        samples = flattenSegments(curve, kDefaultTolerance);
+        ForwardDifferencer fd(curve, samples);
+        Vec2 prev = fd.current();
         for (int i = 1; i <= samples; i++) {
-            double t = (double)i / samples;
-            Vec2 curr = deCasteljau(controlPoints, t);
+            fd.step();
+            Vec2 curr = fd.current();
             drawThickLine((int)prev.x, (int)prev.y, (int)curr.x, (int)curr.y, 3, r, g, b);
             prev = curr;
         }
     }
+
+    // 批量绘制：整批展平到内部复用的折线缓冲，再逐段画线
+    void drawBeziers(const std::vector<Bezier>& curves, unsigned char r, unsigned char g, unsigned char b,
+                     double tolerance = kDefaultTolerance, int thickness = 1) {
+        flattenBeziers(curves, tolerance, scratch);
+        drawPolylines(scratch, r, g, b, thickness);
+    }
+
+    void drawPolylines(const Polylines& lines, unsigned char r, unsigned char g, unsigned char b, int thickness = 1) {
+        for (size_t i = 0; i < lines.size(); i++) {
+            for (uint32_t k = lines.offsets[i] + 1; k < lines.offsets[i + 1]; k++) {
+                const Vec2& a = lines.points[k - 1];
+                const Vec2& c = lines.points[k];
+                if (thickness <= 1) drawLine((int)a.x, (int)a.y, (int)c.x, (int)c.y, r, g, b);
+                else drawThickLine((int)a.x, (int)a.y, (int)c.x, (int)c.y, thickness, r, g, b);
+            }
+        }
+    }
     
     // 绘制控制多边形
     void drawControlPolygon(const std::vector<Vec2>& controlPoints) {
@@ -117,10 +287,113 @@ public:
     void save(const std::string& filename) {
         stbi_write_png(filename.c_str(), width, height, 3, pixels.data(), width * 3);
     }
+
+private:
+    Polylines scratch;  // drawBeziers 的展平缓冲
 };
 
-int main() {
+// ============================================================
+// 基准：大量屏幕尺寸不一的二/三阶曲线（类似字形轮廓）
+// ============================================================
+
+using Clock = std::chrono::steady_clock;
+
+static double msSince(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+// 点到线段的距离
+static double segmentDistance(Vec2 p, Vec2 a, Vec2 b) {
+    Vec2 ab = b - a, ap = p - a;
+    double len2 = ab.x * ab.x + ab.y * ab.y;
+    double t = len2 > 0 ? std::clamp((ap.x * ab.x + ap.y * ab.y) / len2, 0.0, 1.0) : 0.0;
+    return (p - (a + ab * t)).length();
+}
+
+int runBenchmark(int count) {
     const int W = 800, H = 600;
+    std::mt19937 rng(2026);
+    std::uniform_real_distribution<double> posX(0, W), posY(0, H), unit(-1, 1);
+    std::lognormal_distribution<double> size(std::log(12.0), 1.0);  // 多数 5~40 像素，少数上百像素
+
+    std::vector<Bezier> curves;
+    curves.reserve(count);
+    std::vector<std::vector<Vec2>> curvePoints(count);
+    for (int i = 0; i < count; i++) {
+        Vec2 origin(posX(rng), posY(rng));
+        double s = std::min(size(rng), 400.0);
+        int n = (i % 3 == 0) ? 3 : 4;  // 1/3 二阶（TrueType），2/3 三阶（PostScript/CFF）
+        for (int k = 0; k < n; k++) curvePoints[i].push_back(origin + Vec2(unit(rng), unit(rng)) * s);
+        curves.emplace_back(curvePoints[i]);
+    }
+    std::printf("随机曲线: %d 条（1/3 二阶、2/3 三阶），%dx%d\n", count, W, H);
+
+    // 1) 原始：每个采样点 De Casteljau 拷贝一次控制点，固定 100 段
+    Canvas reference(W, H);
+    auto t0 = Clock::now();
+    for (const auto& pts : curvePoints) {
+        Vec2 prev = deCasteljau(pts, 0);
+        for (int i = 1; i <= 100; i++) {
+            Vec2 curr = deCasteljau(pts, (double)i / 100);
+            reference.drawLine((int)prev.x, (int)prev.y, (int)curr.x, (int)curr.y, 0, 0, 0);
+            prev = curr;
+        }
+    }
+    double referenceMs = msSince(t0);
+    std::printf("De Casteljau, 固定 100 段:       %8.1f ms, %lld 段\n", referenceMs, (long long)count * 100);
+
+    // 2) 前向差分，仍然固定 100 段
+    Canvas fixed(W, H);
+    t0 = Clock::now();
+    for (const Bezier& c : curves) {
+        ForwardDifferencer fd(c, 100);
+        Vec2 prev = fd.current();
+        for (int i = 1; i <= 100; i++) {
+            fd.step();
+            Vec2 curr = fd.current();
+            fixed.drawLine((int)prev.x, (int)prev.y, (int)curr.x, (int)curr.y, 0, 0, 0);
+            prev = curr;
+        }
+    }
+    double fixedMs = msSince(t0);
+    size_t diff = 0;
+    for (size_t i = 0; i < fixed.pixels.size(); i += 3) diff += fixed.pixels[i] != reference.pixels[i];
+    std::printf("前向差分, 固定 100 段:           %8.1f ms, x%.2f, %zu 个像素不同\n", fixedMs, referenceMs / fixedMs, diff);
+
+    // 3) 自适应分段 + 批量接口（展平缓冲复用，计时的是第二帧）
+    Canvas adaptive(W, H);
+    adaptive.drawBeziers(curves, 0, 0, 0);
+    std::fill(adaptive.pixels.begin(), adaptive.pixels.end(), 255);
+    Polylines lines;
+    flattenBeziers(curves, kDefaultTolerance, lines);
+    t0 = Clock::now();
+    adaptive.drawBeziers(curves, 0, 0, 0, kDefaultTolerance);
+    double adaptiveMs = msSince(t0);
+    std::printf("自适应 (误差 %.2f px) 批量绘制:  %8.1f ms, x%.2f, %zu 段（平均每条 %.1f）\n", kDefaultTolerance,
+                adaptiveMs, referenceMs / adaptiveMs, lines.points.size() - lines.size(),
+                double(lines.points.size() - lines.size()) / count);
+
+    // 误差检查：每条曲线上密集采样，到对应折线的最近距离不应超过误差上界
+    double worst = 0;
+    for (int i = 0; i < std::min(count, 2000); i++) {
+        uint32_t begin = lines.offsets[i], end = lines.offsets[i + 1];
+        int segments = int(end - begin - 1);
+        for (int k = 0; k <= 64 * segments; k++) {
+            double t = double(k) / (64 * segments);
+            Vec2 p = evalBezier(curves[i], t);
+            uint32_t seg = std::min(begin + uint32_t(t * segments), end - 2);
+            worst = std::max(worst, segmentDistance(p, lines.points[seg], lines.points[seg + 1]));
+        }
+    }
+    std::printf("自适应折线与曲线最大距离: %.4f px（上界 %.2f px）\n", worst, kDefaultTolerance);
+    return worst <= kDefaultTolerance + 1e-9 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    const int W = 800, H = 600;
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        return runBenchmark(argc > 2 ? std::max(1, std::atoi(argv[2])) : 200000);
+    }
     
     // 1. 二阶 Bezier 曲线（抛物线）
     {
@@ -4,6 +4,9 @@
 #include <cmath>
 #include <algorithm>
 #include <limits>
+#include <chrono>
+#include <cstdint>
+#include <string>
 
 // ===== Vector3 Class =====
 struct Vec3 {
@@ -48,10 +51,12 @@ struct Material {
     double ka, kd, ks;
     int specular_exp;
     bool use_normal_map;
+    int normal_map_id;  // 法线贴图在图集中的编号（多个物体可以共用同一张）
     
     Material(Vec3 alb = Vec3(0.8, 0.8, 0.8), double ambient = 0.1, double diffuse = 0.7, 
-             double specular = 0.5, int exp = 32, bool use_nm = false)
-        : albedo(alb), ka(ambient), kd(diffuse), ks(specular), specular_exp(exp), use_normal_map(use_nm) {}
+             double specular = 0.5, int exp = 32, bool use_nm = false, int nm_id = 0)
+        : albedo(alb), ka(ambient), kd(diffuse), ks(specular), specular_exp(exp), use_normal_map(use_nm),
+          normal_map_id(nm_id) {}
 };
 
 // ===== Sphere Class =====
@@ -127,6 +132,76 @@ Vec3 procedural_normal_map(double u, double v) {
     return normal;
 }
 
+// ===== 八面体编码 =====
+// 单位法线投影到八面体 |x|+|y|+|z|=1 上，再把下半球折叠到正方形四角，
+// 得到 [-1,1]² 内的两个分量；每个分量量化成 16 位有符号整数，一条法线只占 4 字节
+// （三个 double 为 24 字节）。16 位量化的最大角度误差约 0.003°
+struct OctNormal {
+    int16_t x, y;
+};
+
+double sign_not_zero(double v) { return v >= 0.0 ? 1.0 : -1.0; }
+
+OctNormal encode_octahedral(const Vec3& n) {
+    double l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    double px = n.x / l1, py = n.y / l1;
+    if (n.z < 0.0) {
+        double fx = (1.0 - std::abs(py)) * sign_not_zero(px);
+        double fy = (1.0 - std::abs(px)) * sign_not_zero(py);
+        px = fx;
+        py = fy;
+    }
+    auto quantize = [](double v) {
+        return static_cast<int16_t>(std::lround(std::clamp(v, -1.0, 1.0) * 32767.0));
+    };
+    return {quantize(px), quantize(py)};
+}
+
+Vec3 decode_octahedral(OctNormal e) {
+    double px = e.x / 32767.0, py = e.y / 32767.0;
+    Vec3 n(px, py, 1.0 - std::abs(px) - std::abs(py));
+    if (n.z < 0.0) {
+        n.x = (1.0 - std::abs(py)) * sign_not_zero(px);
+        n.y = (1.0 - std::abs(px)) * sign_not_zero(py);
+    }
+    return n.normalize();
+}
+
+// ===== 法线贴图图集 =====
+// 把程序化法线贴图预先烘焙成 TILE_SIZE×TILE_SIZE 的八面体编码纹理，
+// 多张贴图依次排在同一个图集里，材质只记录编号。着色时按最近纹素取值（UV 重复环绕），
+// 只剩一次解码和 TBN 变换
+class NormalMapAtlas {
+public:
+    static const int TILE_SIZE = 1024;  // 2 的幂；每张 4 MB
+
+    // 烘焙一张贴图，返回它在图集中的编号
+    template <typename NormalFn>
+    int bake(const NormalFn& normal_at) {
+        size_t base = texels.size();
+        texels.resize(base + size_t(TILE_SIZE) * TILE_SIZE);
+        for (int y = 0; y < TILE_SIZE; ++y) {
+            for (int x = 0; x < TILE_SIZE; ++x) {
+                Vec3 n = normal_at((x + 0.5) / TILE_SIZE, (y + 0.5) / TILE_SIZE);
+                texels[base + size_t(y) * TILE_SIZE + x] = encode_octahedral(n);
+            }
+        }
+        return int(base / (size_t(TILE_SIZE) * TILE_SIZE));
+    }
+
+    Vec3 sample(int id, double u, double v) const {
+        int x = static_cast<int>(std::floor(u * TILE_SIZE)) & (TILE_SIZE - 1);
+        int y = static_cast<int>(std::floor(v * TILE_SIZE)) & (TILE_SIZE - 1);
+        return decode_octahedral(texels[(size_t(id) * TILE_SIZE + y) * TILE_SIZE + x]);
+    }
+
+    int tile_count() const { return int(texels.size() / (size_t(TILE_SIZE) * TILE_SIZE)); }
+    size_t bytes() const { return texels.size() * sizeof(OctNormal); }
+
+private:
+    std::vector<OctNormal> texels;
+};
+
 // ===== 切线空间到世界空间的转换 =====
 Vec3 tangent_to_world(const Vec3& tangent_normal, const Vec3& world_normal) {
     // 构建 TBN 矩阵（Tangent, Bitangent, Normal）
@@ -163,7 +238,9 @@ Vec3 phong_lighting(const Vec3& point, const Vec3& normal, const Vec3& view_dir,
 }
 
 // ===== 场景渲染 =====
-Vec3 trace(const Ray& ray, const std::vector<Sphere>& spheres, const Vec3& light_pos, const Vec3& light_color) {
+// atlas 为空时逐次调用程序化法线贴图（原始实现）
+Vec3 trace(const Ray& ray, const std::vector<Sphere>& spheres, const Vec3& light_pos, const Vec3& light_color,
+           const NormalMapAtlas* atlas = nullptr) {
     double closest_t = std::numeric_limits<double>::max();
     const Sphere* hit_sphere = nullptr;
     
@@ -184,7 +261,8 @@ Vec3 trace(const Ray& ray, const std::vector<Sphere>& spheres, const Vec3& light
         if (hit_sphere->material.use_normal_map) {
             double u, v;
             hit_sphere->get_uv(hit_point, u, v);
-            Vec3 tangent_normal = procedural_normal_map(u, v);
+            Vec3 tangent_normal = atlas ? atlas->sample(hit_sphere->material.normal_map_id, u, v)
+                                        : procedural_normal_map(u, v);
             shading_normal = tangent_to_world(tangent_normal, geometric_normal);
         }
         
@@ -217,7 +295,18 @@ void write_ppm(const std::string& filename, const std::vector<Vec3>& pixels, int
 }
 
 // ===== 主程序 =====
-int main() {
+int main(int argc, char** argv) {
+    bool use_atlas = true;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--procedural") {
+            use_atlas = false;
+        } else {
+            std::cerr << "用法: " << argv[0] << " [--procedural]" << std::endl;
+            return 1;
+        }
+    }
+
     const int width = 800;
     const int height = 600;
     const double aspect_ratio = static_cast<double>(width) / height;
@@ -236,6 +325,18 @@ int main() {
     Vec3 light_pos(5, 5, 5);
     Vec3 light_color(1.0, 1.0, 1.0);
     
+    // 法线贴图图集：砖块贴图只烘焙一次，所有引用它的材质共用
+    NormalMapAtlas atlas;
+    int brick_map = 0;
+    if (use_atlas) {
+        auto bake_start = std::chrono::steady_clock::now();
+        brick_map = atlas.bake(procedural_normal_map);
+        double bake_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - bake_start).count();
+        std::cout << "🧱 烘焙法线贴图图集: " << atlas.tile_count() << " 张 " << NormalMapAtlas::TILE_SIZE << "²，"
+                  << atlas.bytes() / (1024 * 1024) << " MB，耗时 " << bake_ms << " ms" << std::endl;
+    }
+    
     std::vector<Sphere> spheres;
     
     // 左侧球体：不使用法线贴图（平滑）
@@ -243,13 +344,14 @@ int main() {
     spheres.push_back(Sphere(Vec3(-1.5, 0, 0), 1.0, smooth_mat));
     
     // 右侧球体：使用法线贴图（砖块纹理）
-    Material normal_mapped_mat(Vec3(0.8, 0.3, 0.3), 0.1, 0.7, 0.5, 32, true);
+    Material normal_mapped_mat(Vec3(0.8, 0.3, 0.3), 0.1, 0.7, 0.5, 32, true, brick_map);
     spheres.push_back(Sphere(Vec3(1.5, 0, 0), 1.0, normal_mapped_mat));
     
     // 渲染
     std::vector<Vec3> pixels(width * height);
     
     std::cout << "🎨 开始渲染..." << std::endl;
+    auto render_start = std::chrono::steady_clock::now();
     
     for (int j = 0; j < height; ++j) {
         if (j % 50 == 0) {
@@ -263,11 +365,14 @@ int main() {
             Vec3 direction = lower_left + horizontal * u + vertical * v - camera_pos;
             Ray ray(camera_pos, direction);
             
-            pixels[j * width + i] = trace(ray, spheres, light_pos, light_color);
+            pixels[j * width + i] = trace(ray, spheres, light_pos, light_color, use_atlas ? &atlas : nullptr);
         }
     }
     
     std::cout << "  进度: 100%" << std::endl;
+    double render_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - render_start).count();
+    std::cout << "  法线: " << (use_atlas ? "八面体图集" : "程序化") << "，渲染耗时 " << render_ms << " ms" << std::endl;
     
     write_ppm("normal_mapping_output.ppm", pixels, width, height);
     
@@ -3,6 +3,8 @@
 #include <vector>
 #include <cmath>
 #include <algorithm>
+#include <chrono>
+#include <string>
 
 const int WIDTH = 800;
 const int HEIGHT = 600;
@@ -104,9 +106,11 @@ public:
 };
 
 // 程序化纹理：砖块（参考LearnOpenGL，黑色=深度深=砖块凹陷）
+// 尺寸都能整除 1：[0,1]² 正好 4 列 × 8 行砖（行数为偶数，错缝也能上下衔接），
+// 表面噪声在 [0,1] 上是整数个周期，重复环绕采样时没有接缝
 Vec3 brickTexture(double u, double v, double& depth) {
-    const double brick_width = 0.3;
-    const double brick_height = 0.15;
+    const double brick_width = 1.0 / 4.0;
+    const double brick_height = 1.0 / 8.0;
     const double mortar_width = 0.02;
     
     double row = std::floor(v / brick_height);
@@ -123,11 +127,201 @@ Vec3 brickTexture(double u, double v, double& depth) {
         return Vec3(0.5, 0.5, 0.5);  // 灰色
     } else {
         depth = 1.0;  // 砖块深度深（凹陷最深处）
-        double noise = std::sin(u * 100.0) * std::cos(v * 100.0) * 0.1;
+        double noise = std::sin(u * 32.0 * PI) * std::cos(v * 32.0 * PI) * 0.1;  // 16 个周期，频率与原来的 100 接近
         return Vec3(0.7 + noise, 0.3 + noise * 0.5, 0.2);  // 红褐色
     }
 }
 
+// ==================== 烘焙纹理（mipmap） ====================
+// 视差步进的每一层都要取一次高度。程序化 brickTexture 每次都要 floor/fmod/sin/cos，
+// 这里在渲染前把高度和颜色烘焙进 SIZE×SIZE 的 float 纹理并生成 mipmap，
+// 步进时改为一次双线性采样。高度和颜色分开存放，步进循环只读高度平面。
+// 纹理坐标按重复（repeat）方式环绕
+class BakedTexture {
+public:
+    static const int SIZE = 512;  // 灰浆宽 0.02 约 10 个纹素
+
+    struct Level {
+        int size;
+        std::vector<float> depth;
+        std::vector<float> albedo;  // RGB 交错
+    };
+
+    void bake() {
+        levels.clear();
+        Level base{SIZE, std::vector<float>(SIZE * SIZE), std::vector<float>(SIZE * SIZE * 3)};
+        for (int y = 0; y < SIZE; y++) {
+            for (int x = 0; x < SIZE; x++) {
+                double d;
+                Vec3 c = brickTexture((x + 0.5) / SIZE, (y + 0.5) / SIZE, d);
+                int i = y * SIZE + x;
+                base.depth[i] = float(d);
+                base.albedo[i * 3 + 0] = float(c.x);
+                base.albedo[i * 3 + 1] = float(c.y);
+                base.albedo[i * 3 + 2] = float(c.z);
+            }
+        }
+        levels.push_back(std::move(base));
+
+        // 2×2 盒式滤波逐级缩小到 1×1
+        while (levels.back().size > 1) {
+            const Level& src = levels.back();
+            int n = src.size / 2;
+            Level dst{n, std::vector<float>(n * n), std::vector<float>(n * n * 3)};
+            for (int y = 0; y < n; y++) {
+                for (int x = 0; x < n; x++) {
+                    int s00 = (2 * y) * src.size + 2 * x, s01 = s00 + 1;
+                    int s10 = s00 + src.size, s11 = s10 + 1;
+                    int d = y * n + x;
+                    dst.depth[d] = 0.25f * (src.depth[s00] + src.depth[s01] + src.depth[s10] + src.depth[s11]);
+                    for (int c = 0; c < 3; c++) {
+                        dst.albedo[d * 3 + c] = 0.25f * (src.albedo[s00 * 3 + c] + src.albedo[s01 * 3 + c] +
+                                                         src.albedo[s10 * 3 + c] + src.albedo[s11 * 3 + c]);
+                    }
+                }
+            }
+            levels.push_back(std::move(dst));
+        }
+    }
+
+    int num_levels() const { return int(levels.size()); }
+    const Level& level(int i) const { return levels[i]; }
+
+    int level_for(double lod) const {
+        return std::max(0, std::min(num_levels() - 1, int(std::floor(lod + 0.5))));
+    }
+
+    // 单层双线性采样高度（视差步进用）
+    double depth(double u, double v, int level) const {
+        const Level& L = levels[level];
+        Footprint f(L.size, u, v);
+        const float* d = L.depth.data();
+        double top = d[f.i00] + (d[f.i01] - d[f.i00]) * f.wx;
+        double bottom = d[f.i10] + (d[f.i11] - d[f.i10]) * f.wx;
+        return top + (bottom - top) * f.wy;
+    }
+
+    // 三线性采样颜色（最终着色用）
+    Vec3 albedo(double u, double v, double lod) const {
+        lod = std::max(0.0, std::min(double(num_levels() - 1), lod));
+        int l0 = int(lod);
+        int l1 = std::min(l0 + 1, num_levels() - 1);
+        double w = lod - l0;
+        return albedo_bilinear(u, v, l0) * (1.0 - w) + albedo_bilinear(u, v, l1) * w;
+    }
+
+private:
+    std::vector<Level> levels;
+
+    // 双线性采样的 4 个纹素下标（重复环绕）与插值权重
+    struct Footprint {
+        int i00, i01, i10, i11;
+        double wx, wy;
+
+        Footprint(int size, double u, double v) {
+            double fx = u * size - 0.5;
+            double fy = v * size - 0.5;
+            double x0 = std::floor(fx), y0 = std::floor(fy);
+            wx = fx - x0;
+            wy = fy - y0;
+            int x = wrap(int(x0), size), x1 = wrap(int(x0) + 1, size);
+            int y = wrap(int(y0), size), y1 = wrap(int(y0) + 1, size);
+            i00 = y * size + x;
+            i01 = y * size + x1;
+            i10 = y1 * size + x;
+            i11 = y1 * size + x1;
+        }
+
+        // SIZE 是 2 的幂，按位与即可环绕（负数同样适用）
+        static int wrap(int i, int size) { return i & (size - 1); }
+    };
+
+    Vec3 albedo_bilinear(double u, double v, int level) const {
+        const Level& L = levels[level];
+        Footprint f(L.size, u, v);
+        const float* a = L.albedo.data();
+        Vec3 c00(a[f.i00 * 3], a[f.i00 * 3 + 1], a[f.i00 * 3 + 2]);
+        Vec3 c01(a[f.i01 * 3], a[f.i01 * 3 + 1], a[f.i01 * 3 + 2]);
+        Vec3 c10(a[f.i10 * 3], a[f.i10 * 3 + 1], a[f.i10 * 3 + 2]);
+        Vec3 c11(a[f.i11 * 3], a[f.i11 * 3 + 1], a[f.i11 * 3 + 2]);
+        Vec3 top = c00 * (1.0 - f.wx) + c01 * f.wx;
+        Vec3 bottom = c10 * (1.0 - f.wx) + c11 * f.wx;
+        return top * (1.0 - f.wy) + bottom * f.wy;
+    }
+};
+
+// ==================== 锥形步进（Cone Step Mapping） ====================
+// 逐层步进每层只前进固定的 delta_tex_coords。锥形图为每个单元（CELL×CELL 个纹素）
+// 预存两项：单元内的最高点 top（最小深度），以及以它为顶点、朝表面张开的
+// 最大"安全锥"斜率 ratio（每单位深度对应的 UV 半径）——锥内没有任何高度场。
+// 光线位于单元上方深度 z 处时，沿视线前进
+//     Δz = ratio · (top − z) / (|P| + ratio)
+// 仍在锥内，可以一大步跳过空白区域。
+class ConeMap {
+public:
+    static const int CELL = 4;
+    static const int SEARCH_RADIUS = 16;  // 搜索半径（单元），更远处按最坏情况给出上界
+    static constexpr double MAX_RATIO = 1.0;
+
+    // 单元顶点取"单元外扩 1 个纹素"内的最小深度，覆盖双线性采样（0、1 级）的取值范围
+    void build(const BakedTexture& texture) {
+        const auto& base = texture.level(0);
+        int size = base.size;
+        res = size / CELL;
+        cell_uv = double(CELL) / size;
+
+        top.assign(res * res, 1.0f);
+        float global_min = 1.0f;
+        for (int cy = 0; cy < res; cy++) {
+            for (int cx = 0; cx < res; cx++) {
+                float m = 1.0f;
+                for (int y = cy * CELL - 1; y <= cy * CELL + CELL; y++) {
+                    for (int x = cx * CELL - 1; x <= cx * CELL + CELL; x++) {
+                        m = std::min(m, base.depth[(y & (size - 1)) * size + (x & (size - 1))]);
+                    }
+                }
+                top[cy * res + cx] = m;
+                global_min = std::min(global_min, m);
+            }
+        }
+
+        // 单元之间取最近距离（相邻单元为 0），保证单元内任意一点出发都安全
+        ratio.assign(res * res, float(MAX_RATIO));
+        for (int cy = 0; cy < res; cy++) {
+            for (int cx = 0; cx < res; cx++) {
+                float apex = top[cy * res + cx];
+                double r = MAX_RATIO;
+                if (apex > global_min) {
+                    r = std::min(r, SEARCH_RADIUS * cell_uv / (apex - global_min));
+                }
+                for (int dy = -SEARCH_RADIUS; dy <= SEARCH_RADIUS; dy++) {
+                    for (int dx = -SEARCH_RADIUS; dx <= SEARCH_RADIUS; dx++) {
+                        float other = top[((cy + dy) & (res - 1)) * res + ((cx + dx) & (res - 1))];
+                        if (other >= apex) continue;
+                        double gx = std::max(0, std::abs(dx) - 1) * cell_uv;
+                        double gy = std::max(0, std::abs(dy) - 1) * cell_uv;
+                        r = std::min(r, std::sqrt(gx * gx + gy * gy) / (apex - other));
+                    }
+                }
+                ratio[cy * res + cx] = float(r);
+            }
+        }
+    }
+
+    void lookup(double u, double v, double& cell_top, double& cell_ratio) const {
+        int x = int(std::floor(u / cell_uv)) & (res - 1);
+        int y = int(std::floor(v / cell_uv)) & (res - 1);
+        cell_top = top[y * res + x];
+        cell_ratio = ratio[y * res + x];
+    }
+
+private:
+    int res = 0;
+    double cell_uv = 0.0;
+    std::vector<float> top;
+    std::vector<float> ratio;
+};
+
 // Phong光照
 Vec3 phong_shading(const Vec3& normal, const Vec3& view_dir, const Vec3& light_dir, const Vec3& diffuse_color) {
     double shininess = 32.0;
@@ -145,7 +339,9 @@ Vec3 phong_shading(const Vec3& normal, const Vec3& view_dir, const Vec3& light_d
 }
 
 // Parallax Occlusion Mapping (LearnOpenGL标准实现)
-Vec2 parallax_mapping(const Vec2& tex_coords, const Vec3& view_dir_tangent) {
+// depth_at(uv) 取高度：可以直接调用程序化纹理，也可以采样烘焙纹理
+template <typename DepthFn>
+Vec2 parallax_mapping(const Vec2& tex_coords, const Vec3& view_dir_tangent, const DepthFn& depth_at) {
     const double height_scale = 0.3;  // 增大到0.3（原0.1太小）
     
     // 动态层数（根据视角调整）
@@ -162,13 +358,12 @@ Vec2 parallax_mapping(const Vec2& tex_coords, const Vec3& view_dir_tangent) {
     
     // 初始值
     Vec2 current_tex_coords = tex_coords;
-    double current_depth_value;
-    brickTexture(current_tex_coords.x, current_tex_coords.y, current_depth_value);
+    double current_depth_value = depth_at(current_tex_coords);
     
     // Steep Parallax Mapping - 沿视线方向步进
     while (current_layer_depth < current_depth_value) {
         current_tex_coords = current_tex_coords - delta_tex_coords;  // 减法！
-        brickTexture(current_tex_coords.x, current_tex_coords.y, current_depth_value);
+        current_depth_value = depth_at(current_tex_coords);
         current_layer_depth += layer_depth;
     }
     
@@ -176,8 +371,7 @@ Vec2 parallax_mapping(const Vec2& tex_coords, const Vec3& view_dir_tangent) {
     Vec2 prev_tex_coords = current_tex_coords + delta_tex_coords;
     
     double after_depth = current_depth_value - current_layer_depth;
-    double prev_depth_value;
-    brickTexture(prev_tex_coords.x, prev_tex_coords.y, prev_depth_value);
+    double prev_depth_value = depth_at(prev_tex_coords);
     double before_depth = prev_depth_value - current_layer_depth + layer_depth;
     
     double weight = after_depth / (after_depth - before_depth);
@@ -186,9 +380,70 @@ Vec2 parallax_mapping(const Vec2& tex_coords, const Vec3& view_dir_tangent) {
     return final_tex_coords;
 }
 
+// 锥形步进 + 试位法细化
+// 锥形图给出的安全步长在表面附近会趋近于 0，因此每步至少前进一个逐层步进的层厚，
+// 一旦进入高度场以下，就在最后一段区间内细化（最多 REFINE_STEPS 次）定位交点；
+// refine_uv 为所用 mip 级别上一个纹素的 UV 长度
+template <typename DepthFn>
+Vec2 cone_step_mapping(const Vec2& tex_coords, const Vec3& view_dir_tangent, const ConeMap& cones,
+                       const DepthFn& depth_at, double refine_uv) {
+    const double height_scale = 0.3;
+    const int REFINE_STEPS = 4;
+
+    // 最小步长取逐层步进的层厚（同一视角公式），保证不会漏掉逐层步进能找到的交点
+    const double min_layers = 8.0;
+    const double max_layers = 32.0;
+    double num_layers = min_layers + (max_layers - min_layers) * (1.0 - std::abs(view_dir_tangent.z));
+    const double min_step = 1.0 / num_layers;
+    const int max_steps = int(std::ceil(num_layers));
+
+    Vec2 P = Vec2(view_dir_tangent.x, view_dir_tangent.y) / view_dir_tangent.z * height_scale;
+    double p_length = std::sqrt(P.x * P.x + P.y * P.y);
+
+    // 深度差 f(z) = z − depth(uv(z))：在高度场上方为负，进入高度场后非负
+    double z = 0.0, prev_z = 0.0;
+    double f = -depth_at(tex_coords), prev_f = f;
+    bool below = f >= 0.0;
+    for (int i = 0; i < max_steps && !below; i++) {
+        Vec2 uv = tex_coords - P * z;
+        double cell_top, cell_ratio;
+        cones.lookup(uv.x, uv.y, cell_top, cell_ratio);
+        double dz = cell_top > z ? cell_ratio * (cell_top - z) / (p_length + cell_ratio) : 0.0;
+
+        prev_z = z;
+        prev_f = f;
+        z = std::min(1.0, z + std::max(dz, min_step));
+        f = z - depth_at(tex_coords - P * z);
+        below = f >= 0.0;
+    }
+    if (!below || z == prev_z) return tex_coords - P * z;
+
+    // 交点在 (prev_z, z] 之间：试位法（两端函数值已知，取割线交点）缩小区间，
+    // 区间对应的 UV 长度小于 refine_uv 后停止，最后再取一次割线交点
+    double lo = prev_z, hi = z, f_lo = prev_f, f_hi = f;
+    for (int i = 0; i < REFINE_STEPS && p_length * (hi - lo) > refine_uv; i++) {
+        double mid = lo + (hi - lo) * f_lo / (f_lo - f_hi);
+        mid = std::max(lo + 0.1 * (hi - lo), std::min(hi - 0.1 * (hi - lo), mid));
+        double f_mid = mid - depth_at(tex_coords - P * mid);
+        if (f_mid >= 0.0) { hi = mid; f_hi = f_mid; }
+        else              { lo = mid; f_lo = f_mid; }
+    }
+    return tex_coords - P * (lo + (hi - lo) * f_lo / (f_lo - f_hi));
+}
+
+// 视差贴图用到的纹理与统计
+struct ParallaxContext {
+    const BakedTexture* baked = nullptr;  // 为空时使用程序化纹理（原始实现）
+    const ConeMap* cones = nullptr;       // 非空时用锥形步进代替逐层步进（需要烘焙纹理）
+    long depth_fetches = 0;               // 视差步进中的高度采样次数
+    long parallax_pixels = 0;
+};
+
 // 主渲染函数
+// lod 为该像素的 mip 级别（仅烘焙纹理使用）
 Vec3 render_parallax(const Vec3& point, const Sphere& sphere, const Vec3& view_dir, 
-                     const Vec3& light_dir, bool use_parallax) {
+                     const Vec3& light_dir, bool use_parallax, ParallaxContext& ctx, double lod) {
+    const BakedTexture* baked = ctx.baked;
     double u, v;
     sphere.getUV(point, u, v);
     
@@ -200,7 +455,30 @@ Vec3 render_parallax(const Vec3& point, const Sphere& sphere, const Vec3& view_d
         // 将视线方向转换到切线空间
         Vec3 view_tangent = Vec3(view_dir.dot(T), view_dir.dot(B), view_dir.dot(N));
         
-        Vec2 tex_coords = parallax_mapping(Vec2(u, v), view_tangent);
+        Vec2 tex_coords;
+        ctx.parallax_pixels++;
+        if (baked) {
+            // 锥形图按 0、1 级的双线性范围构建，锥形步进时不取更粗的级别
+            int level = baked->level_for(lod);
+            if (ctx.cones) level = std::min(level, 1);
+            auto depth_at = [&](const Vec2& uv) {
+                ctx.depth_fetches++;
+                return baked->depth(uv.x, uv.y, level);
+            };
+            if (ctx.cones) {
+                double texel = 1.0 / baked->level(level).size;
+                tex_coords = cone_step_mapping(Vec2(u, v), view_tangent, *ctx.cones, depth_at, texel);
+            } else {
+                tex_coords = parallax_mapping(Vec2(u, v), view_tangent, depth_at);
+            }
+        } else {
+            tex_coords = parallax_mapping(Vec2(u, v), view_tangent, [&](const Vec2& uv) {
+                ctx.depth_fetches++;
+                double depth;
+                brickTexture(uv.x, uv.y, depth);
+                return depth;
+            });
+        }
         u = tex_coords.x;
         v = tex_coords.y;
         
@@ -210,8 +488,13 @@ Vec3 render_parallax(const Vec3& point, const Sphere& sphere, const Vec3& view_d
     }
     
     // 采样纹理
-    double depth;
-    Vec3 tex_color = brickTexture(u, v, depth);
+    Vec3 tex_color;
+    if (baked) {
+        tex_color = baked->albedo(u, v, lod);
+    } else {
+        double depth;
+        tex_color = brickTexture(u, v, depth);
+    }
     
     // Phong光照
     Vec3 color = phong_shading(N, view_dir, light_dir, tex_color);
@@ -236,12 +519,38 @@ void save_ppm(const std::string& filename, const std::vector<Vec3>& pixels, int
     file.close();
 }
 
+// 像素 (i, j) 的相机光线
+Ray camera_ray(int i, int j) {
+    double u = (i + 0.5) / WIDTH;
+    double v = (j + 0.5) / HEIGHT;
+    
+    double aspect = double(WIDTH) / double(HEIGHT);
+    double x = (2.0 * u - 1.0) * aspect;
+    double y = 2.0 * v - 1.0;
+    
+    return Ray(Vec3(0, 0, 0), Vec3(x, y, -1.0).normalize());
+}
+
+// 估计像素的纹理足迹，得到 mip 级别。
+// 一个像素在表面上的宽度 ≈ t × 像素张角 / |N·V|（掠射时被拉长）；
+// 球面上 v 方向 π·r 对应整张纹理，u 方向 2π·r·cos(纬度) 对应整张纹理，取较大的一个
+double texture_lod(const Ray& ray, double t, const Vec3& normal, const Vec3& view_dir, double radius) {
+    double pixel_angle = 2.0 / HEIGHT / std::max(1e-6, -ray.direction.z);
+    double width = t * pixel_angle / std::max(0.05, std::abs(normal.dot(view_dir)));
+    double cos_lat = std::max(0.05, std::sqrt(std::max(0.0, 1.0 - normal.y * normal.y)));
+    double texels = BakedTexture::SIZE * width / (PI * radius) * std::max(1.0, 0.5 / cos_lat);
+    return texels > 1.0 ? std::log2(texels) : 0.0;
+}
+
 // 渲染单张图片
-void render_scene(const std::string& filename, bool use_parallax, const std::string& description) {
+void render_scene(const std::string& filename, bool use_parallax, const std::string& description,
+                  ParallaxContext ctx) {
     std::cout << "\n📸 " << description << std::endl;
     
     Sphere sphere(Vec3(0, 0, -3), 1.0);
     Vec3 light_dir = Vec3(0.3, 0.3, 1.0).normalize();
+
+    auto start = std::chrono::steady_clock::now();
     
     std::vector<Vec3> pixels(WIDTH * HEIGHT);
     
@@ -251,15 +560,8 @@ void render_scene(const std::string& filename, bool use_parallax, const std::str
         }
         
         for (int i = 0; i < WIDTH; i++) {
-            double u = (i + 0.5) / WIDTH;
-            double v = (j + 0.5) / HEIGHT;
-            
-            double aspect = double(WIDTH) / double(HEIGHT);
-            double x = (2.0 * u - 1.0) * aspect;
-            double y = 2.0 * v - 1.0;
-            
-            Vec3 ray_dir = Vec3(x, y, -1.0).normalize();
-            Ray ray(Vec3(0, 0, 0), ray_dir);
+            Ray ray = camera_ray(i, j);
+            const Vec3& ray_dir = ray.direction;
             
             double t;
             bool hit = sphere.intersect(ray, t);
@@ -268,7 +570,9 @@ void render_scene(const std::string& filename, bool use_parallax, const std::str
             if (hit) {
                 Vec3 hit_point = ray.at(t);
                 Vec3 view_dir = (ray.origin - hit_point).normalize();
-                color = render_parallax(hit_point, sphere, view_dir, light_dir, use_parallax);
+                double lod = ctx.baked ? texture_lod(ray, t, sphere.getNormal(hit_point), view_dir, sphere.radius)
+                                       : 0.0;
+                color = render_parallax(hit_point, sphere, view_dir, light_dir, use_parallax, ctx, lod);
             } else {
                 double gradient = 0.5 * (ray_dir.y + 1.0);
                 color = Vec3(0.5, 0.7, 1.0) * gradient + Vec3(1.0, 1.0, 1.0) * (1.0 - gradient);
@@ -277,26 +581,72 @@ void render_scene(const std::string& filename, bool use_parallax, const std::str
             pixels[j * WIDTH + i] = color;
         }
     }
+
+    double total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "  纹理: " << (ctx.baked ? "烘焙 mipmap" : "程序化")
+              << (ctx.cones ? "，锥形步进" : "") << "，耗时 " << total_ms << " ms";
+    if (ctx.parallax_pixels > 0) {
+        std::cout << "，每像素高度采样 " << double(ctx.depth_fetches) / ctx.parallax_pixels;
+    }
+    std::cout << std::endl;
     
     save_ppm(filename, pixels, WIDTH, HEIGHT);
     std::cout << "✅ 已保存: " << filename << std::endl;
 }
 
-int main() {
+int main(int argc, char** argv) {
+    bool use_baked = true;
+    bool use_cones = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--procedural") use_baked = false;
+        else if (arg == "--cone") use_cones = true;
+        else {
+            std::cerr << "用法: " << argv[0] << " [--procedural | --cone]" << std::endl;
+            return 1;
+        }
+    }
+    if (use_cones && !use_baked) {
+        std::cerr << "锥形步进需要烘焙纹理，不能与 --procedural 同时使用" << std::endl;
+        return 1;
+    }
+
     std::cout << "========================================" << std::endl;
     std::cout << "  Parallax Mapping v3 (LearnOpenGL标准)" << std::endl;
     std::cout << "  修正：砖块深度=0（凹陷），灰浆深度>0（凸起）" << std::endl;
     std::cout << "========================================" << std::endl;
     
-    render_scene("normal_v3.ppm", false, "渲染图1：普通纹理映射");
-    render_scene("parallax_v3.ppm", true, "渲染图2：Parallax Occlusion Mapping");
+    // 两张图共用一份烘焙纹理
+    BakedTexture baked;
+    if (use_baked) {
+        auto start = std::chrono::steady_clock::now();
+        baked.bake();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "\n🧱 烘焙纹理 " << BakedTexture::SIZE << "² + " << baked.num_levels() - 1
+                  << " 级 mipmap，耗时 " << ms << " ms" << std::endl;
+    }
+    ConeMap cones;
+    if (use_cones) {
+        auto start = std::chrono::steady_clock::now();
+        cones.build(baked);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "🔺 构建锥形图，耗时 " << ms << " ms" << std::endl;
+    }
+
+    ParallaxContext ctx;
+    ctx.baked = use_baked ? &baked : nullptr;
+    ctx.cones = use_cones ? &cones : nullptr;
+    
+    render_scene("normal_v3.ppm", false, "渲染图1：普通纹理映射", ctx);
+    render_scene("parallax_v3.ppm", true, "渲染图2：Parallax Occlusion Mapping", ctx);
     
     std::cout << "\n🎉 渲染完成！" << std::endl;
     std::cout << "📊 参数说明：" << std::endl;
     std::cout << "   - height_scale = 0.1 (LearnOpenGL标准值)" << std::endl;
     std::cout << "   - 砖块深度 = 0.0 (黑色，凹陷)" << std::endl;
     std::cout << "   - 灰浆深度 = 0.2 (灰色，凸起)" << std::endl;
-    std::cout << "   - 动态层数 = 8~32 (根据视角调整)" << std::endl;
+    std::cout << "   - " << (use_cones ? "锥形步进 + 试位法细化" : "动态层数 = 8~32 (根据视角调整)") << std::endl;
+    std::cout << "   - 纹理 = " << (use_baked ? "烘焙 512² mipmap（--procedural 切回程序化）" : "程序化") << std::endl;
     
     return 0;
 }
@@ -0,0 +1,124 @@
+/**
+ * 体积光共用部分（god_rays_v2.cpp 与 volumetric_light.cpp 共享）
+ *
+ * - march_adaptive：自适应步长的区段遍历，只负责决定区段和定位阴影边界，
+ *   具体的散射 / 透射积分由调用方给出
+ * - LowResFog：低分辨率体积光 + 深度感知双边上采样
+ *
+ * 两个程序各自定义 Vec3，这里按模板参数使用，只要求默认构造、+、* double、/ double。
+ */
+
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+namespace fog {
+
+// ==================== 自适应步长 ====================
+// 受光/阴影状态不变的区段整段积分，步长逐段翻倍（最多 8 倍基础步长）；
+// 区段两端状态不同说明中间有阴影边界，用二分法把边界定位到 1/4 基础步长以内，
+// 越过边界后步长回到基础步长。基础步长 = max_distance / num_steps，与均匀步进相同。
+//   lit_at(t)              -> bool：距离 t 处是否受光。t 已夹到均匀步进的采样范围内，
+//                                    避免在表面上做阴影测试
+//   integrate(t0, t1, lit) -> bool：累加一段状态一致的区段；返回 false 表示后续贡献可以忽略，
+//                                    遍历在当前区段之后结束
+template <typename LitAt, typename Integrate>
+void march_adaptive(double max_distance, int num_steps, const LitAt& lit_at, const Integrate& integrate) {
+    const double MAX_STEP_SCALE = 8.0;
+    const double MIN_STEP_SCALE = 0.25;
+
+    double base_step = max_distance / num_steps;
+    double first = 0.5 * base_step;
+    double last = max_distance - 0.5 * base_step;
+    auto lit = [&](double t) { return lit_at(std::max(first, std::min(last, t))); };
+
+    double step = base_step;
+    double t0 = 0.0;
+    bool lit0 = lit(t0);
+
+    while (t0 < max_distance) {
+        double t1 = std::min(max_distance, t0 + step);
+        bool lit1 = lit(t1);
+        bool more;
+
+        if (lit1 == lit0) {
+            more = integrate(t0, t1, lit0);
+            step = std::min(step * 2.0, base_step * MAX_STEP_SCALE);
+        } else {
+            double a = t0, b = t1;
+            while (b - a > base_step * MIN_STEP_SCALE) {
+                double m = 0.5 * (a + b);
+                if (lit(m) == lit0) a = m;
+                else b = m;
+            }
+            double edge = 0.5 * (a + b);
+            more = integrate(t0, edge, lit0);
+            more = integrate(edge, t1, lit1) && more;
+            step = base_step;
+        }
+        if (!more) break;
+
+        t0 = t1;
+        lit0 = lit1;
+    }
+}
+
+// ==================== 低分辨率体积光 + 深度感知双边上采样 ====================
+// 体积光在屏幕上变化平缓，按 1/scale 分辨率计算，每个低分辨率像素取块中心的光线和深度。
+// 上采样时取周围 4 个低分辨率像素，权重 = 双线性权重 × 深度相似度；
+// 4 个都和当前像素深度差很多（物体轮廓）时返回 false，由调用方按全分辨率直接步进
+template <typename Vec3>
+struct LowResFog {
+    static constexpr double DEPTH_SIGMA = 0.02;  // 相对深度差的高斯宽度
+    static constexpr double MIN_WEIGHT = 0.05;   // 深度相似度低于此值视为不可用
+
+    int scale = 1, w = 0, h = 0;
+    std::vector<Vec3> fog;
+    std::vector<double> depth;
+
+    // sample(px, py, fog, depth) 在全分辨率像素坐标 (px, py) 处计算体积光与深度
+    template <typename Sample>
+    void build(int width, int height, int fog_scale, const Sample& sample) {
+        scale = fog_scale;
+        w = (width + scale - 1) / scale;
+        h = (height + scale - 1) / scale;
+        fog.assign(w * h, Vec3());
+        depth.assign(w * h, 0.0);
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                sample((x + 0.5) * scale, (y + 0.5) * scale, fog[y * w + x], depth[y * w + x]);
+            }
+        }
+    }
+
+    bool upsample(double px, double py, double pixel_depth, Vec3& result) const {
+        double fx = std::max(0.0, std::min(w - 1.0, px / scale - 0.5));
+        double fy = std::max(0.0, std::min(h - 1.0, py / scale - 0.5));
+        int x0 = std::min(int(fx), std::max(0, w - 2));
+        int y0 = std::min(int(fy), std::max(0, h - 2));
+        double wx = fx - x0, wy = fy - y0;
+
+        Vec3 sum;
+        double weight_sum = 0.0;
+        bool usable = false;
+        for (int dy = 0; dy < 2; dy++) {
+            for (int dx = 0; dx < 2; dx++) {
+                int x = std::min(x0 + dx, w - 1), y = std::min(y0 + dy, h - 1);
+                double rel = (depth[y * w + x] - pixel_depth) / (DEPTH_SIGMA * pixel_depth);
+                double similarity = std::exp(-rel * rel);
+                if (similarity < MIN_WEIGHT) continue;
+                double weight = (dx ? wx : 1.0 - wx) * (dy ? wy : 1.0 - wy) * similarity + 1e-6;
+                sum = sum + fog[y * w + x] * weight;
+                weight_sum += weight;
+                usable = true;
+            }
+        }
+        if (!usable) return false;
+        result = sum / weight_sum;
+        return true;
+    }
+};
+
+} // namespace fog
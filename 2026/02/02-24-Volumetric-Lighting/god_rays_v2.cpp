@@ -3,6 +3,10 @@
 #include <vector>
 #include <cmath>
 #include <algorithm>
+#include <chrono>
+#include <string>
+
+#include "fog_common.h"
 
 const int WIDTH = 1200;
 const int HEIGHT = 800;
@@ -159,6 +163,34 @@ Vec3 volumetric_light(const Ray& ray, const Scene& scene, double max_dist) {
     return accumulated.clamp();
 }
 
+// 体积光（自适应步长，区段划分见 fog_common.h）；基础步长与均匀步进相同
+Vec3 volumetric_light_adaptive(const Ray& ray, const Scene& scene, double max_dist) {
+    const int NUM_STEPS = 60;
+    const double SCATTERING = 0.03;
+
+    auto is_lit = [&](double t) {
+        Vec3 sample_pos = ray.at(t);
+        Vec3 to_light = scene.light_pos - sample_pos;
+        double light_dist = to_light.length();
+        return !scene.is_occluded(sample_pos, to_light / light_dist, light_dist);
+    };
+    // 受光区段 [t0, t1] 的散射量，衰减取区段中点
+    double amount = 0.0;
+    auto integrate = [&](double t0, double t1, bool lit) {
+        if (!lit) return true;
+        Vec3 mid = ray.at(0.5 * (t0 + t1));
+        double light_dist = (scene.light_pos - mid).length();
+        double atten = 1.0 / (1.0 + 0.02 * light_dist * light_dist);
+        amount += SCATTERING * (t1 - t0) * atten;
+        return true;
+    };
+    fog::march_adaptive(max_dist, NUM_STEPS, is_lit, integrate);
+
+    return (scene.light_color * amount).clamp();
+}
+
+using LowResFog = fog::LowResFog<Vec3>;
+
 void save_ppm(const std::string& filename, const std::vector<Vec3>& pixels, int w, int h) {
     std::ofstream file(filename);
     file << "P3\n" << w << " " << h << "\n255\n";
@@ -171,64 +203,118 @@ void save_ppm(const std::string& filename, const std::vector<Vec3>& pixels, int
     }
 }
 
-void render(const std::string& filename, bool use_volumetric, const std::string& desc) {
+// 渲染选项
+struct RenderOptions {
+    bool adaptive = true;  // 自适应步长（false 为均匀步进）
+    int fog_scale = 1;     // 体积光分辨率缩小倍数：1 / 2 / 4
+};
+
+Ray camera_ray(const Vec3& camera_pos, double px, double py) {
+    double u = (2.0*px/WIDTH - 1.0) * (double(WIDTH)/HEIGHT);
+    double v = 2.0*py/HEIGHT - 1.0;
+    return Ray(camera_pos, Vec3(u, v, -1.5).normalize());
+}
+
+void render(const std::string& filename, bool use_volumetric, const std::string& desc,
+            const RenderOptions& options) {
     std::cout << "\n📸 " << desc << std::endl;
     
     Scene scene;
     Vec3 camera_pos(0, 0, 5);
+
+    auto start = std::chrono::steady_clock::now();
+    auto march = [&](const Ray& ray, double max_dist) {
+        return options.adaptive ? volumetric_light_adaptive(ray, scene, max_dist)
+                                : volumetric_light(ray, scene, max_dist);
+    };
+    // 击中物体步进到表面，未击中步进固定 15 个单位
+    auto march_distance = [&](const Ray& ray) {
+        double t;
+        Vec3 color, normal;
+        return scene.intersect(ray, t, color, normal) ? t : 15.0;
+    };
+
+    LowResFog low_res;
+    if (use_volumetric && options.fog_scale > 1) {
+        low_res.build(WIDTH, HEIGHT, options.fog_scale, [&](double px, double py, Vec3& fog, double& depth) {
+            Ray ray = camera_ray(camera_pos, px, py);
+            depth = march_distance(ray);
+            fog = march(ray, depth);
+        });
+    }
     
     std::vector<Vec3> pixels(WIDTH * HEIGHT);
+    long direct_marches = 0;
     
     for (int j = 0; j < HEIGHT; j++) {
         if (j % 100 == 0) std::cout << "  进度: " << (100.0*j/HEIGHT) << "%" << std::endl;
         
         for (int i = 0; i < WIDTH; i++) {
-            double u = (2.0*(i+0.5)/WIDTH - 1.0) * (double(WIDTH)/HEIGHT);
-            double v = 2.0*(j+0.5)/HEIGHT - 1.0;
-            
-            Vec3 ray_dir = Vec3(u, v, -1.5).normalize();
-            Ray ray(camera_pos, ray_dir);
+            Ray ray = camera_ray(camera_pos, i + 0.5, j + 0.5);
             
             Vec3 final_color(0, 0, 0);
             double t;
             Vec3 surface_color, normal;
+            bool hit = scene.intersect(ray, t, surface_color, normal);
             
-            if (scene.intersect(ray, t, surface_color, normal)) {
+            if (hit) {
                 // 击中物体
                 Vec3 hit_point = ray.at(t);
                 final_color = simple_shading(hit_point, normal, surface_color, 
                                             scene.light_pos, scene.light_color);
-                
-                // 添加体积光（相机到表面）
-                if (use_volumetric) {
-                    Vec3 vol = volumetric_light(ray, scene, t);
-                    final_color = final_color + vol;
-                }
-            } else {
-                // 未击中，背景
-                if (use_volumetric) {
-                    final_color = volumetric_light(ray, scene, 15.0);
-                } else {
-                    // 深色背景
-                    final_color = Vec3(0.05, 0.05, 0.08);
+            } else if (!use_volumetric) {
+                // 未击中，深色背景
+                final_color = Vec3(0.05, 0.05, 0.08);
+            }
+
+            // 添加体积光（相机到表面；未击中时只有体积光）
+            if (use_volumetric) {
+                double max_dist = hit ? t : 15.0;
+                Vec3 vol;
+                if (options.fog_scale == 1 || !low_res.upsample(i + 0.5, j + 0.5, max_dist, vol)) {
+                    vol = march(ray, max_dist);
+                    direct_marches++;
                 }
+                final_color = final_color + vol;
             }
             
             pixels[j*WIDTH + i] = final_color.clamp();
         }
     }
+
+    if (use_volumetric) {
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "  " << (options.adaptive ? "自适应步长" : "均匀步长")
+                  << "，体积光分辨率 1/" << options.fog_scale << "，耗时 " << ms << " ms";
+        if (options.fog_scale > 1) {
+            std::cout << "，全分辨率补算像素 " << (100.0 * direct_marches / (WIDTH * HEIGHT)) << "%";
+        }
+        std::cout << std::endl;
+    }
     
     save_ppm(filename, pixels, WIDTH, HEIGHT);
     std::cout << "✅ 已保存: " << filename << std::endl;
 }
 
-int main() {
+int main(int argc, char** argv) {
+    RenderOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--uniform") options.adaptive = false;
+        else if (arg == "--half") options.fog_scale = 2;
+        else if (arg == "--quarter") options.fog_scale = 4;
+        else {
+            std::cerr << "用法: " << argv[0] << " [--uniform] [--half | --quarter]" << std::endl;
+            return 1;
+        }
+    }
+
     std::cout << "========================================" << std::endl;
     std::cout << "  体积光渲染 - God Rays" << std::endl;
     std::cout << "========================================" << std::endl;
     
-    render("scene_no_vol.ppm", false, "普通渲染（无体积光）");
-    render("scene_with_vol.ppm", true, "体积光渲染（God Rays）");
+    render("scene_no_vol.ppm", false, "普通渲染（无体积光）", options);
+    render("scene_with_vol.ppm", true, "体积光渲染（God Rays）", options);
     
     std::cout << "\n🎉 渲染完成！" << std::endl;
     
@@ -3,6 +3,11 @@
 #include <vector>
 #include <cmath>
 #include <algorithm>
+#include <chrono>
+#include <limits>
+#include <string>
+
+#include "fog_common.h"
 
 const int WIDTH = 1200;
 const int HEIGHT = 800;
@@ -194,12 +199,87 @@ Vec3 phong_shading(const Vec3& point, const Vec3& normal, const Vec3& view_dir,
     return (ambient + diffuse + specular).clamp();
 }
 
+// ==================== 光源阴影贴图（立方体贴图） ====================
+// 逐步调用 is_in_shadow 相当于每个步进点都做一次完整的场景求交。
+// 这里改为每帧从点光源向 6 个方向各做一次"光栅化"，记录光源到最近遮挡物的距离，
+// 步进时只需比较"采样点到光源的距离"和贴图中的遮挡距离，变成一次查表。
+class ShadowCubeMap {
+public:
+    explicit ShadowCubeMap(int resolution = 512) : res(resolution) {}
+
+    // 面编号：0/1 = ±X，2/3 = ±Y，4/5 = ±Z；面内坐标 (s, t) ∈ [-1, 1]
+    void build(const Scene& scene) {
+        light = scene.light_pos;
+        depth.assign(6 * res * res, std::numeric_limits<float>::max());
+
+        for (int face = 0; face < 6; face++) {
+            for (int y = 0; y < res; y++) {
+                for (int x = 0; x < res; x++) {
+                    double s = 2.0 * (x + 0.5) / res - 1.0;
+                    double t = 2.0 * (y + 0.5) / res - 1.0;
+                    Ray ray(light, face_direction(face, s, t).normalize());
+
+                    double hit_t;
+                    Vec3 dummy_color, dummy_normal;
+                    if (scene.intersect(ray, hit_t, dummy_color, dummy_normal)) {
+                        depth[(face * res + y) * res + x] = static_cast<float>(hit_t);
+                    }
+                }
+            }
+        }
+    }
+
+    // 采样点能否看到光源：遮挡距离比采样点更远即为受光。
+    // 偏移随距离增长，抵消一个纹素张角内的深度变化（掠射角的地板/墙面）
+    bool is_lit(const Vec3& point, double light_distance) const {
+        Vec3 d = point - light;
+        double ax = std::abs(d.x), ay = std::abs(d.y), az = std::abs(d.z);
+
+        int face;
+        double major, s, t;
+        if (ax >= ay && ax >= az) { face = d.x > 0 ? 0 : 1; major = ax; s = d.y; t = d.z; }
+        else if (ay >= az)        { face = d.y > 0 ? 2 : 3; major = ay; s = d.z; t = d.x; }
+        else                      { face = d.z > 0 ? 4 : 5; major = az; s = d.x; t = d.y; }
+
+        int x = texel(s / major);
+        int y = texel(t / major);
+        double occluder = depth[(face * res + y) * res + x];
+
+        double bias = 0.01 + light_distance * 4.0 / res;
+        return occluder > light_distance - bias;
+    }
+
+private:
+    int res;
+    Vec3 light;
+    std::vector<float> depth;
+
+    static Vec3 face_direction(int face, double s, double t) {
+        double sign = (face & 1) ? -1.0 : 1.0;
+        switch (face >> 1) {
+            case 0:  return Vec3(sign, s, t);
+            case 1:  return Vec3(t, sign, s);
+            default: return Vec3(s, t, sign);
+        }
+    }
+
+    int texel(double coord) const {
+        int i = static_cast<int>((coord * 0.5 + 0.5) * res);
+        return std::max(0, std::min(res - 1, i));
+    }
+};
+
 // 体积光计算（Ray Marching）
-Vec3 volumetric_lighting(const Ray& ray, const Scene& scene, double max_distance) {
+// is_lit(采样点, 光源方向, 光源距离) 决定该步进点是否受光：
+// 可以是逐步阴影光线，也可以是阴影贴图查表
+template <typename Visibility>
+Vec3 volumetric_lighting(const Ray& ray, const Scene& scene, double max_distance,
+                         const Visibility& is_lit) {
     const int NUM_STEPS = 80;  // 步进次数
     const double SCATTERING = 0.25;  // 散射系数（雾的密度）- 增大到0.25
     
     double step_size = max_distance / NUM_STEPS;
+    double step_transmission = std::exp(-SCATTERING * step_size);  // 每步透射率，与步进位置无关
     Vec3 accumulated_light(0, 0, 0);
     double accumulated_transmission = 1.0;  // 透射率（光线能穿透的比例）
     
@@ -211,10 +291,10 @@ Vec3 volumetric_lighting(const Ray& ray, const Scene& scene, double max_distance
         // 计算该点到光源的方向和距离
         Vec3 to_light = scene.light_pos - sample_pos;
         double light_distance = to_light.length();
-        Vec3 light_dir = to_light.normalize();
+        Vec3 light_dir = to_light / light_distance;
         
         // 检查该点是否能看到光源（阴影测试）
-        bool in_shadow = scene.is_in_shadow(sample_pos, light_dir, light_distance);
+        bool in_shadow = !is_lit(sample_pos, light_dir, light_distance);
         
         if (!in_shadow) {
             // 计算光照衰减（距离平方衰减）
@@ -225,7 +305,7 @@ Vec3 volumetric_lighting(const Ray& ray, const Scene& scene, double max_distance
             accumulated_light = accumulated_light + scene.light_color * scatter_amount * accumulated_transmission;
             
             // 更新透射率（光被散射后，后续步进的贡献会减少）
-            accumulated_transmission *= std::exp(-SCATTERING * step_size);
+            accumulated_transmission *= step_transmission;
         } else {
             // 在阴影中，透射率也会降低（被物体遮挡）
             accumulated_transmission *= 0.95;
@@ -240,6 +320,242 @@ Vec3 volumetric_lighting(const Ray& ray, const Scene& scene, double max_distance
     return accumulated_light.clamp();
 }
 
+// 体积光计算（自适应步长，区段划分见 fog_common.h）
+// 基础步长、散射和透射与均匀步进一致：阴影中"每步 ×0.95"按基础步长折算成每单位长度的衰减
+template <typename Visibility>
+Vec3 volumetric_lighting_adaptive(const Ray& ray, const Scene& scene, double max_distance,
+                                  const Visibility& is_lit) {
+    const int NUM_STEPS = 80;
+    const double SCATTERING = 0.25;
+
+    double base_step = max_distance / NUM_STEPS;
+    double shadow_decay = std::log(0.95) / base_step;
+    double step_transmission = std::exp(-SCATTERING * base_step);
+    double base_scatter = SCATTERING * base_step;
+
+    auto lit_at = [&](double t) {
+        Vec3 sample_pos = ray.at(t);
+        Vec3 to_light = scene.light_pos - sample_pos;
+        double light_distance = to_light.length();
+        return is_lit(sample_pos, to_light / light_distance, light_distance);
+    };
+
+    Vec3 accumulated_light(0, 0, 0);
+    double accumulated_transmission = 1.0;
+
+    // 积分一段状态一致的区段 [t0, t1]，衰减取区段中点；透射率太低时提前结束
+    auto integrate = [&](double t0, double t1, bool lit) {
+        double length = t1 - t0;
+        if (length > 0.0 && lit) {
+            Vec3 mid = ray.at(0.5 * (t0 + t1));
+            double light_distance = (scene.light_pos - mid).length();
+            double attenuation = 1.0 / (1.0 + 0.05 * light_distance + 0.01 * light_distance * light_distance);
+            // 等价于把区段拆成若干基础步长逐步累加的几何级数，区段加长不改变积分结果
+            double segment_transmission = std::exp(-SCATTERING * length);
+            double scatter = (1.0 - segment_transmission) / (1.0 - step_transmission) * base_scatter;
+            accumulated_light = accumulated_light +
+                scene.light_color * (scatter * attenuation * accumulated_transmission);
+            accumulated_transmission *= segment_transmission;
+        } else if (length > 0.0) {
+            accumulated_transmission *= std::exp(shadow_decay * length);
+        }
+        return accumulated_transmission >= 0.01;
+    };
+    fog::march_adaptive(max_distance, NUM_STEPS, lit_at, integrate);
+
+    return accumulated_light.clamp();
+}
+
+// ==================== 相机 ====================
+// 像素坐标取连续值：像素 (i, j) 的中心是 (i + 0.5, j + 0.5)
+struct Camera {
+    Vec3 position, forward, right, up;
+    double tan_half_fov, aspect;
+
+    Camera(const Vec3& pos, const Vec3& look_at, const Vec3& world_up, double fov_degrees)
+        : position(pos) {
+        forward = (look_at - pos).normalize();
+        right = forward.cross(world_up).normalize();
+        up = right.cross(forward).normalize();
+        tan_half_fov = std::tan(fov_degrees * PI / 180.0 / 2.0);
+        aspect = double(WIDTH) / double(HEIGHT);
+    }
+
+    Ray generate(double px, double py) const {
+        double u = (2.0 * px / WIDTH - 1.0) * aspect * tan_half_fov;
+        double v = (2.0 * py / HEIGHT - 1.0) * tan_half_fov;
+        return Ray(position, (forward + right * u + up * v).normalize());
+    }
+
+    // 投影到像素坐标。点在相机后方时投影点位于反向延长线上，
+    // 但过该点的直线仍然是对极线，对极采样照常可用
+    void project(const Vec3& p, double& px, double& py) const {
+        Vec3 d = p - position;
+        double z = d.dot(forward);
+        if (std::abs(z) < 1e-6) z = z < 0 ? -1e-6 : 1e-6;
+        double u = d.dot(right) / z;
+        double v = d.dot(up) / z;
+        px = (u / (aspect * tan_half_fov) + 1.0) * 0.5 * WIDTH;
+        py = (v / tan_half_fov + 1.0) * 0.5 * HEIGHT;
+    }
+};
+
+// ==================== 对极线采样 ====================
+// 光束在屏幕上都从光源的投影点向外辐射，沿同一条对极线体积光只缓慢变化，
+// 变化集中在相邻对极线之间。于是只在 NUM_LINES 条对极线上各取 SAMPLES_PER_LINE
+// 个点做步进，其余像素在相邻两条线、相邻两个采样之间双线性插值。
+// 插值的 4 个采样与像素深度差别过大（物体轮廓处）时，插值会把前景和背景的
+// 体积光混在一起，这些像素改为直接步进。
+class EpipolarFog {
+public:
+    static const int NUM_LINES = 1024;
+    static const int SAMPLES_PER_LINE = 128;
+    static constexpr double DEPTH_TOLERANCE = 0.03;  // 相对深度差阈值
+
+    // march(光线, 步进距离) 计算一条视线上的体积光
+    template <typename March>
+    void build(const Camera& camera, const Scene& scene, const March& march) {
+        camera.project(scene.light_pos, lx, ly);
+        setup_lines();
+
+        fog.assign(NUM_LINES * SAMPLES_PER_LINE, Vec3());
+        depth.assign(NUM_LINES * SAMPLES_PER_LINE, 0.0f);
+
+        for (int k = 0; k < NUM_LINES; k++) {
+            const Line& line = lines[k];
+            if (!line.valid) continue;
+            for (int s = 0; s < SAMPLES_PER_LINE; s++) {
+                double r = line.r0 + (line.r1 - line.r0) * s / (SAMPLES_PER_LINE - 1);
+                Ray ray = camera.generate(lx + line.dx * r, ly + line.dy * r);
+                double dist = march_distance(scene, ray);
+                fog[k * SAMPLES_PER_LINE + s] = march(ray, dist);
+                depth[k * SAMPLES_PER_LINE + s] = static_cast<float>(dist);
+            }
+        }
+    }
+
+    // 插值得到像素 (px, py) 的体积光；插值不可靠时返回 false，由调用方直接步进
+    bool resolve(double px, double py, double pixel_depth, Vec3& result) const {
+        double dx = px - lx, dy = py - ly;
+        double r = std::sqrt(dx * dx + dy * dy);
+        double angle = std::remainder(std::atan2(dy, dx) - theta0, 2.0 * PI);
+
+        int k0, k1;
+        double wk;
+        if (full_circle) {
+            if (angle < 0) angle += 2.0 * PI;
+            double f = angle / (2.0 * PI) * NUM_LINES;
+            k0 = std::min(static_cast<int>(f), NUM_LINES - 1);
+            k1 = (k0 + 1) % NUM_LINES;
+            wk = f - k0;
+        } else {
+            double f = std::max(0.0, std::min(1.0, angle / theta_span)) * (NUM_LINES - 1);
+            k0 = std::min(static_cast<int>(f), NUM_LINES - 2);
+            k1 = k0 + 1;
+            wk = f - k0;
+        }
+
+        Vec3 a, b;
+        if (!sample_line(k0, r, pixel_depth, a) || !sample_line(k1, r, pixel_depth, b)) {
+            return false;
+        }
+        result = a * (1.0 - wk) + b * wk;
+        return true;
+    }
+
+    // 与逐像素渲染一致：击中物体步进到交点，未击中则步进固定 20 个单位
+    static double march_distance(const Scene& scene, const Ray& ray) {
+        double t;
+        Vec3 color, normal;
+        return scene.intersect(ray, t, color, normal) ? t : 20.0;
+    }
+
+private:
+    struct Line {
+        bool valid = false;
+        double dx = 0, dy = 0;  // 屏幕空间单位方向
+        double r0 = 0, r1 = 0;  // 与屏幕矩形相交的半径区间
+    };
+
+    double lx = 0, ly = 0;            // 光源的屏幕投影
+    double theta0 = 0, theta_span = 0;
+    bool full_circle = false;
+    std::vector<Line> lines;
+    std::vector<Vec3> fog;
+    std::vector<float> depth;
+
+    // 光源投影在屏幕内时对极线铺满 360°；在屏幕外时只覆盖屏幕矩形所张的角度范围
+    void setup_lines() {
+        full_circle = lx >= 0 && lx <= WIDTH && ly >= 0 && ly <= HEIGHT;
+        if (full_circle) {
+            theta0 = 0.0;
+            theta_span = 2.0 * PI;
+        } else {
+            const double cx[4] = {0.0, double(WIDTH), double(WIDTH), 0.0};
+            const double cy[4] = {0.0, 0.0, double(HEIGHT), double(HEIGHT)};
+            double base = std::atan2(cy[0] - ly, cx[0] - lx);
+            double lo = 0.0, hi = 0.0;
+            for (int c = 1; c < 4; c++) {
+                double delta = std::remainder(std::atan2(cy[c] - ly, cx[c] - lx) - base, 2.0 * PI);
+                lo = std::min(lo, delta);
+                hi = std::max(hi, delta);
+            }
+            theta0 = base + lo;
+            theta_span = hi - lo;
+        }
+
+        lines.assign(NUM_LINES, Line());
+        for (int k = 0; k < NUM_LINES; k++) {
+            double theta = full_circle ? theta0 + theta_span * k / NUM_LINES
+                                       : theta0 + theta_span * k / (NUM_LINES - 1);
+            Line& line = lines[k];
+            line.dx = std::cos(theta);
+            line.dy = std::sin(theta);
+
+            // slab 法求射线 L + r·d 与屏幕矩形 [0, W] × [0, H] 的交集
+            double r0 = 0.0, r1 = 1e30;
+            if (!clip_slab(lx, line.dx, WIDTH, r0, r1) || !clip_slab(ly, line.dy, HEIGHT, r0, r1)) {
+                continue;
+            }
+            line.valid = true;
+            line.r0 = r0;
+            line.r1 = r1;
+        }
+    }
+
+    static bool clip_slab(double origin, double dir, double extent, double& r0, double& r1) {
+        if (std::abs(dir) < 1e-12) {
+            return origin >= 0.0 && origin <= extent;
+        }
+        double a = (0.0 - origin) / dir;
+        double b = (extent - origin) / dir;
+        if (a > b) std::swap(a, b);
+        r0 = std::max(r0, a);
+        r1 = std::min(r1, b);
+        return r0 <= r1;
+    }
+
+    bool sample_line(int k, double r, double pixel_depth, Vec3& result) const {
+        const Line& line = lines[k];
+        if (!line.valid || line.r1 <= line.r0) return false;
+
+        double f = (r - line.r0) / (line.r1 - line.r0) * (SAMPLES_PER_LINE - 1);
+        if (f < -0.5 || f > SAMPLES_PER_LINE - 0.5) return false;
+        f = std::max(0.0, std::min(double(SAMPLES_PER_LINE - 1), f));
+        int s0 = std::min(static_cast<int>(f), SAMPLES_PER_LINE - 2);
+        double ws = f - s0;
+
+        int base = k * SAMPLES_PER_LINE + s0;
+        double tolerance = DEPTH_TOLERANCE * pixel_depth;
+        if (std::abs(depth[base] - pixel_depth) > tolerance ||
+            std::abs(depth[base + 1] - pixel_depth) > tolerance) {
+            return false;
+        }
+        result = fog[base] * (1.0 - ws) + fog[base + 1] * ws;
+        return true;
+    }
+};
+
 // 保存PPM图片
 void save_ppm(const std::string& filename, const std::vector<Vec3>& pixels, int width, int height) {
     std::ofstream file(filename);
@@ -257,24 +573,77 @@ void save_ppm(const std::string& filename, const std::vector<Vec3>& pixels, int
     file.close();
 }
 
+using LowResFog = fog::LowResFog<Vec3>;
+
+// 体积光可见性的求法
+enum class FogMode {
+    RayCast,    // 每个步进点一条阴影光线（原始实现）
+    ShadowMap,  // 每帧一张立方体阴影贴图，步进时查表
+    Epipolar    // 阴影贴图 + 对极线稀疏采样与插值
+};
+
+// 渲染选项
+struct RenderOptions {
+    FogMode mode = FogMode::ShadowMap;
+    bool adaptive = true;  // 自适应步长（false 为均匀步进）
+    int fog_scale = 1;     // 体积光分辨率缩小倍数：1 / 2 / 4（对极线模式下不用）
+};
+
+const char* fog_mode_name(FogMode mode) {
+    switch (mode) {
+        case FogMode::RayCast:   return "逐步阴影光线";
+        case FogMode::ShadowMap: return "阴影贴图";
+        default:                 return "对极线采样";
+    }
+}
+
 // 主渲染函数
-void render_scene(const std::string& filename, bool use_volumetric) {
+void render_scene(const std::string& filename, bool use_volumetric, const RenderOptions& options) {
     std::cout << "\n📸 渲染" << (use_volumetric ? "【体积光】" : "【普通光照】") << std::endl;
     
     Scene scene;
-    Vec3 camera_pos(-1.0, 1.0, 3.0);  // 相机位置
-    Vec3 look_at(0.0, 0.5, -2.0);     // 看向场景中央
-    Vec3 up(0, 1, 0);
-    
-    // 构建相机坐标系
-    Vec3 forward = (look_at - camera_pos).normalize();
-    Vec3 right = forward.cross(up).normalize();
-    Vec3 camera_up = right.cross(forward).normalize();
-    
-    double fov = 60.0 * PI / 180.0;
-    double aspect = double(WIDTH) / double(HEIGHT);
+    Camera camera(Vec3(-1.0, 1.0, 3.0),  // 相机位置
+                  Vec3(0.0, 0.5, -2.0),  // 看向场景中央
+                  Vec3(0, 1, 0), 60.0);
+
+    FogMode mode = options.mode;
+    auto start = std::chrono::steady_clock::now();
+
+    // 体积光的可见性查询
+    ShadowCubeMap shadow_map;
+    EpipolarFog epipolar;
+    auto ray_cast_lit = [&](const Vec3& p, const Vec3& dir, double dist) {
+        return !scene.is_in_shadow(p, dir, dist);
+    };
+    auto shadow_map_lit = [&](const Vec3& p, const Vec3&, double dist) {
+        return shadow_map.is_lit(p, dist);
+    };
+    auto march = [&](const Ray& ray, double max_distance) {
+        if (mode == FogMode::RayCast) {
+            return options.adaptive ? volumetric_lighting_adaptive(ray, scene, max_distance, ray_cast_lit)
+                                    : volumetric_lighting(ray, scene, max_distance, ray_cast_lit);
+        }
+        return options.adaptive ? volumetric_lighting_adaptive(ray, scene, max_distance, shadow_map_lit)
+                                : volumetric_lighting(ray, scene, max_distance, shadow_map_lit);
+    };
+    LowResFog low_res;
+    if (use_volumetric) {
+        if (mode != FogMode::RayCast) {
+            shadow_map.build(scene);
+        }
+        if (mode == FogMode::Epipolar) {
+            epipolar.build(camera, scene, march);
+        } else if (options.fog_scale > 1) {
+            low_res.build(WIDTH, HEIGHT, options.fog_scale, [&](double px, double py, Vec3& fog, double& depth) {
+                Ray ray = camera.generate(px, py);
+                depth = EpipolarFog::march_distance(scene, ray);
+                fog = march(ray, depth);
+            });
+        }
+    }
     
     std::vector<Vec3> pixels(WIDTH * HEIGHT);
+    long direct_marches = 0;
     
     for (int j = 0; j < HEIGHT; j++) {
         if (j % 100 == 0) {
@@ -282,55 +651,88 @@ void render_scene(const std::string& filename, bool use_volumetric) {
         }
         
         for (int i = 0; i < WIDTH; i++) {
-            double u = (2.0 * (i + 0.5) / WIDTH - 1.0) * aspect * std::tan(fov / 2.0);
-            double v = (2.0 * (j + 0.5) / HEIGHT - 1.0) * std::tan(fov / 2.0);
-            
-            Vec3 ray_dir = (forward + right * u + camera_up * v).normalize();
-            Ray ray(camera_pos, ray_dir);
+            Ray ray = camera.generate(i + 0.5, j + 0.5);
+            const Vec3& ray_dir = ray.direction;
             
             // 场景求交
             double t;
             Vec3 surface_color, normal;
             Vec3 final_color(0, 0, 0);
+            bool hit = scene.intersect(ray, t, surface_color, normal);
             
-            if (scene.intersect(ray, t, surface_color, normal)) {
+            if (hit) {
                 // 击中物体，计算表面光照
                 Vec3 hit_point = ray.at(t);
-                Vec3 view_dir = (camera_pos - hit_point).normalize();
+                Vec3 view_dir = (camera.position - hit_point).normalize();
                 final_color = phong_shading(hit_point, normal, view_dir, 
                                            scene.light_pos, scene.light_color, surface_color);
-                
-                // 添加体积光（从相机到表面的路径）
-                if (use_volumetric) {
-                    Vec3 volumetric = volumetric_lighting(ray, scene, t);
-                    final_color = final_color + volumetric;
-                }
-            } else {
-                // 未击中物体，只渲染体积光
-                if (use_volumetric) {
-                    final_color = volumetric_lighting(ray, scene, 20.0);
-                } else {
-                    // 背景色（渐变天空）
-                    double gradient = 0.5 * (ray_dir.y + 1.0);
-                    final_color = Vec3(0.3, 0.4, 0.6) * gradient + Vec3(0.1, 0.1, 0.15) * (1.0 - gradient);
+            } else if (!use_volumetric) {
+                // 背景色（渐变天空）
+                double gradient = 0.5 * (ray_dir.y + 1.0);
+                final_color = Vec3(0.3, 0.4, 0.6) * gradient + Vec3(0.1, 0.1, 0.15) * (1.0 - gradient);
+            }
+
+            // 添加体积光（从相机到表面的路径；未击中物体时只渲染体积光）
+            if (use_volumetric) {
+                double max_distance = hit ? t : 20.0;
+                Vec3 volumetric;
+                bool resolved = mode == FogMode::Epipolar
+                    ? epipolar.resolve(i + 0.5, j + 0.5, max_distance, volumetric)
+                    : options.fog_scale > 1 && low_res.upsample(i + 0.5, j + 0.5, max_distance, volumetric);
+                if (!resolved) {
+                    volumetric = march(ray, max_distance);
+                    direct_marches++;
                 }
+                final_color = final_color + volumetric;
             }
             
             pixels[j * WIDTH + i] = final_color.clamp();
         }
     }
+
+    if (use_volumetric) {
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "  体积光模式: " << fog_mode_name(mode)
+                  << (options.adaptive ? "，自适应步长" : "，均匀步长");
+        if (mode != FogMode::Epipolar) std::cout << "，分辨率 1/" << options.fog_scale;
+        std::cout << "，耗时 " << ms << " ms";
+        if (mode == FogMode::Epipolar || options.fog_scale > 1) {
+            std::cout << "，直接步进像素 " << (100.0 * direct_marches / (WIDTH * HEIGHT)) << "%";
+        }
+        std::cout << std::endl;
+    }
     
     save_ppm(filename, pixels, WIDTH, HEIGHT);
     std::cout << "✅ 已保存: " << filename << std::endl;
 }
 
-int main() {
+int main(int argc, char** argv) {
+    RenderOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--raycast") options.mode = FogMode::RayCast;
+        else if (arg == "--shadowmap") options.mode = FogMode::ShadowMap;
+        else if (arg == "--epipolar") options.mode = FogMode::Epipolar;
+        else if (arg == "--uniform") options.adaptive = false;
+        else if (arg == "--half") options.fog_scale = 2;
+        else if (arg == "--quarter") options.fog_scale = 4;
+        else {
+            std::cerr << "用法: " << argv[0]
+                      << " [--raycast | --shadowmap | --epipolar] [--uniform] [--half | --quarter]" << std::endl;
+            return 1;
+        }
+    }
+    if (options.mode == FogMode::Epipolar && options.fog_scale > 1) {
+        std::cerr << "对极线模式自带稀疏采样，不能与 --half / --quarter 同时使用" << std::endl;
+        return 1;
+    }
+
     std::cout << "========================================" << std::endl;
     std::cout << "  体积光渲染（Volumetric Lighting）" << std::endl;
     std::cout << "========================================" << std::endl;
     
-    render_scene("no_volumetric.ppm", false);
-    render_scene("with_volumetric.ppm", true);
+    render_scene("no_volumetric.ppm", false, options);
+    render_scene("with_volumetric.ppm", true, options);
     
     std::cout << "\n🎉 渲染完成！" << std::endl;
     std::cout << "  no_volumetric.ppm   - 普通光照" << std::endl;
@@ -1,93 +1,64 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
+#include "obj_loader.h"
+#include "mesh_cache.h"
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <vector>
 #include <string>
 #include <cmath>
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <filesystem>
 
-// 3D向量结构
-struct Vec3 {
-    float x, y, z;
-    Vec3(float x = 0, float y = 0, float z = 0) : x(x), y(y), z(z) {}
-    Vec3 operator+(const Vec3& v) const { return Vec3(x + v.x, y + v.y, z + v.z); }
-    Vec3 operator-(const Vec3& v) const { return Vec3(x - v.x, y - v.y, z - v.z); }
-    Vec3 operator*(float t) const { return Vec3(x * t, y * t, z * t); }
-    float dot(const Vec3& v) const { return x * v.x + y * v.y + z * v.z; }
-    Vec3 cross(const Vec3& v) const {
-        return Vec3(y * v.z - z * v.y, z * v.x - x * v.z, x * v.y - y * v.x);
-    }
-    Vec3 normalize() const {
-        float len = std::sqrt(x * x + y * y + z * z);
-        return len > 0 ? Vec3(x / len, y / len, z / len) : Vec3(0, 0, 0);
-    }
-    float length() const { return std::sqrt(x * x + y * y + z * z); }
-};
+using obj::Vec3;
+using obj::Triangle;
+using obj::OBJLoader;
 
-// 三角形面结构
-struct Triangle {
-    int v0, v1, v2;  // 顶点索引
-    Triangle(int a, int b, int c) : v0(a), v1(b), v2(c) {}
-};
+using EdgeList = std::vector<std::pair<uint32_t, uint32_t>>;
 
-// OBJ模型加载器
-class OBJLoader {
-public:
-    std::vector<Vec3> vertices;
-    std::vector<Triangle> faces;
-    
-    bool load(const std::string& filename) {
-        std::ifstream file(filename);
-        if (!file.is_open()) {
-            std::cerr << "无法打开文件: " << filename << std::endl;
-            return false;
-        }
-        
-        std::string line;
-        while (std::getline(file, line)) {
-            std::istringstream iss(line);
-            std::string prefix;
-            iss >> prefix;
-            
-            if (prefix == "v") {
-                // 顶点坐标
-                float x, y, z;
-                iss >> x >> y >> z;
-                vertices.push_back(Vec3(x, y, z));
+// 三角形网格的无重复边表：边按 (小下标, 大下标) 打包成 64 位键，开放寻址哈希去重。
+// 保留每条边第一次出现时的方向，封闭网格中每条内部边只剩一条（约为 3 × 三角形数的一半）
+// SplitMix64 终混
+inline uint64_t edgeHash(uint64_t key) {
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+    return key ^ (key >> 31);
+}
+
+EdgeList extractUniqueEdges(const uint32_t* indices, size_t indexCount) {
+    const uint64_t kEmpty = ~uint64_t(0);
+    size_t capacity = 16;
+    while (capacity < indexCount + indexCount / 2) capacity <<= 1;
+    std::vector<uint64_t> table(capacity, kEmpty);
+    const size_t mask = capacity - 1;
+
+    EdgeList edges;
+    edges.reserve(indexCount / 2 + 16);
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        for (int k = 0; k < 3; k++) {
+            uint32_t a = indices[i + k], b = indices[i + (k + 1) % 3];
+            uint64_t key = (uint64_t(std::min(a, b)) << 32) | std::max(a, b);
+            // 起始槽位取小下标 × 4：相邻三角形的边落在相邻槽位，访存局部性好（经 optimizeVertexCache
+            // 重排过顶点的网格尤其如此）。前 4 个槽位线性探测，之后按键散列出的奇数步长跳（双重散列）：
+            // 一直线性探测的话，高价顶点（扇形三角化的多边形面）的所有边挤在同一段探测链上，退化成度数的平方
+            size_t slot = size_t(std::min(a, b)) * 4 & mask, step = 1;
+            for (int probe = 1; table[slot] != kEmpty && table[slot] != key; probe++) {
+                if (probe == 4) step = size_t(edgeHash(key)) | 1;
+                slot = (slot + step) & mask;
             }
-            else if (prefix == "f") {
-                // 三角形面（支持格式：f v1 v2 v3 或 f v1/vt1/vn1 v2/vt2/vn2 v3/vt3/vn3）
-                std::string v1, v2, v3;
-                iss >> v1 >> v2 >> v3;
-                
-                int idx1 = parseVertexIndex(v1);
-                int idx2 = parseVertexIndex(v2);
-                int idx3 = parseVertexIndex(v3);
-                
-                if (idx1 >= 0 && idx2 >= 0 && idx3 >= 0) {
-                    faces.push_back(Triangle(idx1, idx2, idx3));
-                }
+            if (table[slot] == kEmpty) {
+                table[slot] = key;
+                edges.emplace_back(a, b);
             }
         }
-        
-        file.close();
-        std::cout << "模型加载完成: " << vertices.size() << " 顶点, " 
-                  << faces.size() << " 三角形" << std::endl;
-        return true;
     }
-    
-private:
-    int parseVertexIndex(const std::string& token) {
-        // 解析格式：v 或 v/vt 或 v/vt/vn 或 v//vn
-        size_t pos = token.find('/');
-        std::string indexStr = (pos == std::string::npos) ? token : token.substr(0, pos);
-        int index = std::stoi(indexStr);
-        // OBJ索引从1开始，转换为从0开始
-        return index - 1;
-    }
-};
+    return edges;
+}
 
 // 简单的线框渲染器
 class WireframeRenderer {
@@ -96,46 +67,50 @@ public:
         : width(width), height(height), buffer(width * height * 3, 255) {}
     
     void render(const OBJLoader& model) {
-        // 计算模型边界
-        Vec3 minBound(1e10, 1e10, 1e10);
-        Vec3 maxBound(-1e10, -1e10, -1e10);
-        for (const auto& v : model.vertices) {
-            minBound.x = std::min(minBound.x, v.x);
-            minBound.y = std::min(minBound.y, v.y);
-            minBound.z = std::min(minBound.z, v.z);
-            maxBound.x = std::max(maxBound.x, v.x);
-            maxBound.y = std::max(maxBound.y, v.y);
-            maxBound.z = std::max(maxBound.z, v.z);
+        std::vector<uint32_t> indices;
+        indices.reserve(model.faces.size() * 3);
+        for (const auto& tri : model.faces) {
+            indices.push_back(uint32_t(tri.v0));
+            indices.push_back(uint32_t(tri.v1));
+            indices.push_back(uint32_t(tri.v2));
         }
-        
-        // 计算缩放和平移
-        Vec3 center = (minBound + maxBound) * 0.5f;
-        Vec3 size = maxBound - minBound;
-        float scale = std::min(width, height) * 0.4f / std::max(std::max(size.x, size.y), size.z);
-        
+        render(model.vertices.data(), model.vertices.size(), indices.data(), indices.size());
+    }
+
+    // 索引网格（mesh_cache.h 的 Mesh / MeshView）画一次：顶点只投影一次，每个三角形直接画三条边。
+    // 共享边会画两次，但提取边表本身比省下的那一半画线还贵，只画一帧时不值得；
+    // 同一网格要画多帧时先 extractUniqueEdges 一次，再每帧调用 renderEdges
+    void render(const Vec3* positions, size_t vertexCount, const uint32_t* indices, size_t indexCount) {
+        if (!projectVertices(positions, vertexCount)) return;
+        for (size_t i = 0; i + 2 < indexCount; i += 3) {
+            drawSegment(indices[i], indices[i + 1]);
+            drawSegment(indices[i + 1], indices[i + 2]);
+            drawSegment(indices[i + 2], indices[i]);
+        }
+        edgeCount = indexCount / 3 * 3;
+    }
+
+    // 所有顶点只投影一次，再把整张无重复边表交给批量画线；边表由调用方持有，拓扑不变时跨帧复用
+    void renderEdges(const Vec3* positions, size_t vertexCount, const EdgeList& edges) {
+        if (!projectVertices(positions, vertexCount)) return;
+        for (const auto& e : edges) drawSegment(e.first, e.second);
+        edgeCount = edges.size();
+    }
+
+    // 原始实现：每个三角形各自投影并画三条边，共享边画两次（对比用）
+    void renderPerTriangle(const OBJLoader& model) {
+        if (model.vertices.empty()) return;
+        setupProjection(model.vertices.data(), model.vertices.size());
+
         // 渲染所有三角形边缘
         for (const auto& tri : model.faces) {
-            Vec3 v0 = model.vertices[tri.v0];
-            Vec3 v1 = model.vertices[tri.v1];
-            Vec3 v2 = model.vertices[tri.v2];
-            
-            // 投影到2D（简单正交投影）
-            auto project = [&](const Vec3& v) -> std::pair<int, int> {
-                float x = (v.x - center.x) * scale + width / 2;
-                float y = (v.y - center.y) * scale + height / 2;
-                return {(int)x, (int)y};
-            };
-            
-            auto p0 = project(v0);
-            auto p1 = project(v1);
-            auto p2 = project(v2);
-            
-            // 绘制三条边
-            drawLine(p0.first, p0.second, p1.first, p1.second);
-            drawLine(p1.first, p1.second, p2.first, p2.second);
-            drawLine(p2.first, p2.second, p0.first, p0.second);
+            drawTriangle(model.vertices[tri.v0], model.vertices[tri.v1], model.vertices[tri.v2]);
         }
     }
+
+    // 上一次 render() 画的边数
+    size_t edgesDrawn() const { return edgeCount; }
+    const std::vector<unsigned char>& pixels() const { return buffer; }
     
     void save(const std::string& filename) {
         stbi_write_png(filename.c_str(), width, height, 3, buffer.data(), width * 3);
@@ -145,6 +120,45 @@ public:
 private:
     int width, height;
     std::vector<unsigned char> buffer;
+    Vec3 center;
+    float scale = 1;
+    std::vector<int> screenX, screenY;  // render() 中每个顶点的投影坐标
+    size_t edgeCount = 0;
+
+    // 根据模型边界计算缩放和平移
+    void setupProjection(const Vec3* vertices, size_t count) {
+        Vec3 minBound(1e10, 1e10, 1e10);
+        Vec3 maxBound(-1e10, -1e10, -1e10);
+        for (size_t i = 0; i < count; i++) {
+            const Vec3& v = vertices[i];
+            minBound.x = std::min(minBound.x, v.x);
+            minBound.y = std::min(minBound.y, v.y);
+            minBound.z = std::min(minBound.z, v.z);
+            maxBound.x = std::max(maxBound.x, v.x);
+            maxBound.y = std::max(maxBound.y, v.y);
+            maxBound.z = std::max(maxBound.z, v.z);
+        }
+        center = (minBound + maxBound) * 0.5f;
+        Vec3 size = maxBound - minBound;
+        scale = std::min(width, height) * 0.4f / std::max(std::max(size.x, size.y), size.z);
+    }
+
+    // 投影到2D（简单正交投影）
+    std::pair<int, int> project(const Vec3& v) const {
+        float x = (v.x - center.x) * scale + width / 2;
+        float y = (v.y - center.y) * scale + height / 2;
+        return {(int)x, (int)y};
+    }
+
+    void drawTriangle(const Vec3& v0, const Vec3& v1, const Vec3& v2) {
+        auto p0 = project(v0);
+        auto p1 = project(v1);
+        auto p2 = project(v2);
+
+        drawLine(p0.first, p0.second, p1.first, p1.second);
+        drawLine(p1.first, p1.second, p2.first, p2.second);
+        drawLine(p2.first, p2.second, p0.first, p0.second);
+    }
     
     void setPixel(int x, int y, unsigned char r, unsigned char g, unsigned char b) {
         if (x >= 0 && x < width && y >= 0 && y < height) {
@@ -179,6 +193,52 @@ private:
             }
         }
     }
+
+    // 投影所有顶点到 screenX / screenY；没有顶点时返回 false
+    bool projectVertices(const Vec3* positions, size_t vertexCount) {
+        if (vertexCount == 0) return false;
+        setupProjection(positions, vertexCount);
+        screenX.resize(vertexCount);
+        screenY.resize(vertexCount);
+        for (size_t i = 0; i < vertexCount; i++) {
+            auto p = project(positions[i]);
+            screenX[i] = p.first;
+            screenY[i] = p.second;
+        }
+        return true;
+    }
+
+    // 按已投影的顶点 a → b 画线：两端都在画布内的边（线段在凸区域内，中间的像素也一定在）走不做边界检查的版本，
+    // 像素地址增量更新；其余的退回逐像素检查的 drawLine。步进规则相同，像素完全一致
+    void drawSegment(uint32_t a, uint32_t b) {
+        auto inside = [&](int x, int y) { return unsigned(x) < unsigned(width) && unsigned(y) < unsigned(height); };
+        int x0 = screenX[a], y0 = screenY[a];
+        int x1 = screenX[b], y1 = screenY[b];
+        if (!inside(x0, y0) || !inside(x1, y1)) {
+            drawLine(x0, y0, x1, y1);
+            return;
+        }
+        int dx = abs(x1 - x0);
+        int dy = abs(y1 - y0);
+        const ptrdiff_t stepX = x0 < x1 ? 3 : -3;
+        const ptrdiff_t stepY = (y0 < y1 ? 3 : -3) * ptrdiff_t(width);
+        int err = dx - dy;
+        unsigned char* p = buffer.data() + (ptrdiff_t(y0) * width + x0) * 3;
+        // 主方向走 max(dx, dy) 步，与 drawLine 的终止条件等价
+        for (int n = std::max(dx, dy); ; n--) {
+            p[0] = p[1] = p[2] = 0;
+            if (n == 0) break;
+            int e2 = 2 * err;
+            if (e2 > -dy) {
+                err -= dy;
+                p += stepX;
+            }
+            if (e2 < dx) {
+                err += dx;
+                p += stepY;
+            }
+        }
+    }
 };
 
 // 生成简单的测试OBJ模型（立方体）
@@ -211,24 +271,306 @@ void generateCubeOBJ(const std::string& filename) {
     std::cout << "测试立方体OBJ已生成: " << filename << std::endl;
 }
 
-int main() {
+// ============================================================
+// 解析器基准
+// ============================================================
+
+// 环面网格：每个格点一组 v / vt / vn，每个格子两个 "f v/vt/vn" 三角形，
+// 格子数按目标文件大小估算（每个格点约 220 字节）
+void generateTorusOBJ(const std::string& filename, double targetMB) {
+    int n = std::max(8, (int)std::sqrt(targetMB * 1024 * 1024 / 220.0));
+    FILE* f = std::fopen(filename.c_str(), "wb");
+    if (!f) return;
+    std::fprintf(f, "# torus %dx%d\n", n, n);
+    const float R = 1.0f, r = 0.35f, kPi = 3.14159265f;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            float a = 2 * kPi * i / n, b = 2 * kPi * j / n;
+            float nx = std::cos(a) * std::cos(b), ny = std::sin(a) * std::cos(b), nz = std::sin(b);
+            std::fprintf(f, "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n",
+                         std::cos(a) * (R + r * std::cos(b)), std::sin(a) * (R + r * std::cos(b)), r * nz,
+                         float(i) / n, float(j) / n, nx, ny, nz);
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            int a = i * n + j + 1, b = ((i + 1) % n) * n + j + 1;
+            int c = ((i + 1) % n) * n + (j + 1) % n + 1, d = i * n + (j + 1) % n + 1;
+            std::fprintf(f, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, c, c, c);
+            std::fprintf(f, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, c, c, c, d, d, d);
+        }
+    }
+    std::fclose(f);
+}
+
+// 快速解析器的格式细节：多边形、负索引、v//vn、CRLF、注释、越界索引、跨块引用
+bool checkFastParser() {
+    const char* text =
+        "# comment\r\n"
+        "v 0 0 0\r\nv 1 0 0\r\nv 1 1 0\r\nv 0 1 0\r\n"
+        "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+        "vn 0 0 1\n"
+        "o quad\ng group\nusemtl none\ns off\n"
+        "f 1/1/1 2/2/1 3/3/1 4/4/1\n"       // 四边形 → 2 个三角形
+        "f -4//-1 -3//-1 -2//-1   # 注释\n"  // 负索引，v//vn
+        "f 1 2 99\n"                          // 越界，丢弃
+        "f 1 0 2\n"                           // 索引 0 非法，丢弃
+        "f 1/-5 2/-5 3/-5\n"                  // 相对纹理索引指到第一个之前（解析为 -1），越界丢弃
+        "f 1/4294967296 2 3\n"                // 超出 int 范围（截断会变成 -1），丢弃
+        "v 2.5e-1 -1.25E+1 +3.\n"
+        "f -1 1 2\n";                         // -1 指向刚定义的第 5 个顶点
+    bool ok = true;
+    auto expect = [&](bool cond, const char* what) {
+        if (!cond) { std::cerr << "解析检查失败: " << what << std::endl; ok = false; }
+    };
+    // 文本不到 1 MB，只有一个块；线程数不影响结果
+    for (int threads : {1, 4}) {
+        OBJLoader m;
+        m.verbose = false;
+        m.loadFromMemory(text, std::strlen(text), threads);
+        expect(m.vertices.size() == 5 && m.texcoords.size() == 4 && m.normals.size() == 1, "元素数量");
+        expect(m.faces.size() == 4 && m.skippedFaces == 4, "面数量");
+        if (m.faces.size() == 4) {
+            const Triangle& q = m.faces[1];
+            expect(q.v0 == 0 && q.v1 == 2 && q.v2 == 3 && q.t2 == 3 && q.n1 == 0, "扇形拆分");
+            const Triangle& r = m.faces[2];
+            expect(r.v0 == 0 && r.v2 == 2 && r.t0 == -1 && r.n0 == 0, "负索引 / v//vn");
+            expect(m.faces[3].v0 == 4, "后定义顶点的负索引");
+        }
+        if (m.vertices.size() == 5) {
+            const Vec3& v = m.vertices[4];
+            expect(v.x == 0.25f && v.y == -12.5f && v.z == 3.0f, "指数形式浮点");
+        }
+    }
+
+    // 多块：拼接很多份“定义 4 个顶点 + 负索引四边形”，负索引必须始终指向本段的顶点
+    std::string big;
+    const int copies = 200000;
+    for (int i = 0; i < copies; i++) big += "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf -4 -3 -2 -1\n";
+    OBJLoader m;
+    m.verbose = false;
+    m.loadFromMemory(big.data(), big.size(), 4);
+    bool relativeOk = m.faces.size() == size_t(copies) * 2;
+    for (size_t i = 0; relativeOk && i < m.faces.size(); i++)
+        relativeOk = m.faces[i].v0 == int(i / 2 * 4) && m.faces[i].v2 == int(i / 2 * 4 + 2 + i % 2);
+    expect(relativeOk, "跨块负索引");
+    return ok;
+}
+
+int runBenchmark(double targetMB, int threads) {
+    using Clock = std::chrono::steady_clock;
+    auto ms = [](Clock::time_point t0) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+    };
+    if (threads <= 0) threads = int(std::max(1u, std::thread::hardware_concurrency()));
+
+    std::cout << "格式检查: " << (checkFastParser() ? "通过" : "失败") << std::endl;
+
+    const std::string path = "bench_torus.obj";
+    generateTorusOBJ(path, targetMB);
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) { std::cerr << "无法生成基准文件" << std::endl; return 1; }
+    std::fseek(f, 0, SEEK_END);
+    double mb = std::ftell(f) / (1024.0 * 1024.0);
+    std::fclose(f);
+    std::cout << "基准文件: " << path << " (" << mb << " MB)" << std::endl;
+
+    OBJLoader ref;
+    ref.verbose = false;
+    auto t0 = Clock::now();
+    ref.loadReference(path);
+    double refMs = ms(t0);
+    std::cout << "原始 getline + istringstream: " << refMs << " ms (" << mb / refMs * 1000 << " MB/s), "
+              << ref.vertices.size() << " 顶点, " << ref.faces.size() << " 三角形" << std::endl;
+
+    int result = 0;
+    OBJLoader model;
+    for (int t : {1, threads}) {
+        OBJLoader fast;
+        fast.verbose = false;
+        t0 = Clock::now();
+        fast.load(path, t);
+        double fastMs = ms(t0);
+
+        bool same = fast.vertices.size() == ref.vertices.size() && fast.faces.size() == ref.faces.size();
+        size_t vertexDiffs = 0;
+        for (size_t i = 0; same && i < fast.vertices.size(); i++) {
+            const Vec3 &a = fast.vertices[i], &b = ref.vertices[i];
+            vertexDiffs += a.x != b.x || a.y != b.y || a.z != b.z;
+        }
+        for (size_t i = 0; same && i < fast.faces.size(); i++) {
+            const Triangle &a = fast.faces[i], &b = ref.faces[i];
+            same = a.v0 == b.v0 && a.v1 == b.v1 && a.v2 == b.v2;
+        }
+        std::cout << "快速加载 (" << t << " 线程): " << fastMs << " ms (" << mb / fastMs * 1000 << " MB/s), x"
+                  << refMs / fastMs << ", " << fast.texcoords.size() << " 纹理坐标, " << fast.normals.size()
+                  << " 法线, ";
+        if (!same) {
+            std::cout << "结果不一致" << std::endl;
+            result = 1;
+        } else if (vertexDiffs) {
+            std::cout << vertexDiffs << " 个顶点与 istringstream 相差 1 ulp" << std::endl;
+        } else {
+            std::cout << "与原始版本一致" << std::endl;
+        }
+        model = std::move(fast);
+        if (t == threads) break;
+    }
+
+    // 线框：逐三角形画三条边 vs 共享投影直接按索引画 vs 无重复边表 + 批量画线
+    // （边表提取单独计时，拓扑不变时只需做一次；多帧时才划算）
+    {
+        std::vector<uint32_t> indices;
+        indices.reserve(model.faces.size() * 3);
+        for (const auto& tri : model.faces) {
+            indices.push_back(uint32_t(tri.v0));
+            indices.push_back(uint32_t(tri.v1));
+            indices.push_back(uint32_t(tri.v2));
+        }
+        WireframeRenderer perTriangle(800, 600), indexed(800, 600), batched(800, 600);
+        t0 = Clock::now();
+        perTriangle.renderPerTriangle(model);
+        double perTriangleMs = ms(t0);
+        t0 = Clock::now();
+        indexed.render(model.vertices.data(), model.vertices.size(), indices.data(), indices.size());
+        double indexedMs = ms(t0);
+        t0 = Clock::now();
+        EdgeList edges = extractUniqueEdges(indices.data(), indices.size());
+        double extractMs = ms(t0);
+        t0 = Clock::now();
+        batched.renderEdges(model.vertices.data(), model.vertices.size(), edges);
+        double batchedMs = ms(t0);
+        auto countDiff = [](const WireframeRenderer& a, const WireframeRenderer& b) {
+            size_t d = 0;
+            for (size_t i = 0; i < a.pixels().size(); i += 3) d += a.pixels()[i] != b.pixels()[i];
+            return d;
+        };
+        std::cout << "线框单帧: 逐三角形 " << indices.size() << " 条边 " << perTriangleMs << " ms; 共享投影按索引画 "
+                  << indexedMs << " ms, x" << perTriangleMs / indexedMs << ", " << countDiff(indexed, perTriangle)
+                  << " 个像素不同; 提取无重复边 " << edges.size() << " 条 " << extractMs << " ms + 批量绘制 "
+                  << batchedMs << " ms" << std::endl;
+
+        // 同一网格画多帧：边表只提取一次
+        const int frames = 10;
+        t0 = Clock::now();
+        for (int f = 0; f < frames; f++)
+            indexed.render(model.vertices.data(), model.vertices.size(), indices.data(), indices.size());
+        double indexedFramesMs = ms(t0);
+        t0 = Clock::now();
+        EdgeList reused = extractUniqueEdges(indices.data(), indices.size());
+        for (int f = 0; f < frames; f++) batched.renderEdges(model.vertices.data(), model.vertices.size(), reused);
+        double batchedFramesMs = ms(t0);
+        std::cout << "线框 " << frames << " 帧: 按索引画 " << indexedFramesMs << " ms; 提取一次边表 + 批量绘制 "
+                  << batchedFramesMs << " ms, x" << indexedFramesMs / batchedFramesMs << ", 与逐三角形 "
+                  << countDiff(batched, perTriangle) << " 个像素不同（共享边只画一个方向）" << std::endl;
+    }
+
+    // 转换为索引网格：去重 + 顶点缓存优化，再写成二进制缓存并映射回来
+    t0 = Clock::now();
+    obj::Mesh mesh = obj::buildMesh(model);
+    double dedupMs = ms(t0);
+    std::cout << "顶点去重: " << model.faces.size() * 3 << " 个角 -> " << mesh.positions.size() << " 个顶点, "
+              << dedupMs << " ms" << std::endl;
+
+    // ACMR：原始顺序、打乱后的顺序、以及分别经 Tipsify 优化后的结果
+    obj::Mesh shuffled = mesh;
+    {
+        std::vector<uint32_t> order(shuffled.triangleCount());
+        for (size_t i = 0; i < order.size(); i++) order[i] = uint32_t(i);
+        std::shuffle(order.begin(), order.end(), std::mt19937(7));
+        for (size_t i = 0; i < order.size(); i++)
+            for (int k = 0; k < 3; k++) shuffled.indices[i * 3 + k] = mesh.indices[order[i] * 3 + k];
+    }
+    double acmrOriginal = obj::averageCacheMissRatio(mesh.indices, mesh.positions.size());
+    double acmrShuffled = obj::averageCacheMissRatio(shuffled.indices, shuffled.positions.size());
+    t0 = Clock::now();
+    obj::optimizeVertexCache(mesh);
+    double optimizeMs = ms(t0);
+    obj::optimizeVertexCache(shuffled);
+    std::cout << "顶点缓存优化 (FIFO 16, ACMR): 文件顺序 " << acmrOriginal << " -> "
+              << obj::averageCacheMissRatio(mesh.indices, mesh.positions.size()) << ", 打乱顺序 " << acmrShuffled
+              << " -> " << obj::averageCacheMissRatio(shuffled.indices, shuffled.positions.size()) << ", "
+              << optimizeMs << " ms" << std::endl;
+
+    const std::string cachePath = path + ".mesh";
+    if (!obj::writeMeshCache(cachePath, mesh, path)) {
+        std::cerr << "写入网格缓存失败" << std::endl;
+        result = 1;
+    } else {
+        t0 = Clock::now();
+        obj::MeshView view;
+        bool opened = view.open(cachePath, path);
+        double openMs = ms(t0);
+        bool same = opened && view.vertexCount == mesh.positions.size() && view.indexCount == mesh.indices.size() &&
+                    std::memcmp(view.positions, mesh.positions.data(), sizeof(Vec3) * view.vertexCount) == 0 &&
+                    std::memcmp(view.normals, mesh.normals.data(), sizeof(Vec3) * view.vertexCount) == 0 &&
+                    std::memcmp(view.uvs, mesh.uvs.data(), sizeof(obj::Vec2) * view.vertexCount) == 0 &&
+                    std::memcmp(view.indices, mesh.indices.data(), sizeof(uint32_t) * view.indexCount) == 0;
+        std::cout << "网格缓存: " << std::filesystem::file_size(cachePath) / (1024.0 * 1024.0) << " MB, 映射 + 校验 "
+                  << openMs << " ms, " << (same ? "内容一致" : "内容不一致") << std::endl;
+        if (!same) result = 1;
+        std::remove(cachePath.c_str());
+    }
+    std::remove(path.c_str());
+    return result;
+}
+
+int main(int argc, char** argv) {
     const int WIDTH = 800;
     const int HEIGHT = 600;
-    
-    // 生成测试模型
-    std::string objFile = "cube.obj";
-    generateCubeOBJ(objFile);
-    
-    // 加载模型
-    OBJLoader loader;
-    if (!loader.load(objFile)) {
-        std::cerr << "模型加载失败" << std::endl;
-        return 1;
+
+    std::string objFile;
+    int threads = 0;
+    bool useCache = false;
+    double benchMB = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) threads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--cache") useCache = true;
+        else if (arg == "--bench") {
+            benchMB = 64;
+            if (i + 1 < argc && argv[i + 1][0] != '-') benchMB = std::max(1.0, std::atof(argv[++i]));
+        } else if (arg[0] != '-' && objFile.empty()) objFile = arg;
+        else {
+            std::cerr << "用法: " << argv[0] << " [model.obj] [--cache] [--threads N] [--bench [MB]]" << std::endl;
+            return 1;
+        }
     }
-    
-    // 渲染线框
+    if (benchMB > 0) return runBenchmark(benchMB, threads);
+
+    // 没有指定模型时使用测试立方体；只在文件不存在时生成，
+    // 否则每次重写都会更新修改时间，--cache 的时间戳检查永远不会命中
+    if (objFile.empty()) {
+        objFile = "cube.obj";
+        if (!std::filesystem::exists(objFile)) generateCubeOBJ(objFile);
+    }
+
     WireframeRenderer renderer(WIDTH, HEIGHT);
-    renderer.render(loader);
+    const std::string cachePath = objFile + ".mesh";
+    obj::MeshView view;
+    if (useCache && view.open(cachePath, objFile)) {
+        // 缓存有效：直接映射，不解析文本
+        std::cout << "网格缓存命中: " << cachePath << " (" << view.vertexCount << " 顶点, "
+                  << view.indexCount / 3 << " 三角形)" << std::endl;
+        renderer.render(view.positions, view.vertexCount, view.indices, view.indexCount);
+    } else {
+        // 加载模型
+        OBJLoader loader;
+        if (!loader.load(objFile, threads)) {
+            std::cerr << "模型加载失败" << std::endl;
+            return 1;
+        }
+        if (useCache) {
+            obj::Mesh mesh = obj::buildMesh(loader);
+            obj::optimizeVertexCache(mesh);
+            bool written = obj::writeMeshCache(cachePath, mesh, objFile);
+            std::cout << (written ? "已写入网格缓存: " : "网格缓存写入失败: ") << cachePath << std::endl;
+            renderer.render(mesh.positions.data(), mesh.positions.size(), mesh.indices.data(), mesh.indices.size());
+        } else {
+            // 渲染线框
+            renderer.render(loader);
+        }
+    }
     renderer.save("obj_loader_output.png");
     
     std::cout << "OBJ模型加载器测试完成！" << std::endl;
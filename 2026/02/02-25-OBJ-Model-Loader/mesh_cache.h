@@ -0,0 +1,299 @@
+/**
+ * 二进制网格缓存（依赖 obj_loader.h）
+ *
+ * OBJ 文本每次运行都要重新解析；这里把解析结果转换成可以直接 mmap 使用的索引网格：
+ *   - buildMesh：按 (位置, 纹理坐标, 法线) 三元组去重，得到统一索引的顶点数组
+ *   - optimizeVertexCache：Tipsify 重排三角形顺序提高顶点后变换缓存命中率，
+ *     再按首次使用顺序重排顶点，让顶点读取也是顺序的
+ *   - writeMeshCache / MeshView：带版本号的文件头 + 位置/法线/UV/32 位索引，加载只需映射和校验
+ */
+
+#pragma once
+
+#include "obj_loader.h"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace obj {
+
+// 统一索引的网格：normals / uvs 为空表示模型没有这类属性，否则与 positions 一样长
+struct Mesh {
+    std::vector<Vec3> positions, normals;
+    std::vector<Vec2> uvs;
+    std::vector<uint32_t> indices;  // 每 3 个一个三角形
+
+    size_t triangleCount() const { return indices.size() / 3; }
+};
+
+// ============================================================
+// 顶点去重
+// ============================================================
+
+inline Mesh buildMesh(const OBJLoader& model) {
+    bool hasUV = false, hasNormal = false;
+    for (const Triangle& f : model.faces) {
+        hasUV = hasUV || f.t0 >= 0 || f.t1 >= 0 || f.t2 >= 0;
+        hasNormal = hasNormal || f.n0 >= 0 || f.n1 >= 0 || f.n2 >= 0;
+    }
+
+    // 位置/纹理坐标/法线下标各 32 位，打包成键；没有纹理坐标或法线的属性记 -1
+    struct Key {
+        int v, t, n;
+        bool operator==(const Key& o) const { return v == o.v && t == o.t && n == o.n; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            uint64_t h = uint64_t(uint32_t(k.v)) * 0x9E3779B97F4A7C15ULL;
+            h ^= (uint64_t(uint32_t(k.t)) + 0x632BE59BD9B4E019ULL) * 0xBF58476D1CE4E5B9ULL;
+            h ^= (uint64_t(uint32_t(k.n)) + 0x94D049BB133111EBULL) * 0xD6E8FEB86659FD93ULL;
+            return size_t(h ^ (h >> 32));
+        }
+    };
+
+    Mesh mesh;
+    std::unordered_map<Key, uint32_t, KeyHash> remap;
+    remap.reserve(model.vertices.size() * 2);
+    mesh.indices.reserve(model.faces.size() * 3);
+    auto addCorner = [&](int v, int t, int n) {
+        Key key{v, hasUV ? t : -1, hasNormal ? n : -1};
+        auto it = remap.emplace(key, uint32_t(mesh.positions.size()));
+        if (it.second) {
+            mesh.positions.push_back(model.vertices[v]);
+            if (hasUV) mesh.uvs.push_back(t >= 0 ? model.texcoords[t] : Vec2());
+            if (hasNormal) mesh.normals.push_back(n >= 0 ? model.normals[n] : Vec3());
+        }
+        mesh.indices.push_back(it.first->second);
+    };
+    for (const Triangle& f : model.faces) {
+        addCorner(f.v0, f.t0, f.n0);
+        addCorner(f.v1, f.t1, f.n1);
+        addCorner(f.v2, f.t2, f.n2);
+    }
+    return mesh;
+}
+
+// ============================================================
+// 顶点缓存优化
+// ============================================================
+
+// FIFO 顶点缓存模拟：平均每个三角形的缓存未命中数（ACMR），1.0 以下越低越好，
+// 规则网格的理论下限约 0.5
+inline double averageCacheMissRatio(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize = 16) {
+    if (indices.empty()) return 0;
+    std::vector<int64_t> insertedAt(vertexCount, -int64_t(cacheSize) - 1);
+    int64_t misses = 0;
+    for (uint32_t v : indices) {
+        // FIFO：顶点在 cacheSize 次未命中之前被放入就还在缓存里
+        if (misses - insertedAt[v] > cacheSize) insertedAt[v] = misses++;
+    }
+    return double(misses) / double(indices.size() / 3);
+}
+
+// Tipsify（Sander, Nehab, Barczak 2007）：从一个"扇心"顶点出发输出它所有未输出的三角形，
+// 下一个扇心优先选还在缓存里、剩余三角形不多的邻居；走进死胡同时回退到最近用过的顶点。
+// 线性时间，之后按首次使用顺序重排顶点
+inline void optimizeVertexCache(Mesh& mesh, int cacheSize = 16) {
+    const size_t vertexCount = mesh.positions.size();
+    const size_t triCount = mesh.triangleCount();
+    if (triCount == 0) return;
+    const std::vector<uint32_t>& in = mesh.indices;
+
+    // 顶点 → 三角形邻接表（CSR）
+    std::vector<uint32_t> offset(vertexCount + 1, 0), adjacency(in.size());
+    for (uint32_t v : in) offset[v + 1]++;
+    for (size_t v = 0; v < vertexCount; v++) offset[v + 1] += offset[v];
+    std::vector<uint32_t> live(vertexCount), cursor(offset.begin(), offset.end() - 1);
+    for (size_t i = 0; i < in.size(); i++) adjacency[cursor[in[i]]++] = uint32_t(i / 3);
+    for (size_t v = 0; v < vertexCount; v++) live[v] = offset[v + 1] - offset[v];
+
+    std::vector<int64_t> cacheTime(vertexCount, 0);
+    std::vector<char> emitted(triCount, 0);
+    std::vector<uint32_t> deadEnd, candidates, out;
+    deadEnd.reserve(in.size());
+    out.reserve(in.size());
+    int64_t stamp = cacheSize + 1;
+    size_t scan = 0;  // 死胡同栈也空了时，按顶点编号顺序找下一个还有剩余三角形的顶点
+
+    int64_t fan = 0;
+    while (fan >= 0) {
+        candidates.clear();
+        for (uint32_t a = offset[fan]; a < offset[fan + 1]; a++) {
+            uint32_t t = adjacency[a];
+            if (emitted[t]) continue;
+            emitted[t] = 1;
+            for (int k = 0; k < 3; k++) {
+                uint32_t v = in[t * 3 + k];
+                out.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (stamp - cacheTime[v] > cacheSize) cacheTime[v] = stamp++;
+            }
+        }
+
+        // 候选扇心：输出它剩余的三角形后它仍在缓存中的顶点里，选最早进入缓存的（最快被挤出）
+        fan = -1;
+        int64_t best = -1;
+        for (uint32_t v : candidates) {
+            if (live[v] == 0) continue;
+            int64_t priority = 0;
+            if (stamp - cacheTime[v] + 2 * int64_t(live[v]) <= cacheSize) priority = stamp - cacheTime[v];
+            if (priority > best) {
+                best = priority;
+                fan = v;
+            }
+        }
+        if (fan >= 0) continue;
+
+        while (!deadEnd.empty() && fan < 0) {
+            uint32_t v = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[v] > 0) fan = v;
+        }
+        while (fan < 0 && scan < vertexCount) {
+            if (live[scan] > 0) fan = int64_t(scan);
+            scan++;
+        }
+    }
+
+    // 顶点按首次出现的顺序重新编号
+    std::vector<uint32_t> newIndex(vertexCount, UINT32_MAX);
+    uint32_t next = 0;
+    for (uint32_t& v : out) {
+        if (newIndex[v] == UINT32_MAX) newIndex[v] = next++;
+        v = newIndex[v];
+    }
+    // 没被任何三角形引用的顶点排在最后
+    for (size_t v = 0; v < vertexCount; v++)
+        if (newIndex[v] == UINT32_MAX) newIndex[v] = next++;
+
+    auto permute = [&](auto& attr) {
+        if (attr.empty()) return;
+        auto reordered = attr;
+        for (size_t v = 0; v < vertexCount; v++) reordered[newIndex[v]] = attr[v];
+        attr.swap(reordered);
+    };
+    permute(mesh.positions);
+    permute(mesh.normals);
+    permute(mesh.uvs);
+    mesh.indices.swap(out);
+}
+
+// ============================================================
+// 缓存文件
+// ============================================================
+
+// 文件布局（小端，按内存布局直接写出，加载时无需解析）：
+//   [0, 64)       MeshCacheHeader
+//   [64, ...)     Vec3 位置 × vertex_count
+//   [..., ...)    Vec3 法线 × vertex_count   （flags & kMeshHasNormals）
+//   [..., ...)    Vec2 UV   × vertex_count   （flags & kMeshHasUVs）
+//   [..., end)    uint32 索引 × index_count
+struct alignas(64) MeshCacheHeader {
+    char magic[8];          // "OBJMESH\0"
+    uint32_t version;
+    uint32_t flags;
+    uint64_t vertex_count;
+    uint64_t index_count;
+    uint64_t source_size;   // 转换时 OBJ 文件的大小和修改时间，用于判断缓存是否过期
+    int64_t source_mtime;
+};
+static_assert(sizeof(MeshCacheHeader) == 64, "MeshCacheHeader 必须是 64 字节");
+static_assert(sizeof(Vec3) == 12 && sizeof(Vec2) == 8, "顶点属性按紧凑 float 数组存储");
+
+const uint32_t kMeshCacheVersion = 1;
+const uint32_t kMeshHasNormals = 1u << 0;
+const uint32_t kMeshHasUVs = 1u << 1;
+
+// 源文件的大小和修改时间；文件不存在时返回 false
+inline bool sourceStamp(const std::string& path, uint64_t& size, int64_t& mtime) {
+    std::error_code ec;
+    size = std::filesystem::file_size(path, ec);
+    if (ec) return false;
+    mtime = int64_t(std::filesystem::last_write_time(path, ec).time_since_epoch().count());
+    return !ec;
+}
+
+inline bool writeMeshCache(const std::string& path, const Mesh& mesh, const std::string& sourcePath = "") {
+    MeshCacheHeader h{};
+    std::memcpy(h.magic, "OBJMESH", 8);
+    h.version = kMeshCacheVersion;
+    h.flags = (mesh.normals.empty() ? 0 : kMeshHasNormals) | (mesh.uvs.empty() ? 0 : kMeshHasUVs);
+    h.vertex_count = mesh.positions.size();
+    h.index_count = mesh.indices.size();
+    if (!sourcePath.empty() && !sourceStamp(sourcePath, h.source_size, h.source_mtime)) return false;
+
+    // 先写临时文件再改名，避免并发任务读到写了一半的缓存
+    std::string tmp = path + ".tmp";
+    std::ofstream out(tmp, std::ios::binary);
+    if (!out) return false;
+    out.write((const char*)&h, sizeof(h));
+    out.write((const char*)mesh.positions.data(), std::streamsize(sizeof(Vec3) * mesh.positions.size()));
+    out.write((const char*)mesh.normals.data(), std::streamsize(sizeof(Vec3) * mesh.normals.size()));
+    out.write((const char*)mesh.uvs.data(), std::streamsize(sizeof(Vec2) * mesh.uvs.size()));
+    out.write((const char*)mesh.indices.data(), std::streamsize(sizeof(uint32_t) * mesh.indices.size()));
+    out.close();
+    if (!out) { std::remove(tmp.c_str()); return false; }
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+// 映射后的只读网格，指针直接指向文件内容
+class MeshView {
+public:
+    // 头部、大小或源文件时间戳不匹配、索引越界时返回 false（调用方应重新转换）；sourcePath 为空时不检查时间戳
+    bool open(const std::string& path, const std::string& sourcePath = "") {
+        if (!file.open(path) || file.size() < sizeof(MeshCacheHeader)) return false;
+        MeshCacheHeader h;
+        std::memcpy(&h, file.data(), sizeof(h));
+        if (std::memcmp(h.magic, "OBJMESH", 8) != 0 || h.version != kMeshCacheVersion) return false;
+        if (!sourcePath.empty()) {
+            uint64_t size;
+            int64_t mtime;
+            if (!sourceStamp(sourcePath, size, mtime) || size != h.source_size || mtime != h.source_mtime) return false;
+        }
+        // 各段先单独和文件大小比较，之后的乘法和加法都不会溢出；
+        // 索引是 uint32，顶点数超过 2^32 的文件不可能是合法缓存
+        uint64_t body = file.size() - sizeof(MeshCacheHeader);
+        if (h.vertex_count > UINT32_MAX || h.vertex_count > body / sizeof(Vec3) ||
+            h.index_count > body / sizeof(uint32_t) || h.index_count % 3 != 0) return false;
+        uint64_t normalCount = (h.flags & kMeshHasNormals) ? h.vertex_count : 0;
+        uint64_t uvCount = (h.flags & kMeshHasUVs) ? h.vertex_count : 0;
+        uint64_t expect = sizeof(Vec3) * (h.vertex_count + normalCount) + sizeof(Vec2) * uvCount +
+                          sizeof(uint32_t) * h.index_count;
+        if (body != expect) return false;
+
+        // 打开时一次性检查索引（在文件末尾），之后按索引取顶点属性不需要再做边界判断
+        const uint32_t* idx = (const uint32_t*)(file.data() + file.size()) - h.index_count;
+        for (uint64_t i = 0; i < h.index_count; i++)
+            if (idx[i] >= h.vertex_count) return false;
+
+        const char* p = file.data() + sizeof(MeshCacheHeader);
+        positions = (const Vec3*)p;
+        p += sizeof(Vec3) * h.vertex_count;
+        normals = normalCount ? (const Vec3*)p : nullptr;
+        p += sizeof(Vec3) * normalCount;
+        uvs = uvCount ? (const Vec2*)p : nullptr;
+        p += sizeof(Vec2) * uvCount;
+        indices = (const uint32_t*)p;
+        vertexCount = size_t(h.vertex_count);
+        indexCount = size_t(h.index_count);
+        return true;
+    }
+
+    const Vec3* positions = nullptr;
+    const Vec3* normals = nullptr;  // 模型没有法线时为空
+    const Vec2* uvs = nullptr;      // 模型没有纹理坐标时为空
+    const uint32_t* indices = nullptr;
+    size_t vertexCount = 0, indexCount = 0;
+
+private:
+    detail::MappedFile file;
+};
+
+} // namespace obj
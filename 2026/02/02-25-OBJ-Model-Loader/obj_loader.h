@@ -0,0 +1,537 @@
+/**
+ * OBJ 模型加载器（头文件，供其他项目共享）
+ *
+ * 解析 Wavefront OBJ 的顶点（v）、纹理坐标（vt）、法线（vn）和面（f），
+ * 类型放在 obj 命名空间中，避免与引用方自己的 Vec3 / Triangle 冲突。
+ *
+ * load() 是快速路径：
+ *   - mmap 映射整个文件（非 POSIX 平台退化为整块读入）
+ *   - 按换行对齐切成若干块，多线程并行解析
+ *   - 手写的整数/浮点解析，直接在映射内存上工作，不分配、不拷贝
+ *   - 各块的顶点/面数组最后合并，负索引（相对索引）在合并时加上前面块的元素数
+ * 多边形面按扇形拆成三角形。loadReference() 保留原来的 getline + istringstream 版本，用于对比。
+ */
+
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace obj {
+
+// 3D向量结构
+struct Vec3 {
+    float x, y, z;
+    Vec3(float x = 0, float y = 0, float z = 0) : x(x), y(y), z(z) {}
+    Vec3 operator+(const Vec3& v) const { return Vec3(x + v.x, y + v.y, z + v.z); }
+    Vec3 operator-(const Vec3& v) const { return Vec3(x - v.x, y - v.y, z - v.z); }
+    Vec3 operator*(float t) const { return Vec3(x * t, y * t, z * t); }
+    float dot(const Vec3& v) const { return x * v.x + y * v.y + z * v.z; }
+    Vec3 cross(const Vec3& v) const {
+        return Vec3(y * v.z - z * v.y, z * v.x - x * v.z, x * v.y - y * v.x);
+    }
+    Vec3 normalize() const {
+        float len = std::sqrt(x * x + y * y + z * z);
+        return len > 0 ? Vec3(x / len, y / len, z / len) : Vec3(0, 0, 0);
+    }
+    float length() const { return std::sqrt(x * x + y * y + z * z); }
+};
+
+// 纹理坐标
+struct Vec2 {
+    float u, v;
+    Vec2(float u = 0, float v = 0) : u(u), v(v) {}
+};
+
+// 三角形面结构
+struct Triangle {
+    int v0, v1, v2;                 // 顶点索引
+    int t0 = -1, t1 = -1, t2 = -1;  // 纹理坐标索引（-1 表示没有）
+    int n0 = -1, n1 = -1, n2 = -1;  // 法线索引（-1 表示没有）
+    Triangle(int a, int b, int c) : v0(a), v1(b), v2(c) {}
+};
+
+// ============================================================
+// 手写数字解析（输入是不以 0 结尾的内存区间，不分配）
+// ============================================================
+
+namespace parse {
+
+inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+inline bool isDigit(char c) { return unsigned(c - '0') < 10u; }
+
+inline const char* skipSpaces(const char* p, const char* end) {
+    while (p < end && isSpace(*p)) ++p;
+    return p;
+}
+
+// 有符号整数；没有数字或溢出时返回 nullptr
+inline const char* parseInt(const char* p, const char* end, long long& out) {
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+')) neg = *p++ == '-';
+    const char* digits = p;
+    long long v = 0;
+    while (p < end && isDigit(*p)) {
+        if (v > (INT32_MAX - 9) / 10) return nullptr;  // OBJ 索引放不下 int，按错误处理
+        v = v * 10 + (*p++ - '0');
+    }
+    if (p == digits) return nullptr;
+    out = neg ? -v : v;
+    return p;
+}
+
+// 浮点数：[+-]digits[.digits][(e|E)[+-]digits]
+// 常见情况（有效数字 <= 15 位、|10 的指数| <= 22）只做一次精确舍入的 double 乘除再转 float，
+// 与 strtof 只在 double→float 二次舍入恰好落在中点时差 1 ulp；
+// 其余情况（inf/nan、超长尾数、极端指数）拷到栈上交给 strtof
+inline const char* parseFloat(const char* p, const char* end, float& out) {
+    static const double kPow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const char* start = p;
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+')) neg = *p++ == '-';
+
+    uint64_t mantissa = 0;
+    int significant = 0;  // 已累计的有效数字（不含前导 0）
+    int exp10 = 0;
+    bool anyDigit = false, exact = true;
+    for (; p < end && isDigit(*p); ++p) {
+        anyDigit = true;
+        if (significant < 19) {
+            mantissa = mantissa * 10 + uint64_t(*p - '0');
+            if (mantissa) significant++;
+        } else {
+            exp10++;
+            exact = false;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && isDigit(*p); ++p) {
+            anyDigit = true;
+            if (significant < 19) {
+                mantissa = mantissa * 10 + uint64_t(*p - '0');
+                if (mantissa) significant++;
+                exp10--;
+            } else {
+                exact = false;
+            }
+        }
+    }
+    if (anyDigit && p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool expNeg = false;
+        if (q < end && (*q == '-' || *q == '+')) expNeg = *q++ == '-';
+        if (q < end && isDigit(*q)) {
+            int e = 0;
+            for (; q < end && isDigit(*q); ++q) e = std::min(e * 10 + (*q - '0'), 100000);
+            exp10 += expNeg ? -e : e;
+            p = q;
+        }
+    }
+
+    if (anyDigit && exact && significant <= 15 && exp10 >= -22 && exp10 <= 22) {
+        double v = double(mantissa);
+        v = exp10 < 0 ? v / kPow10[-exp10] : v * kPow10[exp10];
+        out = float(neg ? -v : v);
+        return p;
+    }
+
+    // 慢路径：以 token 结尾为界拷到栈上
+    char buf[128];
+    size_t len = 0;
+    for (const char* q = start; q < end && !isSpace(*q) && *q != '/' && *q != '\n' && len + 1 < sizeof(buf); ++q)
+        buf[len++] = *q;
+    buf[len] = '\0';
+    char* stop = nullptr;
+    out = std::strtof(buf, &stop);
+    if (stop == buf) return nullptr;
+    return start + (stop - buf);
+}
+
+} // namespace parse
+
+// ============================================================
+// 只读文件映射
+// ============================================================
+
+namespace detail {
+
+// POSIX 下用 mmap 直接映射，其他平台退化为整块读入内存
+class MappedFile {
+public:
+    bool open(const std::string& path) {
+#if defined(__unix__) || defined(__APPLE__)
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0) { ::close(fd); return false; }
+        len = (size_t)st.st_size;
+        if (len > 0) {
+            void* p = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) { ::close(fd); len = 0; return false; }
+            // 多个线程会同时顺序扫描不同区段，提前让内核把整份文件读进来
+            madvise(p, len, MADV_WILLNEED);
+            ptr = (const char*)p;
+            mapped = true;
+        }
+        ::close(fd);
+#else
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in) return false;
+        buffer.resize((size_t)in.tellg());
+        in.seekg(0);
+        in.read(buffer.data(), (std::streamsize)buffer.size());
+        if (!in) return false;
+        ptr = buffer.data();
+        len = buffer.size();
+#endif
+        return true;
+    }
+
+    ~MappedFile() {
+#if defined(__unix__) || defined(__APPLE__)
+        if (mapped) munmap((void*)ptr, len);
+#endif
+    }
+
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return ptr; }
+    size_t size() const { return len; }
+
+private:
+    const char* ptr = nullptr;
+    size_t len = 0;
+    bool mapped = false;
+    std::vector<char> buffer;
+};
+
+// 用 threads 个线程处理 [0, count)，线程用原子计数器领取下标
+template <typename Fn>
+void parallelFor(int count, int threads, Fn&& fn) {
+    threads = std::max(1, std::min(threads, count));
+    if (threads == 1) {
+        for (int i = 0; i < count; ++i) fn(i);
+        return;
+    }
+    std::atomic<int> next{0};
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t) {
+        pool.emplace_back([&] {
+            for (int i; (i = next.fetch_add(1)) < count;) fn(i);
+        });
+    }
+    for (auto& th : pool) th.join();
+}
+
+// 一个块的解析结果。正索引直接转成从 0 开始的全局下标；
+// 负索引记成"块内下标"（可能为负，指向前面的块），合并时再加上前面块的元素数
+struct Chunk {
+    std::vector<Vec3> vertices, normals;
+    std::vector<Vec2> texcoords;
+    std::vector<Triangle> faces;
+    struct Fixup {
+        uint32_t face;
+        uint16_t mask;  // 第 k 位对应 Triangle 中第 k 个索引（v0 v1 v2 t0 t1 t2 n0 n1 n2）
+    };
+    std::vector<Fixup> fixups;
+    size_t skipped = 0;  // 解析失败（索引为 0 或格式错误）的面
+
+    // 面解析的临时缓冲，块内复用
+    struct Corner {
+        int v, t, n;
+        uint16_t relative;  // bit0: v, bit1: t, bit2: n
+    };
+    std::vector<Corner> corners;
+};
+
+inline int* triangleIndex(Triangle& tri, int k) {
+    int* slots[9] = {&tri.v0, &tri.v1, &tri.v2, &tri.t0, &tri.t1, &tri.t2, &tri.n0, &tri.n1, &tri.n2};
+    return slots[k];
+}
+
+// 一个面顶点中的一个索引；count 是本块到目前为止该类元素的数量。
+// 超出 int 范围的索引按格式错误处理（截断后可能恰好变成 -1，被当成"没有该属性"）
+inline const char* parseIndex(const char* p, const char* end, size_t count, int& out, bool& relative) {
+    long long raw;
+    p = parse::parseInt(p, end, raw);
+    if (!p || raw == 0 || raw > INT_MAX || raw < -(long long)INT_MAX) return nullptr;
+    relative = raw < 0;
+    out = int(relative ? (long long)count + raw : raw - 1);
+    return p;
+}
+
+// f v1[/vt1][/vn1] v2... ，n 边形按扇形拆成 n-2 个三角形
+inline void parseFace(const char* p, const char* end, Chunk& c) {
+    c.corners.clear();
+    for (p = parse::skipSpaces(p, end); p < end && *p != '#'; p = parse::skipSpaces(p, end)) {
+        Chunk::Corner corner{0, -1, -1, 0};
+        bool rel = false;
+        p = parseIndex(p, end, c.vertices.size(), corner.v, rel);
+        if (!p) { c.skipped++; return; }
+        corner.relative |= rel ? 1 : 0;
+        if (p < end && *p == '/') {
+            ++p;
+            if (p < end && *p != '/') {
+                p = parseIndex(p, end, c.texcoords.size(), corner.t, rel);
+                if (!p) { c.skipped++; return; }
+                corner.relative |= rel ? 2 : 0;
+            }
+            if (p < end && *p == '/') {
+                p = parseIndex(p + 1, end, c.normals.size(), corner.n, rel);
+                if (!p) { c.skipped++; return; }
+                corner.relative |= rel ? 4 : 0;
+            }
+        }
+        if (p < end && !parse::isSpace(*p)) { c.skipped++; return; }
+        c.corners.push_back(corner);
+    }
+    if (c.corners.size() < 3) {
+        if (!c.corners.empty()) c.skipped++;
+        return;
+    }
+
+    const Chunk::Corner& a = c.corners[0];
+    for (size_t k = 1; k + 1 < c.corners.size(); ++k) {
+        const Chunk::Corner* abc[3] = {&a, &c.corners[k], &c.corners[k + 1]};
+        Triangle tri(abc[0]->v, abc[1]->v, abc[2]->v);
+        tri.t0 = abc[0]->t; tri.t1 = abc[1]->t; tri.t2 = abc[2]->t;
+        tri.n0 = abc[0]->n; tri.n1 = abc[1]->n; tri.n2 = abc[2]->n;
+        uint16_t mask = 0;
+        for (int j = 0; j < 3; ++j) {
+            uint16_t r = abc[j]->relative;
+            mask |= uint16_t(((r & 1) << j) | (((r >> 1) & 1) << (3 + j)) | (((r >> 2) & 1) << (6 + j)));
+        }
+        if (mask) c.fixups.push_back({uint32_t(c.faces.size()), mask});
+        c.faces.push_back(tri);
+    }
+}
+
+inline void parseLine(const char* p, const char* end, Chunk& c) {
+    p = parse::skipSpaces(p, end);
+    if (end - p < 2) return;
+    if (p[0] == 'v') {
+        if (parse::isSpace(p[1])) {
+            float xyz[3] = {0, 0, 0};
+            const char* q = p + 2;
+            for (float& f : xyz) {
+                q = parse::skipSpaces(q, end);
+                const char* r = parse::parseFloat(q, end, f);
+                if (!r) break;
+                q = r;
+            }
+            // 格式错误也保留一个顶点，否则后面的索引都会错位
+            c.vertices.emplace_back(xyz[0], xyz[1], xyz[2]);
+        } else if ((p[1] == 't' || p[1] == 'n') && end - p > 2 && parse::isSpace(p[2])) {
+            float xyz[3] = {0, 0, 0};
+            const char* q = p + 3;
+            for (int k = 0; k < (p[1] == 't' ? 2 : 3); ++k) {
+                q = parse::skipSpaces(q, end);
+                const char* r = parse::parseFloat(q, end, xyz[k]);
+                if (!r) break;
+                q = r;
+            }
+            if (p[1] == 't') c.texcoords.emplace_back(xyz[0], xyz[1]);
+            else c.normals.emplace_back(xyz[0], xyz[1], xyz[2]);
+        }
+    } else if (p[0] == 'f' && parse::isSpace(p[1])) {
+        parseFace(p + 2, end, c);
+    }
+    // 其余（#、o、g、s、usemtl、mtllib……）忽略
+}
+
+inline void parseChunk(const char* p, const char* end, Chunk& c) {
+    while (p < end) {
+        const char* eol = (const char*)std::memchr(p, '\n', size_t(end - p));
+        if (!eol) eol = end;
+        parseLine(p, eol, c);
+        p = eol + 1;
+    }
+}
+
+} // namespace detail
+
+// OBJ模型加载器
+class OBJLoader {
+public:
+    std::vector<Vec3> vertices;
+    std::vector<Vec2> texcoords;
+    std::vector<Vec3> normals;
+    std::vector<Triangle> faces;
+    size_t skippedFaces = 0;  // 格式错误或索引越界而丢弃的三角形
+    bool verbose = true;      // 加载完成后打印统计
+
+    // 快速路径；threads = 0 时使用全部硬件线程
+    bool load(const std::string& filename, int threads = 0) {
+        detail::MappedFile file;
+        if (!file.open(filename)) {
+            std::cerr << "无法打开文件: " << filename << std::endl;
+            return false;
+        }
+        loadFromMemory(file.data(), file.size(), threads);
+        if (verbose) {
+            std::cout << "模型加载完成: " << vertices.size() << " 顶点, " << faces.size() << " 三角形";
+            if (!texcoords.empty()) std::cout << ", " << texcoords.size() << " 纹理坐标";
+            if (!normals.empty()) std::cout << ", " << normals.size() << " 法线";
+            if (skippedFaces) std::cout << ", 丢弃 " << skippedFaces << " 个无效面";
+            std::cout << std::endl;
+        }
+        return true;
+    }
+
+    // 解析内存中的 OBJ 文本（不要求以 0 结尾），结果替换当前内容
+    void loadFromMemory(const char* data, size_t size, int threads = 0) {
+        if (threads <= 0) threads = int(std::max(1u, std::thread::hardware_concurrency()));
+
+        // 每块至少 1 MB，块数是线程数的几倍，让快慢不一的块能互相填补
+        const size_t kMinChunk = size_t(1) << 20;
+        int chunkCount = int(std::max<size_t>(1, std::min<size_t>(size_t(threads) * 4, size / kMinChunk)));
+        std::vector<size_t> bounds(chunkCount + 1, size);
+        bounds[0] = 0;
+        for (int i = 1; i < chunkCount; ++i) {
+            // 从等分点往后找到下一行的开头；不会越过上一个边界
+            size_t pos = std::max(bounds[i - 1], size / chunkCount * i);
+            const void* nl = pos < size ? std::memchr(data + pos, '\n', size - pos) : nullptr;
+            bounds[i] = nl ? size_t((const char*)nl - data) + 1 : size;
+        }
+
+        std::vector<detail::Chunk> chunks(chunkCount);
+        detail::parallelFor(chunkCount, threads, [&](int i) {
+            detail::parseChunk(data + bounds[i], data + bounds[i + 1], chunks[i]);
+        });
+        merge(chunks, threads);
+    }
+
+    // 原始实现：逐行 getline + istringstream，只支持三角形面和正索引（性能对比用）
+    bool loadReference(const std::string& filename) {
+        std::ifstream file(filename);
+        if (!file.is_open()) {
+            std::cerr << "无法打开文件: " << filename << std::endl;
+            return false;
+        }
+
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream iss(line);
+            std::string prefix;
+            iss >> prefix;
+
+            if (prefix == "v") {
+                // 顶点坐标
+                float x, y, z;
+                iss >> x >> y >> z;
+                vertices.push_back(Vec3(x, y, z));
+            }
+            else if (prefix == "f") {
+                // 三角形面（支持格式：f v1 v2 v3 或 f v1/vt1/vn1 v2/vt2/vn2 v3/vt3/vn3）
+                std::string v1, v2, v3;
+                iss >> v1 >> v2 >> v3;
+
+                int idx1 = parseVertexIndex(v1);
+                int idx2 = parseVertexIndex(v2);
+                int idx3 = parseVertexIndex(v3);
+
+                if (idx1 >= 0 && idx2 >= 0 && idx3 >= 0) {
+                    faces.push_back(Triangle(idx1, idx2, idx3));
+                }
+            }
+        }
+
+        file.close();
+        if (verbose) {
+            std::cout << "模型加载完成: " << vertices.size() << " 顶点, "
+                      << faces.size() << " 三角形" << std::endl;
+        }
+        return true;
+    }
+
+private:
+    int parseVertexIndex(const std::string& token) {
+        // 解析格式：v 或 v/vt 或 v/vt/vn 或 v//vn
+        size_t pos = token.find('/');
+        std::string indexStr = (pos == std::string::npos) ? token : token.substr(0, pos);
+        int index = std::stoi(indexStr);
+        // OBJ索引从1开始，转换为从0开始
+        return index - 1;
+    }
+
+    // 合并各块：先算每块在全局数组中的起点，再并行修正相对索引、剔除越界面、拷贝
+    void merge(std::vector<detail::Chunk>& chunks, int threads) {
+        const size_t n = chunks.size();
+        std::vector<size_t> vBase(n + 1, 0), tBase(n + 1, 0), nBase(n + 1, 0), fBase(n + 1, 0);
+        for (size_t i = 0; i < n; ++i) {
+            vBase[i + 1] = vBase[i] + chunks[i].vertices.size();
+            tBase[i + 1] = tBase[i] + chunks[i].texcoords.size();
+            nBase[i + 1] = nBase[i] + chunks[i].normals.size();
+        }
+        const long long limits[3] = {(long long)vBase[n], (long long)tBase[n], (long long)nBase[n]};
+
+        detail::parallelFor(int(n), threads, [&](int i) {
+            detail::Chunk& c = chunks[i];
+            const long long base[3] = {(long long)vBase[i], (long long)tBase[i], (long long)nBase[i]};
+            // 相对索引修正后仍为负说明指到了文件开头之前：记成 INT_MIN，下面按越界剔除，
+            // 不能留成 -1 和 t/n 的"没有该属性"混在一起
+            for (const auto& fix : c.fixups) {
+                Triangle& tri = c.faces[fix.face];
+                for (int k = 0; k < 9; ++k) {
+                    if (!(fix.mask & (1u << k))) continue;
+                    int* idx = detail::triangleIndex(tri, k);
+                    long long global = *idx + base[k / 3];
+                    *idx = global < 0 ? INT_MIN : int(global);
+                }
+            }
+            // 原地压缩掉索引越界的三角形；t/n 为 -1 表示没有，不算越界
+            auto inRange = [](int idx, long long limit, int lowest) { return idx >= lowest && idx < limit; };
+            size_t kept = 0;
+            for (const Triangle& tri : c.faces) {
+                bool ok = inRange(tri.v0, limits[0], 0) && inRange(tri.v1, limits[0], 0) &&
+                          inRange(tri.v2, limits[0], 0) && inRange(tri.t0, limits[1], -1) &&
+                          inRange(tri.t1, limits[1], -1) && inRange(tri.t2, limits[1], -1) &&
+                          inRange(tri.n0, limits[2], -1) && inRange(tri.n1, limits[2], -1) &&
+                          inRange(tri.n2, limits[2], -1);
+                if (ok) c.faces[kept++] = tri;
+            }
+            c.skipped += c.faces.size() - kept;
+            c.faces.resize(kept, Triangle(0, 0, 0));
+        });
+
+        skippedFaces = 0;
+        for (size_t i = 0; i < n; ++i) {
+            fBase[i + 1] = fBase[i] + chunks[i].faces.size();
+            skippedFaces += chunks[i].skipped;
+        }
+        vertices.resize(vBase[n]);
+        texcoords.resize(tBase[n]);
+        normals.resize(nBase[n]);
+        faces.assign(fBase[n], Triangle(0, 0, 0));
+        detail::parallelFor(int(n), threads, [&](int i) {
+            const detail::Chunk& c = chunks[i];
+            std::copy(c.vertices.begin(), c.vertices.end(), vertices.begin() + vBase[i]);
+            std::copy(c.texcoords.begin(), c.texcoords.end(), texcoords.begin() + tBase[i]);
+            std::copy(c.normals.begin(), c.normals.end(), normals.begin() + nBase[i]);
+            std::copy(c.faces.begin(), c.faces.end(), faces.begin() + fBase[i]);
+        });
+    }
+};
+
+} // namespace obj
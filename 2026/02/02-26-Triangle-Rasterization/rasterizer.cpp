@@ -4,6 +4,20 @@
 #include <cmath>
 #include <fstream>
 #include <limits>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "../../../playground/common/perf.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RASTER_X86 1
+#endif
 
 // 简单的 Vec2/Vec3 类
 struct Vec2 {
@@ -43,11 +57,12 @@ Vec3 barycentric(const Vec2& p, const Vec2& a, const Vec2& b, const Vec2& c) {
     float den = v0.x * v1.y - v1.x * v0.y;
     if (std::abs(den) < 1e-6) return Vec3(-1, 1, 1); // 退化三角形
     
-    float v = (v2.x * v1.y - v1.x * v2.y) / den;
-    float w = (v0.x * v2.y - v2.x * v0.y) / den;
-    float u = 1.0f - v - w;
+    // v0 = c - a，所以第一个比值是 c 的权重、第二个才是 b 的权重
+    float wc = (v2.x * v1.y - v1.x * v2.y) / den;
+    float wb = (v0.x * v2.y - v2.x * v0.y) / den;
+    float u = 1.0f - wb - wc;
     
-    return Vec3(u, v, w);
+    return Vec3(u, wb, wc);
 }
 
 // 光栅化三角形
@@ -101,6 +116,502 @@ void rasterizeTriangle(
     }
 }
 
+// ========== 分块光栅化（tile binning + 定点边函数 + 多线程） ==========
+// 1. setup：每个三角形转成 8 位亚像素定点坐标，算好三条边函数 E = A*x + B*y + C，
+//    并按 64x64 屏幕块分箱（包围盒覆盖的块里再用边函数剔除完全不相交的块）
+// 2. 光栅化：工作线程逐个领取块，块内颜色/深度缓冲是线程私有的，
+//    按提交顺序遍历该块的三角形，边函数每走一个像素只做加法，最后写回整帧
+// 各块互不重叠，线程之间没有任何锁；同一块内的顺序与逐个提交一致，结果与线程数无关
+
+constexpr int kSubpixelBits = 8;
+constexpr int64_t kSubpixelOne = int64_t(1) << kSubpixelBits;
+constexpr int kTileSize = 64;
+
+struct TriangleSetup {
+    // 边 i 是顶点 i 的对边；E_i >= 0（加上 top-left 偏置后）表示在三角形内，E_i / area 即重心坐标
+    int64_t A[3], B[3], C[3];
+    int64_t bias[3];
+    float invArea;
+    float z[3], r[3], g[3], b[3];
+    int minX, maxX, minY, maxY;  // 像素包围盒（已裁剪到屏幕）
+    // 层次 Z 用的深度下界：minZ 为三个顶点最小深度，深度平面 z = zA*fx + zB*fy + zC（定点坐标）
+    float minZ, zMargin;
+    double zA, zB, zC;
+};
+
+struct BinnedScene {
+    int width, height, tilesX, tilesY;
+    std::vector<TriangleSetup> tris;
+    // bins[chunk][tile]：每个 setup 线程处理一段连续的三角形，按块记录下标，
+    // 工作线程按 chunk 顺序读取，即可保持提交顺序
+    std::vector<std::vector<std::vector<uint32_t>>> bins;
+};
+
+inline int64_t toFixed(float v) { return (int64_t)std::llround(double(v) * double(kSubpixelOne)); }
+
+// 返回 false 表示退化或完全在屏幕外
+bool setupTriangle(const Vertex& a, const Vertex& b, const Vertex& c, int width, int height, TriangleSetup& t) {
+    const Vertex* v[3] = {&a, &b, &c};
+    int64_t x[3], y[3];
+    for (int i = 0; i < 3; i++) {
+        x[i] = toFixed(v[i]->pos.x);
+        y[i] = toFixed(v[i]->pos.y);
+    }
+    int64_t area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (area == 0) return false;
+    // 原实现两种绕序都接受；统一成 area > 0
+    if (area < 0) {
+        std::swap(v[1], v[2]);
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        area = -area;
+    }
+
+    float minXf = std::min({a.pos.x, b.pos.x, c.pos.x}), maxXf = std::max({a.pos.x, b.pos.x, c.pos.x});
+    float minYf = std::min({a.pos.y, b.pos.y, c.pos.y}), maxYf = std::max({a.pos.y, b.pos.y, c.pos.y});
+    t.minX = std::max(0, (int)std::floor(minXf));
+    t.maxX = std::min(width - 1, (int)std::ceil(maxXf));
+    t.minY = std::max(0, (int)std::floor(minYf));
+    t.maxY = std::min(height - 1, (int)std::ceil(maxYf));
+    if (t.minX > t.maxX || t.minY > t.maxY) return false;
+
+    for (int i = 0; i < 3; i++) {
+        int j = (i + 1) % 3, k = (i + 2) % 3;
+        // E_i(p) = (x_k - x_j)(p.y - y_j) - (y_k - y_j)(p.x - x_j)，在 v_i 处等于 area
+        t.A[i] = y[j] - y[k];
+        t.B[i] = x[k] - x[j];
+        t.C[i] = x[j] * y[k] - x[k] * y[j];
+        // top-left 规则：像素中心正好落在共享边上时只归属一个三角形
+        bool topLeft = t.A[i] > 0 || (t.A[i] == 0 && t.B[i] < 0);
+        t.bias[i] = topLeft ? 0 : -1;
+        t.z[i] = v[i]->z;
+        t.r[i] = v[i]->color.r;
+        t.g[i] = v[i]->color.g;
+        t.b[i] = v[i]->color.b;
+    }
+    t.invArea = 1.0f / float(area);
+
+    // 逐像素深度是 float 重心坐标的加权和，三个权重之和可能比 1 略小，
+    // 下界留出相对 1e-5 的余量，保证层次 Z 的剔除永远不会剔掉实际能通过深度测试的像素
+    float maxAbsZ = std::max({std::abs(t.z[0]), std::abs(t.z[1]), std::abs(t.z[2])});
+    t.zMargin = 1e-5f * maxAbsZ + 1e-30f;
+    t.minZ = std::min({t.z[0], t.z[1], t.z[2]}) - t.zMargin;
+    t.zA = t.zB = t.zC = 0.0;
+    for (int i = 0; i < 3; i++) {
+        t.zA += double(t.A[i]) * t.z[i];
+        t.zB += double(t.B[i]) * t.z[i];
+        t.zC += double(t.C[i]) * t.z[i];
+    }
+    t.zA /= double(area);
+    t.zB /= double(area);
+    t.zC /= double(area);
+    return true;
+}
+
+// 像素 (px, py) 中心处的边函数值
+inline int64_t edgeAt(const TriangleSetup& t, int i, int px, int py) {
+    int64_t fx = int64_t(px) * kSubpixelOne + kSubpixelOne / 2;
+    int64_t fy = int64_t(py) * kSubpixelOne + kSubpixelOne / 2;
+    return t.A[i] * fx + t.B[i] * fy + t.C[i] + t.bias[i];
+}
+
+// 三角形是否可能覆盖块 [x0,x1]x[y0,y1]：每条边在块内取最大值的那个角，若仍 < 0 则整块在外
+inline bool overlapsTile(const TriangleSetup& t, int x0, int y0, int x1, int y1) {
+    for (int i = 0; i < 3; i++) {
+        int px = t.A[i] > 0 ? x1 : x0;
+        int py = t.B[i] > 0 ? y1 : y0;
+        if (edgeAt(t, i, px, py) < 0) return false;
+    }
+    return true;
+}
+
+void binTriangles(const std::vector<Vertex>& verts, int width, int height, int threads, BinnedScene& scene) {
+    PERF_ZONE("raster.bin");
+    const size_t triCount = verts.size() / 3;
+    scene.width = width;
+    scene.height = height;
+    scene.tilesX = (width + kTileSize - 1) / kTileSize;
+    scene.tilesY = (height + kTileSize - 1) / kTileSize;
+    scene.tris.resize(triCount);
+    scene.bins.assign(threads, std::vector<std::vector<uint32_t>>(scene.tilesX * scene.tilesY));
+
+    auto work = [&](int chunk) {
+        size_t begin = triCount * chunk / threads, end = triCount * (chunk + 1) / threads;
+        auto& bins = scene.bins[chunk];
+        for (size_t i = begin; i < end; i++) {
+            TriangleSetup& t = scene.tris[i];
+            if (!setupTriangle(verts[3 * i], verts[3 * i + 1], verts[3 * i + 2], width, height, t)) continue;
+            int tx0 = t.minX / kTileSize, tx1 = t.maxX / kTileSize;
+            int ty0 = t.minY / kTileSize, ty1 = t.maxY / kTileSize;
+            for (int ty = ty0; ty <= ty1; ty++) {
+                for (int tx = tx0; tx <= tx1; tx++) {
+                    // 只跨一个块的小三角形不必再测
+                    if ((tx0 != tx1 || ty0 != ty1) &&
+                        !overlapsTile(t, std::max(tx * kTileSize, t.minX), std::max(ty * kTileSize, t.minY),
+                                      std::min(tx * kTileSize + kTileSize - 1, t.maxX),
+                                      std::min(ty * kTileSize + kTileSize - 1, t.maxY))) {
+                        continue;
+                    }
+                    bins[ty * scene.tilesX + tx].push_back(uint32_t(i));
+                }
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int c = 1; c < threads; c++) pool.emplace_back(work, c);
+    work(0);
+    for (auto& th : pool) th.join();
+}
+
+// ========== 层次 Z（Hierarchical Z）==========
+// 每个 64x64 块再分成 8x8 的小块，记录小块内深度缓冲的最大值 blockMax 和整块最大值 tileMax。
+// 三角形（或它覆盖的某个小块）的深度下界 >= 对应最大值时，不可能有像素通过 z < depth 测试，直接跳过：
+//   1. 三角形级：minZ >= tileMax，整个三角形在这一块内被遮挡
+//   2. 小块级：max(minZ, 深度平面在小块四角的最小值) >= blockMax
+// 预深度模式先只写深度和"可见三角形下标"，第二遍每个像素只着色一次。
+
+constexpr int kBlockSize = 8;
+constexpr int kBlocksPerSide = kTileSize / kBlockSize;
+constexpr uint32_t kNoTriangle = 0xFFFFFFFFu;
+
+int defaultThreads() { return std::max(1, (int)std::thread::hardware_concurrency()); }
+
+struct RasterOptions {
+    int threads = defaultThreads();
+    bool hiZ = true;            // 层次 Z 剔除
+    bool depthPrepass = false;  // 预深度：先定可见性，再逐像素着色一次
+    bool simd = true;           // 8 像素一组的 AVX2 内层循环（CPU 不支持时自动退回标量）
+};
+
+struct RasterStats {
+    size_t trianglesRejected = 0;  // 三角形级层次 Z 剔除（按块计）
+    size_t blocksTested = 0;       // 做过层次 Z 测试的 8x8 小块
+    size_t blocksRejected = 0;     // 其中被剔除的
+    size_t pixelsShaded = 0;       // 颜色插值次数
+};
+
+// 块内颜色打包成 32 位 0x00BBGGRR，SIMD 路径可以直接按掩码写 8 个像素
+inline uint32_t packColor(unsigned r, unsigned g, unsigned b) { return r | (g << 8) | (b << 16); }
+inline Color unpackColor(uint32_t c) { return Color(c & 0xFF, (c >> 8) & 0xFF, (c >> 16) & 0xFF); }
+
+// 工作线程私有的块状态
+struct TileContext {
+    int x0, y0, w, h;
+    uint32_t* color;
+    float* depth;
+    uint32_t* visible;  // 预深度模式下每个像素的可见三角形
+    float blockMax[kBlocksPerSide * kBlocksPerSide];
+    float tileMax;
+    RasterStats stats;
+
+    void updateBlock(int bx, int by) {
+        float m = -std::numeric_limits<float>::infinity();
+        for (int y = by * kBlockSize; y < (by + 1) * kBlockSize; y++) {
+            const float* row = depth + y * kTileSize + bx * kBlockSize;
+            for (int x = 0; x < kBlockSize; x++) m = std::max(m, row[x]);
+        }
+        blockMax[by * kBlocksPerSide + bx] = m;
+    }
+    void updateTileMax() {
+        tileMax = -std::numeric_limits<float>::infinity();
+        for (float m : blockMax) tileMax = std::max(tileMax, m);
+    }
+    void rebuildHiZ() {
+        for (int by = 0; by < kBlocksPerSide; by++)
+            for (int bx = 0; bx < kBlocksPerSide; bx++) updateBlock(bx, by);
+        updateTileMax();
+    }
+};
+
+// 深度平面在像素 (px, py) 中心的值
+inline double planeZ(const TriangleSetup& t, int px, int py) {
+    return t.zA * (double(px) * kSubpixelOne + kSubpixelOne / 2) + t.zB * (double(py) * kSubpixelOne + kSubpixelOne / 2) +
+           t.zC;
+}
+
+// 单个 8x8 小块内 [rx0,rx1]x[ry0,ry1] 的逐像素光栅化，返回是否写过深度
+template <bool kDepthOnly>
+bool rasterizeBlockScalar(const TriangleSetup& t, uint32_t triIndex, TileContext& ctx, int rx0, int ry0, int rx1,
+                          int ry1) {
+    const int64_t stepX[3] = {t.A[0] * kSubpixelOne, t.A[1] * kSubpixelOne, t.A[2] * kSubpixelOne};
+    const int64_t stepY[3] = {t.B[0] * kSubpixelOne, t.B[1] * kSubpixelOne, t.B[2] * kSubpixelOne};
+    int64_t row[3];
+    for (int i = 0; i < 3; i++) row[i] = edgeAt(t, i, rx0, ry0);
+    bool wrote = false;
+    for (int y = ry0; y <= ry1; y++) {
+        int64_t e0 = row[0], e1 = row[1], e2 = row[2];
+        int idx = (y - ctx.y0) * kTileSize + (rx0 - ctx.x0);
+        for (int x = rx0; x <= rx1; x++, idx++, e0 += stepX[0], e1 += stepX[1], e2 += stepX[2]) {
+            if ((e0 | e1 | e2) < 0) continue;  // 任一为负则符号位为 1
+
+            // 去掉 top-left 偏置后就是重心坐标的分子
+            float l0 = float(e0 - t.bias[0]) * t.invArea;
+            float l1 = float(e1 - t.bias[1]) * t.invArea;
+            float l2 = float(e2 - t.bias[2]) * t.invArea;
+            float z = l0 * t.z[0] + l1 * t.z[1] + l2 * t.z[2];
+            if (z < ctx.depth[idx]) {
+                ctx.depth[idx] = z;
+                wrote = true;
+                if (kDepthOnly) {
+                    ctx.visible[idx] = triIndex;
+                } else {
+                    ctx.color[idx] = packColor((unsigned char)(l0 * t.r[0] + l1 * t.r[1] + l2 * t.r[2]),
+                                               (unsigned char)(l0 * t.g[0] + l1 * t.g[1] + l2 * t.g[2]),
+                                               (unsigned char)(l0 * t.b[0] + l1 * t.b[1] + l2 * t.b[2]));
+                    ctx.stats.pixelsShaded++;
+                }
+            }
+        }
+        for (int i = 0; i < 3; i++) row[i] += stepY[i];
+    }
+    return wrote;
+}
+
+#if RASTER_X86
+
+// 8 像素一组（小块的一整行）：
+//   - 边函数用两组 4 路 double 累加。定点边函数值 < 2^53，double 表示和加法都是精确的，
+//     覆盖判定与标量版的 int64 完全相同，转 float 的舍入也与 float(int64) 相同
+//   - 重心坐标、深度、颜色插值用 8 路 float，运算顺序与标量版一致（不用 FMA），结果逐位相同
+//   - 覆盖掩码 & 深度测试掩码，深度/颜色/可见下标都用 maskstore 写回
+// 两组 4 路 double 转成一组 8 路 float
+__attribute__((target("avx2"))) inline __m256 edgeToFloat(__m256d lo, __m256d hi) {
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(lo)), _mm256_cvtpd_ps(hi), 1);
+}
+
+// 一个颜色通道的插值，截断为整数（与 (unsigned char)float 一样向零取整）
+__attribute__((target("avx2"))) inline __m256i interpolateChannel(__m256 l0, __m256 l1, __m256 l2, const float* c) {
+    __m256 v = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(l0, _mm256_set1_ps(c[0])), _mm256_mul_ps(l1, _mm256_set1_ps(c[1]))),
+                             _mm256_mul_ps(l2, _mm256_set1_ps(c[2])));
+    return _mm256_cvttps_epi32(v);
+}
+
+template <bool kDepthOnly>
+__attribute__((target("avx2"))) bool rasterizeBlockAVX2(const TriangleSetup& t, uint32_t triIndex, TileContext& ctx,
+                                                        int rx0, int ry0, int rx1, int ry1) {
+    // 总是从小块左边界开始取 8 列，包围盒外的列用掩码去掉
+    const int bx0 = ctx.x0 + ((rx0 - ctx.x0) & ~(kBlockSize - 1));
+    const int columns = (0xFF << (rx0 - bx0)) & (0xFF >> (kBlockSize - 1 - (rx1 - bx0)));
+    const __m256i laneBit = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+
+    __m256d rowEdge[3], offLo[3], offHi[3], threshold[3];
+    __m256d stepY[3];
+    for (int i = 0; i < 3; i++) {
+        // 不含 top-left 偏置的原始边函数；偏置改成阈值：raw >= -bias
+        double raw = double(edgeAt(t, i, bx0, ry0) - t.bias[i]);
+        double sx = double(t.A[i] * kSubpixelOne);
+        rowEdge[i] = _mm256_set1_pd(raw);
+        offLo[i] = _mm256_setr_pd(0.0, sx, 2.0 * sx, 3.0 * sx);
+        offHi[i] = _mm256_setr_pd(4.0 * sx, 5.0 * sx, 6.0 * sx, 7.0 * sx);
+        threshold[i] = _mm256_set1_pd(double(-t.bias[i]));
+        stepY[i] = _mm256_set1_pd(double(t.B[i] * kSubpixelOne));
+    }
+    const __m256 invArea = _mm256_set1_ps(t.invArea);
+    const __m256 z0 = _mm256_set1_ps(t.z[0]), z1 = _mm256_set1_ps(t.z[1]), z2 = _mm256_set1_ps(t.z[2]);
+
+    bool wrote = false;
+    for (int y = ry0; y <= ry1; y++) {
+        __m256d lo[3], hi[3];
+        __m256d coverLo = _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), coverHi = coverLo;
+        for (int i = 0; i < 3; i++) {
+            lo[i] = _mm256_add_pd(rowEdge[i], offLo[i]);
+            hi[i] = _mm256_add_pd(rowEdge[i], offHi[i]);
+            coverLo = _mm256_and_pd(coverLo, _mm256_cmp_pd(lo[i], threshold[i], _CMP_GE_OQ));
+            coverHi = _mm256_and_pd(coverHi, _mm256_cmp_pd(hi[i], threshold[i], _CMP_GE_OQ));
+            rowEdge[i] = _mm256_add_pd(rowEdge[i], stepY[i]);
+        }
+        // 两组 4 路 64 位掩码先压成 8 位，再展开成 8 路 32 位掩码
+        int coverBits = (_mm256_movemask_pd(coverLo) | (_mm256_movemask_pd(coverHi) << 4)) & columns;
+        if (coverBits == 0) continue;
+        __m256i covered = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(coverBits), laneBit), laneBit);
+
+        __m256 l0 = _mm256_mul_ps(edgeToFloat(lo[0], hi[0]), invArea);
+        __m256 l1 = _mm256_mul_ps(edgeToFloat(lo[1], hi[1]), invArea);
+        __m256 l2 = _mm256_mul_ps(edgeToFloat(lo[2], hi[2]), invArea);
+        __m256 z = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(l0, z0), _mm256_mul_ps(l1, z1)), _mm256_mul_ps(l2, z2));
+
+        float* depth = ctx.depth + (y - ctx.y0) * kTileSize + (bx0 - ctx.x0);
+        __m256i pass = _mm256_and_si256(covered, _mm256_castps_si256(_mm256_cmp_ps(z, _mm256_loadu_ps(depth), _CMP_LT_OQ)));
+        int passBits = _mm256_movemask_ps(_mm256_castsi256_ps(pass));
+        if (passBits == 0) continue;
+        _mm256_maskstore_ps(depth, pass, z);
+        wrote = true;
+
+        int idx = (y - ctx.y0) * kTileSize + (bx0 - ctx.x0);
+        if (kDepthOnly) {
+            _mm256_maskstore_epi32(reinterpret_cast<int*>(ctx.visible + idx), pass, _mm256_set1_epi32(int(triIndex)));
+        } else {
+            __m256i r = interpolateChannel(l0, l1, l2, t.r);
+            __m256i g = interpolateChannel(l0, l1, l2, t.g);
+            __m256i b = interpolateChannel(l0, l1, l2, t.b);
+            __m256i rgb = _mm256_or_si256(r, _mm256_or_si256(_mm256_slli_epi32(g, 8), _mm256_slli_epi32(b, 16)));
+            _mm256_maskstore_epi32(reinterpret_cast<int*>(ctx.color + idx), pass, rgb);
+            ctx.stats.pixelsShaded += size_t(__builtin_popcount(passBits));
+        }
+    }
+    return wrote;
+}
+
+inline bool cpuHasAVX2() {
+    static const bool has = __builtin_cpu_supports("avx2");
+    return has;
+}
+
+#else
+
+template <bool kDepthOnly>
+bool rasterizeBlockAVX2(const TriangleSetup& t, uint32_t triIndex, TileContext& ctx, int rx0, int ry0, int rx1,
+                        int ry1) {
+    return rasterizeBlockScalar<kDepthOnly>(t, triIndex, ctx, rx0, ry0, rx1, ry1);
+}
+
+inline bool cpuHasAVX2() { return false; }
+
+#endif  // RASTER_X86
+
+// 在线程私有的块缓冲中光栅化一个三角形。kDepthOnly 为预深度 pass：只写深度和可见三角形下标
+template <bool kDepthOnly>
+void rasterizeInTile(const TriangleSetup& t, uint32_t triIndex, TileContext& ctx, bool hiZ, bool simd) {
+    int x0 = std::max(t.minX, ctx.x0), x1 = std::min(t.maxX, ctx.x0 + ctx.w - 1);
+    int y0 = std::max(t.minY, ctx.y0), y1 = std::min(t.maxY, ctx.y0 + ctx.h - 1);
+    if (x0 > x1 || y0 > y1) return;
+    if (hiZ && t.minZ >= ctx.tileMax) {
+        ctx.stats.trianglesRejected++;
+        return;
+    }
+
+    // 小三角形只落在一个 8x8 小块里时，包围盒已经够紧，不必再做小块覆盖测试
+    const bool multiBlock = (x0 - ctx.x0) / kBlockSize != (x1 - ctx.x0) / kBlockSize ||
+                            (y0 - ctx.y0) / kBlockSize != (y1 - ctx.y0) / kBlockSize;
+    bool hiZDirty = false;
+
+    for (int by = (y0 - ctx.y0) / kBlockSize; by <= (y1 - ctx.y0) / kBlockSize; by++) {
+        int ry0 = std::max(y0, ctx.y0 + by * kBlockSize), ry1 = std::min(y1, ctx.y0 + by * kBlockSize + kBlockSize - 1);
+        for (int bx = (x0 - ctx.x0) / kBlockSize; bx <= (x1 - ctx.x0) / kBlockSize; bx++) {
+            int rx0 = std::max(x0, ctx.x0 + bx * kBlockSize), rx1 = std::min(x1, ctx.x0 + bx * kBlockSize + kBlockSize - 1);
+            if (multiBlock && !overlapsTile(t, rx0, ry0, rx1, ry1)) continue;
+            if (hiZ) {
+                ctx.stats.blocksTested++;
+                double corner = std::min(std::min(planeZ(t, rx0, ry0), planeZ(t, rx1, ry0)),
+                                         std::min(planeZ(t, rx0, ry1), planeZ(t, rx1, ry1)));
+                // 平面值同样减去余量，再与顶点下界取较大者
+                float bound = std::max(t.minZ, float(corner) - t.zMargin);
+                if (bound >= ctx.blockMax[by * kBlocksPerSide + bx]) {
+                    ctx.stats.blocksRejected++;
+                    continue;
+                }
+            }
+
+            bool wrote = simd ? rasterizeBlockAVX2<kDepthOnly>(t, triIndex, ctx, rx0, ry0, rx1, ry1)
+                              : rasterizeBlockScalar<kDepthOnly>(t, triIndex, ctx, rx0, ry0, rx1, ry1);
+            if (hiZ && wrote) {
+                ctx.updateBlock(bx, by);
+                hiZDirty = true;
+            }
+        }
+    }
+    if (hiZDirty) ctx.updateTileMax();
+}
+
+// 预深度的第二遍：每个可见像素用它的三角形着色一次，重心坐标与前向路径的逐步累加值完全相同
+void shadeVisible(const std::vector<TriangleSetup>& tris, TileContext& ctx) {
+    for (int y = 0; y < ctx.h; y++) {
+        for (int x = 0; x < ctx.w; x++) {
+            int idx = y * kTileSize + x;
+            if (ctx.visible[idx] == kNoTriangle) continue;
+            const TriangleSetup& t = tris[ctx.visible[idx]];
+            float l0 = float(edgeAt(t, 0, ctx.x0 + x, ctx.y0 + y) - t.bias[0]) * t.invArea;
+            float l1 = float(edgeAt(t, 1, ctx.x0 + x, ctx.y0 + y) - t.bias[1]) * t.invArea;
+            float l2 = float(edgeAt(t, 2, ctx.x0 + x, ctx.y0 + y) - t.bias[2]) * t.invArea;
+            ctx.color[idx] = packColor((unsigned char)(l0 * t.r[0] + l1 * t.r[1] + l2 * t.r[2]),
+                                       (unsigned char)(l0 * t.g[0] + l1 * t.g[1] + l2 * t.g[2]),
+                                       (unsigned char)(l0 * t.b[0] + l1 * t.b[1] + l2 * t.b[2]));
+            ctx.stats.pixelsShaded++;
+        }
+    }
+}
+
+// verts 每 3 个顶点一个三角形，按提交顺序与 rasterizeTriangle 逐个调用等价（边缘按 top-left 规则）；
+// 层次 Z 与预深度只影响速度，不影响输出
+RasterStats rasterizeTiled(const std::vector<Vertex>& verts, std::vector<Color>& framebuffer,
+                           std::vector<float>& zbuffer, int width, int height, const RasterOptions& options = {}) {
+    PERF_ZONE("raster.tiled");
+    PERF_COUNT("raster.triangles", verts.size() / 3);
+    const int threads = std::max(1, options.threads);
+    BinnedScene scene;
+    binTriangles(verts, width, height, threads, scene);
+
+    const int tileCount = scene.tilesX * scene.tilesY;
+    const bool simd = options.simd && cpuHasAVX2();
+    std::atomic<int> nextTile(0);
+    std::atomic<size_t> totals[4] = {};
+    auto work = [&]() {
+        std::vector<uint32_t> color(kTileSize * kTileSize);
+        std::vector<float> depth(kTileSize * kTileSize);
+        std::vector<uint32_t> visible(options.depthPrepass ? kTileSize * kTileSize : 0);
+        TileContext ctx;
+        ctx.color = color.data();
+        ctx.depth = depth.data();
+        ctx.visible = visible.data();
+        for (int tile = nextTile++; tile < tileCount; tile = nextTile++) {
+            ctx.x0 = (tile % scene.tilesX) * kTileSize;
+            ctx.y0 = (tile / scene.tilesX) * kTileSize;
+            ctx.w = std::min(kTileSize, width - ctx.x0);
+            ctx.h = std::min(kTileSize, height - ctx.y0);
+            bool empty = true;
+            for (const auto& chunk : scene.bins) empty = empty && chunk[tile].empty();
+            if (empty) continue;
+            PERF_ZONE("raster.tile");
+
+            // 块缓冲从整帧读入（保留清屏色和之前的绘制），画完再写回；
+            // 屏幕边缘的不完整块，块外的深度设为 -inf，不影响层次 Z 的最大值
+            std::fill(depth.begin(), depth.end(), -std::numeric_limits<float>::infinity());
+            for (int y = 0; y < ctx.h; y++) {
+                const Color* src = &framebuffer[(ctx.y0 + y) * width + ctx.x0];
+                for (int x = 0; x < ctx.w; x++) color[y * kTileSize + x] = packColor(src[x].r, src[x].g, src[x].b);
+                std::copy_n(&zbuffer[(ctx.y0 + y) * width + ctx.x0], ctx.w, &depth[y * kTileSize]);
+            }
+            if (options.hiZ) ctx.rebuildHiZ();
+
+            if (options.depthPrepass) {
+                std::fill(visible.begin(), visible.end(), kNoTriangle);
+                for (const auto& chunk : scene.bins)
+                    for (uint32_t i : chunk[tile]) rasterizeInTile<true>(scene.tris[i], i, ctx, options.hiZ, simd);
+                shadeVisible(scene.tris, ctx);
+            } else {
+                for (const auto& chunk : scene.bins)
+                    for (uint32_t i : chunk[tile]) rasterizeInTile<false>(scene.tris[i], i, ctx, options.hiZ, simd);
+            }
+
+            for (int y = 0; y < ctx.h; y++) {
+                Color* dst = &framebuffer[(ctx.y0 + y) * width + ctx.x0];
+                for (int x = 0; x < ctx.w; x++) dst[x] = unpackColor(color[y * kTileSize + x]);
+                std::copy_n(&depth[y * kTileSize], ctx.w, &zbuffer[(ctx.y0 + y) * width + ctx.x0]);
+            }
+        }
+        totals[0] += ctx.stats.trianglesRejected;
+        totals[1] += ctx.stats.blocksTested;
+        totals[2] += ctx.stats.blocksRejected;
+        totals[3] += ctx.stats.pixelsShaded;
+    };
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threads; i++) pool.emplace_back(work);
+    work();
+    for (auto& th : pool) th.join();
+
+    RasterStats stats;
+    stats.trianglesRejected = totals[0];
+    stats.blocksTested = totals[1];
+    stats.blocksRejected = totals[2];
+    stats.pixelsShaded = totals[3];
+    PERF_COUNT("raster.triangles_rejected", stats.trianglesRejected);
+    PERF_COUNT("raster.blocks_tested", stats.blocksTested);
+    PERF_COUNT("raster.blocks_rejected", stats.blocksRejected);
+    PERF_COUNT("raster.pixels_shaded", stats.pixelsShaded);
+    return stats;
+}
+
+
 // 保存为 PPM 图片
 void savePPM(const std::string& filename, const std::vector<Color>& framebuffer, int width, int height) {
     std::ofstream file(filename, std::ios::binary);
@@ -110,9 +621,114 @@ void savePPM(const std::string& filename, const std::vector<Color>& framebuffer,
     }
 }
 
-int main() {
+// 两帧之间不同的像素数
+size_t countDiff(const std::vector<Color>& a, const std::vector<Color>& b) {
+    size_t diff = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        diff += a[i].r != b[i].r || a[i].g != b[i].g || a[i].b != b[i].b;
+    }
+    return diff;
+}
+
+// 随机三角形基准：逐个 rasterizeTriangle 对比分块版本；顶点在中心 ±triSize 像素内
+int runBenchmark(int width, int height, size_t triCount, float triSize, int threads) {
+    std::mt19937 rng(26);
+    std::uniform_real_distribution<float> px(-10.0f, width + 10.0f), py(-10.0f, height + 10.0f);
+    std::uniform_real_distribution<float> off(-triSize, triSize), depth(0.0f, 1.0f);
+    std::uniform_int_distribution<int> channel(0, 255);
+    std::vector<Vertex> verts;
+    verts.reserve(triCount * 3);
+    for (size_t i = 0; i < triCount; i++) {
+        float cx = px(rng), cy = py(rng);
+        for (int k = 0; k < 3; k++) {
+            verts.emplace_back(Vec2(cx + off(rng), cy + off(rng)), depth(rng),
+                               Color(channel(rng), channel(rng), channel(rng)));
+        }
+    }
+
+    using Clock = std::chrono::steady_clock;
+    auto msSince = [](Clock::time_point t0) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+    };
+    const Color clear(30, 30, 40);
+    std::cout << "随机三角形: " << triCount << " 个 (±" << triSize << " 像素), " << width << "x" << height << "\n";
+
+    std::vector<Color> refColor(width * height, clear);
+    std::vector<float> refDepth(width * height, std::numeric_limits<float>::max());
+    auto t0 = Clock::now();
+    {
+        PERF_ZONE("raster.reference");
+        for (size_t i = 0; i < triCount; i++) {
+            rasterizeTriangle(verts[3 * i], verts[3 * i + 1], verts[3 * i + 2], refColor, refDepth, width, height);
+        }
+    }
+    double refMs = msSince(t0);
+    std::cout << "rasterizeTriangle (逐个, barycentric): " << refMs << " ms\n";
+
+    // 各种分块模式的输出必须完全一致（颜色和深度），以不带层次 Z 的版本为基准
+    struct Variant {
+        const char* name;
+        RasterOptions options;
+    };
+    std::vector<Variant> variants = {
+        {"标量, 无层次 Z", {threads, false, false, false}},
+        {"标量, 层次 Z", {threads, true, false, false}},
+        {"AVX2, 无层次 Z", {threads, false, false, true}},
+        {"AVX2, 层次 Z", {threads, true, false, true}},
+        {"AVX2, 层次 Z + 预深度", {threads, true, true, true}},
+    };
+    if (threads > 1) variants.push_back({"AVX2, 层次 Z", {1, true, false, true}});
+
+    std::vector<Color> baseColor;
+    std::vector<float> baseDepth;
+    for (const Variant& v : variants) {
+        std::vector<Color> color(width * height, clear);
+        std::vector<float> zbuf(width * height, std::numeric_limits<float>::max());
+        t0 = Clock::now();
+        RasterStats st = rasterizeTiled(verts, color, zbuf, width, height, v.options);
+        double ms = msSince(t0);
+        std::cout << "rasterizeTiled [" << v.name << ", " << v.options.threads << " 线程]: " << ms << " ms, x"
+                  << refMs / ms << ", 着色 " << st.pixelsShaded << " 次";
+        if (v.options.hiZ) {
+            std::cout << ", 整三角形剔除 " << st.trianglesRejected << ", 8x8 小块剔除 " << st.blocksRejected << "/"
+                      << st.blocksTested;
+        }
+        if (baseColor.empty()) {
+            std::cout << ", 与逐个版本相差 " << countDiff(color, refColor) << " 像素（边缘归属规则不同）";
+            baseColor = color;
+            baseDepth = zbuf;
+        } else {
+            std::cout << ((countDiff(color, baseColor) == 0 && zbuf == baseDepth) ? ", 输出一致" : ", 输出不一致!");
+        }
+        std::cout << "\n";
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    perf::Session session("triangle_rasterizer");
     const int width = 800;
     const int height = 600;
+
+    bool tiled = true;
+    RasterOptions options;
+    size_t benchTriangles = 0;
+    float benchSize = 12.0f;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--reference") tiled = false;
+        else if (arg == "--no-hiz") options.hiZ = false;
+        else if (arg == "--prepass") options.depthPrepass = true;
+        else if (arg == "--scalar") options.simd = false;
+        else if (arg == "--size" && i + 1 < argc) benchSize = std::max(1.0f, float(std::atof(argv[++i])));
+        else if (arg == "--threads" && i + 1 < argc) options.threads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--bench") benchTriangles = (i + 1 < argc) ? size_t(std::atoll(argv[++i])) : 1000000;
+        else {
+            std::cerr << "用法: " << argv[0] << " [--reference] [--no-hiz] [--prepass] [--scalar] [--threads N] [--bench [三角形数]] [--size 像素]\n";
+            return 1;
+        }
+    }
+    if (benchTriangles > 0) return runBenchmark(width, height, benchTriangles, benchSize, options.threads);
     
     // 初始化帧缓冲和深度缓冲
     std::vector<Color> framebuffer(width * height, Color(30, 30, 40));
@@ -137,9 +753,15 @@ int main() {
     
     // 光栅化三个三角形
     std::cout << "Rasterizing triangles...\n";
-    rasterizeTriangle(tri1_v0, tri1_v1, tri1_v2, framebuffer, zbuffer, width, height);
-    rasterizeTriangle(tri2_v0, tri2_v1, tri2_v2, framebuffer, zbuffer, width, height);
-    rasterizeTriangle(tri3_v0, tri3_v1, tri3_v2, framebuffer, zbuffer, width, height);
+    if (tiled) {
+        std::vector<Vertex> verts = {tri1_v0, tri1_v1, tri1_v2, tri2_v0, tri2_v1, tri2_v2, tri3_v0, tri3_v1, tri3_v2};
+        rasterizeTiled(verts, framebuffer, zbuffer, width, height, options);
+    } else {
+        PERF_ZONE("raster.reference");
+        rasterizeTriangle(tri1_v0, tri1_v1, tri1_v2, framebuffer, zbuffer, width, height);
+        rasterizeTriangle(tri2_v0, tri2_v1, tri2_v2, framebuffer, zbuffer, width, height);
+        rasterizeTriangle(tri3_v0, tri3_v1, tri3_v2, framebuffer, zbuffer, width, height);
+    }
     
     // 保存图片
     savePPM("rasterization_output.ppm", framebuffer, width, height);
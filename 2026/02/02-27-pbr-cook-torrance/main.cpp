@@ -10,6 +10,7 @@
  * - F: Fresnel 方程（Schlick 近似）
  * 
  * 渲染一个球体阵列，展示不同金属度和粗糙度的 PBR 材质
+ * 求交与阴影查询走共享的 BVH（03-01 的 bvh.h）
  */
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
@@ -21,6 +22,15 @@
 #include <iostream>
 #include <string>
 #include <limits>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+
+#include "../../03/03-01-BVH-Accelerated-Ray-Tracer/bvh.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
 
 // 常量
 const double PI = 3.14159265358979323846;
@@ -163,6 +173,129 @@ Vec3 cookTorranceBRDF(
     return (diffuse + specular) * NdotL;
 }
 
+// ============================================================
+// 单精度快速着色路径
+// ============================================================
+// 与 cookTorranceBRDF 相同的模型，改动：
+// - 只与材质有关的量（alpha²、Schlick-GGX 的 k、F0、漫反射色）建场景时预计算一次
+// - 只与视线有关的量（N·V 及其单边几何项）每个交点算一次，所有光源共用
+// - G / (4·N·V·N·L) 合并成可见性项 1 / (4·(N·V(1-k)+k)·(N·L(1-k)+k))，去掉一次除法
+// - 可选 2D 查找表：单边几何项按 (N·X, 粗糙度) 双线性插值
+struct Vec3f {
+    float x, y, z;
+    
+    Vec3f(float x = 0, float y = 0, float z = 0) : x(x), y(y), z(z) {}
+    explicit Vec3f(const Vec3& v) : x((float)v.x), y((float)v.y), z((float)v.z) {}
+    
+    Vec3f operator+(const Vec3f& v) const { return {x+v.x, y+v.y, z+v.z}; }
+    Vec3f operator-(const Vec3f& v) const { return {x-v.x, y-v.y, z-v.z}; }
+    Vec3f operator*(float t) const { return {x*t, y*t, z*t}; }
+    Vec3f operator*(const Vec3f& v) const { return {x*v.x, y*v.y, z*v.z}; }
+    Vec3f& operator+=(const Vec3f& v) { x+=v.x; y+=v.y; z+=v.z; return *this; }
+    
+    float dot(const Vec3f& v) const { return x*v.x + y*v.y + z*v.z; }
+    Vec3f normalize() const {
+        float len2 = x*x + y*y + z*z;
+        if (len2 < 1e-12f) return {0,0,0};
+        return *this * (1.0f / std::sqrt(len2));
+    }
+};
+
+// 每个材质的预计算常量
+struct ShadingConstants {
+    Vec3f F0;            // 基础反射率
+    Vec3f diffuseColor;  // (1 - metallic) · albedo / π
+    float alpha2;        // (roughness²)²
+    float k;             // Schlick-GGX 的 k = (roughness + 1)² / 8
+    float roughness;
+    
+    static ShadingConstants from(const PBRMaterial& mat) {
+        ShadingConstants c;
+        Vec3 F0 = Vec3(0.04, 0.04, 0.04) * (1.0 - mat.metallic) + mat.albedo * mat.metallic;
+        c.F0 = Vec3f(F0);
+        c.diffuseColor = Vec3f(mat.albedo * ((1.0 - mat.metallic) / PI));
+        double a = mat.roughness * mat.roughness;
+        c.alpha2 = (float)(a * a);
+        double r = mat.roughness + 1.0;
+        c.k = (float)(r * r / 8.0);
+        c.roughness = (float)mat.roughness;
+        return c;
+    }
+};
+
+// Schlick-GGX 单边几何项的分母倒数 1 / (N·X(1-k) + k)，按 (N·X, 粗糙度) 建 2D 表
+// （与 split-sum 的 DFG 表同样的索引方式）；粗糙度方向只有 k 一个参数，插值误差很小
+struct GGXTables {
+    static constexpr int NDOT_SIZE = 128;
+    static constexpr int ROUGH_SIZE = 32;
+    std::vector<float> invG1;  // [roughness][NdotX]
+    
+    GGXTables() : invG1(NDOT_SIZE * ROUGH_SIZE) {
+        for (int r = 0; r < ROUGH_SIZE; r++) {
+            double rough = (double)r / (ROUGH_SIZE - 1);
+            double k = (rough + 1.0) * (rough + 1.0) / 8.0;
+            for (int n = 0; n < NDOT_SIZE; n++) {
+                double ndot = (double)n / (NDOT_SIZE - 1);
+                invG1[r * NDOT_SIZE + n] = (float)(1.0 / (ndot * (1.0 - k) + k));
+            }
+        }
+    }
+    
+    float lookup(float ndot, float rough) const {
+        float fn = std::clamp(ndot, 0.0f, 1.0f) * (NDOT_SIZE - 1);
+        float fr = std::clamp(rough, 0.0f, 1.0f) * (ROUGH_SIZE - 1);
+        int n0 = std::min((int)fn, NDOT_SIZE - 2), r0 = std::min((int)fr, ROUGH_SIZE - 2);
+        float tn = fn - n0, tr = fr - r0;
+        const float* row0 = &invG1[r0 * NDOT_SIZE + n0];
+        const float* row1 = row0 + NDOT_SIZE;
+        float a = row0[0] + (row0[1] - row0[0]) * tn;
+        float b = row1[0] + (row1[1] - row1[0]) * tn;
+        return a + (b - a) * tr;
+    }
+};
+
+// 一个交点的着色上下文：N·V 相关的量算一次，逐光源调用 eval
+struct FastBRDF {
+    const ShadingConstants& c;
+    const GGXTables* tables;  // nullptr 时解析计算
+    Vec3f N, V;
+    float NdotV;
+    float invG1V;
+    
+    FastBRDF(const ShadingConstants& c, const GGXTables* tables, const Vec3f& N, const Vec3f& V)
+        : c(c), tables(tables), N(N), V(V) {
+        NdotV = std::max(N.dot(V), 0.0f);
+        invG1V = invG1(NdotV);
+    }
+    
+    float invG1(float ndot) const {
+        return tables ? tables->lookup(ndot, c.roughness) : 1.0f / (ndot * (1.0f - c.k) + c.k);
+    }
+    
+    // 返回 BRDF · N·L
+    Vec3f eval(const Vec3f& L) const {
+        Vec3f H = (V + L).normalize();
+        float NdotL = std::max(N.dot(L), 0.0f);
+        float NdotH = std::max(N.dot(H), 0.0f);
+        float HdotV = std::max(H.dot(V), 0.0f);
+        
+        // D：GGX
+        float denom = NdotH * NdotH * (c.alpha2 - 1.0f) + 1.0f;
+        float D = c.alpha2 / std::max((float)PI * denom * denom, 1e-6f);
+        // 可见性：G / (4·N·V·N·L)
+        float vis = 0.25f * invG1V * invG1(NdotL);
+        // F：Schlick，(1 - cos)^5 用乘法展开
+        float m = std::max(1.0f - HdotV, 0.0f);
+        float m2 = m * m;
+        float f = m2 * m2 * m;
+        Vec3f F = c.F0 + (Vec3f(1, 1, 1) - c.F0) * f;
+        
+        Vec3f specular = F * (D * vis);
+        Vec3f diffuse = (Vec3f(1, 1, 1) - F) * c.diffuseColor;
+        return (diffuse + specular) * NdotL;
+    }
+};
+
 // ============================================================
 // 场景：球体
 // ============================================================
@@ -173,21 +306,29 @@ struct Sphere {
     
     Sphere(Vec3 c, double r, PBRMaterial m) : center(c), radius(r), material(m) {}
     
-    Hit intersect(const Ray& ray) const {
-        Hit hit;
+    // 只求交点距离（阴影查询与 BVH 遍历内层用，不算法线）
+    bool intersectT(const Ray& ray, double& tOut) const {
         Vec3 oc = ray.origin - center;
         double a = ray.direction.dot(ray.direction);
         double b = 2.0 * oc.dot(ray.direction);
         double c = oc.dot(oc) - radius * radius;
         double disc = b * b - 4 * a * c;
         
-        if (disc < 0) return hit;
+        if (disc < 0) return false;
         
         double t = (-b - std::sqrt(disc)) / (2.0 * a);
         if (t < 0.001) {
             t = (-b + std::sqrt(disc)) / (2.0 * a);
         }
-        if (t < 0.001) return hit;
+        if (t < 0.001) return false;
+        tOut = t;
+        return true;
+    }
+    
+    Hit intersect(const Ray& ray) const {
+        Hit hit;
+        double t;
+        if (!intersectT(ray, t)) return hit;
         
         hit.t = t;
         hit.valid = true;
@@ -197,6 +338,56 @@ struct Sphere {
     }
 };
 
+// ============================================================
+// 场景加速结构
+// ============================================================
+// 球体包围盒建 BVH，提供两种查询：
+// - closestHit：最近交点，只在遍历结束后对命中的球算一次位置和法线
+// - occluded：任意交点，遇到第一个遮挡物立即返回，不算法线、不取材质
+struct Scene {
+    std::vector<Sphere> spheres;
+    std::vector<ShadingConstants> constants;  // 与 spheres 一一对应（快速着色路径用）
+    bvh::Tree accel;
+    mutable uint64_t sphereTests = 0;  // 球体求交次数（统计用）
+    
+    void build() {
+        constants.clear();
+        for (const auto& s : spheres) constants.push_back(ShadingConstants::from(s.material));
+        std::vector<bvh::AABB> boxes;
+        boxes.reserve(spheres.size());
+        for (const auto& s : spheres) {
+            boxes.emplace_back(s.center.x - s.radius, s.center.y - s.radius, s.center.z - s.radius,
+                               s.center.x + s.radius, s.center.y + s.radius, s.center.z + s.radius);
+        }
+        accel.build(boxes);
+    }
+    
+    // 返回命中的球体（未命中为 nullptr）
+    const Sphere* closestHit(const Ray& ray, Hit& hit) const {
+        double tMax = std::numeric_limits<double>::infinity();
+        int idx = accel.intersect(toBVHRay(ray), 0.0, tMax, [&](int i, double, double t1, double& t) {
+            sphereTests++;
+            return spheres[i].intersectT(ray, t) && t < t1;
+        });
+        if (idx < 0) return nullptr;
+        hit = spheres[idx].intersect(ray);
+        return &spheres[idx];
+    }
+    
+    // (0, maxDist) 内是否有遮挡
+    bool occluded(const Ray& ray, double maxDist) const {
+        return accel.occluded(toBVHRay(ray), 0.0, maxDist, [&](int i, double, double t1, double& t) {
+            sphereTests++;
+            return spheres[i].intersectT(ray, t) && t < t1;
+        });
+    }
+    
+private:
+    static bvh::Ray toBVHRay(const Ray& r) {
+        return bvh::Ray(r.origin.x, r.origin.y, r.origin.z, r.direction.x, r.direction.y, r.direction.z);
+    }
+};
+
 // ============================================================
 // 光源
 // ============================================================
@@ -231,14 +422,377 @@ Vec3 gammaCorrect(Vec3 color) {
     };
 }
 
+// 整幅帧缓冲的色调映射 + gamma + 量化（单精度批处理）
+// ACES 部分是纯算术、无分支，编译器可直接向量化；gamma 与 8 位量化合成一张
+// 4096 项查找表（ACES 输出已在 [0,1]），避免逐像素 pow
+struct TonemapLUT {
+    static constexpr int SIZE = 4096;
+    uint8_t table[SIZE + 1];
+    
+    TonemapLUT() {
+        for (int i = 0; i <= SIZE; i++) {
+            double v = std::pow((double)i / SIZE, 1.0 / 2.2) * 255.0;
+            table[i] = (uint8_t)std::clamp(v, 0.0, 255.0);
+        }
+    }
+};
+
+void tonemapFramebuffer(const float* hdr, uint8_t* out, size_t count) {
+    static const TonemapLUT lut;
+    const float a = 2.51f, b = 0.03f, c = 2.43f, d = 0.59f, e = 0.14f;
+    std::vector<float> mapped(count);
+    for (size_t i = 0; i < count; i++) {
+        float x = std::max(hdr[i], 0.0f);
+        float y = (x * (a * x + b)) / (x * (c * x + d) + e);
+        mapped[i] = std::min(std::max(y, 0.0f), 1.0f) * TonemapLUT::SIZE + 0.5f;
+    }
+    for (size_t i = 0; i < count; i++) out[i] = lut.table[(int)mapped[i]];
+}
+
+// ============================================================
+// 8 路 SIMD 着色核
+// ============================================================
+// 一行中水平相邻的 8 个像素作为 8 条 lane，从生成光线、求交、阴影、Cook-Torrance
+// 到色调映射全部在 SoA float 寄存器中完成；未命中 / 被遮挡的 lane 用掩码屏蔽。
+// 求交沿用场景的 bvh::Tree：8 条光线一起走树，任一活跃 lane 命中节点即下降。
+// 编译期选择实现：定义了 __AVX__ 时一条 256 位指令，否则是 8 元素数组循环（交给编译器向量化）
+
+#if defined(__AVX__)
+struct F8 {
+    __m256 v;
+    
+    F8() = default;
+    F8(__m256 v) : v(v) {}
+    F8(float s) : v(_mm256_set1_ps(s)) {}
+    static F8 load(const float* p) { return _mm256_loadu_ps(p); }
+    void store(float* p) const { _mm256_storeu_ps(p, v); }
+    
+    friend F8 operator+(F8 a, F8 b) { return _mm256_add_ps(a.v, b.v); }
+    friend F8 operator-(F8 a, F8 b) { return _mm256_sub_ps(a.v, b.v); }
+    friend F8 operator*(F8 a, F8 b) { return _mm256_mul_ps(a.v, b.v); }
+    friend F8 operator/(F8 a, F8 b) { return _mm256_div_ps(a.v, b.v); }
+    friend F8 vmin(F8 a, F8 b) { return _mm256_min_ps(a.v, b.v); }
+    friend F8 vmax(F8 a, F8 b) { return _mm256_max_ps(a.v, b.v); }
+    friend F8 vsqrt(F8 a) { return _mm256_sqrt_ps(a.v); }
+    
+    // 比较结果与掩码：每个 lane 全 1 或全 0
+    friend F8 operator<(F8 a, F8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+    friend F8 operator>(F8 a, F8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+    friend F8 operator<=(F8 a, F8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+    friend F8 operator>=(F8 a, F8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ); }
+    friend F8 operator&(F8 a, F8 b) { return _mm256_and_ps(a.v, b.v); }
+    friend F8 operator|(F8 a, F8 b) { return _mm256_or_ps(a.v, b.v); }
+    friend F8 andNot(F8 a, F8 b) { return _mm256_andnot_ps(b.v, a.v); }  // a & ~b
+    friend F8 select(F8 mask, F8 a, F8 b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+    friend int laneMask(F8 mask) { return _mm256_movemask_ps(mask.v); }
+};
+#else
+struct F8 {
+    float v[8];
+    
+    F8() = default;
+    F8(float s) { for (int i = 0; i < 8; i++) v[i] = s; }
+    static F8 load(const float* p) { F8 r; for (int i = 0; i < 8; i++) r.v[i] = p[i]; return r; }
+    void store(float* p) const { for (int i = 0; i < 8; i++) p[i] = v[i]; }
+    
+    template <class Op> static F8 map(F8 a, F8 b, Op op) {
+        F8 r;
+        for (int i = 0; i < 8; i++) r.v[i] = op(a.v[i], b.v[i]);
+        return r;
+    }
+    static float bits(uint32_t u) { float f; std::memcpy(&f, &u, 4); return f; }
+    static uint32_t bits(float f) { uint32_t u; std::memcpy(&u, &f, 4); return u; }
+    template <class Cmp> static F8 compare(F8 a, F8 b, Cmp cmp) {
+        return map(a, b, [&](float x, float y) { return bits(cmp(x, y) ? 0xFFFFFFFFu : 0u); });
+    }
+    template <class Op> static F8 bitwise(F8 a, F8 b, Op op) {
+        return map(a, b, [&](float x, float y) { return bits((uint32_t)op(bits(x), bits(y))); });
+    }
+    
+    friend F8 operator+(F8 a, F8 b) { return map(a, b, [](float x, float y) { return x + y; }); }
+    friend F8 operator-(F8 a, F8 b) { return map(a, b, [](float x, float y) { return x - y; }); }
+    friend F8 operator*(F8 a, F8 b) { return map(a, b, [](float x, float y) { return x * y; }); }
+    friend F8 operator/(F8 a, F8 b) { return map(a, b, [](float x, float y) { return x / y; }); }
+    friend F8 vmin(F8 a, F8 b) { return map(a, b, [](float x, float y) { return x < y ? x : y; }); }
+    friend F8 vmax(F8 a, F8 b) { return map(a, b, [](float x, float y) { return x > y ? x : y; }); }
+    friend F8 vsqrt(F8 a) { F8 r; for (int i = 0; i < 8; i++) r.v[i] = std::sqrt(a.v[i]); return r; }
+    
+    friend F8 operator<(F8 a, F8 b) { return compare(a, b, [](float x, float y) { return x < y; }); }
+    friend F8 operator>(F8 a, F8 b) { return compare(a, b, [](float x, float y) { return x > y; }); }
+    friend F8 operator<=(F8 a, F8 b) { return compare(a, b, [](float x, float y) { return x <= y; }); }
+    friend F8 operator>=(F8 a, F8 b) { return compare(a, b, [](float x, float y) { return x >= y; }); }
+    friend F8 operator&(F8 a, F8 b) { return bitwise(a, b, [](uint32_t x, uint32_t y) { return x & y; }); }
+    friend F8 operator|(F8 a, F8 b) { return bitwise(a, b, [](uint32_t x, uint32_t y) { return x | y; }); }
+    friend F8 andNot(F8 a, F8 b) { return bitwise(a, b, [](uint32_t x, uint32_t y) { return x & ~y; }); }
+    friend F8 select(F8 mask, F8 a, F8 b) {
+        F8 r;
+        for (int i = 0; i < 8; i++) r.v[i] = bits(mask.v[i]) ? a.v[i] : b.v[i];
+        return r;
+    }
+    friend int laneMask(F8 mask) {
+        int m = 0;
+        for (int i = 0; i < 8; i++) m |= (bits(mask.v[i]) >> 31) << i;
+        return m;
+    }
+};
+#endif
+
+struct V8 {
+    F8 x, y, z;
+    
+    V8() = default;
+    V8(F8 x, F8 y, F8 z) : x(x), y(y), z(z) {}
+    explicit V8(const Vec3& v) : x((float)v.x), y((float)v.y), z((float)v.z) {}
+    
+    V8 operator+(const V8& v) const { return {x + v.x, y + v.y, z + v.z}; }
+    V8 operator-(const V8& v) const { return {x - v.x, y - v.y, z - v.z}; }
+    V8 operator*(const V8& v) const { return {x * v.x, y * v.y, z * v.z}; }
+    V8 operator*(F8 t) const { return {x * t, y * t, z * t}; }
+    F8 dot(const V8& v) const { return x * v.x + y * v.y + z * v.z; }
+    V8 normalize() const { return *this * (F8(1.0f) / vsqrt(vmax(dot(*this), F8(1e-12f)))); }
+};
+
+inline V8 select(F8 mask, const V8& a, const V8& b) {
+    return {select(mask, a.x, b.x), select(mask, a.y, b.y), select(mask, a.z, b.z)};
+}
+
+// 着色核用的场景副本：球体几何与 ShadingConstants 拆成 float 分量数组，按 lane 的球体下标取
+struct PacketScene {
+    const Scene& scene;
+    std::vector<float> cx, cy, cz, radius, invRadius;
+    std::vector<float> f0[3], diffuse[3], albedo[3], alpha2, k;
+    
+    explicit PacketScene(const Scene& scene) : scene(scene) {
+        for (size_t i = 0; i < scene.spheres.size(); i++) {
+            const Sphere& s = scene.spheres[i];
+            const ShadingConstants& c = scene.constants[i];
+            cx.push_back((float)s.center.x);
+            cy.push_back((float)s.center.y);
+            cz.push_back((float)s.center.z);
+            radius.push_back((float)s.radius);
+            invRadius.push_back((float)(1.0 / s.radius));
+            const float F0[3] = {c.F0.x, c.F0.y, c.F0.z};
+            const float dc[3] = {c.diffuseColor.x, c.diffuseColor.y, c.diffuseColor.z};
+            const float al[3] = {(float)s.material.albedo.x, (float)s.material.albedo.y, (float)s.material.albedo.z};
+            for (int a = 0; a < 3; a++) {
+                f0[a].push_back(F0[a]);
+                diffuse[a].push_back(dc[a]);
+                albedo[a].push_back(al[a]);
+            }
+            alpha2.push_back(c.alpha2);
+            k.push_back(c.k);
+        }
+    }
+    
+    // 按每个 lane 的球体下标取数组元素；不活跃 lane 取第 0 个（结果随后被掩码丢弃）
+    static F8 gather(const std::vector<float>& arr, const int* idx) {
+        alignas(32) float tmp[8];
+        for (int i = 0; i < 8; i++) tmp[i] = arr[idx[i] < 0 ? 0 : idx[i]];
+        return F8::load(tmp);
+    }
+    
+    // 对整包光线测试一个球（方向为单位向量）：返回在 [0.001, tMax) 内命中的 lane 掩码与交点距离
+    // （沿用标量版的根选择）
+    F8 intersectSphere(int s, const V8& org, const V8& dir, F8 tMax, F8& tOut) const {
+        V8 oc(org.x - F8(cx[s]), org.y - F8(cy[s]), org.z - F8(cz[s]));
+        F8 b = oc.dot(dir);
+        // 判别式用 r² - |oc - b·d|²（垂足距离），避免 b² - c 在 float 下的相消误差
+        V8 perp = oc - dir * b;
+        F8 disc = F8(radius[s] * radius[s]) - perp.dot(perp);
+        F8 sq = vsqrt(vmax(disc, F8(0.0f)));
+        F8 tNear = F8(0.0f) - b - sq;
+        F8 t = select(tNear < F8(0.001f), sq - b, tNear);
+        tOut = t;
+        return (disc >= F8(0.0f)) & (t >= F8(0.001f)) & (t < tMax);
+    }
+    
+    // 8 条光线的包遍历：closest 为 true 时找最近交点（写 tBest / hitIdx），
+    // 否则为阴影查询，返回被遮挡的 lane 掩码（某 lane 已被遮挡后不再参与测试）
+    F8 traverse(const V8& org, const V8& dir, F8 active, F8& tBest, int* hitIdx, bool closest) const {
+        const bvh::Tree& tree = scene.accel;
+        F8 occluded(0.0f);
+        if (tree.empty() || laneMask(active) == 0) return occluded;
+        V8 invDir(F8(1.0f) / dir.x, F8(1.0f) / dir.y, F8(1.0f) / dir.z);
+        // 按第 0 条光线的方向符号排近/远子节点（相机光线包方向一致，只影响效率）
+        alignas(32) float lane0[3][8];
+        dir.x.store(lane0[0]);
+        dir.y.store(lane0[1]);
+        dir.z.store(lane0[2]);
+        const int sign[3] = {lane0[0][0] < 0, lane0[1][0] < 0, lane0[2][0] < 0};
+        
+        int stack[bvh::STACK_SIZE];
+        int sp = 0;
+        int nodeIdx = 0;
+        while (true) {
+            const bvh::FlatNode& node = tree.nodes[nodeIdx];
+            F8 t0(0.0f), t1 = tBest;
+            const F8* o[3] = {&org.x, &org.y, &org.z};
+            const F8* inv[3] = {&invDir.x, &invDir.y, &invDir.z};
+            for (int a = 0; a < 3; a++) {
+                F8 ta = (F8(node.bmin[a]) - *o[a]) * *inv[a];
+                F8 tb = (F8(node.bmax[a]) - *o[a]) * *inv[a];
+                t0 = vmax(t0, vmin(ta, tb));
+                t1 = vmin(t1, vmax(ta, tb));
+            }
+            F8 live = closest ? active : andNot(active, occluded);
+            if (laneMask(live & (t0 <= t1)) != 0) {
+                if (node.prim_count > 0) {
+                    for (int i = 0; i < node.prim_count; i++) {
+                        int s = tree.prim_indices[node.offset + i];
+                        F8 t;
+                        F8 hit = live & intersectSphere(s, org, dir, tBest, t);
+                        scene.sphereTests += __builtin_popcount(laneMask(live));
+                        int m = laneMask(hit);
+                        if (m == 0) continue;
+                        if (closest) {
+                            tBest = select(hit, t, tBest);
+                            for (int l = 0; l < 8; l++) if (m >> l & 1) hitIdx[l] = s;
+                        } else {
+                            occluded = occluded | hit;
+                            live = andNot(live, hit);
+                        }
+                    }
+                    if (!closest && laneMask(andNot(active, occluded)) == 0) return occluded;
+                } else {
+                    int nearFirst = sign[node.axis];
+                    stack[sp++] = node.offset + 1 - nearFirst;
+                    nodeIdx = node.offset + nearFirst;
+                    continue;
+                }
+            }
+            if (sp == 0) break;
+            nodeIdx = stack[--sp];
+        }
+        return occluded;
+    }
+};
+
+struct PacketCamera {
+    Vec3 position, camX, camY, camZ;
+    double halfW, halfH;
+    int width, height;
+};
+
+// 着色一行中从 px0 开始的 8 个像素，写入 8 位 RGB（超出图像宽度的 lane 丢弃）
+void shadePacket8(const PacketScene& ps, const PacketCamera& cam, const std::vector<PointLight>& lights,
+                  const Vec3& ambient, int px0, int py, uint8_t* image, uint64_t& rayCount) {
+    static const TonemapLUT lut;
+    alignas(32) float laneU[8];
+    for (int i = 0; i < 8; i++) laneU[i] = (float)((2.0 * (px0 + i) / cam.width - 1.0) * cam.halfW);
+    float v = (float)((1.0 - 2.0 * py / cam.height) * cam.halfH);
+    
+    // 生成光线
+    F8 u = F8::load(laneU);
+    V8 camX(cam.camX), camY(cam.camY), camZ(cam.camZ);
+    V8 dir = (camX * u + camY * F8(v) - camZ).normalize();
+    V8 org(cam.position);
+    
+    int laneCount = std::min(8, cam.width - px0);
+    alignas(32) float laneOn[8];
+    for (int i = 0; i < 8; i++) laneOn[i] = i < laneCount ? 1.0f : 0.0f;
+    F8 active = F8::load(laneOn) > F8(0.0f);
+    rayCount += laneCount;
+    
+    // 求交
+    F8 tBest(std::numeric_limits<float>::infinity());
+    int hitIdx[8] = {-1, -1, -1, -1, -1, -1, -1, -1};
+    ps.traverse(org, dir, active, tBest, hitIdx, true);
+    F8 hitMask = active & (tBest < F8(std::numeric_limits<float>::infinity()));
+    
+    // 背景：深灰色渐变
+    F8 bt = F8(0.5f) * (dir.y + F8(1.0f));
+    V8 color = V8(Vec3(0.08, 0.08, 0.12)) * (F8(1.0f) - bt) + V8(Vec3(0.05, 0.05, 0.08)) * bt;
+    
+    if (laneMask(hitMask) != 0) {
+        V8 P = org + dir * tBest;
+        V8 C(PacketScene::gather(ps.cx, hitIdx), PacketScene::gather(ps.cy, hitIdx), PacketScene::gather(ps.cz, hitIdx));
+        V8 N = ((P - C) * PacketScene::gather(ps.invRadius, hitIdx)).normalize();
+        V8 V = V8(F8(0.0f) - dir.x, F8(0.0f) - dir.y, F8(0.0f) - dir.z);
+        V8 F0(PacketScene::gather(ps.f0[0], hitIdx), PacketScene::gather(ps.f0[1], hitIdx), PacketScene::gather(ps.f0[2], hitIdx));
+        V8 kd(PacketScene::gather(ps.diffuse[0], hitIdx), PacketScene::gather(ps.diffuse[1], hitIdx),
+              PacketScene::gather(ps.diffuse[2], hitIdx));
+        V8 albedo(PacketScene::gather(ps.albedo[0], hitIdx), PacketScene::gather(ps.albedo[1], hitIdx),
+                  PacketScene::gather(ps.albedo[2], hitIdx));
+        F8 alpha2 = PacketScene::gather(ps.alpha2, hitIdx);
+        F8 k = PacketScene::gather(ps.k, hitIdx);
+        F8 one(1.0f), zero(0.0f);
+        
+        F8 NdotV = vmax(N.dot(V), zero);
+        F8 invG1V = one / (NdotV * (one - k) + k);
+        V8 shaded = V8(ambient) * albedo;
+        V8 shadowOrg = P + N * F8(0.001f);
+        
+        for (const auto& light : lights) {
+            V8 toLight = V8(light.position) - P;
+            F8 dist2 = toLight.dot(toLight);
+            F8 dist = vsqrt(dist2);
+            V8 L = toLight * (one / dist);
+            F8 NdotL = vmax(N.dot(L), zero);
+            // 背光的 lane 贡献为 0，不用发阴影光线
+            F8 lit = hitMask & (NdotL > zero);
+            if (laneMask(lit) == 0) continue;
+            F8 tShadow = dist;
+            rayCount += __builtin_popcount(laneMask(lit));
+            lit = andNot(lit, ps.traverse(shadowOrg, L, lit, tShadow, nullptr, false));
+            if (laneMask(lit) == 0) continue;
+            
+            // Cook-Torrance（与 FastBRDF 相同的形式）
+            V8 H = (V + L).normalize();
+            F8 NdotH = vmax(N.dot(H), zero);
+            F8 HdotV = vmax(H.dot(V), zero);
+            F8 denom = NdotH * NdotH * (alpha2 - one) + one;
+            F8 D = alpha2 / vmax(F8((float)PI) * denom * denom, F8(1e-6f));
+            F8 vis = F8(0.25f) * invG1V / (NdotL * (one - k) + k);
+            F8 m = vmax(one - HdotV, zero);
+            F8 m2 = m * m;
+            F8 f = m2 * m2 * m;
+            V8 F = F0 + (V8(F8(1.0f), one, one) - F0) * f;
+            V8 brdf = (F * (D * vis) + (V8(one, one, one) - F) * kd) * NdotL;
+            
+            V8 radiance = V8(light.color) * (F8((float)light.intensity) / dist2);
+            shaded = select(lit, shaded + brdf * radiance, shaded);
+        }
+        color = select(hitMask, shaded, color);
+    }
+    
+    // 色调映射：ACES + gamma/量化查找表
+    const F8 a(2.51f), b(0.03f), c(2.43f), d(0.59f), e(0.14f);
+    const F8* ch[3] = {&color.x, &color.y, &color.z};
+    alignas(32) float mapped[3][8];
+    for (int j = 0; j < 3; j++) {
+        F8 x = vmax(*ch[j], F8(0.0f));
+        F8 y = (x * (a * x + b)) / (x * (c * x + d) + e);
+        (vmin(vmax(y, F8(0.0f)), F8(1.0f)) * F8((float)TonemapLUT::SIZE) + F8(0.5f)).store(mapped[j]);
+    }
+    uint8_t* row = image + ((size_t)py * cam.width + px0) * 3;
+    for (int i = 0; i < laneCount; i++) {
+        for (int j = 0; j < 3; j++) row[i * 3 + j] = lut.table[(int)mapped[j][i]];
+    }
+}
+
 // ============================================================
 // 主渲染函数
 // ============================================================
-int main() {
+// 用法：./pbr_renderer [--scalar | --exact] [--lut]
+//   默认     8 路 SIMD 着色核（shadePacket8）
+//   --scalar 逐像素单精度着色 + 整帧批量色调映射
+//   --exact  原双精度 cookTorranceBRDF + 逐像素 ACESFilm / gammaCorrect（对照用）
+//   --lut    逐像素单精度路径的几何项改查 GGXTables
+int main(int argc, char** argv) {
+    bool exact = false, scalar = false, useLUT = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--exact") exact = true;
+        else if (arg == "--scalar") scalar = true;
+        else if (arg == "--lut") useLUT = true;
+    }
+    bool simd = !exact && !scalar && !useLUT;
+    
     // 图像尺寸
     const int WIDTH = 800;
     const int HEIGHT = 600;
     std::vector<uint8_t> image(WIDTH * HEIGHT * 3);
+    std::vector<float> hdr(WIDTH * HEIGHT * 3);  // 色调映射前的线性颜色
     
     // 相机设置
     Vec3 cameraPos(0, 0, 8);
@@ -256,7 +810,8 @@ int main() {
     Vec3 camY = camZ.cross(camX);
     
     // 构建 5x4 球体阵列（金属度 x 粗糙度）
-    std::vector<Sphere> spheres;
+    Scene scene;
+    std::vector<Sphere>& spheres = scene.spheres;
     
     int gridCols = 5;  // 金属度变化（0.0 -> 1.0）
     int gridRows = 4;  // 粗糙度变化（0.0 -> 1.0）
@@ -298,8 +853,27 @@ int main() {
     std::cout << "尺寸: " << WIDTH << "x" << HEIGHT << std::endl;
     std::cout << "球体数量: " << spheres.size() << std::endl;
     
-    // 渲染循环
-    for (int py = 0; py < HEIGHT; py++) {
+    scene.build();
+    static const GGXTables ggxTables;
+    const GGXTables* tables = useLUT ? &ggxTables : nullptr;
+    Vec3f ambientF(ambient);
+    std::cout << "着色路径: " << (exact ? "双精度（--exact）" : useLUT ? "单精度 + GGX 查找表"
+                                 : scalar ? "单精度逐像素" : "8 路 SIMD")
+              << std::endl;
+    uint64_t rayCount = 0;
+    auto startTime = std::chrono::steady_clock::now();
+    
+    if (simd) {
+        PacketScene packetScene(scene);
+        PacketCamera cam{cameraPos, camX, camY, camZ, halfW, halfH, WIDTH, HEIGHT};
+        for (int py = 0; py < HEIGHT; py++) {
+            for (int px = 0; px < WIDTH; px += 8)
+                shadePacket8(packetScene, cam, lights, ambient, px, py, image.data(), rayCount);
+        }
+    }
+    
+    // 渲染循环（逐像素）
+    for (int py = 0; py < HEIGHT && !simd; py++) {
         if (py % 100 == 0) {
             std::cout << "进度: " << (py * 100 / HEIGHT) << "%" << std::endl;
         }
@@ -315,19 +889,12 @@ int main() {
             
             // 找最近交叉点
             Hit closest;
-            const Sphere* hitSphere = nullptr;
-            
-            for (const auto& sphere : spheres) {
-                Hit h = sphere.intersect(ray);
-                if (h.valid && h.t < closest.t) {
-                    closest = h;
-                    hitSphere = &sphere;
-                }
-            }
+            const Sphere* hitSphere = scene.closestHit(ray, closest);
+            rayCount++;
             
             Vec3 finalColor(0, 0, 0);
             
-            if (hitSphere) {
+            if (hitSphere && exact) {
                 Vec3 N = closest.normal;
                 Vec3 V = (cameraPos - closest.position).normalize();
                 const PBRMaterial& mat = hitSphere->material;
@@ -341,17 +908,10 @@ int main() {
                     double dist2 = (light.position - closest.position).dot(
                                    light.position - closest.position);
                     
-                    // 简单阴影检测
+                    // 阴影检测：任意交点查询
                     Ray shadowRay(closest.position + N * 0.001, L);
-                    bool inShadow = false;
-                    for (const auto& sphere : spheres) {
-                        Hit sh = sphere.intersect(shadowRay);
-                        if (sh.valid && sh.t < std::sqrt(dist2)) {
-                            inShadow = true;
-                            break;
-                        }
-                    }
-                    if (inShadow) continue;
+                    rayCount++;
+                    if (scene.occluded(shadowRay, std::sqrt(dist2))) continue;
                     
                     // 辐射度（距离衰减）
                     Vec3 radiance = light.color * (light.intensity / dist2);
@@ -360,26 +920,60 @@ int main() {
                     Vec3 brdf = cookTorranceBRDF(N, V, L, mat);
                     finalColor += brdf * radiance;
                 }
+            } else if (hitSphere) {
+                // 单精度路径：交点与阴影查询仍用双精度，只有 BRDF 求值改成 float
+                Vec3 N = closest.normal;
+                const ShadingConstants& c = scene.constants[hitSphere - scene.spheres.data()];
+                FastBRDF brdf(c, tables, Vec3f(N), Vec3f((cameraPos - closest.position).normalize()));
+                Vec3f color = ambientF * Vec3f(hitSphere->material.albedo);
+                
+                for (const auto& light : lights) {
+                    Vec3 toLight = light.position - closest.position;
+                    double dist2 = toLight.dot(toLight);
+                    Vec3 L = toLight.normalize();
+                    
+                    Ray shadowRay(closest.position + N * 0.001, L);
+                    rayCount++;
+                    if (scene.occluded(shadowRay, std::sqrt(dist2))) continue;
+                    
+                    Vec3f radiance(light.color * (light.intensity / dist2));
+                    color += brdf.eval(Vec3f(L)) * radiance;
+                }
+                finalColor = Vec3(color.x, color.y, color.z);
             } else {
                 // 背景：深灰色渐变
                 double t = 0.5 * (rayDir.y + 1.0);
                 finalColor = Vec3(0.08, 0.08, 0.12) * (1.0 - t) + Vec3(0.05, 0.05, 0.08) * t;
             }
             
-            // HDR 色调映射
-            finalColor = ACESFilm(finalColor);
-            
-            // Gamma 校正
-            finalColor = gammaCorrect(finalColor);
-            
-            // 写入像素
             int idx = (py * WIDTH + px) * 3;
-            image[idx + 0] = (uint8_t)(std::clamp(finalColor.x * 255.0, 0.0, 255.0));
-            image[idx + 1] = (uint8_t)(std::clamp(finalColor.y * 255.0, 0.0, 255.0));
-            image[idx + 2] = (uint8_t)(std::clamp(finalColor.z * 255.0, 0.0, 255.0));
+            if (exact) {
+                // HDR 色调映射
+                finalColor = ACESFilm(finalColor);
+                
+                // Gamma 校正
+                finalColor = gammaCorrect(finalColor);
+                
+                // 写入像素
+                image[idx + 0] = (uint8_t)(std::clamp(finalColor.x * 255.0, 0.0, 255.0));
+                image[idx + 1] = (uint8_t)(std::clamp(finalColor.y * 255.0, 0.0, 255.0));
+                image[idx + 2] = (uint8_t)(std::clamp(finalColor.z * 255.0, 0.0, 255.0));
+            } else {
+                hdr[idx + 0] = (float)finalColor.x;
+                hdr[idx + 1] = (float)finalColor.y;
+                hdr[idx + 2] = (float)finalColor.z;
+            }
         }
     }
     
+    if (!exact && !simd) tonemapFramebuffer(hdr.data(), image.data(), hdr.size());
+    
+    double renderMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "渲染时间: " << renderMs << " ms" << std::endl;
+    std::cout << "平均球体测试/光线: " << (double)scene.sphereTests / rayCount
+              << "（线性遍历为 " << spheres.size() << "）" << std::endl;
+    
     // 保存图片
     int result = stbi_write_png("pbr_output.png", WIDTH, HEIGHT, 3, image.data(), WIDTH * 3);
     if (result) {
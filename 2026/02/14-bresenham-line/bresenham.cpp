@@ -3,6 +3,13 @@
 #include <cmath>
 #include <string>
 #include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
 
 // Simple PPM image format writer
 void write_ppm(const std::string& filename, const std::vector<std::vector<int>>& pixels, int width, int height) {
@@ -54,36 +61,270 @@ void draw_line(std::vector<std::vector<int>>& pixels, int x1, int y1, int x2, in
     }
 }
 
-int main() {
+// ================= Batched span rasterizer =================
+// One contiguous row-major framebuffer instead of one heap vector per row.
+struct Framebuffer {
+    int width, height;
+    std::vector<unsigned char> pixels;
+
+    Framebuffer(int w, int h) : width(w), height(h), pixels(size_t(w) * h, 0) {}
+    unsigned char* row(int y) { return pixels.data() + size_t(y) * width; }
+};
+
+struct Line {
+    int x1, y1, x2, y2;
+};
+
+void write_ppm(const std::string& filename, const Framebuffer& fb) {
+    std::ofstream file(filename);
+    file << "P3\n";
+    file << fb.width << " " << fb.height << "\n";
+    file << "255\n";
+
+    for (int y = 0; y < fb.height; y++) {
+        for (int x = 0; x < fb.width; x++) {
+            file << (fb.pixels[size_t(y) * fb.width + x] ? "255 255 255 " : "0 0 0 ");
+        }
+        file << "\n";
+    }
+    file.close();
+}
+
+// floor / ceil for a positive divisor and any sign of numerator
+static int64_t floor_div(int64_t a, int64_t b) { return a >= 0 ? a / b : -((-a + b - 1) / b); }
+static int64_t ceil_div(int64_t a, int64_t b) { return -floor_div(-a, b); }
+
+// Closed form of draw_line's error-term walk. Measured along the major axis
+// (length "major", step k = 0..major), the minor-axis offset is
+//     j(k) = floor((2*k*minor + major - 1) / (2*major))
+// and the first step that reaches minor offset j is
+//     first_step(j) = ceil((2*j*major - major + 1) / (2*minor)), clamped to >= 0.
+// Both were checked against the loop for every |dx|, |dy| < 40, so clipping and
+// spans below reproduce draw_line pixel for pixel.
+struct LineWalk {
+    int64_t major, minor;
+
+    int64_t minor_at(int64_t k) const { return major ? (2 * k * minor + major - 1) / (2 * major) : 0; }
+    int64_t first_step(int64_t j) const {
+        if (j <= 0) return 0;
+        if (minor == 0) return major + 1;  // never leaves offset 0
+        return ceil_div(2 * j * major - major + 1, 2 * minor);
+    }
+};
+
+// Walks first_step(j + 1) for j = j0, j0 + 1, ... without a division per run:
+// the numerator grows by 2*major per run, so the quotient grows by a fixed
+// base plus a carry from the remainder (the same trick as Bresenham itself).
+struct RunBoundary {
+    int64_t next, slack, base, rem, denom;
+
+    RunBoundary(const LineWalk& w, int64_t j0) {
+        next = w.first_step(j0 + 1);
+        if (w.minor == 0) {
+            base = rem = slack = 0;
+            denom = 1;
+            return;
+        }
+        denom = 2 * w.minor;
+        base = (2 * w.major) / denom;
+        rem = (2 * w.major) % denom;
+        slack = next * denom - (2 * (j0 + 1) * w.major - w.major + 1);
+    }
+    void advance() {
+        next += base;
+        slack -= rem;
+        if (slack < 0) {
+            next += 1;
+            slack += denom;
+        }
+    }
+};
+
+// Short runs are the common case for diagonal-ish lines; a plain loop beats a
+// memset call there
+static inline void fill_span(unsigned char* p, size_t n) {
+    if (n <= 16) {
+        for (size_t i = 0; i < n; ++i) p[i] = 1;
+    } else {
+        std::memset(p, 1, n);
+    }
+}
+
+// Range of steps k in [0, len] for which start + dir*k lies in [lo, hi]; false if empty
+static bool step_range(int start, int dir, int64_t len, int lo, int hi, int64_t& k0, int64_t& k1) {
+    if (dir > 0) {
+        k0 = int64_t(lo) - start;
+        k1 = int64_t(hi) - start;
+    } else {
+        k0 = int64_t(start) - hi;
+        k1 = int64_t(start) - lo;
+    }
+    k0 = std::max<int64_t>(k0, 0);
+    k1 = std::min<int64_t>(k1, len);
+    return k0 <= k1;
+}
+
+// Draw the part of a line inside rows [y_lo, y_hi) with no per-pixel checks:
+// the visible range is solved up front, then each run of pixels sharing a row
+// (x-major) or a column (y-major) is written as one span.
+void draw_line_spans(Framebuffer& fb, const Line& l, int y_lo, int y_hi) {
+    const int dx = std::abs(l.x2 - l.x1), dy = std::abs(l.y2 - l.y1);
+    const int sx = (l.x1 < l.x2) ? 1 : -1, sy = (l.y1 < l.y2) ? 1 : -1;
+    const int x_hi = fb.width - 1;
+    y_hi -= 1;
+
+    if (dx >= dy) {
+        // x-major: horizontal spans, one per row
+        LineWalk w{dx, dy};
+        int64_t k0, k1, j0, j1;
+        if (!step_range(l.x1, sx, dx, 0, x_hi, k0, k1)) return;
+        if (!step_range(l.y1, sy, dy, y_lo, y_hi, j0, j1)) return;
+        j0 = std::max(j0, w.minor_at(k0));
+        j1 = std::min(j1, w.minor_at(k1));
+        if (j0 > j1) return;
+        int64_t start = std::max(k0, w.first_step(j0));
+        RunBoundary run(w, j0);
+        unsigned char* row = fb.row(int(l.y1 + sy * j0));
+        const ptrdiff_t stride = ptrdiff_t(sy) * fb.width;
+        for (int64_t j = j0; j <= j1; ++j, row += stride) {
+            int64_t end = std::min(k1, run.next - 1);
+            if (start <= end) {
+                int xa = int(l.x1 + sx * start), xb = int(l.x1 + sx * end);
+                fill_span(row + std::min(xa, xb), size_t(std::abs(xb - xa)) + 1);
+            }
+            start = std::max(k0, run.next);
+            run.advance();
+        }
+    } else {
+        // y-major: vertical spans, one per column
+        LineWalk w{dy, dx};
+        int64_t k0, k1, i0, i1;
+        if (!step_range(l.y1, sy, dy, y_lo, y_hi, k0, k1)) return;
+        if (!step_range(l.x1, sx, dx, 0, x_hi, i0, i1)) return;
+        i0 = std::max(i0, w.minor_at(k0));
+        i1 = std::min(i1, w.minor_at(k1));
+        if (i0 > i1) return;
+        const ptrdiff_t stride = ptrdiff_t(sy) * fb.width;
+        int64_t start = std::max(k0, w.first_step(i0));
+        RunBoundary run(w, i0);
+        unsigned char* p = fb.row(int(l.y1 + sy * start)) + (l.x1 + sx * i0);
+        for (int64_t i = i0; i <= i1; ++i) {
+            int64_t end = std::min(k1, run.next - 1);
+            for (int64_t k = start; k <= end; ++k, p += stride) *p = 1;
+            // the next column starts on the row right after this run
+            p += sx;
+            start = std::max(k0, run.next);
+            run.advance();
+        }
+    }
+}
+
+// Batch API: the framebuffer is split into horizontal bands, one per thread.
+// Lines are binned by their row range, and every thread clips its lines to its
+// own band, so threads never write the same pixel and need no locking.
+void draw_lines(Framebuffer& fb, const std::vector<Line>& lines, int threads) {
+    threads = std::max(1, std::min(threads, fb.height));
+    const int band = (fb.height + threads - 1) / threads;
+
+    std::vector<std::vector<uint32_t>> bins(threads);
+    for (size_t i = 0; i < lines.size(); ++i) {
+        int lo = std::max(0, std::min(lines[i].y1, lines[i].y2));
+        int hi = std::min(fb.height - 1, std::max(lines[i].y1, lines[i].y2));
+        for (int b = lo / band; lo <= hi && b <= hi / band; ++b) bins[b].push_back(uint32_t(i));
+    }
+
+    auto work = [&](int b) {
+        int y_lo = b * band, y_hi = std::min(fb.height, y_lo + band);
+        for (uint32_t i : bins[b]) draw_line_spans(fb, lines[i], y_lo, y_hi);
+    };
+    if (threads == 1) {
+        work(0);
+        return;
+    }
+    std::vector<std::thread> pool;
+    for (int b = 0; b < threads; ++b) pool.emplace_back(work, b);
+    for (auto& t : pool) t.join();
+}
+
+// Random lines (1/4 partially off-canvas) drawn with the per-pixel reference
+// and with the batch API; prints timings and checks the images match.
+int run_benchmark(int width, int height, int count) {
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> xs(-width / 4, width + width / 4), ys(-height / 4, height + height / 4);
+    std::vector<Line> lines(count);
+    for (auto& l : lines) l = {xs(rng), ys(rng), xs(rng), ys(rng)};
+
+    using Clock = std::chrono::steady_clock;
+    auto ms_since = [](Clock::time_point t0) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+    };
+
+    std::vector<std::vector<int>> grid(height, std::vector<int>(width, 0));
+    auto t0 = Clock::now();
+    for (const auto& l : lines) draw_line(grid, l.x1, l.y1, l.x2, l.y2);
+    double ref_ms = ms_since(t0);
+    std::cout << "draw_line (per-pixel)   : " << ref_ms << " ms" << std::endl;
+
+    // always try several bands, even on a single core, so the band clipping is checked too
+    int hw = std::max(4, int(std::thread::hardware_concurrency()));
+    bool ok = true;
+    for (int threads : {1, hw}) {
+        Framebuffer fb(width, height);
+        t0 = Clock::now();
+        draw_lines(fb, lines, threads);
+        double ms = ms_since(t0);
+        bool same = true;
+        for (int y = 0; y < height && same; y++)
+            for (int x = 0; x < width && same; x++) same = (grid[y][x] != 0) == (fb.row(y)[x] != 0);
+        ok = ok && same;
+        std::cout << "draw_lines (" << threads << " thread" << (threads > 1 ? "s" : " ") << ")   : " << ms
+                  << " ms, x" << ref_ms / ms << (same ? ", identical" : ", MISMATCH") << std::endl;
+    }
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
     const int width = 800;
     const int height = 600;
-    
+
+    if (argc > 1) {
+        // --bench [N]: N random lines (default 200000)
+        if (std::string(argv[1]) != "--bench") {
+            std::cerr << "Usage: " << argv[0] << " [--bench [N]]" << std::endl;
+            return 1;
+        }
+        return run_benchmark(width, height, argc > 2 ? std::atoi(argv[2]) : 200000);
+    }
+
     // Create canvas
-    std::vector<std::vector<int>> pixels(height, std::vector<int>(width, 0));
-    
+    Framebuffer fb(width, height);
+
     // Draw multiple lines to demonstrate the algorithm
-    draw_line(pixels, 50, 50, 750, 50);     // Horizontal line
-    draw_line(pixels, 50, 550, 750, 550);   // Another horizontal
-    draw_line(pixels, 50, 50, 50, 550);     // Vertical line
-    draw_line(pixels, 750, 50, 750, 550);   // Another vertical
-    
-    // Draw diagonal lines
-    draw_line(pixels, 50, 50, 750, 550);    // Main diagonal
-    draw_line(pixels, 750, 50, 50, 550);    // Anti-diagonal
-    
-    // Draw some random lines
-    draw_line(pixels, 200, 150, 600, 250);
-    draw_line(pixels, 300, 300, 500, 400);
-    draw_line(pixels, 400, 200, 400, 500);
-    draw_line(pixels, 150, 450, 650, 150);
-    
+    std::vector<Line> lines = {
+        {50, 50, 750, 50},     // Horizontal line
+        {50, 550, 750, 550},   // Another horizontal
+        {50, 50, 50, 550},     // Vertical line
+        {750, 50, 750, 550},   // Another vertical
+
+        // Diagonal lines
+        {50, 50, 750, 550},    // Main diagonal
+        {750, 50, 50, 550},    // Anti-diagonal
+
+        // Some random lines
+        {200, 150, 600, 250},
+        {300, 300, 500, 400},
+        {400, 200, 400, 500},
+        {150, 450, 650, 150},
+    };
+    draw_lines(fb, lines, int(std::max(1u, std::thread::hardware_concurrency())));
+
     // Write to PPM file
-    write_ppm("bresenham_output.ppm", pixels, width, height);
+    write_ppm("bresenham_output.ppm", fb);
     
     std::cout << "Bresenham line drawing completed!" << std::endl;
     std::cout << "Output saved as bresenham_output.ppm" << std::endl;
     std::cout << "Image dimensions: " << width << "x" << height << std::endl;
-    std::cout << "Lines drawn: 10 lines with various orientations" << std::endl;
+    std::cout << "Lines drawn: " << lines.size() << " lines with various orientations" << std::endl;
     
     return 0;
-}
\ No newline at end of file
+}
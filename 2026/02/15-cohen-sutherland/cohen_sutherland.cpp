@@ -2,6 +2,16 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CLIP_X86 1
+#endif
 
 const int INSIDE = 0;   // 0000
 const int LEFT   = 1;   // 0001
@@ -160,7 +170,341 @@ void save_ppm(const std::vector<std::vector<int>>& pixels, int width, int height
     std::cout << "已保存文件: " << filename << std::endl;
 }
 
-int main() {
+// ================= 批量裁剪（SoA 浮点线段） =================
+// 第一阶段：一次用 SIMD 算 8/16 条线段两端的区域码，批量完成"完全在内"和"完全在外"的判定；
+// 第二阶段：只有跨越边界的线段才进入 Liang-Barsky 参数裁剪。
+// 输出不保持输入顺序：完全在内的线段先写，裁剪后的线段随后追加，index 记录原始下标。
+
+struct SegmentSoA {
+    std::vector<float> x1, y1, x2, y2;
+
+    void resize(size_t n) {
+        x1.resize(n);
+        y1.resize(n);
+        x2.resize(n);
+        y2.resize(n);
+    }
+    size_t size() const { return x1.size(); }
+};
+
+struct ClipRect {
+    float x_min, y_min, x_max, y_max;
+};
+
+struct ClipStats {
+    size_t accepted = 0;  // 两端都在区域内，原样输出
+    size_t rejected = 0;  // 两端在同一侧外部，直接丢弃
+    size_t partial = 0;   // 需要 Liang-Barsky 的线段
+    size_t clipped = 0;   // 其中裁剪后仍可见的
+};
+
+// 浮点版区域码，边界与 compute_code 相同（闭区间）
+inline int compute_code_f(float x, float y, const ClipRect& r) {
+    int code = INSIDE;
+    if (x < r.x_min) code |= LEFT;
+    else if (x > r.x_max) code |= RIGHT;
+    if (y < r.y_min) code |= BOTTOM;
+    else if (y > r.y_max) code |= TOP;
+    return code;
+}
+
+// Liang-Barsky 参数裁剪：p·t <= q 四个半平面依次收紧 [t0, t1]
+inline bool liang_barsky_clip(float& x1, float& y1, float& x2, float& y2, const ClipRect& r) {
+    const float dx = x2 - x1, dy = y2 - y1;
+    const float p[4] = {-dx, dx, -dy, dy};
+    const float q[4] = {x1 - r.x_min, r.x_max - x1, y1 - r.y_min, r.y_max - y1};
+    float t0 = 0.0f, t1 = 1.0f;
+    for (int i = 0; i < 4; ++i) {
+        if (p[i] == 0.0f) {
+            if (q[i] < 0.0f) return false;  // 平行于该边且在外侧
+            continue;
+        }
+        float t = q[i] / p[i];
+        if (p[i] < 0.0f) {
+            if (t > t1) return false;
+            if (t > t0) t0 = t;
+        } else {
+            if (t < t0) return false;
+            if (t < t1) t1 = t;
+        }
+    }
+    const float ox = x1, oy = y1;
+    x1 = ox + t0 * dx;
+    y1 = oy + t0 * dy;
+    x2 = ox + t1 * dx;
+    y2 = oy + t1 * dy;
+    return true;
+}
+
+// 单条线段的标量参考：区域码判定 + Liang-Barsky，批量版本的结果必须与它一致
+inline bool clip_segment_scalar(float& x1, float& y1, float& x2, float& y2, const ClipRect& r) {
+    int c1 = compute_code_f(x1, y1, r), c2 = compute_code_f(x2, y2, r);
+    if ((c1 | c2) == 0) return true;
+    if (c1 & c2) return false;
+    return liang_barsky_clip(x1, y1, x2, y2, r);
+}
+
+// 第一阶段的输出：完全在内的线段已写入 out[0..accepted)，partial 为待裁剪线段的原始下标
+struct ClassifyResult {
+    size_t accepted, rejected;
+};
+
+using ClassifyFn = ClassifyResult (*)(const SegmentSoA& in, size_t begin, size_t end, const ClipRect& r,
+                                      SegmentSoA& out, uint32_t* index, size_t out_pos,
+                                      std::vector<uint32_t>& partial);
+
+inline void emit_accepted(const SegmentSoA& in, size_t i, SegmentSoA& out, uint32_t* index, size_t pos) {
+    out.x1[pos] = in.x1[i];
+    out.y1[pos] = in.y1[i];
+    out.x2[pos] = in.x2[i];
+    out.y2[pos] = in.y2[i];
+    index[pos] = uint32_t(i);
+}
+
+ClassifyResult classify_scalar(const SegmentSoA& in, size_t begin, size_t end, const ClipRect& r, SegmentSoA& out,
+                               uint32_t* index, size_t out_pos, std::vector<uint32_t>& partial) {
+    ClassifyResult res{0, 0};
+    for (size_t i = begin; i < end; ++i) {
+        int c1 = compute_code_f(in.x1[i], in.y1[i], r), c2 = compute_code_f(in.x2[i], in.y2[i], r);
+        if ((c1 | c2) == 0) emit_accepted(in, i, out, index, out_pos + res.accepted++);
+        else if (c1 & c2) res.rejected++;
+        else partial.push_back(uint32_t(i));
+    }
+    return res;
+}
+
+#if CLIP_X86
+
+// 8 个端点的区域码：比较结果是全 1 掩码，与上对应位后拼起来
+__attribute__((target("avx2"))) inline __m256i outcode_avx2(__m256 x, __m256 y, const ClipRect& r) {
+    __m256i left = _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(x, _mm256_set1_ps(r.x_min), _CMP_LT_OQ)),
+                                    _mm256_set1_epi32(LEFT));
+    __m256i right = _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(x, _mm256_set1_ps(r.x_max), _CMP_GT_OQ)),
+                                     _mm256_set1_epi32(RIGHT));
+    __m256i bottom = _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(y, _mm256_set1_ps(r.y_min), _CMP_LT_OQ)),
+                                      _mm256_set1_epi32(BOTTOM));
+    __m256i top = _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(y, _mm256_set1_ps(r.y_max), _CMP_GT_OQ)),
+                                   _mm256_set1_epi32(TOP));
+    return _mm256_or_si256(_mm256_or_si256(left, right), _mm256_or_si256(bottom, top));
+}
+
+__attribute__((target("avx2,bmi"))) ClassifyResult classify_avx2(const SegmentSoA& in, size_t begin, size_t end,
+                                                                 const ClipRect& r, SegmentSoA& out, uint32_t* index,
+                                                                 size_t out_pos, std::vector<uint32_t>& partial) {
+    ClassifyResult res{0, 0};
+    size_t i = begin;
+    const __m256i zero = _mm256_setzero_si256();
+    for (; i + 8 <= end; i += 8) {
+        __m256i c1 = outcode_avx2(_mm256_loadu_ps(&in.x1[i]), _mm256_loadu_ps(&in.y1[i]), r);
+        __m256i c2 = outcode_avx2(_mm256_loadu_ps(&in.x2[i]), _mm256_loadu_ps(&in.y2[i]), r);
+        unsigned inside =
+            unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_or_si256(c1, c2), zero))));
+        unsigned outside = ~unsigned(_mm256_movemask_ps(
+                               _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(c1, c2), zero)))) & 0xFFu;
+        res.rejected += size_t(__builtin_popcount(outside));
+        // 常见情况是整组 8 条都在内或都在外，直接跳过逐位处理
+        if (inside == 0xFFu) {
+            for (int l = 0; l < 8; ++l) emit_accepted(in, i + l, out, index, out_pos + res.accepted++);
+            continue;
+        }
+        for (unsigned m = inside; m; m &= m - 1) emit_accepted(in, i + __builtin_ctz(m), out, index, out_pos + res.accepted++);
+        for (unsigned m = ~(inside | outside) & 0xFFu; m; m &= m - 1) partial.push_back(uint32_t(i + __builtin_ctz(m)));
+    }
+    ClassifyResult tail = classify_scalar(in, i, end, r, out, index, out_pos + res.accepted, partial);
+    return {res.accepted + tail.accepted, res.rejected + tail.rejected};
+}
+
+// AVX-512：比较直接得到 16 位掩码，compress store 把通过的线段连续写出，不需要逐位循环
+__attribute__((target("avx512f"))) inline __m512i outcode_avx512(__m512 x, __m512 y, const ClipRect& r) {
+    __m512i code = _mm512_setzero_si512();
+    code = _mm512_mask_or_epi32(code, _mm512_cmp_ps_mask(x, _mm512_set1_ps(r.x_min), _CMP_LT_OQ), code,
+                                _mm512_set1_epi32(LEFT));
+    code = _mm512_mask_or_epi32(code, _mm512_cmp_ps_mask(x, _mm512_set1_ps(r.x_max), _CMP_GT_OQ), code,
+                                _mm512_set1_epi32(RIGHT));
+    code = _mm512_mask_or_epi32(code, _mm512_cmp_ps_mask(y, _mm512_set1_ps(r.y_min), _CMP_LT_OQ), code,
+                                _mm512_set1_epi32(BOTTOM));
+    code = _mm512_mask_or_epi32(code, _mm512_cmp_ps_mask(y, _mm512_set1_ps(r.y_max), _CMP_GT_OQ), code,
+                                _mm512_set1_epi32(TOP));
+    return code;
+}
+
+__attribute__((target("avx512f"))) ClassifyResult classify_avx512(const SegmentSoA& in, size_t begin, size_t end,
+                                                                  const ClipRect& r, SegmentSoA& out,
+                                                                  uint32_t* index, size_t out_pos,
+                                                                  std::vector<uint32_t>& partial) {
+    ClassifyResult res{0, 0};
+    size_t i = begin;
+    const __m512i lane = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    // partial 预留足够空间，compress store 直接写进去，最后再收缩
+    size_t partial_pos = partial.size();
+    partial.resize(partial_pos + (end - begin));
+    for (; i + 16 <= end; i += 16) {
+        __m512 x1 = _mm512_loadu_ps(&in.x1[i]), y1 = _mm512_loadu_ps(&in.y1[i]);
+        __m512 x2 = _mm512_loadu_ps(&in.x2[i]), y2 = _mm512_loadu_ps(&in.y2[i]);
+        __m512i c1 = outcode_avx512(x1, y1, r), c2 = outcode_avx512(x2, y2, r);
+        __mmask16 inside = _mm512_testn_epi32_mask(_mm512_or_si512(c1, c2), _mm512_or_si512(c1, c2));
+        __mmask16 outside = _mm512_test_epi32_mask(c1, c2);
+        __mmask16 cross = __mmask16(~(inside | outside));
+        size_t pos = out_pos + res.accepted;
+        __m512i ids = _mm512_add_epi32(_mm512_set1_epi32(int(i)), lane);
+        _mm512_mask_compressstoreu_ps(&out.x1[pos], inside, x1);
+        _mm512_mask_compressstoreu_ps(&out.y1[pos], inside, y1);
+        _mm512_mask_compressstoreu_ps(&out.x2[pos], inside, x2);
+        _mm512_mask_compressstoreu_ps(&out.y2[pos], inside, y2);
+        _mm512_mask_compressstoreu_epi32(index + pos, inside, ids);
+        _mm512_mask_compressstoreu_epi32(&partial[partial_pos], cross, ids);
+        res.accepted += size_t(__builtin_popcount(inside));
+        res.rejected += size_t(__builtin_popcount(outside));
+        partial_pos += size_t(__builtin_popcount(cross));
+    }
+    partial.resize(partial_pos);
+    ClassifyResult tail = classify_scalar(in, i, end, r, out, index, out_pos + res.accepted, partial);
+    return {res.accepted + tail.accepted, res.rejected + tail.rejected};
+}
+
+#endif  // CLIP_X86
+
+struct ClipKernel {
+    const char* name;
+    ClassifyFn classify;
+};
+
+// 当前 CPU 支持的所有实现，最宽的排在最后
+std::vector<ClipKernel> available_kernels() {
+    std::vector<ClipKernel> kernels = {{"scalar", classify_scalar}};
+#if CLIP_X86
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi")) kernels.push_back({"avx2", classify_avx2});
+    if (__builtin_cpu_supports("avx512f")) kernels.push_back({"avx512", classify_avx512});
+#endif
+    return kernels;
+}
+
+// 批量裁剪：按块做第一阶段，块内跨边界的线段紧接着做 Liang-Barsky，待裁剪下标列表始终留在缓存里。
+// out/index 输出可见线段，返回可见条数
+size_t clip_segments(const SegmentSoA& in, const ClipRect& r, SegmentSoA& out, std::vector<uint32_t>& index,
+                     ClipStats* stats = nullptr, ClassifyFn classify = available_kernels().back().classify) {
+    const size_t n = in.size();
+    const size_t block = 4096;
+    out.resize(n);
+    index.resize(n);
+    std::vector<uint32_t> partial;
+    partial.reserve(block);
+    ClipStats st;
+    size_t count = 0;
+    for (size_t begin = 0; begin < n; begin += block) {
+        size_t end = std::min(n, begin + block);
+        partial.clear();
+        ClassifyResult cr = classify(in, begin, end, r, out, index.data(), count, partial);
+        count += cr.accepted;
+        st.accepted += cr.accepted;
+        st.rejected += cr.rejected;
+        st.partial += partial.size();
+        for (uint32_t i : partial) {
+            float x1 = in.x1[i], y1 = in.y1[i], x2 = in.x2[i], y2 = in.y2[i];
+            if (!liang_barsky_clip(x1, y1, x2, y2, r)) continue;
+            out.x1[count] = x1;
+            out.y1[count] = y1;
+            out.x2[count] = x2;
+            out.y2[count] = y2;
+            index[count++] = i;
+            st.clipped++;
+        }
+    }
+    out.resize(count);
+    index.resize(count);
+    if (stats) *stats = st;
+    return count;
+}
+
+// 计时循环的结果写到这里，防止整数版循环被优化掉
+static volatile long long g_sink;
+
+// 随机线段基准：中心散布在比裁剪区域大一圈的范围内，长度 0~120，
+// 模拟绘图管线里以短线段为主、大部分可以整批接受/拒绝的情况
+int run_benchmark(size_t n) {
+    std::mt19937 rng(2026);
+    std::uniform_real_distribution<float> cx(-200.0f, 1000.0f), cy(-150.0f, 750.0f), off(-60.0f, 60.0f);
+    SegmentSoA in;
+    in.resize(n);
+    std::vector<int> ix1(n), iy1(n), ix2(n), iy2(n);
+    for (size_t i = 0; i < n; ++i) {
+        float x = cx(rng), y = cy(rng), ox = off(rng), oy = off(rng);
+        // 整数化后两种实现处理同一组端点
+        in.x1[i] = float(ix1[i] = int(x - ox));
+        in.y1[i] = float(iy1[i] = int(y - oy));
+        in.x2[i] = float(ix2[i] = int(x + ox));
+        in.y2[i] = float(iy2[i] = int(y + oy));
+    }
+    const ClipRect rect{float(X_MIN), float(Y_MIN), float(X_MAX), float(Y_MAX)};
+
+    using Clock = std::chrono::steady_clock;
+    auto ms_since = [](Clock::time_point t0) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+    };
+
+    std::cout << "随机线段: " << n << " 条\n";
+
+    // 原始整数 Cohen-Sutherland，逐条裁剪
+    auto t0 = Clock::now();
+    size_t cs_visible = 0;
+    long long checksum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        int x1 = ix1[i], y1 = iy1[i], x2 = ix2[i], y2 = iy2[i];
+        if (cohen_sutherland_clip(x1, y1, x2, y2)) {
+            cs_visible++;
+            checksum += x1 + y2;
+        }
+    }
+    double cs_ms = ms_since(t0);
+    std::cout << "cohen_sutherland_clip (整数, 逐条): " << cs_ms << " ms, 可见 " << cs_visible << "\n";
+
+    // 逐条浮点参考，用于校验批量结果
+    t0 = Clock::now();
+    std::vector<float> ref(4 * n);
+    std::vector<char> ref_visible(n);
+    size_t ref_count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        float* c = &ref[4 * i];
+        c[0] = in.x1[i], c[1] = in.y1[i], c[2] = in.x2[i], c[3] = in.y2[i];
+        ref_visible[i] = clip_segment_scalar(c[0], c[1], c[2], c[3], rect);
+        ref_count += ref_visible[i];
+    }
+    std::cout << "clip_segment_scalar   (浮点, 逐条): " << ms_since(t0) << " ms, 可见 " << ref_count << "\n";
+
+    bool ok = true;
+    SegmentSoA out;
+    std::vector<uint32_t> index;
+    for (const ClipKernel& k : available_kernels()) {
+        ClipStats st;
+        t0 = Clock::now();
+        size_t count = clip_segments(in, rect, out, index, &st, k.classify);
+        double ms = ms_since(t0);
+
+        bool same = count == ref_count;
+        for (size_t j = 0; j < count && same; ++j) {
+            const float* c = &ref[4 * size_t(index[j])];
+            same = ref_visible[index[j]] && out.x1[j] == c[0] && out.y1[j] == c[1] && out.x2[j] == c[2] &&
+                   out.y2[j] == c[3];
+        }
+        ok = ok && same;
+        std::cout << "clip_segments [" << k.name << "]: " << ms << " ms (x" << cs_ms / ms << "), 内 " << st.accepted
+                  << " / 外 " << st.rejected << " / 跨边界 " << st.partial << " (可见 " << st.clipped << ")"
+                  << (same ? ", 与逐条结果一致" : ", 结果不一致!") << "\n";
+    }
+    g_sink = checksum;
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        // --bench [N]：N 条随机线段（默认 1000 万）
+        if (std::string(argv[1]) != "--bench") {
+            std::cerr << "用法: " << argv[0] << " [--bench [N]]\n";
+            return 1;
+        }
+        return run_benchmark(argc > 2 ? size_t(std::atoll(argv[2])) : 10000000);
+    }
+
     const int WIDTH = 800;
     const int HEIGHT = 600;
     
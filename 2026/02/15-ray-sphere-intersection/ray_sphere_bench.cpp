@@ -0,0 +1,123 @@
+// 光线-球体求交内核微基准
+// 对当前 CPU 支持的每种 ISA 分别测 1×N（一条光线对 N 个球）和 N×1（N 条光线对一个球）
+// 的吞吐（每秒求交次数），并检查结果与标量版逐位一致
+//
+// 用法: ./ray_sphere_bench [球数] [光线数]
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "ray_sphere_simd.h"
+
+using Clock = std::chrono::steady_clock;
+
+// 计时循环的结果写到这里，防止编译器把求交整个优化掉
+static volatile long long g_sink;
+
+struct Workload {
+    rsi::SphereSoA spheres;
+    rsi::RaySoA rays;
+};
+
+// 球随机分布在 [-10,10]^3，光线从原点附近射向随机方向，命中率大约一半
+static Workload makeWorkload(int sphereCount, int rayCount) {
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> pos(-10.0f, 10.0f), rad(0.2f, 1.5f), dir(-1.0f, 1.0f), jitter(-0.5f, 0.5f);
+    Workload w;
+    for (int i = 0; i < sphereCount; ++i) w.spheres.add(pos(rng), pos(rng), pos(rng), rad(rng));
+    for (int i = 0; i < rayCount; ++i) w.rays.add(jitter(rng), jitter(rng), jitter(rng), dir(rng), dir(rng), dir(rng));
+    return w;
+}
+
+// 重复执行 body 直到至少 minMs 毫秒，返回每次调用的平均秒数
+template <typename Body>
+static double timePerCall(Body&& body, double minMs = 200.0) {
+    long long calls = 0;
+    auto t0 = Clock::now();
+    double ms = 0;
+    do {
+        body();
+        ++calls;
+        ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+    } while (ms < minMs);
+    return ms / 1000.0 / calls;
+}
+
+int main(int argc, char** argv) {
+    int sphereCount = argc > 1 ? std::atoi(argv[1]) : 256;
+    int rayCount = argc > 2 ? std::atoi(argv[2]) : 4096;
+    if (sphereCount <= 0 || rayCount <= 0) {
+        std::fprintf(stderr, "用法: %s [球数] [光线数]\n", argv[0]);
+        return 1;
+    }
+
+    Workload w = makeWorkload(sphereCount, rayCount);
+    const float tMin = 1e-3f;
+    const double tests = double(sphereCount) * rayCount;
+
+    std::printf("光线-球体求交微基准: %d 个球 x %d 条光线\n", sphereCount, rayCount);
+    std::printf("自动选择: %s\n\n", rsi::isaName(rsi::kernels().isa));
+
+    // 标量结果作为参考
+    rsi::Kernels ref = rsi::kernelsFor(rsi::Isa::Scalar);
+    std::vector<int> refHit(rayCount);
+    std::vector<float> refT(size_t(rayCount) * sphereCount), tOut(refT.size());
+    for (int r = 0; r < rayCount; ++r) {
+        float o[3] = {w.rays.ox[r], w.rays.oy[r], w.rays.oz[r]};
+        float d[3] = {w.rays.dx[r], w.rays.dy[r], w.rays.dz[r]};
+        float t;
+        refHit[r] = ref.closestSphere(o, d, w.spheres, tMin, t);
+    }
+    for (int s = 0; s < sphereCount; ++s) {
+        float c[3] = {w.spheres.cx[s], w.spheres.cy[s], w.spheres.cz[s]};
+        ref.raysVsSphere(w.rays, c, std::sqrt(w.spheres.r2[s]), tMin, &refT[size_t(s) * rayCount]);
+    }
+
+    std::printf("%-8s %16s %16s %8s\n", "ISA", "1xN (M次/秒)", "Nx1 (M次/秒)", "校验");
+    const rsi::Isa all[] = {rsi::Isa::Scalar, rsi::Isa::SSE4, rsi::Isa::AVX2, rsi::Isa::AVX512, rsi::Isa::NEON};
+    double scalarRate = 0;
+    for (rsi::Isa isa : all) {
+        if (!rsi::isaSupported(isa)) continue;
+        rsi::Kernels k = rsi::kernelsFor(isa);
+
+        // 1×N：每条光线找最近的球
+        long long checksum = 0;
+        double perPass = timePerCall([&] {
+            for (int r = 0; r < rayCount; ++r) {
+                float o[3] = {w.rays.ox[r], w.rays.oy[r], w.rays.oz[r]};
+                float d[3] = {w.rays.dx[r], w.rays.dy[r], w.rays.dz[r]};
+                float t;
+                checksum += k.closestSphere(o, d, w.spheres, tMin, t);
+            }
+        });
+        double closestRate = tests / perPass;
+
+        // N×1：每个球测所有光线
+        perPass = timePerCall([&] {
+            for (int s = 0; s < sphereCount; ++s) {
+                float c[3] = {w.spheres.cx[s], w.spheres.cy[s], w.spheres.cz[s]};
+                checksum += (long long)k.raysVsSphere(w.rays, c, std::sqrt(w.spheres.r2[s]), tMin,
+                                                      &tOut[size_t(s) * rayCount]);
+            }
+        });
+        double raysRate = tests / perPass;
+
+        // 计时循环的最后一遍已经写满 tOut，直接逐位比较
+        bool exact = std::memcmp(tOut.data(), refT.data(), tOut.size() * sizeof(float)) == 0;
+        for (int r = 0; r < rayCount && exact; ++r) {
+            float o[3] = {w.rays.ox[r], w.rays.oy[r], w.rays.oz[r]};
+            float d[3] = {w.rays.dx[r], w.rays.dy[r], w.rays.dz[r]};
+            float t;
+            exact = k.closestSphere(o, d, w.spheres, tMin, t) == refHit[r];
+        }
+
+        g_sink = g_sink + checksum;
+        if (isa == rsi::Isa::Scalar) scalarRate = closestRate;
+        std::printf("%-8s %16.1f %16.1f %8s   (1xN %.2fx)\n", rsi::isaName(isa), closestRate / 1e6, raysRate / 1e6,
+                    exact ? "一致" : "不一致", closestRate / scalarRate);
+    }
+    return 0;
+}
@@ -3,6 +3,7 @@
 #include <cmath>
 #include <vector>
 #include <algorithm>
+#include "ray_sphere_simd.h"
 
 // 3D向量类
 struct Vec3 {
@@ -37,36 +38,7 @@ struct Ray {
     Ray(const Vec3& origin, const Vec3& direction) : origin(origin), direction(direction) {}
 };
 
-// 光线与球体相交检测
-bool raySphereIntersect(const Ray& ray, const Sphere& sphere, float& t) {
-    Vec3 oc = ray.origin - sphere.center;
-    float a = ray.direction.dot(ray.direction);
-    float b = 2.0f * oc.dot(ray.direction);
-    float c = oc.dot(oc) - sphere.radius * sphere.radius;
-    
-    float discriminant = b * b - 4 * a * c;
-    
-    if (discriminant < 0) {
-        return false; // 没有交点
-    }
-    
-    float sqrtDisc = sqrt(discriminant);
-    float t1 = (-b - sqrtDisc) / (2.0f * a);
-    float t2 = (-b + sqrtDisc) / (2.0f * a);
-    
-    if (t1 > 0 && t2 > 0) {
-        t = (t1 < t2) ? t1 : t2; // 取较近的交点
-        return true;
-    } else if (t1 > 0) {
-        t = t1;
-        return true;
-    } else if (t2 > 0) {
-        t = t2;
-        return true;
-    }
-    
-    return false;
-}
+// 光线与球体相交检测见 ray_sphere_simd.h（标量参考 + SSE4/AVX2/AVX-512/NEON）
 
 // 写入PPM图像文件
 void writePPM(const std::string& filename, int width, int height, const std::vector<std::vector<Vec3>>& pixels) {
@@ -103,16 +75,25 @@ int main() {
     // 光线原点（相机位置）
     Vec3 cameraPos(200, 150, -200);
     
-    // 渲染图像
+    // 渲染图像：每行的光线打包成 SoA，一次调用 SIMD 内核求出整行的交点
+    std::cout << "求交内核: " << rsi::isaName(rsi::kernels().isa) << std::endl;
+    const float center[3] = {sphere.center.x, sphere.center.y, sphere.center.z};
+    std::vector<float> rowT(width);
     for (int y = 0; y < height; ++y) {
+        rsi::RaySoA rays;
         for (int x = 0; x < width; ++x) {
             // 创建从相机到像素的光线
             Vec3 pixelPos(x, y, 0);
             Vec3 rayDir = (pixelPos - cameraPos).normalize();
-            Ray ray(cameraPos, rayDir);
-            
-            float t;
-            if (raySphereIntersect(ray, sphere, t)) {
+            rays.add(cameraPos.x, cameraPos.y, cameraPos.z, rayDir.x, rayDir.y, rayDir.z);
+        }
+        rsi::raysVsSphere(rays, center, sphere.radius, 0.0f, rowT.data());
+
+        for (int x = 0; x < width; ++x) {
+            float t = rowT[x];
+            if (t != rsi::kMiss) {
+                Ray ray(cameraPos, Vec3(rays.dx[x], rays.dy[x], rays.dz[x]));
+
                 // 计算交点位置
                 Vec3 hitPoint = ray.origin + ray.direction * t;
                 
@@ -0,0 +1,491 @@
+// ray_sphere_simd.h - 光线-球体求交内核库（运行时按 CPU 选择 SIMD 实现）
+//
+// 两种批量形态：
+//   closestSphere : 1 条光线 vs N 个球，返回最近命中的球下标
+//   raysVsSphere  : N 条光线 vs 1 个球，逐条写出命中距离
+//
+// 每种形态都有 scalar / SSE4.1 / AVX2 / AVX-512 / NEON 版本。x86 版本用 target 属性
+// 单独编译，不需要 -mavx2 之类的全局编译选项；程序第一次调用时用 CPUID
+// （__builtin_cpu_supports）选出当前机器支持的最宽实现。
+// 环境变量 RSI_ISA=scalar|sse4|avx2|avx512|neon 可强制指定（不支持时退回自动选择）。
+//
+// 所有版本运算顺序相同、只用 IEEE 精确的加减乘除和 sqrt，结果与标量版逐位一致。
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RSI_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#define RSI_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace rsi {
+
+constexpr float kMiss = std::numeric_limits<float>::infinity();
+
+// 球体 SoA：center + 半径平方，求交只用到这四个数组
+struct SphereSoA {
+    std::vector<float> cx, cy, cz, r2;
+
+    void add(float x, float y, float z, float radius) {
+        cx.push_back(x);
+        cy.push_back(y);
+        cz.push_back(z);
+        r2.push_back(radius * radius);
+    }
+    size_t size() const { return cx.size(); }
+};
+
+// 光线 SoA；方向不要求归一化，返回的 t 以方向长度为单位
+struct RaySoA {
+    std::vector<float> ox, oy, oz, dx, dy, dz;
+
+    void add(float x, float y, float z, float u, float v, float w) {
+        ox.push_back(x);
+        oy.push_back(y);
+        oz.push_back(z);
+        dx.push_back(u);
+        dy.push_back(v);
+        dz.push_back(w);
+    }
+    size_t size() const { return ox.size(); }
+};
+
+enum class Isa { Scalar, SSE4, AVX2, AVX512, NEON };
+
+inline const char* isaName(Isa isa) {
+    switch (isa) {
+        case Isa::Scalar: return "scalar";
+        case Isa::SSE4:   return "sse4";
+        case Isa::AVX2:   return "avx2";
+        case Isa::AVX512: return "avx512";
+        case Isa::NEON:   return "neon";
+    }
+    return "?";
+}
+
+// origin/dir 为 3 个 float；返回最近命中的球下标，未命中返回 -1（tHit = kMiss）
+using ClosestFn = int (*)(const float* origin, const float* dir, const SphereSoA& spheres, float tMin,
+                          float& tHit);
+// center 为 3 个 float；tOut[i] 为第 i 条光线的命中距离（未命中 kMiss），返回命中条数
+using RaysFn = size_t (*)(const RaySoA& rays, const float* center, float radius, float tMin, float* tOut);
+
+struct Kernels {
+    Isa isa;
+    ClosestFn closestSphere;
+    RaysFn raysVsSphere;
+};
+
+// avx512f 目标隐含 FMA，GCC 对 C++ 默认 -ffp-contract=fast 会把乘加融合，
+// 这里对内核关闭融合，保证各 ISA 与标量版逐位一致
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace detail {
+
+// ========== 标量参考实现 ==========
+// a = d·d, hb = oc·d（半 b 形式），c = oc·oc - r²，disc = hb² - a·c
+// t0 = (-hb - √disc) / a，t0 > tMin 取 t0，否则 t1 > tMin 取 t1（光线起点在球内）
+
+inline float hitDistance(float ocx, float ocy, float ocz, float dx, float dy, float dz, float r2,
+                         float tMin) {
+    float a = dx * dx + dy * dy + dz * dz;
+    float hb = ocx * dx + ocy * dy + ocz * dz;
+    float c = ocx * ocx + ocy * ocy + ocz * ocz - r2;
+    float disc = hb * hb - a * c;
+    if (disc < 0.0f) return kMiss;
+    float s = std::sqrt(disc);
+    float t0 = (-hb - s) / a;
+    float t1 = (-hb + s) / a;
+    if (t0 > tMin) return t0;
+    if (t1 > tMin) return t1;
+    return kMiss;
+}
+
+// 从 first 开始的标量尾部，SIMD 版本处理完整的向量宽度后复用
+inline int closestTail(const float* o, const float* d, const SphereSoA& s, size_t first, float tMin,
+                       int best, float& tHit) {
+    for (size_t i = first; i < s.size(); ++i) {
+        float t = hitDistance(o[0] - s.cx[i], o[1] - s.cy[i], o[2] - s.cz[i], d[0], d[1], d[2], s.r2[i], tMin);
+        if (t < tHit) {
+            tHit = t;
+            best = int(i);
+        }
+    }
+    return best;
+}
+
+inline size_t raysTail(const RaySoA& r, const float* c, float r2, size_t first, float tMin, float* tOut) {
+    size_t hits = 0;
+    for (size_t i = first; i < r.size(); ++i) {
+        tOut[i] = hitDistance(r.ox[i] - c[0], r.oy[i] - c[1], r.oz[i] - c[2], r.dx[i], r.dy[i], r.dz[i], r2, tMin);
+        hits += tOut[i] != kMiss;
+    }
+    return hits;
+}
+
+inline int closestScalar(const float* o, const float* d, const SphereSoA& s, float tMin, float& tHit) {
+    tHit = kMiss;
+    return closestTail(o, d, s, 0, tMin, -1, tHit);
+}
+
+inline size_t raysScalar(const RaySoA& r, const float* c, float radius, float tMin, float* tOut) {
+    return raysTail(r, c, radius * radius, 0, tMin, tOut);
+}
+
+// 各通道的 (t, 下标) 归约：t 最小者胜，t 相同取下标小的，与标量版从前往后严格 < 的结果一致
+inline int reduceLanes(const float* t, const int* idx, int lanes, float& tHit) {
+    int best = -1;
+    tHit = kMiss;
+    for (int l = 0; l < lanes; ++l) {
+        if (t[l] < tHit || (t[l] == tHit && idx[l] >= 0 && idx[l] < best)) {
+            tHit = t[l];
+            best = idx[l];
+        }
+    }
+    return best;
+}
+
+#if RSI_X86
+
+// ========== SSE4.1（4 宽） ==========
+
+__attribute__((target("sse4.1"))) inline __m128 hitSSE(__m128 ocx, __m128 ocy, __m128 ocz, __m128 dx,
+                                                        __m128 dy, __m128 dz, __m128 r2, __m128 tMin) {
+    __m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+    __m128 hb = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, dx), _mm_mul_ps(ocy, dy)), _mm_mul_ps(ocz, dz));
+    __m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, ocx), _mm_mul_ps(ocy, ocy)), _mm_mul_ps(ocz, ocz)), r2);
+    __m128 disc = _mm_sub_ps(_mm_mul_ps(hb, hb), _mm_mul_ps(a, c));
+    __m128 valid = _mm_cmpge_ps(disc, _mm_setzero_ps());
+    __m128 s = _mm_sqrt_ps(_mm_max_ps(disc, _mm_setzero_ps()));
+    __m128 nhb = _mm_sub_ps(_mm_setzero_ps(), hb);
+    __m128 t0 = _mm_div_ps(_mm_sub_ps(nhb, s), a);
+    __m128 t1 = _mm_div_ps(_mm_add_ps(nhb, s), a);
+    __m128 miss = _mm_set1_ps(kMiss);
+    __m128 t = _mm_blendv_ps(miss, t1, _mm_cmpgt_ps(t1, tMin));
+    t = _mm_blendv_ps(t, t0, _mm_cmpgt_ps(t0, tMin));
+    return _mm_blendv_ps(miss, t, valid);
+}
+
+__attribute__((target("sse4.1"))) inline int closestSSE4(const float* o, const float* d, const SphereSoA& s,
+                                                         float tMin, float& tHit) {
+    const size_t n = s.size(), full = n & ~size_t(3);
+    __m128 ox = _mm_set1_ps(o[0]), oy = _mm_set1_ps(o[1]), oz = _mm_set1_ps(o[2]);
+    __m128 dx = _mm_set1_ps(d[0]), dy = _mm_set1_ps(d[1]), dz = _mm_set1_ps(d[2]);
+    __m128 tm = _mm_set1_ps(tMin);
+    __m128 bestT = _mm_set1_ps(kMiss);
+    __m128i bestI = _mm_set1_epi32(-1);
+    __m128i idx = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i step = _mm_set1_epi32(4);
+    for (size_t i = 0; i < full; i += 4) {
+        __m128 t = hitSSE(_mm_sub_ps(ox, _mm_loadu_ps(&s.cx[i])), _mm_sub_ps(oy, _mm_loadu_ps(&s.cy[i])),
+                          _mm_sub_ps(oz, _mm_loadu_ps(&s.cz[i])), dx, dy, dz, _mm_loadu_ps(&s.r2[i]), tm);
+        __m128 closer = _mm_cmplt_ps(t, bestT);
+        bestT = _mm_blendv_ps(bestT, t, closer);
+        bestI = _mm_castps_si128(_mm_blendv_ps(_mm_castsi128_ps(bestI), _mm_castsi128_ps(idx), closer));
+        idx = _mm_add_epi32(idx, step);
+    }
+    alignas(16) float lt[4];
+    alignas(16) int li[4];
+    _mm_store_ps(lt, bestT);
+    _mm_store_si128(reinterpret_cast<__m128i*>(li), bestI);
+    int best = reduceLanes(lt, li, 4, tHit);
+    return closestTail(o, d, s, full, tMin, best, tHit);
+}
+
+__attribute__((target("sse4.1"))) inline size_t raysSSE4(const RaySoA& r, const float* c, float radius,
+                                                          float tMin, float* tOut) {
+    const size_t n = r.size(), full = n & ~size_t(3);
+    __m128 cx = _mm_set1_ps(c[0]), cy = _mm_set1_ps(c[1]), cz = _mm_set1_ps(c[2]);
+    __m128 r2 = _mm_set1_ps(radius * radius), tm = _mm_set1_ps(tMin), miss = _mm_set1_ps(kMiss);
+    size_t hits = 0;
+    for (size_t i = 0; i < full; i += 4) {
+        __m128 t = hitSSE(_mm_sub_ps(_mm_loadu_ps(&r.ox[i]), cx), _mm_sub_ps(_mm_loadu_ps(&r.oy[i]), cy),
+                          _mm_sub_ps(_mm_loadu_ps(&r.oz[i]), cz), _mm_loadu_ps(&r.dx[i]), _mm_loadu_ps(&r.dy[i]),
+                          _mm_loadu_ps(&r.dz[i]), r2, tm);
+        _mm_storeu_ps(tOut + i, t);
+        hits += __builtin_popcount(_mm_movemask_ps(_mm_cmpneq_ps(t, miss)));
+    }
+    return hits + raysTail(r, c, radius * radius, full, tMin, tOut);
+}
+
+// ========== AVX2（8 宽） ==========
+
+__attribute__((target("avx2"))) inline __m256 hitAVX2(__m256 ocx, __m256 ocy, __m256 ocz, __m256 dx,
+                                                       __m256 dy, __m256 dz, __m256 r2, __m256 tMin) {
+    __m256 a = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+    __m256 hb = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, dx), _mm256_mul_ps(ocy, dy)), _mm256_mul_ps(ocz, dz));
+    __m256 c = _mm256_sub_ps(
+        _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, ocx), _mm256_mul_ps(ocy, ocy)), _mm256_mul_ps(ocz, ocz)), r2);
+    __m256 disc = _mm256_sub_ps(_mm256_mul_ps(hb, hb), _mm256_mul_ps(a, c));
+    __m256 zero = _mm256_setzero_ps();
+    __m256 valid = _mm256_cmp_ps(disc, zero, _CMP_GE_OQ);
+    __m256 s = _mm256_sqrt_ps(_mm256_max_ps(disc, zero));
+    __m256 nhb = _mm256_sub_ps(zero, hb);
+    __m256 t0 = _mm256_div_ps(_mm256_sub_ps(nhb, s), a);
+    __m256 t1 = _mm256_div_ps(_mm256_add_ps(nhb, s), a);
+    __m256 miss = _mm256_set1_ps(kMiss);
+    __m256 t = _mm256_blendv_ps(miss, t1, _mm256_cmp_ps(t1, tMin, _CMP_GT_OQ));
+    t = _mm256_blendv_ps(t, t0, _mm256_cmp_ps(t0, tMin, _CMP_GT_OQ));
+    return _mm256_blendv_ps(miss, t, valid);
+}
+
+__attribute__((target("avx2"))) inline int closestAVX2(const float* o, const float* d, const SphereSoA& s,
+                                                       float tMin, float& tHit) {
+    const size_t n = s.size(), full = n & ~size_t(7);
+    __m256 ox = _mm256_set1_ps(o[0]), oy = _mm256_set1_ps(o[1]), oz = _mm256_set1_ps(o[2]);
+    __m256 dx = _mm256_set1_ps(d[0]), dy = _mm256_set1_ps(d[1]), dz = _mm256_set1_ps(d[2]);
+    __m256 tm = _mm256_set1_ps(tMin);
+    __m256 bestT = _mm256_set1_ps(kMiss);
+    __m256i bestI = _mm256_set1_epi32(-1);
+    __m256i idx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i step = _mm256_set1_epi32(8);
+    for (size_t i = 0; i < full; i += 8) {
+        __m256 t = hitAVX2(_mm256_sub_ps(ox, _mm256_loadu_ps(&s.cx[i])), _mm256_sub_ps(oy, _mm256_loadu_ps(&s.cy[i])),
+                           _mm256_sub_ps(oz, _mm256_loadu_ps(&s.cz[i])), dx, dy, dz, _mm256_loadu_ps(&s.r2[i]), tm);
+        __m256 closer = _mm256_cmp_ps(t, bestT, _CMP_LT_OQ);
+        bestT = _mm256_blendv_ps(bestT, t, closer);
+        bestI = _mm256_blendv_epi8(bestI, idx, _mm256_castps_si256(closer));
+        idx = _mm256_add_epi32(idx, step);
+    }
+    alignas(32) float lt[8];
+    alignas(32) int li[8];
+    _mm256_store_ps(lt, bestT);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(li), bestI);
+    int best = reduceLanes(lt, li, 8, tHit);
+    return closestTail(o, d, s, full, tMin, best, tHit);
+}
+
+__attribute__((target("avx2"))) inline size_t raysAVX2(const RaySoA& r, const float* c, float radius,
+                                                        float tMin, float* tOut) {
+    const size_t n = r.size(), full = n & ~size_t(7);
+    __m256 cx = _mm256_set1_ps(c[0]), cy = _mm256_set1_ps(c[1]), cz = _mm256_set1_ps(c[2]);
+    __m256 r2 = _mm256_set1_ps(radius * radius), tm = _mm256_set1_ps(tMin), miss = _mm256_set1_ps(kMiss);
+    size_t hits = 0;
+    for (size_t i = 0; i < full; i += 8) {
+        __m256 t = hitAVX2(_mm256_sub_ps(_mm256_loadu_ps(&r.ox[i]), cx), _mm256_sub_ps(_mm256_loadu_ps(&r.oy[i]), cy),
+                           _mm256_sub_ps(_mm256_loadu_ps(&r.oz[i]), cz), _mm256_loadu_ps(&r.dx[i]),
+                           _mm256_loadu_ps(&r.dy[i]), _mm256_loadu_ps(&r.dz[i]), r2, tm);
+        _mm256_storeu_ps(tOut + i, t);
+        hits += __builtin_popcount(_mm256_movemask_ps(_mm256_cmp_ps(t, miss, _CMP_NEQ_UQ)));
+    }
+    return hits + raysTail(r, c, radius * radius, full, tMin, tOut);
+}
+
+// ========== AVX-512（16 宽，掩码寄存器代替 blend） ==========
+
+__attribute__((target("avx512f"))) inline __m512 hitAVX512(__m512 ocx, __m512 ocy, __m512 ocz, __m512 dx,
+                                                            __m512 dy, __m512 dz, __m512 r2, __m512 tMin) {
+    __m512 a = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy)), _mm512_mul_ps(dz, dz));
+    __m512 hb = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(ocx, dx), _mm512_mul_ps(ocy, dy)), _mm512_mul_ps(ocz, dz));
+    __m512 c = _mm512_sub_ps(
+        _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(ocx, ocx), _mm512_mul_ps(ocy, ocy)), _mm512_mul_ps(ocz, ocz)), r2);
+    __m512 disc = _mm512_sub_ps(_mm512_mul_ps(hb, hb), _mm512_mul_ps(a, c));
+    __m512 zero = _mm512_setzero_ps();
+    __mmask16 valid = _mm512_cmp_ps_mask(disc, zero, _CMP_GE_OQ);
+    // 无交点的通道直接置 0，不必像 SSE/AVX 那样先 max(disc, 0)
+    __m512 s = _mm512_maskz_sqrt_ps(valid, disc);
+    __m512 nhb = _mm512_sub_ps(zero, hb);
+    __m512 t0 = _mm512_div_ps(_mm512_sub_ps(nhb, s), a);
+    __m512 t1 = _mm512_div_ps(_mm512_add_ps(nhb, s), a);
+    __m512 t = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(t1, tMin, _CMP_GT_OQ), _mm512_set1_ps(kMiss), t1);
+    t = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(t0, tMin, _CMP_GT_OQ), t, t0);
+    return _mm512_mask_blend_ps(valid, _mm512_set1_ps(kMiss), t);
+}
+
+__attribute__((target("avx512f"))) inline int closestAVX512(const float* o, const float* d, const SphereSoA& s,
+                                                            float tMin, float& tHit) {
+    const size_t n = s.size(), full = n & ~size_t(15);
+    __m512 ox = _mm512_set1_ps(o[0]), oy = _mm512_set1_ps(o[1]), oz = _mm512_set1_ps(o[2]);
+    __m512 dx = _mm512_set1_ps(d[0]), dy = _mm512_set1_ps(d[1]), dz = _mm512_set1_ps(d[2]);
+    __m512 tm = _mm512_set1_ps(tMin);
+    __m512 bestT = _mm512_set1_ps(kMiss);
+    __m512i bestI = _mm512_set1_epi32(-1);
+    __m512i idx = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m512i step = _mm512_set1_epi32(16);
+    for (size_t i = 0; i < full; i += 16) {
+        __m512 t = hitAVX512(_mm512_sub_ps(ox, _mm512_loadu_ps(&s.cx[i])), _mm512_sub_ps(oy, _mm512_loadu_ps(&s.cy[i])),
+                             _mm512_sub_ps(oz, _mm512_loadu_ps(&s.cz[i])), dx, dy, dz, _mm512_loadu_ps(&s.r2[i]), tm);
+        __mmask16 closer = _mm512_cmp_ps_mask(t, bestT, _CMP_LT_OQ);
+        bestT = _mm512_mask_blend_ps(closer, bestT, t);
+        bestI = _mm512_mask_blend_epi32(closer, bestI, idx);
+        idx = _mm512_add_epi32(idx, step);
+    }
+    alignas(64) float lt[16];
+    alignas(64) int li[16];
+    _mm512_store_ps(lt, bestT);
+    _mm512_store_si512(li, bestI);
+    int best = reduceLanes(lt, li, 16, tHit);
+    return closestTail(o, d, s, full, tMin, best, tHit);
+}
+
+__attribute__((target("avx512f"))) inline size_t raysAVX512(const RaySoA& r, const float* c, float radius,
+                                                             float tMin, float* tOut) {
+    const size_t n = r.size(), full = n & ~size_t(15);
+    __m512 cx = _mm512_set1_ps(c[0]), cy = _mm512_set1_ps(c[1]), cz = _mm512_set1_ps(c[2]);
+    __m512 r2 = _mm512_set1_ps(radius * radius), tm = _mm512_set1_ps(tMin), miss = _mm512_set1_ps(kMiss);
+    size_t hits = 0;
+    for (size_t i = 0; i < full; i += 16) {
+        __m512 t = hitAVX512(_mm512_sub_ps(_mm512_loadu_ps(&r.ox[i]), cx), _mm512_sub_ps(_mm512_loadu_ps(&r.oy[i]), cy),
+                             _mm512_sub_ps(_mm512_loadu_ps(&r.oz[i]), cz), _mm512_loadu_ps(&r.dx[i]),
+                             _mm512_loadu_ps(&r.dy[i]), _mm512_loadu_ps(&r.dz[i]), r2, tm);
+        _mm512_storeu_ps(tOut + i, t);
+        hits += __builtin_popcount(_mm512_cmp_ps_mask(t, miss, _CMP_NEQ_UQ));
+    }
+    return hits + raysTail(r, c, radius * radius, full, tMin, tOut);
+}
+
+#endif  // RSI_X86
+
+#if RSI_NEON
+
+// ========== NEON（4 宽，AArch64 上总是可用） ==========
+
+inline float32x4_t hitNEON(float32x4_t ocx, float32x4_t ocy, float32x4_t ocz, float32x4_t dx, float32x4_t dy,
+                           float32x4_t dz, float32x4_t r2, float32x4_t tMin) {
+    // 不用 vmlaq/vfmaq：融合乘加会让结果和标量版不再逐位一致
+    float32x4_t a = vaddq_f32(vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy)), vmulq_f32(dz, dz));
+    float32x4_t hb = vaddq_f32(vaddq_f32(vmulq_f32(ocx, dx), vmulq_f32(ocy, dy)), vmulq_f32(ocz, dz));
+    float32x4_t c = vsubq_f32(vaddq_f32(vaddq_f32(vmulq_f32(ocx, ocx), vmulq_f32(ocy, ocy)), vmulq_f32(ocz, ocz)), r2);
+    float32x4_t disc = vsubq_f32(vmulq_f32(hb, hb), vmulq_f32(a, c));
+    float32x4_t zero = vdupq_n_f32(0.0f);
+    uint32x4_t valid = vcgeq_f32(disc, zero);
+    float32x4_t s = vsqrtq_f32(vmaxq_f32(disc, zero));
+    float32x4_t nhb = vnegq_f32(hb);
+    float32x4_t t0 = vdivq_f32(vsubq_f32(nhb, s), a);
+    float32x4_t t1 = vdivq_f32(vaddq_f32(nhb, s), a);
+    float32x4_t miss = vdupq_n_f32(kMiss);
+    float32x4_t t = vbslq_f32(vcgtq_f32(t1, tMin), t1, miss);
+    t = vbslq_f32(vcgtq_f32(t0, tMin), t0, t);
+    return vbslq_f32(valid, t, miss);
+}
+
+inline int closestNEON(const float* o, const float* d, const SphereSoA& s, float tMin, float& tHit) {
+    const size_t n = s.size(), full = n & ~size_t(3);
+    float32x4_t ox = vdupq_n_f32(o[0]), oy = vdupq_n_f32(o[1]), oz = vdupq_n_f32(o[2]);
+    float32x4_t dx = vdupq_n_f32(d[0]), dy = vdupq_n_f32(d[1]), dz = vdupq_n_f32(d[2]);
+    float32x4_t tm = vdupq_n_f32(tMin);
+    float32x4_t bestT = vdupq_n_f32(kMiss);
+    int32x4_t bestI = vdupq_n_s32(-1);
+    const int32_t start[4] = {0, 1, 2, 3};
+    int32x4_t idx = vld1q_s32(start);
+    const int32x4_t step = vdupq_n_s32(4);
+    for (size_t i = 0; i < full; i += 4) {
+        float32x4_t t = hitNEON(vsubq_f32(ox, vld1q_f32(&s.cx[i])), vsubq_f32(oy, vld1q_f32(&s.cy[i])),
+                                vsubq_f32(oz, vld1q_f32(&s.cz[i])), dx, dy, dz, vld1q_f32(&s.r2[i]), tm);
+        uint32x4_t closer = vcltq_f32(t, bestT);
+        bestT = vbslq_f32(closer, t, bestT);
+        bestI = vbslq_s32(closer, idx, bestI);
+        idx = vaddq_s32(idx, step);
+    }
+    float lt[4];
+    int li[4];
+    vst1q_f32(lt, bestT);
+    vst1q_s32(li, bestI);
+    int best = reduceLanes(lt, li, 4, tHit);
+    return closestTail(o, d, s, full, tMin, best, tHit);
+}
+
+inline size_t raysNEON(const RaySoA& r, const float* c, float radius, float tMin, float* tOut) {
+    const size_t n = r.size(), full = n & ~size_t(3);
+    float32x4_t cx = vdupq_n_f32(c[0]), cy = vdupq_n_f32(c[1]), cz = vdupq_n_f32(c[2]);
+    float32x4_t r2 = vdupq_n_f32(radius * radius), tm = vdupq_n_f32(tMin), miss = vdupq_n_f32(kMiss);
+    size_t hits = 0;
+    for (size_t i = 0; i < full; i += 4) {
+        float32x4_t t = hitNEON(vsubq_f32(vld1q_f32(&r.ox[i]), cx), vsubq_f32(vld1q_f32(&r.oy[i]), cy),
+                                vsubq_f32(vld1q_f32(&r.oz[i]), cz), vld1q_f32(&r.dx[i]), vld1q_f32(&r.dy[i]),
+                                vld1q_f32(&r.dz[i]), r2, tm);
+        vst1q_f32(tOut + i, t);
+        // 命中通道为全 1，取反后右移 31 位得到 0/1 计数
+        hits += vaddvq_u32(vshrq_n_u32(vmvnq_u32(vceqq_f32(t, miss)), 31));
+    }
+    return hits + raysTail(r, c, radius * radius, full, tMin, tOut);
+}
+
+#endif  // RSI_NEON
+
+}  // namespace detail
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC pop_options
+#endif
+
+// ========== 运行时选择 ==========
+
+inline bool isaSupported(Isa isa) {
+    switch (isa) {
+        case Isa::Scalar: return true;
+#if RSI_X86
+        // __builtin_cpu_supports 查 CPUID，AVX 系列同时检查 XGETBV（操作系统是否保存 YMM/ZMM 状态）
+        case Isa::SSE4:   return __builtin_cpu_supports("sse4.1");
+        case Isa::AVX2:   return __builtin_cpu_supports("avx2");
+        case Isa::AVX512: return __builtin_cpu_supports("avx512f");
+#endif
+#if RSI_NEON
+        case Isa::NEON:   return true;
+#endif
+        default:          return false;
+    }
+}
+
+inline Kernels kernelsFor(Isa isa) {
+    switch (isa) {
+#if RSI_X86
+        case Isa::SSE4:   return {isa, detail::closestSSE4, detail::raysSSE4};
+        case Isa::AVX2:   return {isa, detail::closestAVX2, detail::raysAVX2};
+        case Isa::AVX512: return {isa, detail::closestAVX512, detail::raysAVX512};
+#endif
+#if RSI_NEON
+        case Isa::NEON:   return {isa, detail::closestNEON, detail::raysNEON};
+#endif
+        default:          return {Isa::Scalar, detail::closestScalar, detail::raysScalar};
+    }
+}
+
+// 当前机器支持的最宽实现
+inline Isa bestIsa() {
+    const Isa order[] = {Isa::AVX512, Isa::AVX2, Isa::SSE4, Isa::NEON};
+    for (Isa isa : order) {
+        if (isaSupported(isa)) return isa;
+    }
+    return Isa::Scalar;
+}
+
+inline Isa selectIsa() {
+    if (const char* forced = std::getenv("RSI_ISA")) {
+        const Isa all[] = {Isa::Scalar, Isa::SSE4, Isa::AVX2, Isa::AVX512, Isa::NEON};
+        for (Isa isa : all) {
+            if (std::strcmp(forced, isaName(isa)) == 0 && isaSupported(isa)) return isa;
+        }
+    }
+    return bestIsa();
+}
+
+// 首次调用时选定，之后直接返回同一组函数指针
+inline const Kernels& kernels() {
+    static const Kernels selected = kernelsFor(selectIsa());
+    return selected;
+}
+
+inline int closestSphere(const float* origin, const float* dir, const SphereSoA& spheres, float tMin, float& tHit) {
+    return kernels().closestSphere(origin, dir, spheres, tMin, tHit);
+}
+
+inline size_t raysVsSphere(const RaySoA& rays, const float* center, float radius, float tMin, float* tOut) {
+    return kernels().raysVsSphere(rays, center, radius, tMin, tOut);
+}
+
+}  // namespace rsi
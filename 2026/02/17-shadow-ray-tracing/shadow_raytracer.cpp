@@ -1,6 +1,6 @@
 // Shadow Ray Tracing - 带阴影的光线追踪器
 // 日期: 2026-02-17
-// 技术: 光线追踪 + Shadow Ray + Phong光照模型
+// 技术: 光线追踪 + Shadow Ray + Phong光照模型 + 遮挡物缓存 / 多光源剔除与随机选择
 
 #include <iostream>
 #include <vector>
@@ -8,6 +8,11 @@
 #include <fstream>
 #include <limits>
 #include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <string>
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
@@ -94,19 +99,129 @@ struct Light {
     Vec3 position;
     Vec3 color;
     double intensity;
+    double range;  // 作用半径，超出后贡献为 0；INF 表示不衰减（原始行为）
     
-    Light(const Vec3& pos, const Vec3& col, double intens = 1.0)
-        : position(pos), color(col), intensity(intens) {}
+    Light(const Vec3& pos, const Vec3& col, double intens = 1.0, double r = INF)
+        : position(pos), color(col), intensity(intens), range(r) {}
+    
+    // 平滑窗口衰减 (1 - (d/r)²)²，在 range 处连续降到 0
+    double attenuation(double distance) const {
+        if (range == INF) return 1.0;
+        if (distance >= range) return 0.0;
+        double x = distance / range;
+        double w = 1.0 - x * x;
+        return w * w;
+    }
+};
+
+// 着色时的可变状态：每个光源的遮挡物缓存、随机数与统计。由渲染线程持有，Scene 保持只读
+struct LightingContext {
+    std::vector<int> lastOccluder;  // 每个光源上一次命中的遮挡球下标，-1 表示无
+    bool useOccluderCache = true;
+    int samplesPerHit = 0;          // > 0 时对候选光源按贡献随机选择这么多条阴影光线
+    uint64_t rngState = 1;
+    
+    // 统计
+    long long shadingPoints = 0;
+    long long shadowRays = 0;
+    long long sphereTests = 0;
+    long long cacheHits = 0;
+    long long culledLights = 0;
+    
+    LightingContext(size_t lightCount) : lastOccluder(lightCount, -1) {}
+    
+    // xorshift64*，返回 [0, 1)
+    double random() {
+        rngState ^= rngState >> 12;
+        rngState ^= rngState << 25;
+        rngState ^= rngState >> 27;
+        return double((rngState * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+    }
+};
+
+// 光源均匀网格：每个格子记录作用范围与之相交的有限范围光源，着色点只遍历所在格子的列表
+// 无限范围的光源始终参与着色
+struct LightGrid {
+    std::vector<int> globalLights;           // range == INF
+    std::vector<std::vector<int>> cells;
+    Vec3 boundsMin, boundsMax;
+    int res[3] = {0, 0, 0};
+    double cellSize = 1.0;
+    
+    void build(const std::vector<Light>& lights, double targetCellSize = 1.0) {
+        globalLights.clear();
+        cells.clear();
+        boundsMin = Vec3(INF, INF, INF);
+        boundsMax = Vec3(-INF, -INF, -INF);
+        for (size_t i = 0; i < lights.size(); i++) {
+            const Light& l = lights[i];
+            if (l.range == INF) { globalLights.push_back(int(i)); continue; }
+            boundsMin = Vec3(std::min(boundsMin.x, l.position.x - l.range),
+                             std::min(boundsMin.y, l.position.y - l.range),
+                             std::min(boundsMin.z, l.position.z - l.range));
+            boundsMax = Vec3(std::max(boundsMax.x, l.position.x + l.range),
+                             std::max(boundsMax.y, l.position.y + l.range),
+                             std::max(boundsMax.z, l.position.z + l.range));
+        }
+        if (globalLights.size() == lights.size()) return;
+        
+        cellSize = targetCellSize;
+        Vec3 extent = boundsMax - boundsMin;
+        res[0] = std::max(1, int(std::ceil(extent.x / cellSize)));
+        res[1] = std::max(1, int(std::ceil(extent.y / cellSize)));
+        res[2] = std::max(1, int(std::ceil(extent.z / cellSize)));
+        cells.assign(size_t(res[0]) * res[1] * res[2], {});
+        
+        for (size_t i = 0; i < lights.size(); i++) {
+            const Light& l = lights[i];
+            if (l.range == INF) continue;
+            int lo[3], hi[3];
+            cellRange(l.position - Vec3(l.range, l.range, l.range), lo);
+            cellRange(l.position + Vec3(l.range, l.range, l.range), hi);
+            for (int z = lo[2]; z <= hi[2]; z++)
+                for (int y = lo[1]; y <= hi[1]; y++)
+                    for (int x = lo[0]; x <= hi[0]; x++) {
+                        // 格子到光源的最近距离，超出 range 的格子不登记
+                        Vec3 cmin = boundsMin + Vec3(x, y, z) * cellSize;
+                        double dx = std::max(0.0, std::max(cmin.x - l.position.x, l.position.x - cmin.x - cellSize));
+                        double dy = std::max(0.0, std::max(cmin.y - l.position.y, l.position.y - cmin.y - cellSize));
+                        double dz = std::max(0.0, std::max(cmin.z - l.position.z, l.position.z - cmin.z - cellSize));
+                        if (dx * dx + dy * dy + dz * dz < l.range * l.range)
+                            cells[(size_t(z) * res[1] + y) * res[0] + x].push_back(int(i));
+                    }
+        }
+    }
+    
+    // 包含 point 的格子光源列表；网格外没有有限范围光源能照到
+    const std::vector<int>* cellLights(const Vec3& point) const {
+        if (cells.empty()) return nullptr;
+        if (point.x < boundsMin.x || point.y < boundsMin.y || point.z < boundsMin.z ||
+            point.x >= boundsMax.x || point.y >= boundsMax.y || point.z >= boundsMax.z) return nullptr;
+        int c[3];
+        cellRange(point, c);
+        return &cells[(size_t(c[2]) * res[1] + c[1]) * res[0] + c[0]];
+    }
+    
+private:
+    void cellRange(const Vec3& p, int out[3]) const {
+        Vec3 rel = (p - boundsMin) / cellSize;
+        out[0] = std::min(res[0] - 1, std::max(0, int(rel.x)));
+        out[1] = std::min(res[1] - 1, std::max(0, int(rel.y)));
+        out[2] = std::min(res[2] - 1, std::max(0, int(rel.z)));
+    }
 };
 
 // 场景
 struct Scene {
     std::vector<Sphere> spheres;
     std::vector<Light> lights;
+    LightGrid lightGrid;  // 光源增删后需调用 buildLightGrid()
     Vec3 backgroundColor;
     
     Scene() : backgroundColor(0.1, 0.1, 0.2) {}  // 深蓝色背景
     
+    void buildLightGrid() { lightGrid.build(lights); }
+    
     // 查找最近的交点
     bool findNearestIntersection(const Ray& ray, double& nearestT, const Sphere*& hitSphere) const {
         nearestT = INF;
@@ -124,59 +239,126 @@ struct Scene {
     }
     
     // 检查阴影：从点到光源的路径上是否有遮挡物
-    bool isInShadow(const Vec3& point, const Vec3& lightPos) const {
-        Vec3 toLight = lightPos - point;
+    // 任一遮挡即可返回，先测该光源上一次的遮挡球：相邻像素的阴影光线通常被同一个物体挡住
+    bool isInShadow(const Vec3& point, size_t lightIndex, LightingContext& ctx) const {
+        Vec3 toLight = lights[lightIndex].position - point;
         double distanceToLight = toLight.length();
         Ray shadowRay(point, toLight);
+        ctx.shadowRays++;
         
-        // 检查是否有物体遮挡
-        for (const auto& sphere : spheres) {
+        auto blocks = [&](const Sphere& sphere) {
+            ctx.sphereTests++;
             double t;
-            if (sphere.intersect(shadowRay, t)) {
-                // 如果交点在光源之前，说明被遮挡
-                if (t > EPSILON && t < distanceToLight) {
-                    return true;
-                }
+            // 如果交点在光源之前，说明被遮挡
+            return sphere.intersect(shadowRay, t) && t > EPSILON && t < distanceToLight;
+        };
+        
+        int cached = ctx.useOccluderCache ? ctx.lastOccluder[lightIndex] : -1;
+        if (cached >= 0 && blocks(spheres[cached])) {
+            ctx.cacheHits++;
+            return true;
+        }
+        
+        // 检查是否有物体遮挡
+        for (size_t i = 0; i < spheres.size(); i++) {
+            if (int(i) == cached) continue;
+            if (blocks(spheres[i])) {
+                ctx.lastOccluder[lightIndex] = int(i);
+                return true;
             }
         }
         
         return false;
     }
     
+    // 不考虑遮挡时单个光源的漫反射 + 镜面反射贡献；超出作用范围或贡献可忽略时返回 false
+    bool unshadowedContribution(const Light& light, const Vec3& point, const Vec3& normal, const Vec3& viewDir,
+                                const Material& material, Vec3& contribution) const {
+        const double negligible = 1e-6;  // 线性空间，gamma 后远小于 1/255
+        
+        Vec3 toLight = light.position - point;
+        double distance = toLight.length();
+        double attenuation = light.attenuation(distance);
+        if (attenuation <= 0.0) return false;
+        
+        Vec3 lightDir = toLight / distance;
+        double strength = light.intensity * attenuation;
+        
+        // 漫反射 (Diffuse)
+        double diffuseIntensity = std::max(0.0, normal.dot(lightDir));
+        Vec3 diffuse = material.color * (material.diffuse * diffuseIntensity * strength);
+        
+        // 镜面反射 (Specular) - Phong模型
+        Vec3 reflectDir = (normal * (2.0 * normal.dot(lightDir)) - lightDir).normalize();
+        double specularIntensity = std::pow(std::max(0.0, viewDir.dot(reflectDir)), material.shininess);
+        Vec3 specular = light.color * (material.specular * specularIntensity * strength);
+        
+        contribution = diffuse + specular;
+        return std::max(contribution.x, std::max(contribution.y, contribution.z)) > negligible;
+    }
+    
     // Phong 光照模型 + 阴影
-    Vec3 computePhongLighting(const Vec3& point, const Vec3& normal, const Vec3& viewDir, const Material& material) const {
+    // 先算出每个光源的无遮挡贡献，只给有贡献的光源发阴影光线；
+    // ctx.samplesPerHit > 0 且候选光源更多时，按贡献大小随机抽取光源，结果保持无偏
+    Vec3 computePhongLighting(const Vec3& point, const Vec3& normal, const Vec3& viewDir, const Material& material,
+                              LightingContext& ctx) const {
         Vec3 color(0, 0, 0);
+        ctx.shadingPoints++;
         
         // 环境光（不受阴影影响）
         Vec3 ambient = material.color * material.ambient;
         color = color + ambient;
         
-        // 遍历所有光源
-        for (const auto& light : lights) {
-            // 检查阴影
-            if (isInShadow(point, light.position)) {
-                continue;  // 在阴影中，跳过这个光源的漫反射和镜面反射
+        struct Candidate { size_t light; Vec3 contribution; double weight; };
+        thread_local std::vector<Candidate> candidates;
+        candidates.clear();
+        double totalWeight = 0.0;
+        
+        auto consider = [&](size_t i) {
+            Vec3 c;
+            if (!unshadowedContribution(lights[i], point, normal, viewDir, material, c)) {
+                ctx.culledLights++;
+                return;
             }
-            
-            Vec3 lightDir = (light.position - point).normalize();
-            
-            // 漫反射 (Diffuse)
-            double diffuseIntensity = std::max(0.0, normal.dot(lightDir));
-            Vec3 diffuse = material.color * (material.diffuse * diffuseIntensity * light.intensity);
-            
-            // 镜面反射 (Specular) - Phong模型
-            Vec3 reflectDir = (normal * (2.0 * normal.dot(lightDir)) - lightDir).normalize();
-            double specularIntensity = std::pow(std::max(0.0, viewDir.dot(reflectDir)), material.shininess);
-            Vec3 specular = light.color * (material.specular * specularIntensity * light.intensity);
-            
-            color = color + diffuse + specular;
+            double w = std::max(c.x, std::max(c.y, c.z));
+            candidates.push_back({i, c, w});
+            totalWeight += w;
+        };
+        // 网格外或不在格子列表里的有限范围光源直接剔除
+        const std::vector<int>* local = lightGrid.cellLights(point);
+        for (int i : lightGrid.globalLights) consider(size_t(i));
+        if (local) {
+            for (int i : *local) consider(size_t(i));
+        }
+        ctx.culledLights += lights.size() - lightGrid.globalLights.size() - (local ? local->size() : 0);
+        
+        if (ctx.samplesPerHit <= 0 || int(candidates.size()) <= ctx.samplesPerHit) {
+            // 逐个光源检查阴影
+            for (const auto& cand : candidates) {
+                if (!isInShadow(point, cand.light, ctx)) color = color + cand.contribution;
+            }
+            return color;
+        }
+        
+        // 按贡献比例抽样：E[c_j·V_j / (K·p_j)] = Σ c_i·V_i，p_j = w_j / W
+        for (int k = 0; k < ctx.samplesPerHit; k++) {
+            double target = ctx.random() * totalWeight;
+            size_t pick = 0;
+            while (pick + 1 < candidates.size() && target >= candidates[pick].weight) {
+                target -= candidates[pick].weight;
+                pick++;
+            }
+            const Candidate& cand = candidates[pick];
+            if (isInShadow(point, cand.light, ctx)) continue;
+            double scale = totalWeight / (cand.weight * ctx.samplesPerHit);
+            color = color + cand.contribution * scale;
         }
         
         return color;
     }
     
     // 追踪光线
-    Vec3 traceRay(const Ray& ray, int depth = 0) const {
+    Vec3 traceRay(const Ray& ray, LightingContext& ctx, int depth = 0) const {
         if (depth > 3) return backgroundColor;  // 递归深度限制
         
         double t;
@@ -192,7 +374,7 @@ struct Scene {
         Vec3 viewDir = (ray.origin - hitPoint).normalize();
         
         // 计算 Phong 光照 + 阴影
-        Vec3 color = computePhongLighting(hitPoint, normal, viewDir, hitSphere->material);
+        Vec3 color = computePhongLighting(hitPoint, normal, viewDir, hitSphere->material, ctx);
         
         return color;
     }
@@ -209,7 +391,7 @@ public:
         pixels.resize(width * height * 3);
     }
     
-    void render(const Scene& scene, const Vec3& cameraPos, double fov) {
+    void render(const Scene& scene, const Vec3& cameraPos, double fov, LightingContext& ctx) {
         double aspectRatio = static_cast<double>(width) / height;
         double scale = std::tan(fov * 0.5 * M_PI / 180.0);
         
@@ -224,8 +406,9 @@ public:
                 Vec3 rayDir(px, py, -1);
                 Ray ray(cameraPos, rayDir);
                 
-                // 追踪光线
-                Vec3 color = scene.traceRay(ray);
+                // 追踪光线；随机数按像素播种，结果与扫描顺序无关
+                ctx.rngState = (uint64_t(y) * width + x) * 0x9E3779B97F4A7C15ULL + 1;
+                Vec3 color = scene.traceRay(ray, ctx);
                 
                 // Gamma校正和裁剪
                 color.x = std::pow(std::min(1.0, color.x), 1.0 / 2.2);
@@ -253,7 +436,39 @@ public:
     }
 };
 
-int main() {
+// 多光源测试场景：在地面上摆一圈小球，并撒 count 个有限作用范围的彩色点光源
+void addManyLights(Scene& scene, int count) {
+    std::mt19937 rng(2026);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    
+    for (int i = 0; i < 24; i++) {
+        double a = 2 * M_PI * i / 24;
+        scene.spheres.push_back(Sphere(Vec3(4.0 * cos(a), -0.7, -5 + 2.5 * sin(a)), 0.3,
+            Material(Vec3(0.9, 0.9, 0.9), 0.1, 0.7, 0.3, 32)));
+    }
+    
+    for (int i = 0; i < count; i++) {
+        Vec3 pos(-6 + 12 * unit(rng), -0.6 + 2.0 * unit(rng), -10 + 9 * unit(rng));
+        Vec3 col(0.3 + 0.7 * unit(rng), 0.3 + 0.7 * unit(rng), 0.3 + 0.7 * unit(rng));
+        scene.lights.push_back(Light(pos, col, 0.15, 2.0 + 2.0 * unit(rng)));
+    }
+}
+
+int main(int argc, char** argv) {
+    int manyLights = 0;
+    int samplesPerHit = 0;
+    bool occluderCache = true;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--many" && i + 1 < argc) manyLights = std::max(0, atoi(argv[++i]));
+        else if (arg == "--sample" && i + 1 < argc) samplesPerHit = std::max(0, atoi(argv[++i]));
+        else if (arg == "--no-cache") occluderCache = false;
+        else {
+            std::cerr << "用法: " << argv[0] << " [--many N] [--sample K] [--no-cache]" << std::endl;
+            return 1;
+        }
+    }
+    
     // 创建场景
     Scene scene;
     
@@ -281,6 +496,9 @@ int main() {
     // 辅助光源（左侧，橙色弱光）
     scene.lights.push_back(Light(Vec3(-3, 3, 0), Vec3(1.0, 0.7, 0.3), 0.5));
     
+    if (manyLights > 0) addManyLights(scene, manyLights);
+    scene.buildLightGrid();
+    
     // 创建渲染器
     int width = 800;
     int height = 600;
@@ -290,11 +508,28 @@ int main() {
     Vec3 cameraPos(0, 1, 2);
     double fov = 60.0;
     
+    LightingContext ctx(scene.lights.size());
+    ctx.useOccluderCache = occluderCache;
+    ctx.samplesPerHit = samplesPerHit;
+    
     // 渲染场景
-    renderer.render(scene, cameraPos, fov);
+    auto start = std::chrono::steady_clock::now();
+    renderer.render(scene, cameraPos, fov, ctx);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    
+    std::cout << "光源: " << scene.lights.size() << ", 球体: " << scene.spheres.size()
+              << ", 渲染耗时: " << ms << " ms" << std::endl;
+    if (ctx.shadingPoints > 0) {
+        std::cout << "每着色点: 阴影光线 " << double(ctx.shadowRays) / ctx.shadingPoints
+                  << ", 剔除光源 " << double(ctx.culledLights) / ctx.shadingPoints << std::endl;
+    }
+    if (ctx.shadowRays > 0) {
+        std::cout << "每条阴影光线: 球体测试 " << double(ctx.sphereTests) / ctx.shadowRays
+                  << ", 遮挡缓存命中率 " << 100.0 * ctx.cacheHits / ctx.shadowRays << "%" << std::endl;
+    }
     
     // 保存图像
-    renderer.savePNG("shadow_output.png");
+    renderer.savePNG(manyLights > 0 ? "shadow_many_lights.png" : "shadow_output.png");
     
     return 0;
 }
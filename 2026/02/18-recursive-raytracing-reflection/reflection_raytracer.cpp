@@ -4,6 +4,10 @@
 #include <fstream>
 #include <algorithm>
 #include <limits>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <numeric>
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
@@ -116,15 +120,10 @@ struct Scene {
     void addLight(const Light& light) { lights.push_back(light); }
 };
 
-// 递归光线追踪（支持反射）
-Vec3 trace(const Ray& ray, const Scene& scene, int depth) {
-    if (depth <= 0) {
-        return Vec3(0, 0, 0); // 达到最大递归深度，返回黑色
-    }
-    
-    // 找到最近的交点
-    double closest_t = std::numeric_limits<double>::infinity();
-    const Sphere* hit_sphere = nullptr;
+// 找到最近的交点
+bool intersect_scene(const Ray& ray, const Scene& scene, double& closest_t, const Sphere*& hit_sphere) {
+    closest_t = std::numeric_limits<double>::infinity();
+    hit_sphere = nullptr;
     
     for (const auto& sphere : scene.spheres) {
         double t;
@@ -133,22 +132,22 @@ Vec3 trace(const Ray& ray, const Scene& scene, int depth) {
             hit_sphere = &sphere;
         }
     }
-    
-    // 没有击中任何物体，返回背景色（天空渐变）
-    if (!hit_sphere) {
-        double t = 0.5 * (ray.direction.y + 1.0);
-        Vec3 white(1.0, 1.0, 1.0);
-        Vec3 blue(0.5, 0.7, 1.0);
-        return white * (1.0 - t) + blue * t;
-    }
-    
-    // 计算交点信息
-    Vec3 hit_point = ray.at(closest_t);
-    Vec3 normal = (hit_point - hit_sphere->center).normalize();
-    Vec3 view_dir = (ray.origin - hit_point).normalize();
-    
+    return hit_sphere != nullptr;
+}
+
+// 背景色（天空渐变）
+Vec3 sky(const Ray& ray) {
+    double t = 0.5 * (ray.direction.y + 1.0);
+    Vec3 white(1.0, 1.0, 1.0);
+    Vec3 blue(0.5, 0.7, 1.0);
+    return white * (1.0 - t) + blue * t;
+}
+
+// 交点处的直接光照：环境光 + 每个光源的漫反射/高光（含阴影）
+Vec3 shade_direct(const Scene& scene, const Sphere& sphere, const Vec3& hit_point, const Vec3& normal,
+                  const Vec3& view_dir) {
     // 环境光
-    Vec3 color = scene.ambient * hit_sphere->material.color;
+    Vec3 color = scene.ambient * sphere.material.color;
     
     // 遍历所有光源
     for (const auto& light : scene.lights) {
@@ -159,9 +158,9 @@ Vec3 trace(const Ray& ray, const Scene& scene, int depth) {
         Ray shadow_ray(hit_point + normal * 1e-4, light_dir);
         bool in_shadow = false;
         
-        for (const auto& sphere : scene.spheres) {
+        for (const auto& other : scene.spheres) {
             double t;
-            if (sphere.intersect(shadow_ray, t) && t < light_distance) {
+            if (other.intersect(shadow_ray, t) && t < light_distance) {
                 in_shadow = true;
                 break;
             }
@@ -170,18 +169,46 @@ Vec3 trace(const Ray& ray, const Scene& scene, int depth) {
         if (!in_shadow) {
             // 漫反射 (Lambert)
             double diffuse_intensity = std::max(0.0, normal.dot(light_dir));
-            Vec3 diffuse = hit_sphere->material.color * light.color * diffuse_intensity 
-                         * hit_sphere->material.diffuse * light.intensity;
+            Vec3 diffuse = sphere.material.color * light.color * diffuse_intensity 
+                         * sphere.material.diffuse * light.intensity;
             
             // 镜面反射 (Phong)
             Vec3 reflect_dir = (light_dir * -1.0).reflect(normal);
             double spec_intensity = std::pow(std::max(0.0, reflect_dir.dot(view_dir)), 32);
             Vec3 specular = light.color * spec_intensity 
-                          * hit_sphere->material.specular * light.intensity;
+                          * sphere.material.specular * light.intensity;
             
             color = color + diffuse + specular;
         }
     }
+    return color;
+}
+
+Vec3 clamp_color(Vec3 color) {
+    color.x = std::min(1.0, color.x);
+    color.y = std::min(1.0, color.y);
+    color.z = std::min(1.0, color.z);
+    return color;
+}
+
+// 递归光线追踪（支持反射），保留作对照
+Vec3 trace(const Ray& ray, const Scene& scene, int depth) {
+    if (depth <= 0) {
+        return Vec3(0, 0, 0); // 达到最大递归深度，返回黑色
+    }
+    
+    double closest_t;
+    const Sphere* hit_sphere;
+    if (!intersect_scene(ray, scene, closest_t, hit_sphere)) {
+        return sky(ray);  // 没有击中任何物体，返回背景色
+    }
+    
+    // 计算交点信息
+    Vec3 hit_point = ray.at(closest_t);
+    Vec3 normal = (hit_point - hit_sphere->center).normalize();
+    Vec3 view_dir = (ray.origin - hit_point).normalize();
+    
+    Vec3 color = shade_direct(scene, *hit_sphere, hit_point, normal, view_dir);
     
     // 递归反射
     if (hit_sphere->material.reflectivity > 0.0) {
@@ -193,18 +220,124 @@ Vec3 trace(const Ray& ray, const Scene& scene, int depth) {
     }
     
     // Clamp 颜色值
-    color.x = std::min(1.0, color.x);
-    color.y = std::min(1.0, color.y);
-    color.z = std::min(1.0, color.z);
+    return clamp_color(color);
+}
+
+// ============================================================
+// 迭代追踪：路径吞吐量截断 + 每帧光线预算
+// ============================================================
+
+struct TraceStats {
+    long long rays = 0;             // 主光线 + 反射光线（不含阴影光线）
+    long long throughput_cutoffs = 0;
+    long long budget_cutoffs = 0;
+};
+
+// 每帧的反射光线预算（令牌桶）：每个像素存入 rate 个令牌，反射光线消耗令牌。
+// 背景等不反射的像素没用掉的份额累积下来，留给后面反射多的像素；整帧总数不超过 rate × 像素数
+struct RayBudget {
+    double rate = -1.0;  // 每像素平均可用的反射光线数；< 0 表示不限
+    double tokens = 0.0;
+    
+    // 当前像素最多可发射的反射光线数
+    int allowance(int max_bounces) {
+        if (rate < 0) return max_bounces;
+        tokens += rate;
+        return int(std::min(double(max_bounces), std::floor(tokens)));
+    }
+    
+    void consume(int used) {
+        if (rate >= 0) tokens -= used;
+    }
+};
+
+// 与 trace() 等价的循环版本。每层的混合 clamp(direct·(1−r) + r·C_next) 是非线性的，
+// 所以先沿路径正向记录每层的直接光照和反射率，再从末端反向折叠。
+// 路径吞吐量 Π r 低于 epsilon 时后续层对结果的影响不超过 epsilon，直接截断（按黑色处理，与深度截断一致）；
+// bounce_allowance 是本像素还能发射的反射光线数，用完后同样截断
+Vec3 trace_iterative(const Ray& primary, const Scene& scene, int max_depth, double epsilon,
+                     int& bounce_allowance, TraceStats& stats) {
+    const int kMaxDepth = 64;
+    struct Vertex { double r, g, b, reflectivity; };  // 平凡类型，避免每条路径都初始化整个数组
+    Vertex path[kMaxDepth];
+    int vertices = 0;
+    max_depth = std::min(max_depth, kMaxDepth);
+    
+    Ray ray = primary;
+    double throughput = 1.0;
+    Vec3 tail(0, 0, 0);  // 路径末端的颜色，默认黑色（深度/吞吐量/预算截断）
+    
+    for (int depth = 0; depth < max_depth; depth++) {
+        if (depth > 0) {
+            if (bounce_allowance <= 0) {
+                // 预算用完：用上一个交点的直接光照近似反射颜色，比直接当作黑色误差小得多
+                const Vertex& last = path[vertices - 1];
+                tail = clamp_color(Vec3(last.r, last.g, last.b));
+                stats.budget_cutoffs++;
+                break;
+            }
+            bounce_allowance--;
+        }
+        stats.rays++;
+        
+        double closest_t;
+        const Sphere* hit_sphere;
+        if (!intersect_scene(ray, scene, closest_t, hit_sphere)) {
+            tail = sky(ray);
+            break;
+        }
+        
+        Vec3 hit_point = ray.at(closest_t);
+        Vec3 normal = (hit_point - hit_sphere->center).normalize();
+        Vec3 view_dir = (ray.origin - hit_point).normalize();
+        Vec3 direct = shade_direct(scene, *hit_sphere, hit_point, normal, view_dir);
+        
+        double r = hit_sphere->material.reflectivity;
+        if (r <= 0.0) {
+            tail = clamp_color(direct);
+            break;
+        }
+        path[vertices++] = {direct.x, direct.y, direct.z, r};
+        
+        throughput *= r;
+        if (throughput < epsilon) {
+            stats.throughput_cutoffs++;
+            break;
+        }
+        ray = Ray(hit_point + normal * 1e-4, ray.direction.reflect(normal));
+    }
     
+    Vec3 color = tail;
+    for (int i = vertices - 1; i >= 0; i--) {
+        Vec3 direct(path[i].r, path[i].g, path[i].b);
+        color = clamp_color(direct * (1.0 - path[i].reflectivity) + color * path[i].reflectivity);
+    }
     return color;
 }
 
-int main() {
+int main(int argc, char** argv) {
     // 图像参数
     const int width = 800;
     const int height = 600;
-    const int max_depth = 5; // 最大反射深度
+    int max_depth = 5;              // 最大反射深度
+    double epsilon = 1.0 / 256.0;   // 路径吞吐量低于此值即截断（影响小于 1/255）
+    double rays_per_pixel = -1.0;   // 每帧光线预算（按像素平均，含主光线）；< 0 表示不限
+    bool recursive = false;
+    bool mirrors = false;           // 追加一圈互相映照的镜面小球
+    
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--depth" && i + 1 < argc) max_depth = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--epsilon" && i + 1 < argc) epsilon = std::atof(argv[++i]);
+        else if (arg == "--budget" && i + 1 < argc) rays_per_pixel = std::atof(argv[++i]);
+        else if (arg == "--recursive") recursive = true;
+        else if (arg == "--mirrors") mirrors = true;
+        else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--depth N] [--epsilon E] [--budget RAYS_PER_PIXEL] [--recursive] [--mirrors]" << std::endl;
+            return 1;
+        }
+    }
     
     // 创建场景
     Scene scene;
@@ -230,6 +363,15 @@ int main() {
     scene.addSphere(Sphere(Vec3(0, 1.5, -4), 0.5, 
                            Material(Vec3(1.0, 0.84, 0.0), 0.3, 0.7, 0.6)));
     
+    if (mirrors) {
+        // 围绕中心银球的一圈镜面小球，光线在球间多次弹射
+        for (int i = 0; i < 10; i++) {
+            double a = 2.0 * M_PI * i / 10;
+            scene.addSphere(Sphere(Vec3(1.7 * std::cos(a), 1.7 * std::sin(a) * 0.6, -5 + 1.2 * std::sin(a)), 0.55,
+                                   Material(Vec3(0.9, 0.9, 0.9), 0.2, 0.6, 0.7)));
+        }
+    }
+    
     // 添加光源（增强亮度）
     scene.addLight(Light(Vec3(5, 5, -2), Vec3(1, 1, 1), 1.5));      // 主光源增强
     scene.addLight(Light(Vec3(-5, 3, -3), Vec3(0.9, 0.9, 1.0), 1.0)); // 副光源增强
@@ -240,10 +382,21 @@ int main() {
     std::cout << "Rendering " << width << "x" << height << " image..." << std::endl;
     std::cout << "Max reflection depth: " << max_depth << std::endl;
     
-    for (int y = 0; y < height; y++) {
-        if (y % 50 == 0) {
-            std::cout << "Progress: " << (y * 100 / height) << "%" << std::endl;
+    TraceStats stats;
+    RayBudget budget;
+    if (rays_per_pixel >= 1.0) budget.rate = rays_per_pixel - 1.0;  // 主光线总是发射
+    auto start = std::chrono::steady_clock::now();
+    
+    // 按与 height 互质的步长跳行扫描：反射多的区域在时间上被打散，预算不足时截断均匀分布在整幅图上，
+    // 而不是集中在先扫到的那几行之后
+    int row_stride = int(height * 0.618);
+    while (std::gcd(row_stride, height) != 1) row_stride++;
+    
+    for (int row = 0; row < height; row++) {
+        if (row % 50 == 0) {
+            std::cout << "Progress: " << (row * 100 / height) << "%" << std::endl;
         }
+        int y = int((long long)row * row_stride % height);
         
         for (int x = 0; x < width; x++) {
             // 将像素坐标映射到 [-1, 1] 范围
@@ -256,7 +409,15 @@ int main() {
             Ray ray(ray_origin, ray_direction);
             
             // 追踪光线
-            Vec3 color = trace(ray, scene, max_depth);
+            Vec3 color;
+            if (recursive) {
+                color = trace(ray, scene, max_depth);
+            } else {
+                int allowance = budget.allowance(max_depth - 1);
+                int granted = allowance;
+                color = trace_iterative(ray, scene, max_depth, epsilon, allowance, stats);
+                budget.consume(granted - allowance);
+            }
             
             // 写入像素（RGB）
             int idx = (y * width + x) * 3;
@@ -266,6 +427,14 @@ int main() {
         }
     }
     
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Render time: " << ms << " ms" << std::endl;
+    if (!recursive) {
+        std::cout << "Rays/pixel: " << double(stats.rays) / (width * height)
+                  << ", throughput cutoffs: " << stats.throughput_cutoffs
+                  << ", budget cutoffs: " << stats.budget_cutoffs << std::endl;
+    }
+    
     // 保存图像
     std::string filename = "reflection_output.png";
     if (stbi_write_png(filename.c_str(), width, height, 3, image.data(), width * 3)) {
@@ -0,0 +1,402 @@
+/**
+ * BVH 加速结构（头文件，供其他光线追踪器共享）
+ *
+ * 只依赖图元包围盒：引用方给出每个图元的 AABB 建树，遍历时通过回调
+ * 对叶子中的图元做精确求交，因此与引用方自己的 Vec3 / Ray / 图元类型无关。
+ * 节点布局与 03-01 BVH 光线追踪器的扁平节点相同（32 字节、子节点相邻、
+ * float 包围盒向外取整），类型放在 bvh 命名空间中。
+ *
+ * 分桶 SAH 分割（sah_split）与最近 / 任意交点遍历（closest_hit / any_hit）只在这里实现一份：
+ * Tree 用它们建树和遍历；03-01 main.cpp 的 BVH<Prim> 也用同一个 sah_split 选分割点、
+ * 用同一套遍历模板（叶子求交换成它的 SIMD 叶子核，计数钩子接它的 instr），
+ * 并行构建、LBVH、refit / 局部重建、光线包和 BVH4 是在这之上的扩展。
+ */
+
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+
+namespace bvh {
+
+// double -> float 向下 / 向上取整
+inline float float_down(double v) {
+    float f = (float)v;
+    return (double)f > v ? std::nextafter(f, -std::numeric_limits<float>::infinity()) : f;
+}
+inline float float_up(double v) {
+    float f = (float)v;
+    return (double)f < v ? std::nextafter(f, std::numeric_limits<float>::infinity()) : f;
+}
+
+// 轴对齐包围盒（构建用，double）
+struct AABB {
+    double lo[3] = { std::numeric_limits<double>::infinity(),
+                     std::numeric_limits<double>::infinity(),
+                     std::numeric_limits<double>::infinity() };
+    double hi[3] = { -std::numeric_limits<double>::infinity(),
+                     -std::numeric_limits<double>::infinity(),
+                     -std::numeric_limits<double>::infinity() };
+
+    AABB() = default;
+    AABB(double x0, double y0, double z0, double x1, double y1, double z1)
+        : lo{x0, y0, z0}, hi{x1, y1, z1} {}
+
+    bool empty() const { return lo[0] > hi[0]; }
+
+    void expand(const AABB& b) {
+        for (int i = 0; i < 3; i++) {
+            lo[i] = std::min(lo[i], b.lo[i]);
+            hi[i] = std::max(hi[i], b.hi[i]);
+        }
+    }
+    void expand(const double p[3]) {
+        for (int i = 0; i < 3; i++) {
+            lo[i] = std::min(lo[i], p[i]);
+            hi[i] = std::max(hi[i], p[i]);
+        }
+    }
+
+    double area() const {
+        if (empty()) return 0.0;
+        double dx = hi[0] - lo[0], dy = hi[1] - lo[1], dz = hi[2] - lo[2];
+        return 2.0 * (dx * dy + dy * dz + dz * dx);
+    }
+
+    double centroid(int axis) const { return 0.5 * (lo[axis] + hi[axis]); }
+};
+
+// 扁平化 BVH 节点（32 字节，遍历用）
+// - 包围盒用 float 存储，构建时向外取整，保证保守
+// - 内部节点的两个子节点相邻存放：nodes[offset] 与 nodes[offset + 1]
+// - 节点按深度优先顺序排列，axis 记录分裂轴，用于按光线方向决定先访问哪个子节点
+struct alignas(32) FlatNode {
+    float bmin[3], bmax[3];
+    int32_t offset;       // 内部节点：左子节点下标；叶子：prim_indices 起始下标
+    uint16_t prim_count;  // 0 表示内部节点
+    uint8_t axis;         // 分裂轴（0/1/2）
+    uint8_t pad;
+};
+static_assert(sizeof(FlatNode) == 32, "FlatNode 必须是 32 字节");
+
+// 遍历用光线：float 原点与方向倒数，构造时缓存方向符号
+struct Ray {
+    float org[3];
+    float inv_dir[3];
+    int sign[3];  // 1 表示该轴方向为负（按方向倒数判断，-0 分量也算负）
+
+    Ray() = default;
+    Ray(double ox, double oy, double oz, double dx, double dy, double dz) {
+        const double o[3] = {ox, oy, oz}, d[3] = {dx, dy, dz};
+        for (int i = 0; i < 3; i++) {
+            org[i] = (float)o[i];
+            inv_dir[i] = (float)(1.0 / d[i]);
+            sign[i] = inv_dir[i] < 0 ? 1 : 0;
+        }
+    }
+};
+
+// ============================================================
+// 分桶 SAH 分割
+// ============================================================
+
+static constexpr int MAX_LEAF_SIZE = 8;         // 叶子最多图元数
+static constexpr int STACK_SIZE = 64;           // 遍历栈深度上限（树深度必须小于它）
+static constexpr int NUM_BUCKETS = 12;          // SAH 桶数量
+static constexpr double TRAVERSAL_COST = 0.125; // 相对一次图元测试的节点遍历代价
+
+// 构建输入：图元包围盒与质心。质心由引用方给出，不一定是包围盒中心（三角形取顶点平均）
+struct BuildPrim {
+    AABB box;
+    double centroid[3];
+};
+
+// 在 idx[start, end) 上选质心包围盒最长轴做分桶 SAH，并把 idx 原地分成左右两段；
+// 返回分割点，-1 表示成叶更便宜（只有图元数不超过 MAX_LEAF_SIZE 时才允许成叶）。
+// 分裂代价 = TRAVERSAL_COST + (n0·A0 + n1·A1) / A，成叶代价 = n
+inline int sah_split(const BuildPrim* prims, int* idx, int start, int end, int& axis) {
+    int count = end - start;
+    bool may_leaf = count <= MAX_LEAF_SIZE;
+    auto centroid = [&](int p) { return prims[p].centroid[axis]; };
+    auto by_centroid = [&](int a, int b) { return centroid(a) < centroid(b); };
+
+    AABB cb;
+    for (int i = start; i < end; i++) cb.expand(prims[idx[i]].centroid);
+    double ext[3] = {cb.hi[0] - cb.lo[0], cb.hi[1] - cb.lo[1], cb.hi[2] - cb.lo[2]};
+    axis = 0;
+    if (ext[1] > ext[0]) axis = 1;
+    if (ext[2] > ext[axis]) axis = 2;
+
+    if (count <= 4) {
+        // 小数量直接中值分割
+        std::sort(idx + start, idx + end, by_centroid);
+        int mid = start + count / 2;
+        if (may_leaf) {
+            AABB b0, b1;
+            for (int i = start; i < mid; i++) b0.expand(prims[idx[i]].box);
+            for (int i = mid; i < end; i++) b1.expand(prims[idx[i]].box);
+            AABB all = b0;
+            all.expand(b1);
+            double split_cost = TRAVERSAL_COST +
+                ((mid - start) * b0.area() + (end - mid) * b1.area()) / all.area();
+            if (split_cost >= count) return -1;
+        }
+        return mid;
+    }
+
+    double extent = ext[axis];
+    if (extent < 1e-10) {
+        // 退化情况：所有质心在同一位置
+        return may_leaf ? -1 : start + count / 2;
+    }
+
+    struct Bucket { AABB box; int count = 0; };
+    Bucket buckets[NUM_BUCKETS];
+    for (int i = start; i < end; i++) {
+        const BuildPrim& p = prims[idx[i]];
+        int b = std::min((int)(NUM_BUCKETS * (p.centroid[axis] - cb.lo[axis]) / extent), NUM_BUCKETS - 1);
+        buckets[b].count++;
+        buckets[b].box.expand(p.box);
+    }
+
+    // 一次前缀扫描 + 一次后缀扫描求全部分割点代价，O(桶数)
+    double left_area[NUM_BUCKETS - 1];
+    int left_count[NUM_BUCKETS - 1];
+    AABB acc;
+    int cnt = 0;
+    for (int i = 0; i < NUM_BUCKETS - 1; i++) {
+        acc.expand(buckets[i].box);
+        cnt += buckets[i].count;
+        left_area[i] = acc.area();
+        left_count[i] = cnt;
+    }
+    acc.expand(buckets[NUM_BUCKETS - 1].box);
+    double total_area = acc.area();
+
+    double min_cost = std::numeric_limits<double>::infinity();
+    int min_bucket = 0;
+    acc = AABB();
+    cnt = 0;
+    for (int i = NUM_BUCKETS - 2; i >= 0; i--) {
+        acc.expand(buckets[i + 1].box);
+        cnt += buckets[i + 1].count;
+        double cost = TRAVERSAL_COST + (left_count[i] * left_area[i] + cnt * acc.area()) / total_area;
+        if (cost <= min_cost) {  // 平局取靠左的分割点
+            min_cost = cost;
+            min_bucket = i;
+        }
+    }
+    if (may_leaf && min_cost >= count) return -1;
+
+    double split_val = cb.lo[axis] + (min_bucket + 1) * extent / NUM_BUCKETS;
+    int mid = (int)(std::partition(idx + start, idx + end,
+                                   [&](int p) { return centroid(p) < split_val; }) - idx);
+    if (mid == start || mid == end) {
+        // 防止退化：按质心中值切分
+        mid = start + count / 2;
+        std::nth_element(idx + start, idx + mid, idx + end, by_centroid);
+    }
+    return mid;
+}
+
+// ============================================================
+// 遍历
+// ============================================================
+
+// 遍历计数钩子：默认为空，引用方可以传自己的计数器（需要 node_visit() 与 stack_depth(sp)）
+struct NoCounters {
+    void node_visit() const {}
+    void stack_depth(int) const {}
+};
+
+// slab 测试（float），[t0, t1] 由调用方向外取整
+inline bool hit_box(const FlatNode& node, const Ray& ray, float t0, float t1) {
+    for (int i = 0; i < 3; i++) {
+        float tn = (node.bmin[i] - ray.org[i]) * ray.inv_dir[i];
+        float tf = (node.bmax[i] - ray.org[i]) * ray.inv_dir[i];
+        if (ray.sign[i]) std::swap(tn, tf);
+        t0 = tn > t0 ? tn : t0;
+        t1 = tf < t1 ? tf : t1;
+        if (t1 < t0) return false;
+    }
+    return true;
+}
+
+// 最近交点遍历：按光线方向符号先访问近侧子节点，远侧子节点入栈。
+// leaf(offset, count, t_max) 对叶子引用的 [offset, offset + count) 一段图元求交，
+// 找到比 t_max 更近的交点时把 t_max 缩小到该距离并返回图元下标，否则返回 -1。
+// t_max 为输入输出：返回时为最近交点距离。返回最近图元下标，未命中为 -1。
+// 要求树深度小于 STACK_SIZE。
+template <class LeafFn, class Counters = NoCounters>
+int closest_hit(const FlatNode* nodes, const Ray& ray, double t_min, double& t_max,
+                LeafFn&& leaf, Counters counters = {}) {
+    int stack[STACK_SIZE];
+    int sp = 0;
+    int node_idx = 0;
+    int hit_idx = -1;
+    float t_lo = float_down(t_min), t_hi = float_up(t_max);
+
+    while (true) {
+        const FlatNode& node = nodes[node_idx];
+        counters.node_visit();
+        if (hit_box(node, ray, t_lo, t_hi)) {
+            if (node.prim_count > 0) {
+                int pi = leaf(node.offset, (int)node.prim_count, t_max);
+                if (pi >= 0) {
+                    hit_idx = pi;
+                    t_hi = float_up(t_max);
+                }
+            } else {
+                int near_child = node.offset + ray.sign[node.axis];
+                stack[sp++] = node.offset + 1 - ray.sign[node.axis];
+                counters.stack_depth(sp);
+                node_idx = near_child;
+                continue;
+            }
+        }
+        if (sp == 0) break;
+        node_idx = stack[--sp];
+    }
+    return hit_idx;
+}
+
+// 任意交点遍历（阴影光线）：不排序子节点，leaf(offset, count) 在 (t_min, t_max) 内
+// 有任一交点时返回 true，遍历随即结束。要求树深度小于 STACK_SIZE。
+template <class LeafFn, class Counters = NoCounters>
+bool any_hit(const FlatNode* nodes, const Ray& ray, double t_min, double t_max,
+             LeafFn&& leaf, Counters counters = {}) {
+    int stack[STACK_SIZE];
+    int sp = 0;
+    int node_idx = 0;
+    float t_lo = float_down(t_min), t_hi = float_up(t_max);
+
+    while (true) {
+        const FlatNode& node = nodes[node_idx];
+        counters.node_visit();
+        if (hit_box(node, ray, t_lo, t_hi)) {
+            if (node.prim_count > 0) {
+                if (leaf(node.offset, (int)node.prim_count)) return true;
+            } else {
+                stack[sp++] = node.offset + 1;
+                counters.stack_depth(sp);
+                node_idx = node.offset;
+                continue;
+            }
+        }
+        if (sp == 0) break;
+        node_idx = stack[--sp];
+    }
+    return false;
+}
+
+// ============================================================
+// BVH 树
+// ============================================================
+
+class Tree {
+public:
+    static constexpr int MAX_DEPTH = STACK_SIZE - 2;
+
+    std::vector<FlatNode> nodes;
+    std::vector<int> prim_indices;  // 叶子引用其中的连续区间
+    int max_depth = 0;
+
+    // 按图元包围盒建树（分桶 SAH，质心取包围盒中心）；boxes[i] 对应图元 i
+    void build(const std::vector<AABB>& boxes) {
+        nodes.clear();
+        prim_indices.resize(boxes.size());
+        max_depth = 0;
+        if (boxes.empty()) return;
+        for (size_t i = 0; i < boxes.size(); i++) prim_indices[i] = (int)i;
+        build_prims_.resize(boxes.size());
+        for (size_t i = 0; i < boxes.size(); i++) {
+            build_prims_[i].box = boxes[i];
+            for (int a = 0; a < 3; a++) build_prims_[i].centroid[a] = boxes[i].centroid(a);
+        }
+
+        nodes.reserve(2 * boxes.size());
+        nodes.emplace_back();
+        build_node(0, 0, (int)boxes.size(), 0);
+        build_prims_.clear();
+        build_prims_.shrink_to_fit();
+    }
+
+    bool empty() const { return nodes.empty(); }
+
+    // 最近交点遍历。hit(prim, t_min, t_max, t) 对图元精确求交，命中且 t 在区间内时写 t 并返回 true；
+    // 传入的 t_max 总是当前最近距离，因此最后一次返回 true 的即为最近交点。
+    // t_max 为输入输出：返回时为最近交点距离。返回最近图元下标，未命中为 -1。
+    template <class HitFn>
+    int intersect(const Ray& ray, double t_min, double& t_max, HitFn&& hit) const {
+        if (nodes.empty()) return -1;
+        return closest_hit(nodes.data(), ray, t_min, t_max, [&](int offset, int count, double& closest) {
+            int hit_idx = -1;
+            for (int i = offset; i < offset + count; i++) {
+                double t;
+                if (hit(prim_indices[i], t_min, closest, t)) {
+                    closest = t;
+                    hit_idx = prim_indices[i];
+                }
+            }
+            return hit_idx;
+        });
+    }
+
+    // 任意交点遍历（阴影光线用）：找到 (t_min, t_max) 内任一交点即返回
+    template <class HitFn>
+    bool occluded(const Ray& ray, double t_min, double t_max, HitFn&& hit) const {
+        if (nodes.empty()) return false;
+        return any_hit(nodes.data(), ray, t_min, t_max, [&](int offset, int count) {
+            for (int i = offset; i < offset + count; i++) {
+                double t;
+                if (hit(prim_indices[i], t_min, t_max, t)) return true;
+            }
+            return false;
+        });
+    }
+
+private:
+    std::vector<BuildPrim> build_prims_;
+
+    // 深度优先构建：子节点成对追加到 nodes 末尾
+    void build_node(int flat_idx, int start, int end, int depth) {
+        max_depth = std::max(max_depth, depth);
+        AABB bounds;
+        for (int i = start; i < end; i++) bounds.expand(build_prims_[prim_indices[i]].box);
+        int count = end - start;
+
+        int axis = 0;
+        // 深度保护：到达 MAX_DEPTH 时强制成叶，保证遍历栈不会溢出
+        int mid = count > 1 && depth < MAX_DEPTH
+            ? sah_split(build_prims_.data(), prim_indices.data(), start, end, axis) : -1;
+
+        FlatNode fn{};
+        for (int i = 0; i < 3; i++) {
+            fn.bmin[i] = float_down(bounds.lo[i]);
+            fn.bmax[i] = float_up(bounds.hi[i]);
+        }
+
+        if (mid < 0) {
+            fn.offset = start;
+            fn.prim_count = (uint16_t)std::min(count, 0xFFFF);
+            nodes[flat_idx] = fn;
+            return;
+        }
+
+        int child = (int)nodes.size();
+        nodes.emplace_back();
+        nodes.emplace_back();
+        fn.offset = child;
+        fn.prim_count = 0;
+        fn.axis = (uint8_t)axis;
+        nodes[flat_idx] = fn;
+
+        build_node(child, start, mid, depth + 1);
+        build_node(child + 1, mid, end, depth + 1);
+    }
+};
+
+}  // namespace bvh
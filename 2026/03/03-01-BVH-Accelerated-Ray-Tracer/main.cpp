@@ -23,6 +23,29 @@
 #include <fstream>
 #include <string>
 #include <sstream>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <cctype>
+#include <cstdlib>
+#include "../../02/02-25-OBJ-Model-Loader/obj_loader.h"
+#include "bvh.h"
+#include "../../../playground/common/perf.h"
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 // ============================================================
 // 基础数学工具
@@ -59,6 +82,14 @@ Vec3 operator*(double t, const Vec3& v) { return v * t; }
 
 struct Ray {
     Vec3 origin, direction;
+    Vec3 inv_dir;   // 方向分量的倒数（构造时缓存，包围盒测试不再做除法）
+    int sign[3];    // 方向分量符号：1 表示负方向
+    
+    Ray() : sign{0, 0, 0} {}
+    Ray(const Vec3& o, const Vec3& d) : origin(o), direction(d),
+        inv_dir(1.0 / d.x, 1.0 / d.y, 1.0 / d.z),
+        sign{inv_dir.x < 0, inv_dir.y < 0, inv_dir.z < 0} {}
+    
     Vec3 at(double t) const { return origin + direction * t; }
 };
 
@@ -97,13 +128,13 @@ struct AABB {
     // 光线与 AABB 相交测试（slab method）
     bool intersect(const Ray& ray, double t_min, double t_max) const {
         for (int i = 0; i < 3; i++) {
-            double inv_d = 1.0 / ray.direction[i];
+            double inv_d = ray.inv_dir[i];
             double t0 = (min_pt[i] - ray.origin[i]) * inv_d;
             double t1 = (max_pt[i] - ray.origin[i]) * inv_d;
-            if (inv_d < 0) std::swap(t0, t1);
+            if (ray.sign[i]) std::swap(t0, t1);
             t_min = std::max(t_min, t0);
             t_max = std::min(t_max, t1);
-            if (t_max <= t_min) return false;
+            if (t_max < t_min) return false; // 允许零厚度包围盒（轴对齐三角形）
         }
         return true;
     }
@@ -133,7 +164,7 @@ struct HitRecord {
     Vec3 normal;
     double t;
     bool front_face;
-    Material mat;
+    int material;     // Scene::materials 下标
     
     void set_face_normal(const Ray& ray, const Vec3& outward_normal) {
         front_face = ray.direction.dot(outward_normal) < 0;
@@ -148,14 +179,17 @@ struct HitRecord {
 struct Sphere {
     Vec3 center;
     double radius;
-    Material mat;
+    int material;     // Scene::materials 下标（几何与材质分开存放）
     
     AABB bounding_box() const {
         Vec3 r_vec(radius, radius, radius);
         return AABB(center - r_vec, center + r_vec);
     }
     
-    bool intersect(const Ray& ray, double t_min, double t_max, HitRecord& rec) const {
+    Vec3 centroid() const { return center; }
+    
+    // 只求交点参数 t，不写碰撞记录（BVH 遍历内层使用）
+    bool hit_t(const Ray& ray, double t_min, double t_max, double& t_out) const {
         Vec3 oc = ray.origin - center;
         double a = ray.direction.dot(ray.direction);
         double half_b = oc.dot(ray.direction);
@@ -170,16 +204,421 @@ struct Sphere {
             t = (-half_b + sqrt_d) / a;
             if (t < t_min || t > t_max) return false;
         }
-        
+        t_out = t;
+        return true;
+    }
+    
+    // 由已知的 t 填充碰撞记录
+    void fill_hit(const Ray& ray, double t, HitRecord& rec) const {
         rec.t = t;
         rec.point = ray.at(t);
         Vec3 outward_normal = (rec.point - center) / radius;
         rec.set_face_normal(ray, outward_normal);
-        rec.mat = mat;
+        rec.material = material;
+    }
+    
+    bool intersect(const Ray& ray, double t_min, double t_max, HitRecord& rec) const {
+        double t;
+        if (!hit_t(ray, t_min, t_max, t)) return false;
+        fill_hit(ray, t, rec);
+        return true;
+    }
+};
+
+// ============================================================
+// 三角形（网格图元，由 OBJ 模型导入）
+// ============================================================
+
+struct Triangle {
+    Vec3 v0, e1, e2;  // 顶点 v0 与两条边 e1 = v1 - v0, e2 = v2 - v0
+    int material;     // Scene::materials 下标
+
+    static Triangle make(const Vec3& a, const Vec3& b, const Vec3& c, int m) {
+        return {a, b - a, c - a, m};
+    }
+
+    AABB bounding_box() const {
+        Vec3 v1 = v0 + e1, v2 = v0 + e2;
+        return AABB(Vec3(std::min({v0.x, v1.x, v2.x}), std::min({v0.y, v1.y, v2.y}), std::min({v0.z, v1.z, v2.z})),
+                    Vec3(std::max({v0.x, v1.x, v2.x}), std::max({v0.y, v1.y, v2.y}), std::max({v0.z, v1.z, v2.z})));
+    }
+
+    Vec3 centroid() const { return v0 + (e1 + e2) / 3.0; }
+
+    // Möller–Trumbore 求交
+    bool hit_t(const Ray& ray, double t_min, double t_max, double& t_out) const {
+        Vec3 p = ray.direction.cross(e2);
+        double det = e1.dot(p);
+        if (std::abs(det) < 1e-12) return false;
+        double inv_det = 1.0 / det;
+        Vec3 s = ray.origin - v0;
+        double u = s.dot(p) * inv_det;
+        if (u < 0 || u > 1) return false;
+        Vec3 q = s.cross(e1);
+        double v = ray.direction.dot(q) * inv_det;
+        if (v < 0 || u + v > 1) return false;
+        double t = e2.dot(q) * inv_det;
+        if (t < t_min || t > t_max) return false;
+        t_out = t;
+        return true;
+    }
+
+    void fill_hit(const Ray& ray, double t, HitRecord& rec) const {
+        rec.t = t;
+        rec.point = ray.at(t);
+        rec.set_face_normal(ray, e1.cross(e2).normalize());
+        rec.material = material;
+    }
+
+    bool intersect(const Ray& ray, double t_min, double t_max, HitRecord& rec) const {
+        double t;
+        if (!hit_t(ray, t_min, t_max, t)) return false;
+        fill_hit(ray, t, rec);
         return true;
     }
 };
 
+// ============================================================
+// 遍历性能计数（编译期开关）
+// ============================================================
+
+// 默认开启；-DBVH_INSTRUMENT=0 编译时所有计数函数为空、RayScope 为空类型，
+// 热路径上不留任何代码。计数器是线程私有的 64 位整数，渲染按 tile 取差值归约。
+#ifndef BVH_INSTRUMENT
+#define BVH_INSTRUMENT 1
+#endif
+
+namespace instr {
+
+constexpr bool ENABLED = BVH_INSTRUMENT != 0;
+constexpr int DEPTH_BINS = 129;  // 每次查询的最大遍历栈深度 0..128
+constexpr int COST_BINS = 32;    // 每次查询的代价（包围盒测试 + 图元测试）按 ⌊log2⌋ 分桶
+
+struct Counters {
+    uint64_t node_visits = 0;    // 包围盒测试（光线-节点 / 光线包-节点）
+    uint64_t leaf_tests = 0;     // 进入的叶子
+    uint64_t prim_tests = 0;     // 图元求交测试
+    uint64_t shadow_rays = 0;    // 阴影光线
+    uint64_t queries = 0;        // 加速结构查询（光线包按光线条数计）
+    uint64_t depth_hist[DEPTH_BINS] = {};
+    uint64_t cost_hist[COST_BINS] = {};
+    
+    Counters& operator+=(const Counters& o) {
+        node_visits += o.node_visits;
+        leaf_tests += o.leaf_tests;
+        prim_tests += o.prim_tests;
+        shadow_rays += o.shadow_rays;
+        queries += o.queries;
+        for (int i = 0; i < DEPTH_BINS; i++) depth_hist[i] += o.depth_hist[i];
+        for (int i = 0; i < COST_BINS; i++) cost_hist[i] += o.cost_hist[i];
+        return *this;
+    }
+    
+    Counters operator-(const Counters& o) const {
+        Counters d = *this;
+        d.node_visits -= o.node_visits;
+        d.leaf_tests -= o.leaf_tests;
+        d.prim_tests -= o.prim_tests;
+        d.shadow_rays -= o.shadow_rays;
+        d.queries -= o.queries;
+        for (int i = 0; i < DEPTH_BINS; i++) d.depth_hist[i] -= o.depth_hist[i];
+        for (int i = 0; i < COST_BINS; i++) d.cost_hist[i] -= o.cost_hist[i];
+        return d;
+    }
+    
+    uint64_t cost() const { return node_visits + prim_tests; }
+    
+    // 直方图分位数（返回桶下标）
+    static int percentile(const uint64_t* hist, int bins, double q) {
+        uint64_t total = 0;
+        for (int i = 0; i < bins; i++) total += hist[i];
+        if (total == 0) return 0;
+        uint64_t target = (uint64_t)(q * (double)(total - 1));
+        uint64_t acc = 0;
+        for (int i = 0; i < bins; i++) {
+            acc += hist[i];
+            if (acc > target) return i;
+        }
+        return bins - 1;
+    }
+};
+
+#if BVH_INSTRUMENT
+// 当前线程的累计计数，以及正在进行的查询的最大栈深度
+inline Counters& local() {
+    thread_local Counters counters;
+    return counters;
+}
+inline int& query_depth() {
+    thread_local int depth = 0;
+    return depth;
+}
+
+inline void node_visit() { local().node_visits++; }
+inline void leaf_test(int prims) { Counters& c = local(); c.leaf_tests++; c.prim_tests += (uint64_t)prims; }
+inline void prim_tests(size_t n) { local().prim_tests += n; }
+inline void shadow_ray() { local().shadow_rays++; }
+inline void stack_depth(int sp) { int& d = query_depth(); if (sp > d) d = sp; }
+inline Counters snapshot() { return local(); }
+
+inline int log2_bin(uint64_t v) {
+    int b = 0;
+    while (v > 1 && b < COST_BINS - 1) { v >>= 1; b++; }
+    return b;
+}
+
+// 一次查询的作用域：析构时把代价与最大栈深度记入直方图（光线包按 rays 条平均）
+class RayScope {
+public:
+    explicit RayScope(int rays = 1) : rays(rays), start(local().cost()) { query_depth() = 0; }
+    ~RayScope() {
+        Counters& c = local();
+        uint64_t per_ray = (c.cost() - start) / (uint64_t)rays;
+        c.queries += (uint64_t)rays;
+        c.cost_hist[log2_bin(per_ray)] += (uint64_t)rays;
+        c.depth_hist[std::min(query_depth(), DEPTH_BINS - 1)] += (uint64_t)rays;
+    }
+private:
+    int rays;
+    uint64_t start;
+};
+#else
+inline void node_visit() {}
+inline void leaf_test(int) {}
+inline void prim_tests(size_t) {}
+inline void shadow_ray() {}
+inline void stack_depth(int) {}
+inline Counters snapshot() { return {}; }
+struct RayScope { explicit RayScope(int = 1) {} };
+#endif
+
+} // namespace instr
+
+// ============================================================
+// 球体 SoA 存储 + SIMD 求交核
+// ============================================================
+
+// 球心与半径按分量分开存成 float 数组（16 字节/球，AoS 的 Sphere 为 40 字节），
+// 一次测试 8 个球：AVX2 一条 256 位指令，SSE/NEON 两条 128 位指令，否则标量。
+// float 判别式只做保守的候选筛选（容差覆盖舍入误差），候选球再用 double 的
+// Sphere::hit_t 精确求交，结果与逐个 double 求交完全一致。
+struct SphereSoA {
+    static constexpr int LANES = 8;
+    std::vector<float> cx, cy, cz, radius;  // 末尾多留 LANES 个，任意起点整组读取不越界
+    int count = 0;
+    
+    // order 非空时按 order[0..n) 的顺序排列（BVH 叶子顺序），否则按原顺序
+    void assign(const std::vector<Sphere>& spheres, const int* order = nullptr, size_t n = 0) {
+        if (!order) n = spheres.size();
+        count = (int)n;
+        cx.assign(n + LANES, 0.0f);
+        cy.assign(n + LANES, 0.0f);
+        cz.assign(n + LANES, 0.0f);
+        radius.assign(n + LANES, 0.0f);
+        for (size_t i = 0; i < n; i++) {
+            const Sphere& s = spheres[order ? order[i] : i];
+            cx[i] = (float)s.center.x;
+            cy[i] = (float)s.center.y;
+            cz[i] = (float)s.center.z;
+            radius[i] = (float)s.radius;
+        }
+    }
+    
+    // 在 SoA 下标 [first, first+n) 中找比 closest 更近的交点：命中时更新 closest，
+    // 返回球体下标（order 非空时为 order[k]），否则返回 -1
+    int intersect(const std::vector<Sphere>& spheres, const int* order, int first, int n,
+                  const Ray& ray, double t_min, double& closest) const {
+        float o[3] = {(float)ray.origin.x, (float)ray.origin.y, (float)ray.origin.z};
+        float d[3] = {(float)ray.direction.x, (float)ray.direction.y, (float)ray.direction.z};
+        float a = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+        int hit_idx = -1;
+        for (int base = first; base < first + n; base += LANES) {
+            unsigned mask = candidates8(base, o, d, a);
+            int remaining = first + n - base;
+            if (remaining < LANES) mask &= (1u << remaining) - 1;
+            while (mask) {
+                int lane = __builtin_ctz(mask);
+                mask &= mask - 1;
+                int k = base + lane;
+                int si = order ? order[k] : k;
+                double t;
+                if (spheres[si].hit_t(ray, t_min, closest, t)) {
+                    closest = t;
+                    hit_idx = si;
+                }
+            }
+        }
+        return hit_idx;
+    }
+    
+private:
+    // 判别式 b² - a·c 加上相对容差 1e-5·(b² + a·(|oc|² + r²)) 仍小于 0 的球一定不相交，
+    // 其余作为候选（位掩码第 j 位对应 base + j）
+    unsigned candidates8(int base, const float o[3], const float d[3], float a) const {
+#if defined(__AVX2__)
+        __m256 ocx = _mm256_sub_ps(_mm256_set1_ps(o[0]), _mm256_loadu_ps(&cx[base]));
+        __m256 ocy = _mm256_sub_ps(_mm256_set1_ps(o[1]), _mm256_loadu_ps(&cy[base]));
+        __m256 ocz = _mm256_sub_ps(_mm256_set1_ps(o[2]), _mm256_loadu_ps(&cz[base]));
+        __m256 r = _mm256_loadu_ps(&radius[base]);
+        __m256 va = _mm256_set1_ps(a);
+        __m256 b = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, _mm256_set1_ps(d[0])),
+                                               _mm256_mul_ps(ocy, _mm256_set1_ps(d[1]))),
+                                 _mm256_mul_ps(ocz, _mm256_set1_ps(d[2])));
+        __m256 oc2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, ocx), _mm256_mul_ps(ocy, ocy)),
+                                   _mm256_mul_ps(ocz, ocz));
+        __m256 r2 = _mm256_mul_ps(r, r);
+        __m256 b2 = _mm256_mul_ps(b, b);
+        __m256 disc = _mm256_sub_ps(b2, _mm256_mul_ps(va, _mm256_sub_ps(oc2, r2)));
+        __m256 tol = _mm256_mul_ps(_mm256_set1_ps(1e-5f),
+                                   _mm256_add_ps(b2, _mm256_mul_ps(va, _mm256_add_ps(oc2, r2))));
+        __m256 ok = _mm256_cmp_ps(_mm256_add_ps(disc, tol), _mm256_setzero_ps(), _CMP_GE_OQ);
+        return (unsigned)_mm256_movemask_ps(ok);
+#elif defined(__SSE2__) || defined(__ARM_NEON)
+        return candidates4(base, o, d, a) | (candidates4(base + 4, o, d, a) << 4);
+#else
+        unsigned mask = 0;
+        for (int j = 0; j < LANES; j++) {
+            int k = base + j;
+            float ocx = o[0] - cx[k], ocy = o[1] - cy[k], ocz = o[2] - cz[k];
+            float b = ocx * d[0] + ocy * d[1] + ocz * d[2];
+            float oc2 = ocx * ocx + ocy * ocy + ocz * ocz;
+            float r2 = radius[k] * radius[k];
+            float disc = b * b - a * (oc2 - r2);
+            float tol = 1e-5f * (b * b + a * (oc2 + r2));
+            if (disc + tol >= 0.0f) mask |= 1u << j;
+        }
+        return mask;
+#endif
+    }
+    
+#if !defined(__AVX2__) && defined(__SSE2__)
+    unsigned candidates4(int base, const float o[3], const float d[3], float a) const {
+        __m128 ocx = _mm_sub_ps(_mm_set1_ps(o[0]), _mm_loadu_ps(&cx[base]));
+        __m128 ocy = _mm_sub_ps(_mm_set1_ps(o[1]), _mm_loadu_ps(&cy[base]));
+        __m128 ocz = _mm_sub_ps(_mm_set1_ps(o[2]), _mm_loadu_ps(&cz[base]));
+        __m128 r = _mm_loadu_ps(&radius[base]);
+        __m128 va = _mm_set1_ps(a);
+        __m128 b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, _mm_set1_ps(d[0])), _mm_mul_ps(ocy, _mm_set1_ps(d[1]))),
+                              _mm_mul_ps(ocz, _mm_set1_ps(d[2])));
+        __m128 oc2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, ocx), _mm_mul_ps(ocy, ocy)), _mm_mul_ps(ocz, ocz));
+        __m128 r2 = _mm_mul_ps(r, r);
+        __m128 b2 = _mm_mul_ps(b, b);
+        __m128 disc = _mm_sub_ps(b2, _mm_mul_ps(va, _mm_sub_ps(oc2, r2)));
+        __m128 tol = _mm_mul_ps(_mm_set1_ps(1e-5f), _mm_add_ps(b2, _mm_mul_ps(va, _mm_add_ps(oc2, r2))));
+        return (unsigned)_mm_movemask_ps(_mm_cmpge_ps(_mm_add_ps(disc, tol), _mm_setzero_ps()));
+    }
+#elif !defined(__AVX2__) && defined(__ARM_NEON)
+    unsigned candidates4(int base, const float o[3], const float d[3], float a) const {
+        float32x4_t ocx = vsubq_f32(vdupq_n_f32(o[0]), vld1q_f32(&cx[base]));
+        float32x4_t ocy = vsubq_f32(vdupq_n_f32(o[1]), vld1q_f32(&cy[base]));
+        float32x4_t ocz = vsubq_f32(vdupq_n_f32(o[2]), vld1q_f32(&cz[base]));
+        float32x4_t r = vld1q_f32(&radius[base]);
+        float32x4_t va = vdupq_n_f32(a);
+        float32x4_t b = vaddq_f32(vaddq_f32(vmulq_n_f32(ocx, d[0]), vmulq_n_f32(ocy, d[1])), vmulq_n_f32(ocz, d[2]));
+        float32x4_t oc2 = vaddq_f32(vaddq_f32(vmulq_f32(ocx, ocx), vmulq_f32(ocy, ocy)), vmulq_f32(ocz, ocz));
+        float32x4_t r2 = vmulq_f32(r, r);
+        float32x4_t b2 = vmulq_f32(b, b);
+        float32x4_t disc = vsubq_f32(b2, vmulq_f32(va, vsubq_f32(oc2, r2)));
+        float32x4_t tol = vmulq_n_f32(vaddq_f32(b2, vmulq_f32(va, vaddq_f32(oc2, r2))), 1e-5f);
+        uint32x4_t ok = vcgeq_f32(vaddq_f32(disc, tol), vdupq_n_f32(0.0f));
+        // 每个 lane 的比较结果取一位拼成掩码
+        static const uint32_t bits[4] = {1, 2, 4, 8};
+        return vaddvq_u32(vandq_u32(ok, vld1q_u32(bits)));
+    }
+#endif
+};
+
+// 叶子图元求交：在 leaf_prims[first, first+n) 中找比 closest 更近的交点，
+// 命中时更新 closest 并返回图元下标，否则返回 -1。
+// 默认逐个调用 Prim::hit_t；球体特化为按叶子顺序排列的 SoA + SIMD 核
+template <class Prim>
+struct LeafKernel {
+    void assign(const std::vector<Prim>&, const int*, size_t) {}
+    
+    int intersect(const std::vector<Prim>& prims, const int* leaf_prims, int first, int n,
+                  const Ray& ray, double t_min, double& closest) const {
+        instr::leaf_test(n);
+        int hit_idx = -1;
+        for (int k = first; k < first + n; k++) {
+            double t;
+            int pi = leaf_prims[k];
+            if (prims[pi].hit_t(ray, t_min, closest, t)) {
+                closest = t;
+                hit_idx = pi;
+            }
+        }
+        return hit_idx;
+    }
+};
+
+template <>
+struct LeafKernel<Sphere> {
+    SphereSoA soa;  // 第 k 个元素对应 leaf_prims[k]，叶子区间直接就是 SoA 区间
+    
+    void assign(const std::vector<Sphere>& prims, const int* leaf_prims, size_t n) {
+        soa.assign(prims, leaf_prims, n);
+    }
+    
+    int intersect(const std::vector<Sphere>& prims, const int* leaf_prims, int first, int n,
+                  const Ray& ray, double t_min, double& closest) const {
+        instr::leaf_test(n);
+        return soa.intersect(prims, leaf_prims, first, n, ray, t_min, closest);
+    }
+};
+
+// ============================================================
+// 只读文件映射（BVH 缓存加载用）
+// ============================================================
+
+// POSIX 下用 mmap 直接映射，其他平台退化为整块读入内存
+class MappedFile {
+public:
+    static std::shared_ptr<const MappedFile> open(const std::string& path) {
+        std::shared_ptr<MappedFile> f(new MappedFile());
+#if defined(__unix__) || defined(__APPLE__)
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return nullptr;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) { ::close(fd); return nullptr; }
+        void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return nullptr;
+        f->ptr = (const uint8_t*)p;
+        f->len = (size_t)st.st_size;
+#else
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in) return nullptr;
+        f->buffer.resize((size_t)in.tellg());
+        in.seekg(0);
+        in.read((char*)f->buffer.data(), (std::streamsize)f->buffer.size());
+        if (!in || f->buffer.empty()) return nullptr;
+        f->ptr = f->buffer.data();
+        f->len = f->buffer.size();
+#endif
+        return f;
+    }
+    
+    ~MappedFile() {
+#if defined(__unix__) || defined(__APPLE__)
+        if (ptr) munmap((void*)ptr, len);
+#endif
+    }
+    
+    const uint8_t* data() const { return ptr; }
+    size_t size() const { return len; }
+    
+private:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    const uint8_t* ptr = nullptr;
+    size_t len = 0;
+#if !(defined(__unix__) || defined(__APPLE__))
+    std::vector<uint8_t> buffer;
+#endif
+};
+
 // ============================================================
 // BVH 节点
 // ============================================================
@@ -187,165 +626,529 @@ struct Sphere {
 struct BVHNode {
     AABB bbox;
     int left, right;   // 子节点索引（-1 表示叶子节点）
-    int sphere_idx;    // 球体索引（叶子节点有效）
+    int first, count;  // 叶子：图元在 prim_indices 中的区间 [first, first + count)
+    int axis;          // 分裂轴（内部节点有效）
     bool is_leaf;
     
-    BVHNode() : left(-1), right(-1), sphere_idx(-1), is_leaf(false) {}
+    BVHNode() : left(-1), right(-1), first(0), count(0), axis(0), is_leaf(false) {}
+};
+
+// 扁平化 BVH 节点（32 字节，遍历用）与 float 保守取整来自共享的 bvh.h，
+// 缓存文件也按同一布局存储
+using FlatBVHNode = bvh::FlatNode;
+using bvh::float_down;
+using bvh::float_up;
+
+// 共享遍历用的 float 光线：方向倒数与符号沿用 Ray 构造时缓存的值
+inline bvh::Ray to_bvh_ray(const Ray& ray) {
+    bvh::Ray r;
+    for (int i = 0; i < 3; i++) {
+        r.org[i] = (float)ray.origin[i];
+        r.inv_dir[i] = (float)ray.inv_dir[i];
+        r.sign[i] = ray.sign[i];
+    }
+    return r;
+}
+
+// 共享遍历的计数钩子接到 instr（编译关闭时为空）
+struct InstrCounters {
+    void node_visit() const { instr::node_visit(); }
+    void stack_depth(int sp) const { instr::stack_depth(sp); }
 };
 
 // ============================================================
 // BVH 树
 // ============================================================
 
-class BVH {
+// 与图元类型无关的配置
+struct BVHBase {
+    // 构建方式：SAH 分桶（质量高）或 LBVH（Morton 码排序，构建快，适合超大场景）
+    enum BuildMode { SAH, LBVH };
+    
+    // 栈深度、叶子大小和 SAH 遍历代价与 bvh.h 的共享构建 / 遍历一致
+    static constexpr int STACK_SIZE = bvh::STACK_SIZE;
+    static constexpr int MAX_LEAF_SIZE = bvh::MAX_LEAF_SIZE;
+    static constexpr double TRAVERSAL_COST = bvh::TRAVERSAL_COST;
+    static constexpr int PARALLEL_MIN = 4096; // 子树图元数不少于此值时并行构建
+    static constexpr int LBVH_LEAF_SIZE = 4;  // LBVH 不做 SAH 评估，固定在此数量以下成叶
+    static constexpr int MAX_PACKET = 64;     // 光线包最大光线数
+};
+
+// Prim 需要提供：
+//   AABB bounding_box() const;  Vec3 centroid() const;
+//   bool hit_t(const Ray&, double t_min, double t_max, double& t) const;
+//   void fill_hit(const Ray&, double t, HitRecord&) const;
+template <class Prim>
+class BVH : public BVHBase {
 public:
-    std::vector<BVHNode> nodes;
-    const std::vector<Sphere>& spheres;
-    int bvh_intersection_tests = 0; // 统计 BVH 测试次数
-    
-    BVH(const std::vector<Sphere>& spheres) : spheres(spheres) {
-        if (spheres.empty()) return;
+    BuildMode mode;
+    std::vector<BVHNode> nodes;      // 构建用的二叉树（前序排列：子节点下标总大于父节点）
+    std::vector<FlatBVHNode> flat;   // 遍历用的扁平布局
+    std::vector<int> prim_indices;   // 图元下标排列，叶子引用其中连续一段
+    const std::vector<Prim>& prims;
+    int max_depth = 0;              // 树的最大深度
+    int spawn_depth = 0;            // 并行构建的派生深度（2^spawn_depth 约等于线程数）
+    std::vector<bvh::BuildPrim> build_prims; // 构建用：图元包围盒与质心缓存
+    std::vector<uint32_t> morton_codes; // LBVH：排序后的 Morton 码
+    std::vector<double> build_area; // 构建（或上次重建）时各节点的表面积
+    double build_sah_cost = 0;      // 构建时的 SAH 代价
+    
+    // 遍历只通过下面的视图访问扁平节点和图元排列：
+    // 自己构建时指向 flat / prim_indices，从缓存文件加载时直接指向 mmap 的内存
+    const FlatBVHNode* flat_nodes = nullptr;
+    size_t flat_count = 0;
+    const int* leaf_prims = nullptr;
+    std::shared_ptr<const MappedFile> mapping; // 缓存映射（加载时持有）
+    LeafKernel<Prim> leaf_kernel;              // 叶子求交（按 leaf_prims 顺序）
+
+    struct DeferBuild {};  // 只绑定图元、不构建（供缓存加载使用）
+    BVH(const std::vector<Prim>& prims, BuildMode mode, DeferBuild) : mode(mode), prims(prims) {}
+
+    BVH(const std::vector<Prim>& prims, BuildMode mode = SAH, int num_threads = 0)
+        : mode(mode), prims(prims) {
+        if (prims.empty()) return;
+        
+        if (num_threads <= 0) num_threads = (int)std::max(1u, std::thread::hardware_concurrency());
+        while ((1 << spawn_depth) < num_threads) spawn_depth++;
         
-        std::vector<int> indices(spheres.size());
-        for (int i = 0; i < (int)spheres.size(); i++) indices[i] = i;
+        int n = (int)prims.size();
+        prim_indices.resize(n);
+        for (int i = 0; i < n; i++) prim_indices[i] = i;
+        compute_build_prims();
+        if (mode == LBVH) sort_by_morton();
         
-        build(indices, 0, (int)indices.size());
+        // 节点数上限 2n-1；子节点成对从 node_count 原子分配，构建后 compact 成前序
+        nodes.assign(2 * n - 1, BVHNode());
+        node_count = 1;
+        build(0, n, 0, 0);
+        nodes.resize(node_count);
+        compact();
+
+        morton_codes.clear();
+        morton_codes.shrink_to_fit();
+        release_build_prims();
+        flatten();
+        record_build_quality();
     }
     
-    // 递归构建 BVH
-    int build(std::vector<int>& indices, int start, int end) {
-        int node_idx = (int)nodes.size();
-        nodes.emplace_back();
-        
-        int count = end - start;
-        
-        if (count == 1) {
-            // 叶子节点
-            nodes[node_idx].is_leaf = true;
-            nodes[node_idx].sphere_idx = indices[start];
-            nodes[node_idx].bbox = spheres[indices[start]].bounding_box();
-            return node_idx;
+    // ---------------- 动画场景：refit 与局部重建 ----------------
+    
+    // SAH 代价（相对根节点表面积）：内部节点 TRAVERSAL_COST·A，叶子 count·A
+    double sah_cost() const {
+        if (nodes.empty()) return 0;
+        double root_area = std::max(nodes[0].bbox.surface_area(), 1e-30);
+        double cost = 0;
+        for (const auto& n : nodes)
+            cost += (n.is_leaf ? (double)n.count : TRAVERSAL_COST) * n.bbox.surface_area();
+        return cost / root_area;
+    }
+    
+    // 记录构建时的各节点表面积和整体 SAH 代价，作为之后判断退化的基准
+    void record_build_quality() {
+        build_area.resize(nodes.size());
+        for (size_t i = 0; i < nodes.size(); i++) build_area[i] = nodes[i].bbox.surface_area();
+        build_sah_cost = sah_cost();
+    }
+    
+    // 自底向上只更新包围盒，拓扑不变，O(n)
+    // 前序编号保证子节点下标大于父节点，倒序扫描即可
+    void refit() {
+        for (int i = (int)nodes.size() - 1; i >= 0; i--) {
+            BVHNode& n = nodes[i];
+            n.bbox = n.is_leaf ? range_bounds(n.first, n.first + n.count)
+                               : AABB::merge(nodes[n.left].bbox, nodes[n.right].bbox);
         }
-        
-        // 计算所有球心的包围盒
-        AABB centroid_bbox;
-        for (int i = start; i < end; i++) {
-            Vec3 c = spheres[indices[i]].center;
-            centroid_bbox.min_pt.x = std::min(centroid_bbox.min_pt.x, c.x);
-            centroid_bbox.min_pt.y = std::min(centroid_bbox.min_pt.y, c.y);
-            centroid_bbox.min_pt.z = std::min(centroid_bbox.min_pt.z, c.z);
-            centroid_bbox.max_pt.x = std::max(centroid_bbox.max_pt.x, c.x);
-            centroid_bbox.max_pt.y = std::max(centroid_bbox.max_pt.y, c.y);
-            centroid_bbox.max_pt.z = std::max(centroid_bbox.max_pt.z, c.z);
+    }
+    
+    // 原地重建表面积增长超过 ratio 的子树（自顶向下，重建后不再深入）
+    // 子树的叶子覆盖 prim_indices 中连续一段，在这一段上重新做 SAH 构建；
+    // 新节点追加在数组末尾，最后 compact 回前序并丢弃旧节点
+    int rebuild_degraded(double ratio) {
+        std::vector<int> targets;
+        std::vector<int> stack = {0};
+        while (!stack.empty()) {
+            int ni = stack.back(); stack.pop_back();
+            const BVHNode& n = nodes[ni];
+            if (n.is_leaf) continue;
+            if (n.bbox.surface_area() > ratio * build_area[ni]) {
+                targets.push_back(ni);
+                continue;
+            }
+            stack.push_back(n.left);
+            stack.push_back(n.right);
         }
+        if (targets.empty()) return 0;
+    
+        BuildMode saved = mode;
+        mode = SAH; // 局部重建统一用 SAH（LBVH 的 Morton 码已释放）
+        compute_build_prims();
+        for (int ni : targets) {
+            int start, end;
+            subtree_range(ni, start, end);
+            int old_count = node_count;
+            nodes.resize(old_count + 2 * (end - start));
+            build_area.resize(nodes.size());
+            // 子树之间串行重建，因此每棵子树都从深度 0 开始允许并行派生
+            build(start, end, ni, 0);
+            nodes.resize(node_count);
+            build_area.resize(node_count);
+            build_area[ni] = nodes[ni].bbox.surface_area();
+            for (int i = old_count; i < node_count; i++) build_area[i] = nodes[i].bbox.surface_area();
+        }
+        mode = saved;
+        release_build_prims();
+        compact();
+        return (int)targets.size();
+    }
+    
+    // 把二叉树转成扁平数组：子节点成对分配，递归先处理左子树（深度优先）
+    void flatten() {
+        flat.clear();
+        flat.reserve(nodes.size());
+        flat.emplace_back();
+        max_depth = 0;
+        flatten_node(0, 0, 0);
+        flat_nodes = flat.data();
+        flat_count = flat.size();
+        leaf_prims = prim_indices.data();
+        mapping.reset();
+        leaf_kernel.assign(prims, leaf_prims, prim_indices.size());
+    }
+    
+    void flatten_node(int node_idx, int flat_idx, int depth) {
+        const BVHNode& node = nodes[node_idx];
+        max_depth = std::max(max_depth, depth);
         
-        // 选择最长轴分裂
-        Vec3 extent = centroid_bbox.max_pt - centroid_bbox.min_pt;
-        int axis = 0;
-        if (extent.y > extent.x) axis = 1;
-        if (extent.z > extent[axis]) axis = 2;
-        
-        // SAH（Surface Area Heuristic）分割
-        int mid = sah_split(indices, start, end, axis, centroid_bbox);
+        FlatBVHNode fn{};
+        fn.bmin[0] = float_down(node.bbox.min_pt.x);
+        fn.bmin[1] = float_down(node.bbox.min_pt.y);
+        fn.bmin[2] = float_down(node.bbox.min_pt.z);
+        fn.bmax[0] = float_up(node.bbox.max_pt.x);
+        fn.bmax[1] = float_up(node.bbox.max_pt.y);
+        fn.bmax[2] = float_up(node.bbox.max_pt.z);
         
-        int left_child = build(indices, start, mid);
-        int right_child = build(indices, mid, end);
+        if (node.is_leaf) {
+            fn.offset = node.first;
+            fn.prim_count = (uint16_t)node.count;
+            flat[flat_idx] = fn;
+            return;
+        }
         
-        nodes[node_idx].left = left_child;
-        nodes[node_idx].right = right_child;
-        nodes[node_idx].is_leaf = false;
-        nodes[node_idx].bbox = AABB::merge(nodes[left_child].bbox, nodes[right_child].bbox);
+        int child = (int)flat.size();
+        flat.emplace_back();
+        flat.emplace_back();
+        fn.offset = child;
+        fn.prim_count = 0;
+        fn.axis = (uint8_t)node.axis;
+        flat[flat_idx] = fn;
         
-        return node_idx;
+        flatten_node(node.left, child, depth + 1);
+        flatten_node(node.right, child + 1, depth + 1);
     }
     
-    // SAH 分割策略
-    int sah_split(std::vector<int>& indices, int start, int end, int axis, const AABB& centroid_bbox) {
+    // 递归构建 BVH
+    // 子节点成对从原子计数器分配，左右子树可以并行构建
+    void build(int start, int end, int node_idx, int depth) {
         int count = end - start;
+        BVHNode& node = nodes[node_idx];
         
-        if (count <= 4) {
-            // 小数量直接中值分割
-            std::sort(indices.begin() + start, indices.begin() + end,
-                [&](int a, int b) {
-                    return spheres[a].center[axis] < spheres[b].center[axis];
-                });
-            return start + count / 2;
+        int axis = 0;
+        int mid = -1;
+        if (count > 1) {
+            mid = (mode == LBVH) ? morton_split(start, end, axis)
+                                 : choose_split(start, end, axis);
+        }
+
+        if (mid < 0) {
+            // 叶子节点（单个图元，或 SAH 判定不分裂更便宜）
+            node.is_leaf = true;
+            node.left = node.right = -1;
+            node.first = start;
+            node.count = count;
+            node.bbox = range_bounds(start, end);
+            return;
         }
         
-        // SAH 桶数量
-        const int NUM_BUCKETS = 12;
-        struct Bucket { AABB bbox; int count = 0; };
-        Bucket buckets[NUM_BUCKETS];
+        int left_child = node_count.fetch_add(2, std::memory_order_relaxed);
+        int right_child = left_child + 1;
+        
+        if (count >= PARALLEL_MIN && depth < spawn_depth) {
+            // 左子树交给新线程，右子树在当前线程
+            std::thread left_task([this, start, mid, left_child, depth] {
+                build(start, mid, left_child, depth + 1);
+            });
+            build(mid, end, right_child, depth + 1);
+            left_task.join();
+        } else {
+            build(start, mid, left_child, depth + 1);
+            build(mid, end, right_child, depth + 1);
+        }
         
-        double extent = centroid_bbox.max_pt[axis] - centroid_bbox.min_pt[axis];
-        if (extent < 1e-10) {
-            // 退化情况：所有质心在同一位置
-            return start + count / 2;
+        node.left = left_child;
+        node.right = right_child;
+        node.axis = axis;
+        node.is_leaf = false;
+        node.count = 0;
+        node.bbox = AABB::merge(nodes[left_child].bbox, nodes[right_child].bbox);
+    }
+    
+    // 分桶 SAH 分割（bvh.h 的共享实现）；返回 -1 表示应当成叶
+    int choose_split(int start, int end, int& axis) {
+        return bvh::sah_split(build_prims.data(), prim_indices.data(), start, end, axis);
+    }
+    
+    // ---------------- LBVH（Morton 码线性 BVH） ----------------
+    
+    // 把 10 位整数的每一位之间插入两个 0
+    static uint32_t expand_bits(uint32_t v) {
+        v = (v * 0x00010001u) & 0xFF0000FFu;
+        v = (v * 0x00000101u) & 0x0F00F00Fu;
+        v = (v * 0x00000011u) & 0xC30C30C3u;
+        v = (v * 0x00000005u) & 0x49249249u;
+        return v;
+    }
+    
+    // 归一化坐标 [0,1]^3 -> 30 位 Morton 码（x 占最高位）
+    static uint32_t morton3d(double x, double y, double z) {
+        auto q = [](double t) {
+            return (uint32_t)std::min(std::max(t * 1024.0, 0.0), 1023.0);
+        };
+        return (expand_bits(q(x)) << 2) | (expand_bits(q(y)) << 1) | expand_bits(q(z));
+    }
+    
+    // 计算质心 Morton 码并按码排序（prim_indices 与 morton_codes 一一对应）
+    void sort_by_morton() {
+        auto centroid = [&](int p) {
+            const double* c = build_prims[p].centroid;
+            return Vec3(c[0], c[1], c[2]);
+        };
+        AABB cb;
+        for (size_t p = 0; p < build_prims.size(); p++) {
+            Vec3 c = centroid((int)p);
+            cb = AABB::merge(cb, AABB(c, c));
         }
+        Vec3 ext = cb.max_pt - cb.min_pt;
+        auto inv = [](double e) { return e > 1e-10 ? 1.0 / e : 0.0; };
+        Vec3 scale(inv(ext.x), inv(ext.y), inv(ext.z));
         
-        // 将球体分配到桶中
-        for (int i = start; i < end; i++) {
-            double c = spheres[indices[i]].center[axis];
-            int b = (int)(NUM_BUCKETS * (c - centroid_bbox.min_pt[axis]) / extent);
-            if (b >= NUM_BUCKETS) b = NUM_BUCKETS - 1;
-            buckets[b].count++;
-            buckets[b].bbox = AABB::merge(buckets[b].bbox, spheres[indices[i]].bounding_box());
+        std::vector<std::pair<uint32_t, int>> keyed(prim_indices.size());
+        for (size_t i = 0; i < prim_indices.size(); i++) {
+            Vec3 c = (centroid(prim_indices[i]) - cb.min_pt) * scale;
+            keyed[i] = {morton3d(c.x, c.y, c.z), prim_indices[i]};
+        }
+        std::sort(keyed.begin(), keyed.end());
+        morton_codes.resize(keyed.size());
+        for (size_t i = 0; i < keyed.size(); i++) {
+            morton_codes[i] = keyed[i].first;
+            prim_indices[i] = keyed[i].second;
+        }
+    }
+    
+    // 在已排序的 Morton 码中找最高不同位的位置作为分割点（二分查找）；返回 -1 表示成叶
+    int morton_split(int start, int end, int& axis) const {
+        if (end - start <= LBVH_LEAF_SIZE) return -1;
+        uint32_t first = morton_codes[start];
+        uint32_t last = morton_codes[end - 1];
+        if (first == last) {
+            axis = 0;
+            return end - start <= MAX_LEAF_SIZE ? -1 : start + (end - start) / 2;
         }
+        int common_prefix = __builtin_clz(first ^ last);
+        // 30 位码占 [29..0]，最高位为 x，依次 y、z
+        axis = (31 - common_prefix) % 3 == 2 ? 0 : ((31 - common_prefix) % 3 == 1 ? 1 : 2);
         
-        // 计算每个分割点的 SAH 代价
-        double costs[NUM_BUCKETS - 1];
-        for (int i = 0; i < NUM_BUCKETS - 1; i++) {
-            AABB b0, b1;
-            int cnt0 = 0, cnt1 = 0;
-            for (int j = 0; j <= i; j++) {
-                b0 = AABB::merge(b0, buckets[j].bbox);
-                cnt0 += buckets[j].count;
+        int split = start;
+        int step = end - 1 - start;
+        do {
+            step = (step + 1) >> 1;
+            int new_split = split + step;
+            if (new_split < end - 1) {
+                // 与 first 相同的码前缀长度为 32（__builtin_clz(0) 未定义，单独判断）
+                uint32_t diff = first ^ morton_codes[new_split];
+                if (diff == 0 || __builtin_clz(diff) > common_prefix) split = new_split;
             }
-            for (int j = i + 1; j < NUM_BUCKETS; j++) {
-                b1 = AABB::merge(b1, buckets[j].bbox);
-                cnt1 += buckets[j].count;
+        } while (step > 1);
+        return split + 1;
+    }
+    
+    // BVH 遍历 - 找最近交点
+    // 走 bvh.h 的共享遍历（扁平数组 + 固定大小显式栈，近侧子节点优先），叶子换成 SIMD 叶子核；
+    // 只记录最近图元下标，遍历结束后才写一次碰撞记录
+    bool intersect(const Ray& ray, double t_min, double t_max, HitRecord& rec) const {
+        if (flat_count == 0) return false;
+        if (max_depth >= STACK_SIZE) return intersect_node(0, ray, t_min, t_max, rec);
+        
+        double closest = t_max;
+        int hit_idx = bvh::closest_hit(flat_nodes, to_bvh_ray(ray), t_min, closest,
+            [&](int offset, int count, double& t_far) {
+                return leaf_kernel.intersect(prims, leaf_prims, offset, count, ray, t_min, t_far);
+            }, InstrCounters{});
+        if (hit_idx < 0) return false;
+        prims[hit_idx].fill_hit(ray, closest, rec);
+        return true;
+    }
+
+    // 任意交点遍历（阴影光线）：(t_min, t_max) 内找到任一交点即返回，不排序子节点
+    bool occluded(const Ray& ray, double t_min, double t_max) const {
+        if (flat_count == 0) return false;
+        if (max_depth >= STACK_SIZE) {
+            HitRecord rec;
+            return intersect_node(0, ray, t_min, t_max, rec);
+        }
+        return bvh::any_hit(flat_nodes, to_bvh_ray(ray), t_min, t_max,
+            [&](int offset, int count) {
+                double closest = t_max;
+                return leaf_kernel.intersect(prims, leaf_prims, offset, count,
+                                             ray, t_min, closest) >= 0;
+            }, InstrCounters{});
+    }
+    
+    // 光线包遍历：一组方向符号一致的相干光线（如相邻像素的主光线）一起走树，
+    // 节点数据只取一次。每个节点先对整个包做区间算术剔除（原点/方向倒数的区间
+    // 决定 t 的下/上界），再从 first 开始找第一条命中的光线，之前的光线在此子树中
+    // 不再参与（first 随栈保存）。方向符号不一致或含非有限分量时退回单光线遍历。
+    // hits/recs 为输入输出：hits[r] 为 true 时以 recs[r].t 作为该光线的 t_max，
+    // 只有找到更近交点才覆盖（便于多个加速结构依次求交）。
+    void intersect_packet(const Ray* rays, int count, double t_min, double t_max,
+                          HitRecord* recs, bool* hits) const {
+        if (flat_count == 0) return;
+        bool coherent = max_depth < STACK_SIZE && count <= MAX_PACKET;
+        for (int r = 0; r < count && coherent; r++) {
+            for (int i = 0; i < 3; i++) {
+                if (rays[r].sign[i] != rays[0].sign[i] || !std::isfinite(rays[r].inv_dir[i])) {
+                    coherent = false;
+                    break;
+                }
             }
-            costs[i] = 0.125 + (cnt0 * b0.surface_area() + cnt1 * b1.surface_area()) /
-                        AABB::merge(b0, b1).surface_area();
+        }
+        if (!coherent) {
+            for (int r = 0; r < count; r++) {
+                double t_far = hits[r] ? recs[r].t : t_max;
+                if (intersect(rays[r], t_min, t_far, recs[r])) hits[r] = true;
+            }
+            return;
         }
         
-        // 找最小代价分割
-        int min_bucket = 0;
-        double min_cost = costs[0];
-        for (int i = 1; i < NUM_BUCKETS - 1; i++) {
-            if (costs[i] < min_cost) {
-                min_cost = costs[i];
-                min_bucket = i;
+        const int* sign = rays[0].sign;
+        float org[MAX_PACKET][3], inv_dir[MAX_PACKET][3];
+        float o_lo[3], o_hi[3], i_lo[3], i_hi[3];
+        for (int i = 0; i < 3; i++) {
+            o_lo[i] = i_lo[i] = std::numeric_limits<float>::infinity();
+            o_hi[i] = i_hi[i] = -std::numeric_limits<float>::infinity();
+        }
+        double closest[MAX_PACKET];
+        int hit_idx[MAX_PACKET];
+        double max_closest = 0;
+        for (int r = 0; r < count; r++) {
+            for (int i = 0; i < 3; i++) {
+                org[r][i] = (float)rays[r].origin[i];
+                inv_dir[r][i] = (float)rays[r].inv_dir[i];
+                o_lo[i] = std::min(o_lo[i], org[r][i]);
+                o_hi[i] = std::max(o_hi[i], org[r][i]);
+                i_lo[i] = std::min(i_lo[i], inv_dir[r][i]);
+                i_hi[i] = std::max(i_hi[i], inv_dir[r][i]);
             }
+            closest[r] = hits[r] ? recs[r].t : t_max;
+            hit_idx[r] = -1;
+            max_closest = std::max(max_closest, closest[r]);
         }
+        float packet_t_max = float_up(max_closest);  // 包内所有光线当前最近距离的最大值
         
-        // 按分割点分区
-        double split_val = centroid_bbox.min_pt[axis] + (min_bucket + 1) * extent / NUM_BUCKETS;
-        auto it = std::partition(indices.begin() + start, indices.begin() + end,
-            [&](int idx) {
-                return spheres[idx].center[axis] < split_val;
-            });
+        struct Entry { int node, first; };
+        Entry stack[STACK_SIZE];
+        int sp = 0;
+        Entry cur{0, 0};
         
-        int mid = (int)(it - indices.begin());
-        if (mid == start || mid == end) mid = start + count / 2; // 防止退化
-        return mid;
-    }
-    
-    // BVH 遍历 - 找最近交点
-    bool intersect(const Ray& ray, double t_min, double t_max, HitRecord& rec, int& tests) const {
-        if (nodes.empty()) return false;
-        return intersect_node(0, ray, t_min, t_max, rec, tests);
+        while (true) {
+            const FlatBVHNode& node = flat_nodes[cur.node];
+            instr::node_visit();
+            
+            // 区间剔除：t = (plane - o) * inv，o 与 inv 各取区间，求 t 的保守上下界
+            float tn_lo = (float)t_min, tf_hi = packet_t_max;
+            for (int i = 0; i < 3 && tn_lo <= tf_hi; i++) {
+                float dn0 = node.bmin[i] - o_hi[i], dn1 = node.bmin[i] - o_lo[i];
+                float df0 = node.bmax[i] - o_hi[i], df1 = node.bmax[i] - o_lo[i];
+                if (sign[i]) { std::swap(dn0, df0); std::swap(dn1, df1); }
+                float near_lo = std::min(std::min(dn0 * i_lo[i], dn0 * i_hi[i]),
+                                         std::min(dn1 * i_lo[i], dn1 * i_hi[i]));
+                float far_hi = std::max(std::max(df0 * i_lo[i], df0 * i_hi[i]),
+                                        std::max(df1 * i_lo[i], df1 * i_hi[i]));
+                tn_lo = std::max(tn_lo, near_lo);
+                tf_hi = std::min(tf_hi, far_hi);
+            }
+            
+            int first = count;
+            if (tn_lo <= tf_hi) {
+                // 找第一条真正命中包围盒的光线
+                for (int r = cur.first; r < count; r++) {
+                    instr::node_visit();
+                    float t0 = (float)t_min, t1 = (float)closest[r];
+                    bool hit_box = true;
+                    for (int i = 0; i < 3; i++) {
+                        float tn = ((sign[i] ? node.bmax[i] : node.bmin[i]) - org[r][i]) * inv_dir[r][i];
+                        float tf = ((sign[i] ? node.bmin[i] : node.bmax[i]) - org[r][i]) * inv_dir[r][i];
+                        t0 = tn > t0 ? tn : t0;
+                        t1 = tf < t1 ? tf : t1;
+                        if (t1 < t0) { hit_box = false; break; }
+                    }
+                    if (hit_box) { first = r; break; }
+                }
+            }
+            
+            if (first < count) {
+                if (node.prim_count > 0) {
+                    bool updated = false;
+                    for (int r = first; r < count; r++) {
+                        int pi = leaf_kernel.intersect(prims, leaf_prims, node.offset, node.prim_count,
+                                                       rays[r], t_min, closest[r]);
+                        if (pi >= 0) {
+                            hit_idx[r] = pi;
+                            updated = true;
+                        }
+                    }
+                    if (updated) {
+                        double m = 0;
+                        for (int r = 0; r < count; r++) m = std::max(m, closest[r]);
+                        packet_t_max = float_up(m);
+                    }
+                } else {
+                    int near_child = node.offset + sign[node.axis];
+                    int far_child = node.offset + 1 - sign[node.axis];
+                    stack[sp++] = {far_child, first};
+                    instr::stack_depth(sp);
+                    cur = {near_child, first};
+                    continue;
+                }
+            }
+            if (sp == 0) break;
+            cur = stack[--sp];
+        }
+        
+        for (int r = 0; r < count; r++) {
+            if (hit_idx[r] < 0) continue;
+            hits[r] = true;
+            prims[hit_idx[r]].fill_hit(rays[r], closest[r], recs[r]);
+        }
     }
     
+    // 递归遍历（树过深、超出显式栈容量时的后备路径）
     bool intersect_node(int node_idx, const Ray& ray, double t_min, double t_max,
-                         HitRecord& rec, int& tests) const {
+                         HitRecord& rec) const {
         const BVHNode& node = nodes[node_idx];
-        tests++;
+        instr::node_visit();
         
         if (!node.bbox.intersect(ray, t_min, t_max)) return false;
         
         if (node.is_leaf) {
-            return spheres[node.sphere_idx].intersect(ray, t_min, t_max, rec);
+            instr::leaf_test(node.count);
+            bool hit = false;
+            for (int k = node.first; k < node.first + node.count; k++) {
+                if (prims[prim_indices[k]].intersect(ray, t_min, t_max, rec)) {
+                    hit = true;
+                    t_max = rec.t;
+                }
+            }
+            return hit;
         }
         
         bool hit_left = false, hit_right = false;
@@ -353,27 +1156,483 @@ public:
         double t_closest = t_max;
         
         if (node.left >= 0) {
-            hit_left = intersect_node(node.left, ray, t_min, t_closest, rec_left, tests);
+            hit_left = intersect_node(node.left, ray, t_min, t_closest, rec_left);
             if (hit_left) t_closest = rec_left.t;
         }
         if (node.right >= 0) {
-            hit_right = intersect_node(node.right, ray, t_min, t_closest, rec_right, tests);
+            hit_right = intersect_node(node.right, ray, t_min, t_closest, rec_right);
         }
         
         if (hit_right) { rec = rec_right; return true; }
         if (hit_left)  { rec = rec_left;  return true; }
         return false;
     }
-};
+
+private:
+    std::atomic<int> node_count{0};
+
+    void compute_build_prims() {
+        build_prims.resize(prims.size());
+        for (size_t i = 0; i < prims.size(); i++) {
+            AABB box = prims[i].bounding_box();
+            Vec3 c = prims[i].centroid();
+            build_prims[i].box = bvh::AABB(box.min_pt.x, box.min_pt.y, box.min_pt.z,
+                                           box.max_pt.x, box.max_pt.y, box.max_pt.z);
+            for (int a = 0; a < 3; a++) build_prims[i].centroid[a] = c[a];
+        }
+    }
+
+    void release_build_prims() {
+        build_prims.clear();
+        build_prims.shrink_to_fit();
+    }
+
+    AABB range_bounds(int start, int end) const {
+        AABB box;
+        for (int i = start; i < end; i++) box = AABB::merge(box, prims[prim_indices[i]].bounding_box());
+        return box;
+    }
+
+    // 子树叶子在 prim_indices 中覆盖的区间
+    void subtree_range(int node_idx, int& start, int& end) const {
+        start = (int)prim_indices.size();
+        end = 0;
+        std::vector<int> stack = {node_idx};
+        while (!stack.empty()) {
+            int ni = stack.back(); stack.pop_back();
+            const BVHNode& n = nodes[ni];
+            if (n.is_leaf) {
+                start = std::min(start, n.first);
+                end = std::max(end, n.first + n.count);
+                continue;
+            }
+            stack.push_back(n.left);
+            stack.push_back(n.right);
+        }
+    }
+
+    // 把从根可达的节点重排为前序（丢弃局部重建留下的旧节点），build_area 随之重排
+    void compact() {
+        std::vector<int> order;
+        std::vector<int> remap(nodes.size(), -1);
+        order.reserve(nodes.size());
+        std::vector<int> stack = {0};
+        while (!stack.empty()) {
+            int ni = stack.back(); stack.pop_back();
+            remap[ni] = (int)order.size();
+            order.push_back(ni);
+            if (!nodes[ni].is_leaf) {
+                stack.push_back(nodes[ni].right);
+                stack.push_back(nodes[ni].left);
+            }
+        }
+
+        std::vector<BVHNode> out(order.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            out[i] = nodes[order[i]];
+            if (!out[i].is_leaf) {
+                out[i].left = remap[out[i].left];
+                out[i].right = remap[out[i].right];
+            }
+        }
+        if (build_area.size() == nodes.size()) {
+            std::vector<double> area(order.size());
+            for (size_t i = 0; i < order.size(); i++) area[i] = build_area[order[i]];
+            build_area.swap(area);
+        }
+        nodes.swap(out);
+        node_count = (int)nodes.size();
+    }
+};
+
+// ============================================================
+// 4 路宽 BVH（由二叉 BVH 坍缩而来）
+// ============================================================
+
+// 一个节点同时存 4 个子节点的包围盒（SoA float 布局），
+// 一条 SSE 指令即可对 4 个子包围盒做 slab 测试
+struct alignas(16) BVH4Node {
+    float bounds[2][3][4];  // [0=min/1=max][轴][子节点]
+    int32_t child[4];       // >=0：内部节点下标；<0：叶子（~prim_indices 起始下标）；EMPTY：空槽
+    int32_t leaf_count[4];  // 叶子子槽的图元数
+};
+
+template <class Prim>
+class BVH4 {
+public:
+    static constexpr int32_t EMPTY = std::numeric_limits<int32_t>::min();
+    static constexpr int STACK_SIZE = 128;
+    
+    std::vector<BVH4Node> nodes;
+    const std::vector<Prim>& prims;
+    int max_depth = 0;
+    
+    // 遍历视图（同 BVH：自建时指向 nodes，缓存加载时指向 mmap 内存）
+    const BVH4Node* node_data = nullptr;
+    size_t node_count = 0;
+    const int* leaf_prims = nullptr;
+    std::shared_ptr<const MappedFile> mapping;
+    // 叶子区间与源 BVH 共用同一份 leaf_prims，叶子求交核（球体的 SoA）也直接借用源 BVH 的，
+    // 不再复制一份；和 leaf_prims 一样要求源 BVH 比 BVH4 活得久
+    const LeafKernel<Prim>* leaf_kernel = nullptr;
+
+    explicit BVH4(const BVH<Prim>& bvh)
+        : prims(bvh.prims), leaf_prims(bvh.leaf_prims), leaf_kernel(&bvh.leaf_kernel) {
+        if (bvh.nodes.empty()) return;
+        if (bvh.nodes[0].is_leaf) {
+            // 整棵树只有一个叶子：根节点放一个叶子子槽
+            nodes.emplace_back();
+            init_node(nodes[0]);
+            set_child(nodes[0], 0, bvh.nodes[0], ~bvh.nodes[0].first);
+        } else {
+            collapse(bvh, 0, 0);
+        }
+        node_data = nodes.data();
+        node_count = nodes.size();
+    }
+
+    // 从缓存映射构造；bin 是同一缓存文件加载出的二叉 BVH（共用图元排列和叶子求交核）
+    BVH4(const BVH<Prim>& bin, std::shared_ptr<const MappedFile> file,
+         const BVH4Node* data, size_t count, int max_depth)
+        : prims(bin.prims), max_depth(max_depth), node_data(data), node_count(count),
+          leaf_prims(bin.leaf_prims), mapping(std::move(file)), leaf_kernel(&bin.leaf_kernel) {}
+    
+    // 找最近交点：命中的子节点按 t_near 从远到近入栈，先弹出最近的
+    bool intersect(const Ray& ray, double t_min, double t_max, HitRecord& rec) const {
+        if (node_count == 0) return false;
+        
+        float org[3], inv_dir[3];
+        for (int i = 0; i < 3; i++) {
+            org[i] = (float)ray.origin[i];
+            inv_dir[i] = (float)ray.inv_dir[i];
+        }
+        
+        // 栈元素：子槽引用 + 叶子图元数
+        struct Entry { int32_t ref, count; };
+        Entry stack[STACK_SIZE];
+        int sp = 0;
+        stack[sp++] = {0, 0};
+        int hit_idx = -1;
+        double closest = t_max;
+        
+        while (sp > 0) {
+            Entry item = stack[--sp];
+            if (item.ref < 0) {
+                // 叶子
+                int pi = leaf_kernel->intersect(prims, leaf_prims, ~item.ref, item.count,
+                                               ray, t_min, closest);
+                if (pi >= 0) hit_idx = pi;
+                continue;
+            }
+            
+            const BVH4Node& node = node_data[item.ref];
+            instr::node_visit();
+            float t_near[4];
+            int mask = slab_test4(node, org, inv_dir, ray.sign, (float)t_min, (float)closest, t_near);
+            if (mask == 0) continue;
+            
+            // 命中的子节点按 t_near 降序排列（插入排序，最多 4 个）
+            int order[4], n = 0;
+            for (int c = 0; c < 4; c++) {
+                if (!(mask & (1 << c))) continue;
+                int k = n++;
+                while (k > 0 && t_near[order[k - 1]] < t_near[c]) { order[k] = order[k - 1]; k--; }
+                order[k] = c;
+            }
+            for (int k = 0; k < n; k++) stack[sp++] = {node.child[order[k]], node.leaf_count[order[k]]};
+            instr::stack_depth(sp);
+        }
+        
+        if (hit_idx < 0) return false;
+        prims[hit_idx].fill_hit(ray, closest, rec);
+        return true;
+    }
+    
+private:
+    static void init_node(BVH4Node& n) {
+        for (int c = 0; c < 4; c++) {
+            for (int a = 0; a < 3; a++) {
+                n.bounds[0][a][c] = std::numeric_limits<float>::infinity();
+                n.bounds[1][a][c] = -std::numeric_limits<float>::infinity();
+            }
+            n.child[c] = EMPTY;
+            n.leaf_count[c] = 0;
+        }
+    }
+    
+    static void set_child(BVH4Node& n, int c, const BVHNode& src, int32_t ref) {
+        n.bounds[0][0][c] = float_down(src.bbox.min_pt.x);
+        n.bounds[0][1][c] = float_down(src.bbox.min_pt.y);
+        n.bounds[0][2][c] = float_down(src.bbox.min_pt.z);
+        n.bounds[1][0][c] = float_up(src.bbox.max_pt.x);
+        n.bounds[1][1][c] = float_up(src.bbox.max_pt.y);
+        n.bounds[1][2][c] = float_up(src.bbox.max_pt.z);
+        n.child[c] = ref;
+        n.leaf_count[c] = src.is_leaf ? src.count : 0;
+    }
+    
+    // 坍缩：反复展开表面积最大的内部子节点，直到凑满 4 个子节点
+    int collapse(const BVH<Prim>& bvh, int bin_idx, int depth) {
+        max_depth = std::max(max_depth, depth);
+        int node_idx = (int)nodes.size();
+        nodes.emplace_back();
+        
+        const BVHNode& root = bvh.nodes[bin_idx];
+        int kids[4] = {root.left, root.right, -1, -1};
+        int n = 2;
+        while (n < 4) {
+            int best = -1;
+            double best_area = -1;
+            for (int k = 0; k < n; k++) {
+                const BVHNode& c = bvh.nodes[kids[k]];
+                if (!c.is_leaf && c.bbox.surface_area() > best_area) {
+                    best_area = c.bbox.surface_area();
+                    best = k;
+                }
+            }
+            if (best < 0) break;
+            const BVHNode& c = bvh.nodes[kids[best]];
+            kids[best] = c.left;
+            kids[n++] = c.right;
+        }
+        
+        BVH4Node out;
+        init_node(out);
+        for (int k = 0; k < n; k++) {
+            const BVHNode& c = bvh.nodes[kids[k]];
+            int32_t ref = c.is_leaf ? ~c.first : collapse(bvh, kids[k], depth + 1);
+            set_child(out, k, c, ref);
+        }
+        nodes[node_idx] = out;
+        return node_idx;
+    }
+    
+    // 4 个子包围盒的 slab 测试；按方向符号直接选近/远平面，不需要 min/max 交换
+    static int slab_test4(const BVH4Node& node, const float org[3], const float inv_dir[3],
+                          const int sign[3], float t_min, float t_max, float t_near[4]) {
+#if defined(__SSE2__)
+        __m128 tn = _mm_set1_ps(t_min);
+        __m128 tf = _mm_set1_ps(t_max);
+        for (int a = 0; a < 3; a++) {
+            __m128 o = _mm_set1_ps(org[a]);
+            __m128 id = _mm_set1_ps(inv_dir[a]);
+            __m128 near_plane = _mm_load_ps(node.bounds[sign[a]][a]);
+            __m128 far_plane = _mm_load_ps(node.bounds[1 - sign[a]][a]);
+            tn = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(near_plane, o), id), tn);
+            tf = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(far_plane, o), id), tf);
+        }
+        _mm_storeu_ps(t_near, tn);
+        return _mm_movemask_ps(_mm_cmple_ps(tn, tf));
+#else
+        int mask = 0;
+        for (int c = 0; c < 4; c++) {
+            float tn = t_min, tf = t_max;
+            for (int a = 0; a < 3; a++) {
+                float n0 = (node.bounds[sign[a]][a][c] - org[a]) * inv_dir[a];
+                float f0 = (node.bounds[1 - sign[a]][a][c] - org[a]) * inv_dir[a];
+                tn = n0 > tn ? n0 : tn;
+                tf = f0 < tf ? f0 : tf;
+            }
+            t_near[c] = tn;
+            if (tn <= tf) mask |= 1 << c;
+        }
+        return mask;
+#endif
+    }
+};
+
+// ============================================================
+// BVH 缓存文件
+// ============================================================
+
+// 文件布局（小端，按加载时的内存布局直接写出，加载时无需解析）：
+//   [0, 64)            BVHCacheHeader
+//   [64, ...)          FlatBVHNode × flat_count      （32 字节对齐）
+//   [..., ...)         BVH4Node    × wide_count      （16 字节对齐）
+//   [..., end)         int32 图元排列 × prim_count
+struct alignas(64) BVHCacheHeader {
+    char magic[8];           // "BVHCACHE"
+    uint32_t version;
+    uint32_t prim_size;      // sizeof(Prim)，区分图元类型
+    uint64_t scene_hash;     // 图元包围盒 + 构建方式的哈希
+    uint64_t prim_count;
+    uint64_t flat_count;
+    uint64_t wide_count;
+    int32_t max_depth;
+    int32_t wide_max_depth;
+};
+static_assert(sizeof(BVHCacheHeader) == 64, "BVHCacheHeader 必须是 64 字节");
+static_assert(sizeof(int) == 4, "缓存中的图元排列按 32 位整数存储");
+
+const uint32_t BVH_CACHE_VERSION = 1;
+
+// FNV-1a 64 位哈希：覆盖图元数量、构建方式和每个图元的包围盒
+template <class Prim>
+uint64_t scene_hash(const std::vector<Prim>& prims, BVHBase::BuildMode mode) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    auto mix = [&](const void* data, size_t n) {
+        const uint8_t* b = (const uint8_t*)data;
+        for (size_t i = 0; i < n; i++) { h ^= b[i]; h *= 0x100000001b3ULL; }
+    };
+    uint64_t count = prims.size();
+    int32_t m = (int32_t)mode;
+    mix(&count, sizeof(count));
+    mix(&m, sizeof(m));
+    for (const auto& p : prims) {
+        AABB box = p.bounding_box();
+        double v[6] = {box.min_pt.x, box.min_pt.y, box.min_pt.z, box.max_pt.x, box.max_pt.y, box.max_pt.z};
+        mix(v, sizeof(v));
+    }
+    return h;
+}
+
+template <class Prim>
+bool save_bvh_cache(const std::string& path, const BVH<Prim>& bvh, const BVH4<Prim>& wide) {
+    if (bvh.flat_count == 0) return false;
+    BVHCacheHeader h{};
+    std::memcpy(h.magic, "BVHCACHE", 8);
+    h.version = BVH_CACHE_VERSION;
+    h.prim_size = sizeof(Prim);
+    h.scene_hash = scene_hash(bvh.prims, bvh.mode);
+    h.prim_count = bvh.prims.size();
+    h.flat_count = bvh.flat_count;
+    h.wide_count = wide.node_count;
+    h.max_depth = bvh.max_depth;
+    h.wide_max_depth = wide.max_depth;
+    
+    // 先写临时文件再改名，避免并发任务读到写了一半的缓存
+    std::string tmp = path + ".tmp";
+    std::ofstream out(tmp, std::ios::binary);
+    if (!out) return false;
+    out.write((const char*)&h, sizeof(h));
+    out.write((const char*)bvh.flat_nodes, (std::streamsize)(sizeof(FlatBVHNode) * bvh.flat_count));
+    out.write((const char*)wide.node_data, (std::streamsize)(sizeof(BVH4Node) * wide.node_count));
+    out.write((const char*)bvh.leaf_prims, (std::streamsize)(sizeof(int) * h.prim_count));
+    out.close();
+    if (!out) { std::remove(tmp.c_str()); return false; }
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+// 校验映射进来的节点和图元排列，任何一项不满足都视为损坏文件：
+//   - 子节点下标在范围内且大于父节点（构建时子节点总在父节点之后分配，这样也排除了环），
+//     每个节点只被引用一次，实际深度不超过头部记录的深度（遍历栈大小按它选择）
+//   - 叶子区间 [first, first+count) 落在图元排列内，排列中的下标都小于图元数
+//   - 4 路节点的空槽保持构建时的空包围盒，保证遍历永远不会命中它
+template <class Prim>
+bool validate_bvh_cache(const BVHCacheHeader& h, const FlatBVHNode* flat, const BVH4Node* wide,
+                        const int* leaf_prims) {
+    const int64_t prim_count = (int64_t)h.prim_count;
+    auto leaf_ok = [&](int64_t first, int64_t count) {
+        return count > 0 && first >= 0 && first + count <= prim_count;
+    };
+    for (int64_t i = 0; i < prim_count; i++) {
+        if (leaf_prims[i] < 0 || leaf_prims[i] >= prim_count) return false;
+    }
+    
+    std::vector<int32_t> depth(h.flat_count, -1);
+    depth[0] = 0;
+    for (size_t i = 0; i < h.flat_count; i++) {
+        const FlatBVHNode& n = flat[i];
+        if (depth[i] < 0) return false;  // 没有父节点引用的孤立节点
+        if (n.prim_count > 0) {
+            if (!leaf_ok(n.offset, n.prim_count)) return false;
+            continue;
+        }
+        if (n.axis > 2 || n.offset <= (int64_t)i || (uint64_t)n.offset + 1 >= h.flat_count) return false;
+        if (depth[n.offset] >= 0 || depth[n.offset + 1] >= 0) return false;
+        depth[n.offset] = depth[n.offset + 1] = depth[i] + 1;
+        if (depth[i] + 1 > h.max_depth) return false;
+    }
+    
+    const float inf = std::numeric_limits<float>::infinity();
+    depth.assign(h.wide_count, -1);
+    depth[0] = 0;
+    for (size_t i = 0; i < h.wide_count; i++) {
+        const BVH4Node& n = wide[i];
+        if (depth[i] < 0) return false;
+        for (int c = 0; c < 4; c++) {
+            int32_t ref = n.child[c];
+            if (ref == BVH4<Prim>::EMPTY) {
+                for (int a = 0; a < 3; a++) {
+                    if (n.bounds[0][a][c] != inf || n.bounds[1][a][c] != -inf) return false;
+                }
+            } else if (ref < 0) {
+                if (!leaf_ok(~ref, n.leaf_count[c])) return false;
+            } else {
+                if (n.leaf_count[c] != 0 || ref <= (int64_t)i || (uint64_t)ref >= h.wide_count) return false;
+                if (depth[ref] >= 0) return false;
+                depth[ref] = depth[i] + 1;
+                if (depth[ref] > h.wide_max_depth) return false;
+            }
+        }
+    }
+    return true;
+}
+
+// 映射缓存文件；头部、场景哈希或节点校验不通过时返回 false（调用方应重新构建）
+template <class Prim>
+bool load_bvh_cache(const std::string& path, const std::vector<Prim>& prims, BVHBase::BuildMode mode,
+                    std::unique_ptr<BVH<Prim>>& bvh, std::unique_ptr<BVH4<Prim>>& wide) {
+    auto file = MappedFile::open(path);
+    if (!file || file->size() < sizeof(BVHCacheHeader)) return false;
+    
+    BVHCacheHeader h;
+    std::memcpy(&h, file->data(), sizeof(h));
+    if (std::memcmp(h.magic, "BVHCACHE", 8) != 0 || h.version != BVH_CACHE_VERSION ||
+        h.prim_size != sizeof(Prim) || h.prim_count != prims.size() ||
+        h.max_depth >= BVHBase::STACK_SIZE || h.prim_count >= (uint64_t)INT32_MAX ||
+        h.flat_count == 0 || h.wide_count == 0) return false;
+    // 每一段先单独和文件大小比较，之后的乘法和加法都不会溢出
+    size_t body = file->size() - sizeof(BVHCacheHeader);
+    if (h.flat_count > body / sizeof(FlatBVHNode) || h.wide_count > body / sizeof(BVH4Node) ||
+        h.prim_count > body / sizeof(int)) return false;
+    size_t expect = sizeof(FlatBVHNode) * h.flat_count + sizeof(BVH4Node) * h.wide_count +
+                    sizeof(int) * h.prim_count;
+    if (body != expect) return false;
+    if (h.scene_hash != scene_hash(prims, mode)) return false;
+    
+    const uint8_t* base = file->data();
+    const FlatBVHNode* flat = (const FlatBVHNode*)(base + sizeof(BVHCacheHeader));
+    const BVH4Node* wide_nodes = (const BVH4Node*)(flat + h.flat_count);
+    const int* leaf_prims = (const int*)(wide_nodes + h.wide_count);
+    if (!validate_bvh_cache<Prim>(h, flat, wide_nodes, leaf_prims)) return false;
+    
+    bvh = std::make_unique<BVH<Prim>>(prims, mode, typename BVH<Prim>::DeferBuild{});
+    bvh->flat_nodes = flat;
+    bvh->flat_count = h.flat_count;
+    bvh->leaf_prims = leaf_prims;
+    bvh->max_depth = h.max_depth;
+    bvh->mapping = file;
+    bvh->leaf_kernel.assign(prims, leaf_prims, h.prim_count);
+    wide = std::make_unique<BVH4<Prim>>(*bvh, file, wide_nodes, h.wide_count, h.wide_max_depth);
+    return true;
+}
 
 // ============================================================
 // 随机工具
 // ============================================================
 
-static std::mt19937 rng(42);
-static std::uniform_real_distribution<double> dist(0.0, 1.0);
+// 每个线程独立的随机数流（不再共享全局状态，可以并行渲染）
+static thread_local std::mt19937 rng(42);
+static thread_local std::uniform_real_distribution<double> dist(0.0, 1.0);
 
 double rand01() { return dist(rng); }
+
+// SplitMix64：把 (基础种子, 流编号) 打散成互不相关的种子
+uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// 重新播种当前线程的 RNG（按 tile 播种，结果与线程调度无关）
+void seed_rng(uint64_t base_seed, uint64_t stream) {
+    uint64_t s = splitmix64(base_seed ^ splitmix64(stream));
+    std::seed_seq seq{(uint32_t)s, (uint32_t)(s >> 32)};
+    rng.seed(seq);
+    dist.reset();
+}
 double rand_range(double a, double b) { return a + (b - a) * rand01(); }
 
 Vec3 rand_in_unit_sphere() {
@@ -402,25 +1661,161 @@ double schlick(double cosine, double ior) {
     return r0 + (1 - r0) * std::pow(1 - cosine, 5);
 }
 
+// ============================================================
+// 光源
+// ============================================================
+
+// 太阳：天空中半角为 acos(cos_max) 的小圆锥，圆锥内辐亮度恒定。
+// 光线随机弹射很难打中这么小的立体角，所以漫反射顶点对它做显式采样（NEE）
+struct SunLight {
+    Vec3 direction{0, 1, 0};  // 指向太阳（单位向量）
+    double cos_max = 1.0;
+    Vec3 radiance{0, 0, 0};   // 全 0 表示没有太阳
+
+    static SunLight make(const Vec3& dir, double half_angle_deg, const Vec3& radiance) {
+        return {dir.normalize(), std::cos(half_angle_deg * M_PI / 180.0), radiance};
+    }
+
+    bool enabled() const { return radiance.x > 0 || radiance.y > 0 || radiance.z > 0; }
+    bool contains(const Vec3& unit_dir) const { return unit_dir.dot(direction) >= cos_max; }
+
+    // 在圆锥内均匀采样方向，立体角 pdf 为常数
+    double pdf() const { return 1.0 / (2 * M_PI * (1 - cos_max)); }
+    Vec3 sample(double u1, double u2) const {
+        double cos_t = 1 - u1 * (1 - cos_max);
+        double sin_t = std::sqrt(std::max(0.0, 1 - cos_t * cos_t));
+        double phi = 2 * M_PI * u2;
+        Vec3 a = std::abs(direction.x) > 0.9 ? Vec3(0, 1, 0) : Vec3(1, 0, 0);
+        Vec3 t = direction.cross(a).normalize();
+        Vec3 b = direction.cross(t);
+        return (t * (sin_t * std::cos(phi)) + b * (sin_t * std::sin(phi)) + direction * cos_t).normalize();
+    }
+};
+
 // ============================================================
 // 场景管理
 // ============================================================
 
 struct Scene {
+    enum Traversal { BINARY, WIDE4 };
+    
     std::vector<Sphere> spheres;
-    std::unique_ptr<BVH> bvh;
+    std::vector<Triangle> triangles;     // 网格三角形（与球体分别建树）
+    std::vector<Material> materials;     // 图元通过下标引用
+    SphereSoA sphere_soa;                // 球体 float SoA 副本（暴力遍历用，随 BVH 构建/更新同步）
+    std::unique_ptr<BVH<Sphere>> bvh;
+    std::unique_ptr<BVH4<Sphere>> bvh4;
+    std::unique_ptr<BVH<Triangle>> mesh_bvh;
+    std::unique_ptr<BVH4<Triangle>> mesh_bvh4;
+    Traversal traversal = WIDE4;
+    SunLight sun;                        // 天空之外的直射光（可关闭）
+    
+    int add_material(const Material& mat) {
+        materials.push_back(mat);
+        return (int)materials.size() - 1;
+    }
+    
+    void add_sphere(const Vec3& center, double radius, const Material& mat) {
+        spheres.push_back({center, radius, add_material(mat)});
+    }
+    
+    void build_bvh(BVHBase::BuildMode mode = BVHBase::SAH) {
+        PERF_ZONE("bvh.build");
+        sphere_soa.assign(spheres);
+        bvh = std::make_unique<BVH<Sphere>>(spheres, mode);
+        bvh4 = std::make_unique<BVH4<Sphere>>(*bvh);
+        if (triangles.empty()) {
+            mesh_bvh.reset();
+            mesh_bvh4.reset();
+        } else {
+            mesh_bvh = std::make_unique<BVH<Triangle>>(triangles, mode);
+            mesh_bvh4 = std::make_unique<BVH4<Triangle>>(*mesh_bvh);
+        }
+    }
+
+    // 优先从缓存文件映射 BVH（球体、网格各一个文件），缓存缺失或失效时构建并写回
+    // 返回是否命中缓存
+    bool build_bvh_cached(const std::string& cache_prefix, BVHBase::BuildMode mode = BVHBase::SAH) {
+        PERF_ZONE("bvh.build_cached");
+        sphere_soa.assign(spheres);
+        bool hit = load_bvh_cache(cache_prefix + ".spheres.bvh", spheres, mode, bvh, bvh4);
+        if (!hit) {
+            bvh = std::make_unique<BVH<Sphere>>(spheres, mode);
+            bvh4 = std::make_unique<BVH4<Sphere>>(*bvh);
+            save_bvh_cache(cache_prefix + ".spheres.bvh", *bvh, *bvh4);
+        }
+        mesh_bvh.reset();
+        mesh_bvh4.reset();
+        if (!triangles.empty()) {
+            bool mesh_hit = load_bvh_cache(cache_prefix + ".mesh.bvh", triangles, mode, mesh_bvh, mesh_bvh4);
+            if (!mesh_hit) {
+                mesh_bvh = std::make_unique<BVH<Triangle>>(triangles, mode);
+                mesh_bvh4 = std::make_unique<BVH4<Triangle>>(*mesh_bvh);
+                save_bvh_cache(cache_prefix + ".mesh.bvh", *mesh_bvh, *mesh_bvh4);
+            }
+            hit = hit && mesh_hit;
+        }
+        return hit;
+    }
     
-    void build_bvh() {
-        bvh = std::make_unique<BVH>(spheres);
+    // 导入 OBJ 模型：顶点先缩放再平移，每个面成为一个三角形图元
+    void add_mesh(const obj::OBJLoader& model, const Material& mat,
+                  double scale, const Vec3& offset) {
+        auto to_world = [&](int idx) {
+            const obj::Vec3& v = model.vertices[idx];
+            return Vec3(v.x, v.y, v.z) * scale + offset;
+        };
+        int mat_id = add_material(mat);
+        triangles.reserve(triangles.size() + model.faces.size());
+        for (const auto& f : model.faces) {
+            triangles.push_back(Triangle::make(to_world(f.v0), to_world(f.v1), to_world(f.v2), mat_id));
+        }
+    }
+
+    // 动画帧更新：球心移动后调用（网格视为静态）
+    // 1. 先 refit（O(n)）
+    // 2. 整体 SAH 代价增长超过 FULL_REBUILD_RATIO → 整棵重建
+    // 3. 否则只重建表面积增长超过 SUBTREE_REBUILD_RATIO 的子树
+    enum UpdateResult { REFIT, PARTIAL_REBUILD, FULL_REBUILD };
+    static constexpr double FULL_REBUILD_RATIO = 1.5;
+    static constexpr double SUBTREE_REBUILD_RATIO = 2.0;
+    
+    UpdateResult update_bvh() {
+        // 从缓存加载的 BVH 没有构建用的二叉树，无法 refit，直接重建
+        if (!bvh || bvh->nodes.empty() || bvh->prim_indices.size() != spheres.size()) {
+            build_bvh(bvh ? bvh->mode : BVHBase::SAH);
+            return FULL_REBUILD;
+        }
+        
+        sphere_soa.assign(spheres);
+        bvh->refit();
+        UpdateResult result = REFIT;
+        if (bvh->sah_cost() > FULL_REBUILD_RATIO * bvh->build_sah_cost) {
+            bvh = std::make_unique<BVH<Sphere>>(spheres, bvh->mode);
+            bvh4 = std::make_unique<BVH4<Sphere>>(*bvh);
+            return FULL_REBUILD;
+        }
+        if (bvh->rebuild_degraded(SUBTREE_REBUILD_RATIO) > 0) result = PARTIAL_REBUILD;
+        
+        bvh->flatten();
+        bvh4 = std::make_unique<BVH4<Sphere>>(*bvh);
+        return result;
     }
     
-    // 暴力遍历（对比用）
+    // 暴力遍历（对比用）：球体走 SoA SIMD 核，8 个一组筛选
     bool intersect_brute(const Ray& ray, double t_min, double t_max, HitRecord& rec) const {
         HitRecord tmp;
         bool hit = false;
         double closest = t_max;
-        for (const auto& sphere : spheres) {
-            if (sphere.intersect(ray, t_min, closest, tmp)) {
+        instr::RayScope scope;
+        instr::prim_tests(spheres.size() + triangles.size());
+        int si = sphere_soa.intersect(spheres, nullptr, 0, sphere_soa.count, ray, t_min, closest);
+        if (si >= 0) {
+            hit = true;
+            spheres[si].fill_hit(ray, closest, rec);
+        }
+        for (const auto& tri : triangles) {
+            if (tri.intersect(ray, t_min, closest, tmp)) {
                 hit = true;
                 closest = tmp.t;
                 rec = tmp;
@@ -429,67 +1824,216 @@ struct Scene {
         return hit;
     }
     
-    // BVH 加速遍历
-    bool intersect_bvh(const Ray& ray, double t_min, double t_max, HitRecord& rec, int& tests) const {
-        return bvh->intersect(ray, t_min, t_max, rec, tests);
+    // BVH 加速遍历：球体树与网格树依次求交，后者以前者的交点为 t_max
+    bool intersect_bvh(const Ray& ray, double t_min, double t_max, HitRecord& rec) const {
+        instr::RayScope scope;
+        bool hit = intersect_tree(*bvh, *bvh4, ray, t_min, t_max, rec);
+        if (mesh_bvh && intersect_tree(*mesh_bvh, *mesh_bvh4, ray, t_min, hit ? rec.t : t_max, rec))
+            hit = true;
+        return hit;
+    }
+
+    // 阴影光线：(t_min, t_max) 内是否有遮挡，找到任意交点即返回（BVH 走二叉扁平树）
+    bool occluded(const Ray& ray, double t_min, double t_max, bool use_bvh) const {
+        instr::shadow_ray();
+        instr::RayScope scope;
+        if (use_bvh) {
+            return bvh->occluded(ray, t_min, t_max) ||
+                   (mesh_bvh && mesh_bvh->occluded(ray, t_min, t_max));
+        }
+        instr::prim_tests(spheres.size() + triangles.size());
+        double closest = t_max;
+        if (sphere_soa.intersect(spheres, nullptr, 0, sphere_soa.count, ray, t_min, closest) >= 0)
+            return true;
+        double t;
+        for (const auto& tri : triangles) {
+            if (tri.hit_t(ray, t_min, t_max, t)) return true;
+        }
+        return false;
+    }
+    
+    // 光线包求交（主光线用）
+    void intersect_packet(const Ray* rays, int count, double t_min, double t_max,
+                          HitRecord* recs, bool* hits) const {
+        instr::RayScope scope(count);
+        for (int r = 0; r < count; r++) hits[r] = false;
+        bvh->intersect_packet(rays, count, t_min, t_max, recs, hits);
+        if (mesh_bvh) mesh_bvh->intersect_packet(rays, count, t_min, t_max, recs, hits);
+    }
+
+private:
+    template <class Prim>
+    bool intersect_tree(const BVH<Prim>& bin, const BVH4<Prim>& wide, const Ray& ray,
+                        double t_min, double t_max, HitRecord& rec) const {
+        if (traversal == WIDE4 && wide.max_depth * 3 + 4 < BVH4<Prim>::STACK_SIZE)
+            return wide.intersect(ray, t_min, t_max, rec);
+        return bin.intersect(ray, t_min, t_max, rec);
     }
 };
 
 // ============================================================
-// 路径追踪
+// 材质散射（递归与波前两种引擎共用）
+// ============================================================
+
+// 天空渐变
+Vec3 sky_color(const Vec3& direction) {
+    Vec3 unit_dir = direction.normalize();
+    double t = 0.5 * (unit_dir.y + 1.0);
+    return (1 - t) * Vec3(1.0, 1.0, 1.0) + t * Vec3(0.5, 0.7, 1.0);
+}
+
+// 以下散射函数返回 false 表示光线被吸收
+bool scatter_diffuse(const HitRecord& rec, const Material& mat, Ray& scattered, Vec3& attenuation) {
+    Vec3 scatter_dir = rec.normal + rand_unit_vec();
+    // 防止退化
+    if (scatter_dir.dot(scatter_dir) < 1e-8) scatter_dir = rec.normal;
+    scattered = {rec.point, scatter_dir.normalize()};
+    attenuation = mat.albedo;
+    return true;
+}
+
+bool scatter_metal(const Ray& ray, const HitRecord& rec, const Material& mat,
+                   Ray& scattered, Vec3& attenuation) {
+    Vec3 reflected = reflect(ray.direction.normalize(), rec.normal);
+    scattered = {rec.point, reflected + mat.roughness * rand_in_unit_sphere()};
+    attenuation = mat.albedo;
+    return scattered.direction.dot(rec.normal) > 0;
+}
+
+bool scatter_glass(const Ray& ray, const HitRecord& rec, const Material& mat,
+                   Ray& scattered, Vec3& attenuation) {
+    attenuation = {1, 1, 1};
+    double ior = rec.front_face ? (1.0 / mat.ior) : mat.ior;
+    Vec3 unit_dir = ray.direction.normalize();
+    double cos_theta = std::min((-unit_dir).dot(rec.normal), 1.0);
+    double sin_theta = std::sqrt(1.0 - cos_theta * cos_theta);
+    bool cannot_refract = ior * sin_theta > 1.0;
+    Vec3 direction;
+    if (cannot_refract || schlick(cos_theta, ior) > rand01()) {
+        direction = reflect(unit_dir, rec.normal);
+    } else {
+        direction = refract(unit_dir, rec.normal, ior);
+    }
+    scattered = {rec.point, direction};
+    return true;
+}
+
+// ============================================================
+// 直接光照（NEE + MIS）与俄罗斯轮盘（两种引擎共用）
+// ============================================================
+
+// 漫反射顶点同时用两种方式找到太阳：显式采样太阳圆锥（NEE），以及按余弦分布散射后
+// 恰好飞进圆锥。两者按幂启发式（power heuristic）加权合并，任何一种都不会重复计数。
+// 金属与玻璃视为镜面，不做 NEE，之后打中太阳时全额计入。
+const int RR_START_BOUNCE = 3;      // 之前的弹射不做俄罗斯轮盘
+const double RR_MAX_SURVIVAL = 0.95;
+
+inline double power_heuristic(double pdf_a, double pdf_b) {
+    double a = pdf_a * pdf_a, b = pdf_b * pdf_b;
+    return a / (a + b);
+}
+
+// 余弦加权散射方向的立体角 pdf
+inline double diffuse_pdf(const Vec3& normal, const Vec3& unit_dir) {
+    return std::max(0.0, normal.dot(unit_dir)) / M_PI;
+}
+
+// 逃逸到天空的光线带回的辐亮度；bsdf_pdf 为上一顶点采样该方向的 pdf，
+// 0 表示相机光线或镜面弹射（太阳按全权重计入）
+Vec3 escaped_radiance(const Scene& scene, const Vec3& direction, double bsdf_pdf) {
+    Vec3 color = sky_color(direction);
+    if (scene.sun.enabled() && scene.sun.contains(direction.normalize())) {
+        double w = bsdf_pdf > 0 ? power_heuristic(bsdf_pdf, scene.sun.pdf()) : 1.0;
+        color = color + scene.sun.radiance * w;
+    }
+    return color;
+}
+
+// 漫反射顶点的太阳采样：生成阴影光线与未遮挡时的贡献（未乘路径吞吐量），
+// 太阳在表面背面时返回 false
+bool sample_sun(const Scene& scene, const HitRecord& rec, const Material& mat,
+                Ray& shadow, Vec3& contribution) {
+    if (!scene.sun.enabled()) return false;
+    double u1 = rand01(), u2 = rand01();
+    Vec3 wi = scene.sun.sample(u1, u2);
+    double cos_theta = rec.normal.dot(wi);
+    if (cos_theta <= 0) return false;
+    double light_pdf = scene.sun.pdf();
+    double w = power_heuristic(light_pdf, cos_theta / M_PI);
+    // f·cos/pdf = (albedo/π)·cos / light_pdf
+    contribution = mat.albedo * scene.sun.radiance * (cos_theta / M_PI / light_pdf * w);
+    shadow = {rec.point, wi};
+    return true;
+}
+
+// 俄罗斯轮盘：按吞吐量最大分量决定存活概率 q，终止返回 0，
+// 存活返回 1/q（乘到吞吐量上保持无偏）；前 RR_START_BOUNCE 次弹射恒返回 1
+inline double russian_roulette(int bounce, const Vec3& throughput) {
+    if (bounce < RR_START_BOUNCE) return 1.0;
+    double q = std::min(RR_MAX_SURVIVAL, std::max(throughput.x, std::max(throughput.y, throughput.z)));
+    if (q <= 0 || rand01() >= q) return 0.0;
+    return 1.0 / q;
+}
+
+// ============================================================
+// 路径追踪（递归引擎）
 // ============================================================
 
-Vec3 ray_color(const Ray& ray, const Scene& scene, int depth, bool use_bvh, int& total_tests) {
+// 递归路径状态：吞吐量只用于俄罗斯轮盘（返回值是当前顶点往后的辐亮度），
+// bsdf_pdf 为采样到当前光线方向的 pdf（0 表示相机光线或镜面弹射）
+struct PathState {
+    Vec3 throughput{1, 1, 1};
+    double bsdf_pdf = 0;
+    int bounce = 0;
+};
+
+Vec3 shade(const Ray& ray, bool hit, const HitRecord& rec, const Scene& scene,
+           int depth, bool use_bvh, const PathState& state = {});
+
+Vec3 ray_color(const Ray& ray, const Scene& scene, int depth, bool use_bvh,
+               const PathState& state = {}) {
     if (depth <= 0) return {0, 0, 0};
     
     HitRecord rec;
-    int tests = 0;
-    bool hit = use_bvh ? scene.intersect_bvh(ray, 0.001, 1e10, rec, tests)
+    bool hit = use_bvh ? scene.intersect_bvh(ray, 0.001, 1e10, rec)
                         : scene.intersect_brute(ray, 0.001, 1e10, rec);
-    total_tests += tests;
     
-    if (!hit) {
-        // 天空渐变
-        Vec3 unit_dir = ray.direction.normalize();
-        double t = 0.5 * (unit_dir.y + 1.0);
-        return (1 - t) * Vec3(1.0, 1.0, 1.0) + t * Vec3(0.5, 0.7, 1.0);
-    }
+    return shade(ray, hit, rec, scene, depth, use_bvh, state);
+}
+
+// 已知求交结果时的着色（散射后的次级光线继续走单光线 ray_color）
+Vec3 shade(const Ray& ray, bool hit, const HitRecord& rec, const Scene& scene,
+           int depth, bool use_bvh, const PathState& state) {
+    if (!hit) return escaped_radiance(scene, ray.direction, state.bsdf_pdf);
     
     Ray scattered;
     Vec3 attenuation;
-    
-    const Material& mat = rec.mat;
-    
-    if (mat.type == Material::DIFFUSE) {
-        Vec3 scatter_dir = rec.normal + rand_unit_vec();
-        // 防止退化
-        if (scatter_dir.dot(scatter_dir) < 1e-8) scatter_dir = rec.normal;
-        scattered = {rec.point, scatter_dir.normalize()};
-        attenuation = mat.albedo;
-    }
-    else if (mat.type == Material::METAL) {
-        Vec3 reflected = reflect(ray.direction.normalize(), rec.normal);
-        scattered = {rec.point, reflected + mat.roughness * rand_in_unit_sphere()};
-        attenuation = mat.albedo;
-        if (scattered.direction.dot(rec.normal) <= 0) return {0, 0, 0};
-    }
-    else { // GLASS
-        attenuation = {1, 1, 1};
-        double ior = rec.front_face ? (1.0 / mat.ior) : mat.ior;
-        Vec3 unit_dir = ray.direction.normalize();
-        double cos_theta = std::min((-unit_dir).dot(rec.normal), 1.0);
-        double sin_theta = std::sqrt(1.0 - cos_theta * cos_theta);
-        bool cannot_refract = ior * sin_theta > 1.0;
-        Vec3 direction;
-        if (cannot_refract || schlick(cos_theta, ior) > rand01()) {
-            direction = reflect(unit_dir, rec.normal);
-        } else {
-            direction = refract(unit_dir, rec.normal, ior);
+    Vec3 direct(0, 0, 0);
+    const Material& mat = scene.materials[rec.material];
+    bool alive;
+    switch (mat.type) {
+        case Material::DIFFUSE: {
+            Ray shadow;
+            Vec3 contribution;
+            if (sample_sun(scene, rec, mat, shadow, contribution) &&
+                !scene.occluded(shadow, 0.001, 1e10, use_bvh))
+                direct = contribution;
+            alive = scatter_diffuse(rec, mat, scattered, attenuation);
+            break;
         }
-        scattered = {rec.point, direction};
+        case Material::METAL:   alive = scatter_metal(ray, rec, mat, scattered, attenuation); break;
+        default:                alive = scatter_glass(ray, rec, mat, scattered, attenuation); break;
     }
-    
-    return attenuation * ray_color(scattered, scene, depth - 1, use_bvh, total_tests);
+    if (!alive) return direct;
+    
+    PathState next;
+    next.bounce = state.bounce + 1;
+    next.throughput = state.throughput * attenuation;
+    next.bsdf_pdf = mat.type == Material::DIFFUSE ? diffuse_pdf(rec.normal, scattered.direction) : 0;
+    double rr = russian_roulette(state.bounce, next.throughput);
+    if (rr == 0) return direct;
+    next.throughput = next.throughput * rr;
+    return direct + attenuation * rr * ray_color(scattered, scene, depth - 1, use_bvh, next);
 }
 
 // ============================================================
@@ -499,16 +2043,16 @@ Vec3 ray_color(const Ray& ray, const Scene& scene, int depth, bool use_bvh, int&
 Scene generate_scene(int num_spheres) {
     Scene scene;
     
+    // 太阳：半角 1.5°，地面上的直射照度与天空照度相当
+    scene.sun = SunLight::make({-0.4, 1.0, 0.6}, 1.5, Vec3(1.0, 0.9, 0.75) * 700.0);
+    
     // 地面
-    scene.spheres.push_back({
-        {0, -1000, 0}, 1000,
-        Material::diffuse({0.5, 0.5, 0.5})
-    });
+    scene.add_sphere({0, -1000, 0}, 1000, Material::diffuse({0.5, 0.5, 0.5}));
     
     // 三个大球
-    scene.spheres.push_back({{0, 1, 0}, 1.0, Material::glass(1.5)});
-    scene.spheres.push_back({{-4, 1, 0}, 1.0, Material::diffuse({0.4, 0.2, 0.1})});
-    scene.spheres.push_back({{4, 1, 0}, 1.0, Material::metal({0.7, 0.6, 0.5}, 0.0)});
+    scene.add_sphere({0, 1, 0}, 1.0, Material::glass(1.5));
+    scene.add_sphere({-4, 1, 0}, 1.0, Material::diffuse({0.4, 0.2, 0.1}));
+    scene.add_sphere({4, 1, 0}, 1.0, Material::metal({0.7, 0.6, 0.5}, 0.0));
     
     // 随机小球
     std::mt19937 local_rng(12345);
@@ -542,7 +2086,7 @@ Scene generate_scene(int num_spheres) {
             mat = Material::glass(1.5);
         }
         
-        scene.spheres.push_back({center, 0.2, mat});
+        scene.add_sphere(center, 0.2, mat);
         placed++;
     }
     
@@ -557,36 +2101,76 @@ struct Image {
     int width, height;
     std::vector<Vec3> pixels;
     
+    // 渐进渲染的逐像素统计：pixels 即样本均值，亮度方差用 Welford 在线更新
+    std::vector<int> sample_count;
+    std::vector<double> lum_m2;
+    
     Image(int w, int h) : width(w), height(h), pixels(w * h) {}
     
     Vec3& at(int x, int y) { return pixels[y * width + x]; }
     
-    void save_png(const std::string& filename) const {
-        // 使用 PPM 格式，然后用 ImageMagick 转换
-        std::string ppm_file = filename + ".ppm";
-        std::ofstream out(ppm_file, std::ios::binary);
-        out << "P6\n" << width << " " << height << "\n255\n";
-        for (const auto& p : pixels) {
-            // Gamma 校正
-            double r = std::sqrt(std::max(0.0, std::min(1.0, p.x)));
-            double g = std::sqrt(std::max(0.0, std::min(1.0, p.y)));
-            double b = std::sqrt(std::max(0.0, std::min(1.0, p.z)));
-            out << (uint8_t)(255.999 * r)
-                << (uint8_t)(255.999 * g)
-                << (uint8_t)(255.999 * b);
-        }
-        out.close();
-        
-        // 转换为 PNG
-        std::string cmd = "convert " + ppm_file + " " + filename + " 2>/dev/null";
-        int ret = system(cmd.c_str());
-        if (ret == 0) {
-            std::remove(ppm_file.c_str());
-        } else {
-            // 如果 convert 失败，保留 PPM 并重命名
-            std::rename(ppm_file.c_str(), filename.c_str());
-            std::cout << "  [注意: ImageMagick 未安装，保存为 PPM 格式]\n";
+    static double luminance(const Vec3& c) { return 0.2126 * c.x + 0.7152 * c.y + 0.0722 * c.z; }
+    
+    void reset_stats() {
+        std::fill(pixels.begin(), pixels.end(), Vec3(0, 0, 0));
+        sample_count.assign(pixels.size(), 0);
+        lum_m2.assign(pixels.size(), 0.0);
+    }
+    
+    void add_sample(int idx, const Vec3& c) {
+        int n = ++sample_count[idx];
+        double l = luminance(c);
+        double old_mean = luminance(pixels[idx]);
+        pixels[idx] = pixels[idx] + (c - pixels[idx]) / (double)n;
+        lum_m2[idx] += (l - old_mean) * (l - luminance(pixels[idx]));
+    }
+    
+    // 均值的标准误差换算到输出空间（save_png 的 sqrt gamma，d√x = dx / 2√x），
+    // 暗部与亮部按肉眼可见的噪声同等对待；样本不足两个时视为无穷大
+    double display_error(int idx) const {
+        int n = sample_count[idx];
+        if (n < 2) return std::numeric_limits<double>::infinity();
+        double mean = luminance(pixels[idx]);
+        if (mean >= 1.0) return 0.0;  // 已饱和，输出时被截断
+        double std_error = std::sqrt(lum_m2[idx] / (n - 1) / n);
+        return std::min(std_error / (2.0 * std::sqrt(std::max(mean, 0.0)) + 1e-3), std::sqrt(std_error));
+    }
+    
+    // 先整体量化成连续的 RGB8 缓冲（截断到 [0,1] + gamma 2），再用 stb_image_write 进程内编码
+    bool save_png(const std::string& filename) const {
+        PERF_ZONE("bvh.write_png");
+        std::vector<uint8_t> rgb(pixels.size() * 3);
+        auto quantize = [](double v) {
+            return (uint8_t)(255.999 * std::sqrt(std::max(0.0, std::min(1.0, v))));
+        };
+        for (size_t i = 0; i < pixels.size(); i++) {
+            rgb[3 * i + 0] = quantize(pixels[i].x);
+            rgb[3 * i + 1] = quantize(pixels[i].y);
+            rgb[3 * i + 2] = quantize(pixels[i].z);
+        }
+        if (!stbi_write_png(filename.c_str(), width, height, 3, rgb.data(), width * 3)) {
+            std::cerr << "  [错误: 无法写入 " << filename << "]\n";
+            return false;
+        }
+        return true;
+    }
+    
+    // HDR 输出：PFM（线性 float RGB，不截断、不做 gamma），扫描行按 PFM 约定自下而上
+    bool save_pfm(const std::string& filename) const {
+        std::ofstream out(filename, std::ios::binary);
+        if (!out) return false;
+        out << "PF\n" << width << " " << height << "\n-1.0\n";  // 负比例表示小端
+        std::vector<float> row(width * 3);
+        for (int y = height - 1; y >= 0; y--) {
+            for (int x = 0; x < width; x++) {
+                const Vec3& p = pixels[y * width + x];
+                row[3 * x + 0] = (float)p.x;
+                row[3 * x + 1] = (float)p.y;
+                row[3 * x + 2] = (float)p.z;
+            }
+            out.write((const char*)row.data(), (std::streamsize)(row.size() * sizeof(float)));
         }
+        return (bool)out;
     }
 };
 
@@ -631,41 +2215,474 @@ struct Camera {
 
 struct RenderStats {
     double render_time_ms;
-    long long total_tests;
-    long long total_rays;
+    long long total_tests;          // 包围盒测试次数（instr 关闭时为 0）
+    long long total_rays;           // 相机光线数
     double tests_per_ray;
+    instr::Counters counters;       // 整次渲染的计数与直方图
+    int tiles_x = 0, tiles_y = 0;
+    std::vector<uint64_t> tile_cost; // 每个 tile 的代价（包围盒测试 + 图元测试）
 };
 
+// 一次渲染的计数汇入 perf 计数器（每次渲染调用一次，不进热路径）
+void perf_count_render(const RenderStats& stats) {
+    PERF_COUNT("bvh.rays", stats.total_rays);
+    PERF_COUNT("bvh.queries", stats.counters.queries);
+    PERF_COUNT("bvh.node_visits", stats.counters.node_visits);
+    PERF_COUNT("bvh.leaf_tests", stats.counters.leaf_tests);
+    PERF_COUNT("bvh.prim_tests", stats.counters.prim_tests);
+    PERF_COUNT("bvh.shadow_rays", stats.counters.shadow_rays);
+}
+
 // ============================================================
-// 渲染函数
+// 渲染函数（多线程 tile 调度）
 // ============================================================
 
-RenderStats render(Image& img, const Scene& scene, const Camera& cam,
-                   int samples, int max_depth, bool use_bvh) {
-    auto start = std::chrono::high_resolution_clock::now();
-    long long total_tests = 0;
-    long long total_rays = 0;
+const int TILE_SIZE = 32;
+const uint64_t RENDER_SEED = 42;
+
+int default_thread_count() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : (int)n;
+}
+
+const int PACKET_DIM = 4;  // 光线包：4×4 相邻像素的主光线
+
+// 递归引擎渲染一个 tile；统计量累加到调用者（线程私有）的计数器中
+// use_packets 时主光线以 PACKET_DIM×PACKET_DIM 像素块为单位打包求交，
+// 弹射后的次级光线已不相干，走单光线遍历
+void render_tile(Image& img, const Scene& scene, const Camera& cam,
+                 int samples, int max_depth, bool use_bvh, bool use_packets,
+                 int x0, int y0, int x1, int y1, long long& total_rays) {
+    if (use_packets && use_bvh && max_depth > 0) {
+        const int N = PACKET_DIM * PACKET_DIM;
+        Ray rays[N];
+        HitRecord recs[N];
+        bool hits[N];
+        Vec3 colors[N];
+        
+        for (int by = y0; by < y1; by += PACKET_DIM) {
+            for (int bx = x0; bx < x1; bx += PACKET_DIM) {
+                int bw = std::min(PACKET_DIM, x1 - bx);
+                int bh = std::min(PACKET_DIM, y1 - by);
+                int count = bw * bh;
+                for (int i = 0; i < count; i++) colors[i] = {0, 0, 0};
+                
+                for (int s = 0; s < samples; s++) {
+                    for (int i = 0; i < count; i++) {
+                        int x = bx + i % bw, y = by + i / bw;
+                        double u = (x + rand01()) / (img.width - 1);
+                        double v = (y + rand01()) / (img.height - 1);
+                        rays[i] = cam.get_ray(u, v);
+                    }
+                    scene.intersect_packet(rays, count, 0.001, 1e10, recs, hits);
+                    for (int i = 0; i < count; i++) {
+                        colors[i] = colors[i] + shade(rays[i], hits[i], recs[i], scene,
+                                                      max_depth, use_bvh);
+                    }
+                    total_rays += count;
+                }
+                
+                for (int i = 0; i < count; i++) {
+                    int x = bx + i % bw, y = by + i / bw;
+                    img.at(x, img.height - 1 - y) = colors[i] / (double)samples;
+                }
+            }
+        }
+        return;
+    }
     
-    for (int y = 0; y < img.height; y++) {
-        for (int x = 0; x < img.width; x++) {
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
             Vec3 color(0, 0, 0);
             for (int s = 0; s < samples; s++) {
                 double u = (x + rand01()) / (img.width - 1);
                 double v = (y + rand01()) / (img.height - 1);
                 Ray ray = cam.get_ray(u, v);
-                int tests = 0;
-                color = color + ray_color(ray, scene, max_depth, use_bvh, tests);
-                total_tests += tests;
+                color = color + ray_color(ray, scene, max_depth, use_bvh);
                 total_rays++;
             }
             img.at(x, img.height - 1 - y) = color / (double)samples;
         }
     }
+}
+
+// ============================================================
+// 波前（wavefront）路径追踪引擎
+// ============================================================
+
+// 不递归：一个 tile 的路径放进 SoA 队列，每次弹射按阶段整体推进
+//   1. 生成：主光线按 PACKET_DIM×PACKET_DIM 像素块顺序入队，相邻路径相干
+//   2. 延伸：整队求交（第一次弹射可走光线包遍历）
+//   3. 分拣：未命中的路径累加天空色后结束，命中的按材质类型分到各自的着色队列
+//   4. 阴影：漫反射队列采样太阳，阴影光线整队做任意交点测试，未遮挡的贡献累加到路径
+//   5. 着色：每个材质队列单独跑一个散射循环，经俄罗斯轮盘存活的路径写入下一轮队列
+// 同一阶段的数据与代码连续，便于以后替换成批量/GPU 后端
+const int WAVEFRONT_PATHS = 16384;  // 一个波次的最大路径数（按整数个 spp 切分）
+
+struct PathQueue {
+    std::vector<Ray> rays;
+    std::vector<Vec3> throughput;   // 路径到当前顶点为止的衰减乘积
+    std::vector<Vec3> radiance;     // 路径已累积的辐亮度（NEE 贡献），结束时整体交给 on_sample
+    std::vector<double> bsdf_pdf;   // 采样到当前光线方向的 pdf（MIS 用，0 表示相机光线/镜面）
+    std::vector<int> pixel;         // tile 内像素下标
+    
+    size_t size() const { return rays.size(); }
+    void clear() { rays.clear(); throughput.clear(); radiance.clear(); bsdf_pdf.clear(); pixel.clear(); }
+    void reserve(size_t n) {
+        rays.reserve(n); throughput.reserve(n); radiance.reserve(n); bsdf_pdf.reserve(n); pixel.reserve(n);
+    }
+    void push(const Ray& ray, const Vec3& thr, const Vec3& rad, double pdf, int px) {
+        rays.push_back(ray);
+        throughput.push_back(thr);
+        radiance.push_back(rad);
+        bsdf_pdf.push_back(pdf);
+        pixel.push_back(px);
+    }
+};
+
+// 阴影光线队列：漫反射顶点的太阳采样，整队做任意交点测试后把未遮挡的贡献累加回路径
+struct ShadowQueue {
+    std::vector<Ray> rays;
+    std::vector<Vec3> contribution;  // 已乘路径吞吐量
+    std::vector<int> path;           // 所属路径在当前 PathQueue 中的下标
+    
+    size_t size() const { return rays.size(); }
+    void clear() { rays.clear(); contribution.clear(); path.clear(); }
+    void push(const Ray& ray, const Vec3& c, int i) {
+        rays.push_back(ray);
+        contribution.push_back(c);
+        path.push_back(i);
+    }
+};
+
+// 波前追踪一个 tile：spp_of(p) 给出 tile 内像素 p 本次要追踪的样本数，
+// 每条路径结束时调用一次 on_sample(p, 该样本的辐亮度)（包含路径上累积的直接光照）
+template <class SppFn, class SampleFn>
+void trace_tile_wavefront(const Scene& scene, const Camera& cam, int width, int height,
+                          int max_depth, bool use_bvh, bool use_packets,
+                          int x0, int y0, int x1, int y1, SppFn spp_of, SampleFn on_sample,
+                          long long& total_rays) {
+    int tw = x1 - x0, th = y1 - y0;
+    int tile_pixels = tw * th;
+    int samples = 0;
+    for (int p = 0; p < tile_pixels; p++) samples = std::max(samples, spp_of(p));
+    if (samples == 0) return;
+    int spp_per_wave = std::max(1, std::min(samples, WAVEFRONT_PATHS / tile_pixels));
+    size_t capacity = (size_t)spp_per_wave * tile_pixels;
+    
+    PathQueue paths, next;
+    paths.reserve(capacity);
+    next.reserve(capacity);
+    std::vector<int> packet_start;          // 主光线包在队列中的起点
+    std::vector<HitRecord> recs(capacity);
+    std::unique_ptr<bool[]> hits(new bool[capacity]);
+    std::vector<int> shade_queue[3];        // 按 Material::Type 分拣的路径下标
+    ShadowQueue shadows;
+    
+    for (int s0 = 0; s0 < samples; s0 += spp_per_wave) {
+        int spp = std::min(spp_per_wave, samples - s0);
+        
+        // 1. 生成
+        paths.clear();
+        packet_start.clear();
+        for (int s = s0; s < s0 + spp; s++) {
+            for (int by = y0; by < y1; by += PACKET_DIM) {
+                for (int bx = x0; bx < x1; bx += PACKET_DIM) {
+                    int bw = std::min(PACKET_DIM, x1 - bx);
+                    int bh = std::min(PACKET_DIM, y1 - by);
+                    int block_first = (int)paths.size();
+                    for (int i = 0; i < bw * bh; i++) {
+                        int x = bx + i % bw, y = by + i / bw;
+                        int p = (y - y0) * tw + (x - x0);
+                        if (s >= spp_of(p)) continue;
+                        double u = (x + rand01()) / (width - 1);
+                        double v = (y + rand01()) / (height - 1);
+                        paths.push(cam.get_ray(u, v), {1, 1, 1}, {0, 0, 0}, 0.0, p);
+                    }
+                    if ((int)paths.size() > block_first) packet_start.push_back(block_first);
+                }
+            }
+        }
+        packet_start.push_back((int)paths.size());
+        total_rays += (long long)paths.size();
+        
+        for (int bounce = 0; bounce < max_depth && paths.size() > 0; bounce++) {
+            int n = (int)paths.size();
+            
+            // 2. 延伸
+            if (bounce == 0 && use_packets && use_bvh) {
+                for (size_t p = 0; p + 1 < packet_start.size(); p++) {
+                    int first = packet_start[p];
+                    scene.intersect_packet(&paths.rays[first], packet_start[p + 1] - first, 0.001, 1e10,
+                                           &recs[first], &hits[first]);
+                }
+            } else if (use_bvh) {
+                for (int i = 0; i < n; i++)
+                    hits[i] = scene.intersect_bvh(paths.rays[i], 0.001, 1e10, recs[i]);
+            } else {
+                for (int i = 0; i < n; i++)
+                    hits[i] = scene.intersect_brute(paths.rays[i], 0.001, 1e10, recs[i]);
+            }
+            
+            // 3. 分拣
+            for (auto& q : shade_queue) q.clear();
+            for (int i = 0; i < n; i++) {
+                if (!hits[i]) {
+                    Vec3 sky = escaped_radiance(scene, paths.rays[i].direction, paths.bsdf_pdf[i]);
+                    on_sample(paths.pixel[i], paths.radiance[i] + paths.throughput[i] * sky);
+                } else {
+                    shade_queue[scene.materials[recs[i].material].type].push_back(i);
+                }
+            }
+            
+            // 4. 阴影
+            shadows.clear();
+            for (int i : shade_queue[Material::DIFFUSE]) {
+                Ray shadow;
+                Vec3 contribution;
+                if (sample_sun(scene, recs[i], scene.materials[recs[i].material], shadow, contribution))
+                    shadows.push(shadow, paths.throughput[i] * contribution, i);
+            }
+            for (size_t k = 0; k < shadows.size(); k++) {
+                if (!scene.occluded(shadows.rays[k], 0.001, 1e10, use_bvh))
+                    paths.radiance[shadows.path[k]] = paths.radiance[shadows.path[k]] + shadows.contribution[k];
+            }
+            
+            // 5. 着色
+            next.clear();
+            Ray scattered;
+            Vec3 attenuation;
+            auto emit = [&](int i, bool alive, double pdf) {
+                if (alive) {
+                    Vec3 thr = paths.throughput[i] * attenuation;
+                    double rr = russian_roulette(bounce, thr);
+                    if (rr > 0) {
+                        next.push(scattered, thr * rr, paths.radiance[i], pdf, paths.pixel[i]);
+                        return;
+                    }
+                }
+                on_sample(paths.pixel[i], paths.radiance[i]);
+            };
+            for (int i : shade_queue[Material::DIFFUSE]) {
+                bool alive = scatter_diffuse(recs[i], scene.materials[recs[i].material], scattered, attenuation);
+                emit(i, alive, diffuse_pdf(recs[i].normal, scattered.direction));
+            }
+            for (int i : shade_queue[Material::METAL])
+                emit(i, scatter_metal(paths.rays[i], recs[i], scene.materials[recs[i].material], scattered, attenuation), 0.0);
+            for (int i : shade_queue[Material::GLASS])
+                emit(i, scatter_glass(paths.rays[i], recs[i], scene.materials[recs[i].material], scattered, attenuation), 0.0);
+            std::swap(paths, next);
+        }
+        // 弹射次数用尽仍存活的路径只保留已累积的直接光照（与递归版 depth <= 0 返回黑色一致）
+        for (size_t i = 0; i < paths.size(); i++) on_sample(paths.pixel[i], paths.radiance[i]);
+    }
+}
+
+// 固定 spp 渲染一个 tile
+void render_tile_wavefront(Image& img, const Scene& scene, const Camera& cam,
+                           int samples, int max_depth, bool use_bvh, bool use_packets,
+                           int x0, int y0, int x1, int y1, long long& total_rays) {
+    int tw = x1 - x0, th = y1 - y0;
+    std::vector<Vec3> accum(tw * th, Vec3(0, 0, 0));
+    trace_tile_wavefront(scene, cam, img.width, img.height, max_depth, use_bvh, use_packets,
+                         x0, y0, x1, y1,
+                         [&](int) { return samples; },
+                         [&](int p, const Vec3& c) { accum[p] = accum[p] + c; },
+                         total_rays);
+    for (int p = 0; p < tw * th; p++) {
+        int x = x0 + p % tw, y = y0 + p / tw;
+        img.at(x, img.height - 1 - y) = accum[p] / (double)samples;
+    }
+}
+
+enum RenderEngine { RECURSIVE, WAVEFRONT };
+
+// 图像被切成 TILE_SIZE×TILE_SIZE 的 tile，工作线程通过原子计数器动态领取，
+// 先做完的线程自动去拿剩下的 tile（负载均衡）。
+// 每个 tile 开始前用 tile 编号重新播种 RNG，因此输出与线程数无关、完全确定。
+RenderStats render(Image& img, const Scene& scene, const Camera& cam,
+                   int samples, int max_depth, bool use_bvh,
+                   int num_threads = 0, bool use_packets = true,
+                   RenderEngine engine = WAVEFRONT) {
+    PERF_ZONE("bvh.render");
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    int tiles_x = (img.width + TILE_SIZE - 1) / TILE_SIZE;
+    int tiles_y = (img.height + TILE_SIZE - 1) / TILE_SIZE;
+    int num_tiles = tiles_x * tiles_y;
+    if (num_threads <= 0) num_threads = default_thread_count();
+    num_threads = std::max(1, std::min(num_threads, num_tiles));
+    
+    // 每线程统计量，结束后归约；alignas 避免伪共享
+    struct alignas(64) ThreadStats { long long rays = 0; instr::Counters counters; };
+    std::vector<ThreadStats> thread_stats(num_threads);
+    std::vector<uint64_t> tile_cost(num_tiles, 0);
+    std::atomic<int> next_tile{0};
+    
+    auto worker = [&](int tid) {
+        ThreadStats& ts = thread_stats[tid];
+        int tile;
+        while ((tile = next_tile.fetch_add(1, std::memory_order_relaxed)) < num_tiles) {
+            int x0 = (tile % tiles_x) * TILE_SIZE;
+            int y0 = (tile / tiles_x) * TILE_SIZE;
+            int x1 = std::min(x0 + TILE_SIZE, img.width);
+            int y1 = std::min(y0 + TILE_SIZE, img.height);
+            PERF_ZONE("bvh.tile");
+            seed_rng(RENDER_SEED, (uint64_t)tile);
+            instr::Counters before = instr::snapshot();
+            if (engine == WAVEFRONT)
+                render_tile_wavefront(img, scene, cam, samples, max_depth, use_bvh, use_packets,
+                                      x0, y0, x1, y1, ts.rays);
+            else
+                render_tile(img, scene, cam, samples, max_depth, use_bvh, use_packets,
+                            x0, y0, x1, y1, ts.rays);
+            instr::Counters delta = instr::snapshot() - before;
+            tile_cost[tile] = delta.cost();
+            ts.counters += delta;
+        }
+    };
+    
+    std::vector<std::thread> threads;
+    for (int t = 1; t < num_threads; t++) threads.emplace_back(worker, t);
+    worker(0);
+    for (auto& th : threads) th.join();
+    
+    RenderStats stats;
+    stats.total_rays = 0;
+    for (const auto& ts : thread_stats) {
+        stats.total_rays += ts.rays;
+        stats.counters += ts.counters;
+    }
+    stats.total_tests = (long long)stats.counters.node_visits;
+    stats.tests_per_ray = (double)stats.total_tests / std::max(1LL, stats.total_rays);
+    stats.tiles_x = tiles_x;
+    stats.tiles_y = tiles_y;
+    stats.tile_cost = std::move(tile_cost);
     
     auto end = std::chrono::high_resolution_clock::now();
-    double ms = std::chrono::duration<double, std::milli>(end - start).count();
+    stats.render_time_ms = std::chrono::duration<double, std::milli>(end - start).count();
+    perf_count_render(stats);
+    return stats;
+}
+
+// ============================================================
+// 渐进 + 自适应采样
+// ============================================================
+
+struct ProgressiveSettings {
+    int min_spp = 8;             // 首轮每像素样本数（方差估计的起点）
+    int pass_spp = 4;            // 之后每轮给未收敛像素追加的最少样本数（至多追加到已有样本的一半）
+    int max_spp = 256;           // 单像素样本上限
+    double noise_target = 0.004; // 输出空间（gamma 后 0..1）的标准误差低于此值视为收敛
+    double time_budget_ms = 0;   // 总时间预算，0 表示不限
+};
+
+struct ProgressiveStats {
+    RenderStats stats;
+    int passes;
+    double avg_spp;
+    double converged;            // 收敛像素占比
+};
+
+// 分轮渲染：每轮只给误差估计仍高于 noise_target（且未到 max_spp）的像素追加样本，
+// 没有需要追加的像素、或超出时间预算时停止。
+// 每轮每个 tile 用 (轮次, tile) 播种；不设时间预算时输出与线程数无关
+ProgressiveStats render_progressive(Image& img, const Scene& scene, const Camera& cam,
+                                    const ProgressiveSettings& settings, int max_depth,
+                                    bool use_bvh, int num_threads = 0, bool use_packets = true) {
+    PERF_ZONE("bvh.render_progressive");
+    auto start = std::chrono::high_resolution_clock::now();
+    auto elapsed_ms = [&]() {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    };
+    
+    img.reset_stats();
+    int tiles_x = (img.width + TILE_SIZE - 1) / TILE_SIZE;
+    int tiles_y = (img.height + TILE_SIZE - 1) / TILE_SIZE;
+    int num_tiles = tiles_x * tiles_y;
+    if (num_threads <= 0) num_threads = default_thread_count();
+    num_threads = std::max(1, std::min(num_threads, num_tiles));
+    
+    struct alignas(64) ThreadStats { long long rays = 0; instr::Counters counters; };
+    std::vector<ThreadStats> thread_stats(num_threads);
+    std::vector<uint64_t> tile_cost(num_tiles, 0);
+    std::vector<int> pass_spp(img.pixels.size());
+    std::vector<double> error(img.pixels.size());
+    
+    int passes = 0;
+    while (true) {
+        // 决定本轮各像素的样本数：误差取 3×3 邻域最大值，
+        // 避免少量样本恰好一致的像素（如偶尔采到高光的路径）过早判为收敛
+        for (size_t i = 0; i < error.size(); i++) error[i] = img.display_error((int)i);
+        int active = 0;
+        for (size_t i = 0; i < pass_spp.size(); i++) {
+            int n = img.sample_count[i];
+            int x = (int)i % img.width, y = (int)i / img.width;
+            double e = 0;
+            for (int dy = std::max(0, y - 1); dy <= std::min(img.height - 1, y + 1); dy++)
+                for (int dx = std::max(0, x - 1); dx <= std::min(img.width - 1, x + 1); dx++)
+                    e = std::max(e, error[dy * img.width + dx]);
+            int want = 0;
+            if (passes == 0) want = settings.min_spp;
+            else if (n < settings.max_spp && e > settings.noise_target)
+                want = std::min(std::max(settings.pass_spp, n / 2), settings.max_spp - n);
+            pass_spp[i] = want;
+            if (want > 0) active++;
+        }
+        perf::sample_memory();
+        if (active == 0) break;
+        if (passes > 0 && settings.time_budget_ms > 0 && elapsed_ms() >= settings.time_budget_ms) break;
+        
+        std::atomic<int> next_tile{0};
+        auto worker = [&](int tid) {
+            ThreadStats& ts = thread_stats[tid];
+            int tile;
+            while ((tile = next_tile.fetch_add(1, std::memory_order_relaxed)) < num_tiles) {
+                int x0 = (tile % tiles_x) * TILE_SIZE;
+                int y0 = (tile / tiles_x) * TILE_SIZE;
+                int x1 = std::min(x0 + TILE_SIZE, img.width);
+                int y1 = std::min(y0 + TILE_SIZE, img.height);
+                int tw = x1 - x0;
+                // tile 内像素 p 对应的图像下标（图像按行自上而下存储）
+                auto index_of = [&](int p) { return (img.height - 1 - (y0 + p / tw)) * img.width + x0 + p % tw; };
+                PERF_ZONE("bvh.progressive_tile");
+                seed_rng(RENDER_SEED, (uint64_t)passes * num_tiles + tile);
+                instr::Counters before = instr::snapshot();
+                trace_tile_wavefront(scene, cam, img.width, img.height, max_depth, use_bvh, use_packets,
+                                     x0, y0, x1, y1,
+                                     [&](int p) { return pass_spp[index_of(p)]; },
+                                     [&](int p, const Vec3& c) { img.add_sample(index_of(p), c); },
+                                     ts.rays);
+                instr::Counters delta = instr::snapshot() - before;
+                tile_cost[tile] += delta.cost();
+                ts.counters += delta;
+            }
+        };
+        std::vector<std::thread> threads;
+        for (int t = 1; t < num_threads; t++) threads.emplace_back(worker, t);
+        worker(0);
+        for (auto& th : threads) th.join();
+        passes++;
+    }
     
-    return {ms, total_tests, total_rays, (double)total_tests / total_rays};
+    RenderStats stats;
+    stats.total_rays = 0;
+    for (const auto& ts : thread_stats) {
+        stats.total_rays += ts.rays;
+        stats.counters += ts.counters;
+    }
+    stats.total_tests = (long long)stats.counters.node_visits;
+    stats.tests_per_ray = (double)stats.total_tests / std::max(1LL, stats.total_rays);
+    stats.tiles_x = tiles_x;
+    stats.tiles_y = tiles_y;
+    stats.tile_cost = std::move(tile_cost);
+    int converged = 0;
+    for (size_t i = 0; i < img.pixels.size(); i++)
+        if (img.display_error((int)i) <= settings.noise_target) converged++;
+    stats.render_time_ms = elapsed_ms();
+    perf_count_render(stats);
+    
+    return {stats, passes, (double)stats.total_rays / img.pixels.size(), (double)converged / img.pixels.size()};
 }
 
 // ============================================================
@@ -735,6 +2752,46 @@ void generate_comparison_image(const std::string& output_path, int num_spheres)
     }
 }
 
+// ============================================================
+// 遍历代价热力图 + 计数汇总
+// ============================================================
+
+// 每个 tile 按其代价（包围盒测试 + 图元测试）着色：蓝（低）→ 绿 → 红（高）
+void save_cost_heatmap(const std::string& output_path, const RenderStats& stats, int width, int height) {
+    if (stats.tile_cost.empty()) return;
+    uint64_t max_cost = *std::max_element(stats.tile_cost.begin(), stats.tile_cost.end());
+    Image img(width, height);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            // 渲染时 tile 的 y 自下而上，图像按行自上而下存储
+            int tile = ((height - 1 - y) / TILE_SIZE) * stats.tiles_x + x / TILE_SIZE;
+            double t = max_cost ? (double)stats.tile_cost[tile] / max_cost : 0.0;
+            Vec3 c = t < 0.5 ? Vec3(0, 2 * t, 1 - 2 * t) : Vec3(2 * t - 1, 2 - 2 * t, 0);
+            bool border = x % TILE_SIZE == 0 || (height - 1 - y) % TILE_SIZE == 0;
+            img.at(x, y) = border ? c * 0.5 : c;
+        }
+    }
+    img.save_png(output_path);
+}
+
+void print_instrumentation(const RenderStats& stats) {
+    const instr::Counters& c = stats.counters;
+    double rays = (double)std::max(1LL, stats.total_rays);
+    std::cout << "  遍历计数（每条相机光线）: 节点 " << c.node_visits / rays
+              << "，叶子 " << c.leaf_tests / rays
+              << "，图元 " << c.prim_tests / rays
+              << "，阴影光线 " << c.shadow_rays / rays << "\n";
+    auto cost_at = [&](double q) {
+        return 1ULL << instr::Counters::percentile(c.cost_hist, instr::COST_BINS, q);
+    };
+    auto depth_at = [&](double q) {
+        return instr::Counters::percentile(c.depth_hist, instr::DEPTH_BINS, q);
+    };
+    std::cout << "  单次查询代价 p50/p90/p99: ≥" << cost_at(0.5) << " / ≥" << cost_at(0.9)
+              << " / ≥" << cost_at(0.99) << "，遍历栈深度 p50/p99: " << depth_at(0.5)
+              << " / " << depth_at(0.99) << "（共 " << c.queries << " 次查询）\n";
+}
+
 // ============================================================
 // 生成 BVH 可视化（调试用）
 // ============================================================
@@ -841,8 +2898,9 @@ void visualize_bvh(const std::string& output_path, int num_spheres) {
                     int nx = px + dx, ny = py + dy;
                     if (nx >= 0 && nx < W && ny >= 0 && ny < H) {
                         // 根据材质颜色
-                        Vec3 c = s.mat.albedo;
-                        if (s.mat.type == Material::GLASS) c = {0.8, 0.9, 1.0};
+                        const Material& m = scene.materials[s.material];
+                        Vec3 c = m.albedo;
+                        if (m.type == Material::GLASS) c = {0.8, 0.9, 1.0};
                         img.at(nx, ny) = c;
                     }
                 }
@@ -854,11 +2912,261 @@ void visualize_bvh(const std::string& output_path, int num_spheres) {
     std::cout << "✅ BVH 可视化已保存\n";
 }
 
+// ============================================================
+// 基准测试（./bvh_tracer --bench [--full] [--out 文件]）
+// ============================================================
+
+// 以一个基准配置为中心，每次只改变一个维度（场景规模 / 分辨率 / spp / 线程数 /
+// 构建方式 / 遍历方式 / 引擎），结果写成 JSON，便于跟踪回归和比较遍历变体
+struct BenchConfig {
+    std::string sweep;           // 所属扫描维度
+    int spheres = 10000;
+    int width = 320, height = 180;
+    int spp = 4;
+    int threads = 0;             // 0 = 全部硬件线程
+    BVHBase::BuildMode mode = BVHBase::SAH;
+    Scene::Traversal traversal = Scene::WIDE4;
+    bool packets = true;
+    RenderEngine engine = WAVEFRONT;
+};
+
+struct BenchResult {
+    BenchConfig config;
+    int prims;                   // 实际图元数（含地面和三个大球）
+    double build_ms;
+    RenderStats stats;
+};
+
+const int BENCH_MAX_DEPTH = 10;
+
+std::vector<BenchConfig> benchmark_suite(bool full) {
+    std::vector<BenchConfig> suite;
+    auto add = [&](const std::string& sweep, BenchConfig c) { c.sweep = sweep; suite.push_back(c); };
+    
+    std::vector<int> sizes = {10, 100, 1000, 10000, 100000};
+    if (full) sizes.push_back(1000000);
+    for (int n : sizes) { BenchConfig c; c.spheres = n; add("spheres", c); }
+    
+    int resolutions[][2] = {{160, 90}, {320, 180}, {640, 360}};
+    for (auto& r : resolutions) { BenchConfig c; c.width = r[0]; c.height = r[1]; add("resolution", c); }
+    
+    for (int spp : {1, 4, 16}) { BenchConfig c; c.spp = spp; add("spp", c); }
+    
+    int hw = default_thread_count();
+    for (int t = 1; t < hw; t *= 2) { BenchConfig c; c.threads = t; add("threads", c); }
+    { BenchConfig c; c.threads = hw; add("threads", c); }
+    
+    for (auto mode : {BVHBase::SAH, BVHBase::LBVH}) { BenchConfig c; c.mode = mode; add("build", c); }
+    if (full) {
+        BenchConfig c; c.spheres = 1000000; c.mode = BVHBase::LBVH; add("build", c);
+    }
+    
+    { BenchConfig c; c.traversal = Scene::BINARY; c.packets = false; add("traversal", c); }
+    { BenchConfig c; c.traversal = Scene::WIDE4; c.packets = false; add("traversal", c); }
+    { BenchConfig c; c.traversal = Scene::WIDE4; c.packets = true; add("traversal", c); }
+    
+    for (auto engine : {RECURSIVE, WAVEFRONT}) { BenchConfig c; c.engine = engine; add("engine", c); }
+    return suite;
+}
+
+BenchResult run_benchmark(const BenchConfig& c) {
+    Scene scene = generate_scene(c.spheres);
+    scene.traversal = c.traversal;
+    
+    auto t0 = std::chrono::high_resolution_clock::now();
+    scene.build_bvh(c.mode);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    
+    Camera cam({13, 2, 3}, {0, 0, 0}, {0, 1, 0}, 20, (double)c.width / c.height, 0.1, 10.0);
+    Image img(c.width, c.height);
+    RenderStats stats = render(img, scene, cam, c.spp, BENCH_MAX_DEPTH, true,
+                               c.threads, c.packets, c.engine);
+    return {c, (int)scene.spheres.size(),
+            std::chrono::duration<double, std::milli>(t1 - t0).count(), stats};
+}
+
+const char* simd_name() {
+#if defined(__AVX2__)
+    return "avx2";
+#elif defined(__SSE2__)
+    return "sse2";
+#elif defined(__ARM_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+bool write_benchmark_json(const std::string& path, const std::vector<BenchResult>& results) {
+    std::ofstream out(path);
+    if (!out) return false;
+    out << "{\n";
+    out << "  \"project\": \"BVH Accelerated Ray Tracer\",\n";
+    out << "  \"timestamp\": " << (long long)std::time(nullptr) << ",\n";
+    out << "  \"hardware_threads\": " << default_thread_count() << ",\n";
+    out << "  \"simd\": \"" << simd_name() << "\",\n";
+    out << "  \"max_depth\": " << BENCH_MAX_DEPTH << ",\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        const BenchConfig& c = r.config;
+        double rays_per_sec = r.stats.total_rays / std::max(r.stats.render_time_ms * 1e-3, 1e-9);
+        out << "    {\"sweep\": \"" << c.sweep << "\""
+            << ", \"spheres\": " << r.prims
+            << ", \"width\": " << c.width << ", \"height\": " << c.height
+            << ", \"spp\": " << c.spp
+            << ", \"threads\": " << (c.threads > 0 ? c.threads : default_thread_count())
+            << ", \"build\": \"" << (c.mode == BVHBase::SAH ? "sah" : "lbvh") << "\""
+            << ", \"traversal\": \"" << (c.traversal == Scene::WIDE4 ? "bvh4" : "binary") << "\""
+            << ", \"packets\": " << (c.packets ? "true" : "false")
+            << ", \"engine\": \"" << (c.engine == WAVEFRONT ? "wavefront" : "recursive") << "\""
+            << ", \"build_ms\": " << r.build_ms
+            << ", \"render_ms\": " << r.stats.render_time_ms
+            << ", \"camera_rays\": " << r.stats.total_rays
+            << ", \"camera_rays_per_sec\": " << rays_per_sec
+            << ", \"tests_per_ray\": " << r.stats.tests_per_ray
+            << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return (bool)out;
+}
+
+int run_benchmarks(const std::string& path, bool full) {
+    auto suite = benchmark_suite(full);
+    std::vector<BenchResult> results;
+    std::cout << "基准测试：" << suite.size() << " 组配置\n";
+    for (size_t i = 0; i < suite.size(); i++) {
+        BenchResult r = run_benchmark(suite[i]);
+        std::cout << "  [" << i + 1 << "/" << suite.size() << "] " << r.config.sweep
+                  << "  球体 " << r.prims << "  " << r.config.width << "x" << r.config.height
+                  << "  " << r.config.spp << "spp  构建 " << r.build_ms << " ms  渲染 "
+                  << r.stats.render_time_ms << " ms  测试/光线 " << r.stats.tests_per_ray << "\n";
+        results.push_back(r);
+    }
+    if (!write_benchmark_json(path, results)) {
+        std::cerr << "无法写入 " << path << "\n";
+        return 1;
+    }
+    std::cout << "✅ 结果已写入 " << path << "\n";
+    return 0;
+}
+
+// ============================================================
+// 动画检查（./bvh_tracer --animate [帧数]）
+// ============================================================
+
+// 去掉地面大球（它的包围盒占满根节点，整体 SAH 代价几乎不随小球变化），小球分三段运动：
+// 前 1/3 帧全部缓慢漂移（预期只 refit），中间 1/3 每 20 个球中有一个快速移动
+// （拉大所在子树，触发局部重建），最后 1/3 每帧把四分之一的球传送到场景内的随机位置
+// （拓扑被打乱，整体代价超标，触发整棵重建）。
+// 每帧调用 update_bvh()，记录走了哪个分支和耗时，再用随机光线把 BVH（BVH4 与二叉树
+// 两种遍历）的最近交点和遮挡结果与暴力遍历逐条比较。有任何不一致时返回非零。
+int run_animation_check(int frames) {
+    const int SPHERES = 1000;
+    const int RAYS_PER_FRAME = 4000;
+    const size_t FIRST_MOVING = 3;  // 三个大球不动
+    Scene scene = generate_scene(SPHERES);
+    scene.spheres.erase(scene.spheres.begin());
+    scene.build_bvh();
+    
+    std::mt19937 motion_rng(777);
+    std::uniform_real_distribution<double> d(-1.0, 1.0);
+    std::vector<Vec3> drift(scene.spheres.size());
+    for (size_t i = FIRST_MOVING; i < scene.spheres.size(); i++)
+        drift[i] = Vec3(d(motion_rng), 0, d(motion_rng)) * 0.005;
+    
+    const char* names[] = {"REFIT", "PARTIAL", "FULL"};
+    int branch_count[3] = {};
+    double branch_ms[3] = {};
+    long long mismatches = 0;
+    std::mt19937 ray_rng(4242);
+    std::cout << "动画检查：" << scene.spheres.size() << " 个球，" << frames << " 帧，每帧 "
+              << RAYS_PER_FRAME << " 条光线与暴力遍历比较\n";
+    
+    for (int f = 0; f < frames; f++) {
+        int phase = f * 3 / frames;
+        for (size_t i = FIRST_MOVING; i < scene.spheres.size(); i++) {
+            Sphere& sp = scene.spheres[i];
+            Vec3 v = drift[i];
+            if (phase == 1 && i % 20 == 0) v = v * 100.0;
+            if (phase == 2 && motion_rng() % 4 == 0)
+                v = Vec3(d(motion_rng) * 11, sp.center.y, d(motion_rng) * 11) - sp.center;
+            sp.center = sp.center + v;
+        }
+        
+        auto t0 = std::chrono::high_resolution_clock::now();
+        Scene::UpdateResult result = scene.update_bvh();
+        auto t1 = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        branch_count[result]++;
+        branch_ms[result] += ms;
+        
+        int frame_mismatches = 0;
+        for (int r = 0; r < RAYS_PER_FRAME; r++) {
+            std::uniform_real_distribution<double> u(-1.0, 1.0);
+            Vec3 origin(u(ray_rng) * 14, 0.5 + (u(ray_rng) + 1) * 2, u(ray_rng) * 14);
+            Vec3 dir(u(ray_rng), u(ray_rng) * 0.5, u(ray_rng));
+            if (dir.dot(dir) < 1e-6) continue;
+            Ray ray(origin, dir.normalize());
+            
+            HitRecord ref, got;
+            bool ref_hit = scene.intersect_brute(ray, 0.001, 1e30, ref);
+            bool ok = true;
+            for (auto traversal : {Scene::WIDE4, Scene::BINARY}) {
+                scene.traversal = traversal;
+                bool hit = scene.intersect_bvh(ray, 0.001, 1e30, got);
+                if (hit != ref_hit || (hit && got.t != ref.t)) ok = false;
+            }
+            scene.traversal = Scene::WIDE4;
+            double t_shadow = ref_hit ? ref.t * 1.5 : 1e30;
+            if (scene.occluded(ray, 0.001, t_shadow, true) != scene.occluded(ray, 0.001, t_shadow, false))
+                ok = false;
+            if (!ok) frame_mismatches++;
+        }
+        mismatches += frame_mismatches;
+        std::cout << "  帧 " << f + 1 << "  " << names[result] << "  " << ms << " ms"
+                  << "  更新后 SAH 代价 " << scene.bvh->sah_cost() / scene.bvh->build_sah_cost
+                  << " x 构建时" << (frame_mismatches ? "  ❌ 不一致 " + std::to_string(frame_mismatches) : "")
+                  << "\n";
+    }
+    
+    std::cout << "分支统计：";
+    for (int b = 0; b < 3; b++) {
+        std::cout << names[b] << " " << branch_count[b] << " 帧";
+        if (branch_count[b]) std::cout << "（平均 " << branch_ms[b] / branch_count[b] << " ms）";
+        std::cout << (b < 2 ? "，" : "\n");
+    }
+    if (mismatches) {
+        std::cout << "❌ " << mismatches << " 条光线与暴力遍历结果不一致\n";
+        return 1;
+    }
+    std::cout << "✅ 所有光线与暴力遍历一致\n";
+    return 0;
+}
+
 // ============================================================
 // 主函数
 // ============================================================
 
-int main() {
+int main(int argc, char** argv) {
+    perf::Session session("bvh_tracer");
+    // 基准测试模式：结果默认写到仓库根目录（与 status.json 同级）
+    bool bench = false, full = false;
+    int animate_frames = 0;
+    std::string bench_out = "../../../bvh_benchmark.json";
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--bench") bench = true;
+        else if (arg == "--full") full = true;
+        else if (arg == "--out" && i + 1 < argc) bench_out = argv[++i];
+        else if (arg == "--animate") {
+            animate_frames = 60;
+            if (i + 1 < argc && std::isdigit((unsigned char)argv[i + 1][0])) animate_frames = std::atoi(argv[++i]);
+        }
+    }
+    if (bench) return run_benchmarks(bench_out, full);
+    if (animate_frames > 0) return run_animation_check(animate_frames);
+    
     std::cout << "╔═══════════════════════════════════════════╗\n";
     std::cout << "║  BVH Accelerated Ray Tracer - 2026-03-01  ║\n";
     std::cout << "╚═══════════════════════════════════════════╝\n\n";
@@ -872,7 +3180,8 @@ int main() {
     // 额外：生成高质量单张（BVH加速）
     std::cout << "\n生成高质量最终渲染...\n";
     Scene scene = generate_scene(80);
-    scene.build_bvh();
+    // 场景固定，第二次运行起直接映射缓存文件
+    bool cache_hit = scene.build_bvh_cached("bvh_output");
     
     Vec3 look_from(13, 2, 3);
     Vec3 look_at(0, 0, 0);
@@ -885,19 +3194,60 @@ int main() {
     Image img(W, H);
     auto stats = render(img, scene, cam, samples, max_depth, true);
     img.save_png("bvh_output.png");
+    img.save_pfm("bvh_output.pfm");
     
     std::cout << "\n最终渲染统计:\n";
     std::cout << "  分辨率: " << W << "x" << H << "\n";
     std::cout << "  采样数: " << samples << "\n";
+    std::cout << "  渲染线程: " << default_thread_count() << "\n";
     std::cout << "  场景球体: " << scene.spheres.size() << "\n";
-    std::cout << "  BVH节点: " << scene.bvh->nodes.size() << "\n";
+    std::cout << "  BVH节点: " << scene.bvh->flat_count
+              << (cache_hit ? "（来自缓存 bvh_output.spheres.bvh）" : "（已写入缓存）") << "\n";
     std::cout << "  渲染时间: " << stats.render_time_ms << " ms\n";
     std::cout << "  平均 AABB 测试/光线: " << stats.tests_per_ray << "\n";
+    if (instr::ENABLED) {
+        print_instrumentation(stats);
+        save_cost_heatmap("bvh_heatmap.png", stats, W, H);
+    }
+    
+    // 自适应采样：同一场景，只在噪声高的像素上追加样本
+    std::cout << "\n生成自适应采样渲染...\n";
+    Image prog_img(W / 2, H / 2);
+    ProgressiveSettings prog;
+    prog.max_spp = 32;
+    auto prog_stats = render_progressive(prog_img, scene, cam, prog, max_depth, true);
+    prog_img.save_png("bvh_progressive.png");
+    std::cout << "  轮数: " << prog_stats.passes
+              << "，平均采样数: " << prog_stats.avg_spp
+              << "，收敛像素: " << (int)(prog_stats.converged * 100) << "%"
+              << "，渲染时间: " << prog_stats.stats.render_time_ms << " ms\n";
+    
+    // 网格场景：OBJ 模型（02-25 项目的立方体）与球体共用同一套 BVH
+    std::cout << "\n生成网格场景渲染...\n";
+    bool mesh_ok = false;
+    obj::OBJLoader model;
+    if (model.load("../../02/02-25-OBJ-Model-Loader/cube.obj")) {
+        Scene mesh_scene = generate_scene(80);
+        mesh_scene.add_mesh(model, Material::metal({0.8, 0.8, 0.85}, 0.05), 0.6, {2.0, 0.6, 2.0});
+        mesh_scene.build_bvh();
+        
+        Image mesh_img(400, 225);
+        auto mesh_stats = render(mesh_img, mesh_scene, cam, 4, max_depth, true);
+        mesh_img.save_png("bvh_mesh_output.png");
+        std::cout << "  三角形: " << mesh_scene.triangles.size()
+                  << "，网格 BVH 节点: " << mesh_scene.mesh_bvh->flat_count
+                  << "，渲染时间: " << mesh_stats.render_time_ms << " ms\n";
+        mesh_ok = true;
+    }
     
     std::cout << "\n✅ 所有输出文件已生成:\n";
     std::cout << "  - bvh_comparison.png   (左:BVH, 右:暴力 对比图)\n";
     std::cout << "  - bvh_visualization.png (BVH包围盒结构可视化)\n";
     std::cout << "  - bvh_output.png        (高质量最终渲染)\n";
+    std::cout << "  - bvh_output.pfm        (同一渲染的线性 HDR 输出)\n";
+    if (instr::ENABLED) std::cout << "  - bvh_heatmap.png       (每 tile 遍历代价热力图)\n";
+    std::cout << "  - bvh_progressive.png   (自适应采样渲染)\n";
+    if (mesh_ok) std::cout << "  - bvh_mesh_output.png   (OBJ 网格 + 球体)\n";
     
     return 0;
 }
@@ -0,0 +1,247 @@
+// frame_output.h - 动画序列的异步帧输出管线
+//
+// 模拟线程 submit() 一帧后立即返回继续下一帧，后台编码线程负责压缩写盘：
+//   - 有界环形缓冲：最多 capacity 帧在途，满了 submit() 才阻塞（背压，内存不会无限增长）
+//   - 编码线程池：PNG 压缩是纯 CPU 工作，多线程并行编码
+//   - 可选 PPM 格式：不压缩、一次 fwrite，适合当作中间结果
+//   - 每帧写完（而不是入队）时才报告结果：失败总会打到 stderr，set_print_saved(true) 时成功的也打印
+//
+// 依赖 stb_image_write：包含本文件前先 #include "stb_image_write.h"
+// （各 demo 目录自带一份，由调用方负责 STB_IMAGE_WRITE_IMPLEMENTATION）
+
+#pragma once
+
+#ifndef INCLUDE_STB_IMAGE_WRITE_H
+#error "frame_output.h 需要先包含 stb_image_write.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "perf.h"
+
+namespace frame_output {
+
+enum class Format { PNG, PPM };
+
+inline const char* extension(Format format) {
+    return format == Format::PNG ? ".png" : ".ppm";
+}
+
+// 实际写出的格式：PPM 只支持 RGB，灰度/带 alpha 的帧退回 PNG
+inline Format written_format(Format format, int channels) {
+    return channels == 3 ? format : Format::PNG;
+}
+
+// 同步写一帧，返回是否成功。path 的扩展名应与 written_format(format, channels) 一致
+inline bool write_image(const std::string& path, Format format, int width, int height, int channels,
+                        const unsigned char* pixels) {
+    PERF_ZONE("frame_output.write");
+    if (written_format(format, channels) == Format::PNG) {
+        return stbi_write_png(path.c_str(), width, height, channels, pixels, width * channels) != 0;
+    }
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    std::fprintf(f, "P6\n%d %d\n255\n", width, height);
+    size_t bytes = size_t(width) * height * 3;
+    bool ok = std::fwrite(pixels, 1, bytes, f) == bytes;
+    return std::fclose(f) == 0 && ok;
+}
+
+struct Stats {
+    int frames = 0;
+    int failed = 0;
+    double encode_ms = 0;  // 编码线程累计耗时
+    double stall_ms = 0;   // submit() 因缓冲满而阻塞的累计时间
+};
+
+class FrameWriter {
+public:
+    // threads = 0 时 submit() 内同步编码，用于对比
+    explicit FrameWriter(Format format = Format::PNG, int threads = default_threads(), int capacity = 4)
+        : format_(format), threads_(std::max(0, threads)), capacity_(std::max(1, capacity)) {
+        for (int i = 0; i < threads_; i++) workers_.emplace_back([this] { worker(); });
+    }
+
+    ~FrameWriter() { finish(); }
+
+    FrameWriter(const FrameWriter&) = delete;
+    FrameWriter& operator=(const FrameWriter&) = delete;
+
+    static int default_threads() {
+        int n = int(std::thread::hardware_concurrency());
+        return std::max(1, std::min(4, n - 1));
+    }
+
+    // 写完一帧后打印 "Saved: 文件名"（异步时由编码线程打印，顺序是完成顺序）
+    void set_print_saved(bool on) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        print_saved_ = on;
+    }
+
+    // stem 不含扩展名，按实际写出的格式追加（PPM 下非 RGB 帧写成 .png）；
+    // 返回将要写出的文件名（异步时此刻还没写完）。像素被拷贝，调用方可立即复用缓冲
+    std::string submit(const std::string& stem, int width, int height, int channels,
+                       const unsigned char* pixels) {
+        std::string path = stem + extension(written_format(format_, channels));
+        size_t bytes = size_t(width) * height * channels;
+
+        if (workers_.empty()) {
+            auto t0 = Clock::now();
+            bool ok = write_image(path, format_, width, height, channels, pixels);
+            std::lock_guard<std::mutex> lock(mutex_);
+            record(path, ok, ms_since(t0));
+            return path;
+        }
+
+        Job job;
+        {
+            auto t0 = Clock::now();
+            std::unique_lock<std::mutex> lock(mutex_);
+            slot_free_.wait(lock, [this] { return in_flight_ < capacity_; });
+            stats_.stall_ms += ms_since(t0);
+            in_flight_++;
+            // 回收已编码完成帧的缓冲，稳态下不再分配
+            if (!free_buffers_.empty()) {
+                job.pixels = std::move(free_buffers_.back());
+                free_buffers_.pop_back();
+            }
+        }
+        job.path = path;
+        job.width = width;
+        job.height = height;
+        job.channels = channels;
+        job.pixels.resize(bytes);
+        std::memcpy(job.pixels.data(), pixels, bytes);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(std::move(job));
+        }
+        job_ready_.notify_one();
+        return path;
+    }
+
+    // 等待所有在途帧写完并停止编码线程；之后不能再 submit()
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) return;
+            stopping_ = true;
+        }
+        job_ready_.notify_all();
+        for (auto& t : workers_) t.join();
+        workers_.clear();
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    void print_stats(const char* label) const {
+        Stats s = stats();
+        std::printf("%s: %d 帧 (%s, %d 编码线程), 编码累计 %.0f ms, 模拟线程阻塞 %.0f ms%s\n",
+                    label, s.frames, format_ == Format::PNG ? "PNG" : "PPM", threads_,
+                    s.encode_ms, s.stall_ms, s.failed ? ", 有写入失败" : "");
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Job {
+        std::string path;
+        int width = 0, height = 0, channels = 0;
+        std::vector<unsigned char> pixels;
+    };
+
+    static double ms_since(Clock::time_point t0) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+    }
+
+    // 调用方持有锁（同时保证多线程打印不交错）
+    void record(const std::string& path, bool ok, double ms) {
+        stats_.frames++;
+        stats_.encode_ms += ms;
+        if (!ok) {
+            stats_.failed++;
+            std::fprintf(stderr, "写入失败: %s\n", path.c_str());
+        } else if (print_saved_) {
+            std::printf("Saved: %s\n", path.c_str());
+        }
+    }
+
+    void worker() {
+        for (;;) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                job_ready_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+                if (queue_.empty()) return;  // stopping_ 且队列已清空
+                job = std::move(queue_.front());
+                queue_.pop_front();
+            }
+
+            auto t0 = Clock::now();
+            bool ok = write_image(job.path, format_, job.width, job.height, job.channels, job.pixels.data());
+            double ms = ms_since(t0);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                record(job.path, ok, ms);
+                free_buffers_.push_back(std::move(job.pixels));
+                in_flight_--;
+            }
+            slot_free_.notify_one();
+        }
+    }
+
+    Format format_;
+    int threads_;
+    int capacity_;
+    int in_flight_ = 0;
+    bool stopping_ = false;
+    bool print_saved_ = false;
+    std::deque<Job> queue_;
+    std::vector<std::vector<unsigned char>> free_buffers_;
+    std::vector<std::thread> workers_;
+    mutable std::mutex mutex_;
+    std::condition_variable job_ready_, slot_free_;
+    Stats stats_;
+};
+
+// 三个 demo 共用的命令行解析：--ppm 输出 PPM，--sync 同步编码（对比用），--threads N
+struct Options {
+    Format format = Format::PNG;
+    int threads = FrameWriter::default_threads();
+    int every = 0;  // 各 demo 自定义的保存间隔（0 = 使用 demo 默认值）
+
+    // 未识别的参数返回 false
+    bool parse(int argc, char** argv) {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--ppm") format = Format::PPM;
+            else if (arg == "--png") format = Format::PNG;
+            else if (arg == "--sync") threads = 0;
+            else if (arg == "--threads" && i + 1 < argc) threads = std::max(0, std::atoi(argv[++i]));
+            else if (arg == "--every" && i + 1 < argc) every = std::max(1, std::atoi(argv[++i]));
+            else return false;
+        }
+        return true;
+    }
+
+    static void usage(const char* prog) {
+        std::fprintf(stderr, "用法: %s [--png | --ppm] [--sync | --threads N] [--every N]\n", prog);
+    }
+};
+
+}  // namespace frame_output
@@ -0,0 +1,378 @@
+// perf.h - 各 demo 共用的性能埋点：作用域计时、计数器、内存采样、Chrome trace / JSON 汇总导出
+//
+//   perf::Session session("bvh_tracer");  // main 开头；析构时按环境变量导出
+//   PERF_ZONE("bvh.render");              // 作用域计时：次数、累计/最小/最大耗时
+//   PERF_COUNT("bvh.rays", n);            // 累加计数器（热循环里请按块累加后再调用一次）
+//   perf::sample_memory();                // 记一次当前 RSS，trace 里显示为曲线；峰值 RSS 总会导出
+//
+// 导出由环境变量控制，不改各 demo 的命令行：
+//   PERF_SUMMARY=out.json  汇总 JSON（scripts/perf_regress.py 读取、与基线比较）
+//   PERF_TRACE=trace.json  Chrome trace，用 chrome://tracing 或 ui.perfetto.dev 打开
+//   PERF_PRINT=1           退出时把汇总表打到 stderr
+//
+// 每个 PERF_ZONE / PERF_COUNT 调用点有一个静态的 Site / Counter，首次执行时注册，之后只是几次
+// relaxed 原子操作。多线程里的同名 zone 累计的是各线程耗时之和。trace 事件只在设置了 PERF_TRACE
+// 时记录，写到线程私有缓冲（每个缓冲上限 kMaxEvents，超出丢弃并计数）。线程退出时缓冲还给注册表，
+// 之后新建的线程接着用，所以每帧新开线程的 demo 缓冲数也只等于同时存在的线程数。
+// -DPERF_ENABLED=0 编译时宏展开为空，Session 和采样函数什么也不做。
+
+#pragma once
+
+#ifndef PERF_ENABLED
+#define PERF_ENABLED 1
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace perf {
+
+// ========== 内存 ==========
+
+// 进程峰值常驻内存（KB）；不支持的平台返回 0
+inline long peak_rss_kb() {
+#if defined(__APPLE__)
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss / 1024 : 0;  // macOS 单位是字节
+#elif defined(__unix__)
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+#else
+    return 0;
+#endif
+}
+
+// 当前常驻内存（KB），读 /proc/self/statm；其他平台返回 0
+inline long current_rss_kb() {
+#if defined(__linux__)
+    long pages = 0, resident = 0;
+    FILE* f = std::fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    int n = std::fscanf(f, "%ld %ld", &pages, &resident);
+    std::fclose(f);
+    return n == 2 ? resident * (sysconf(_SC_PAGESIZE) / 1024) : 0;
+#else
+    return 0;
+#endif
+}
+
+// ========== 注册表 ==========
+
+inline uint64_t now_ns() {
+    static const auto origin = std::chrono::steady_clock::now();
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin)
+        .count();
+}
+
+struct Site;
+struct Counter;
+
+struct Event {
+    const char* name;
+    uint64_t start_ns;
+    uint64_t dur_ns;   // 计数事件不用
+    long value;        // 计数事件的值（RSS KB）；区间事件为 -1
+};
+
+struct ThreadBuffer {
+    int tid;
+    std::vector<Event> events;
+    uint64_t dropped = 0;
+};
+
+constexpr size_t kMaxEvents = 1 << 20;
+
+class Registry {
+public:
+    static Registry& instance() {
+        static Registry registry;
+        return registry;
+    }
+
+    std::atomic<bool> tracing{false};
+
+    void add(Site* site) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sites_.push_back(site);
+    }
+    void add(Counter* counter) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        counters_.push_back(counter);
+    }
+
+    // 当前线程的 trace 缓冲。缓冲始终归注册表所有：线程退出时放回空闲列表（事件保留，导出时还能读到），
+    // 下一个新线程优先复用它，trace 里就是同一条轨道上前后不重叠的两段
+    ThreadBuffer& thread_buffer() {
+        struct Lease {
+            ThreadBuffer* buffer = nullptr;
+            ~Lease() {
+                if (buffer) Registry::instance().release(buffer);
+            }
+        };
+        thread_local Lease lease;
+        if (!lease.buffer) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!free_.empty()) {
+                lease.buffer = free_.back();
+                free_.pop_back();
+            } else {
+                buffers_.push_back(std::make_unique<ThreadBuffer>());
+                lease.buffer = buffers_.back().get();
+                lease.buffer->tid = (int)buffers_.size();
+            }
+        }
+        return *lease.buffer;
+    }
+
+    void record(const Event& e) {
+        ThreadBuffer& b = thread_buffer();
+        if (b.events.size() < kMaxEvents) b.events.push_back(e);
+        else b.dropped++;
+    }
+
+    // 导出时调用（所有工作线程应已结束）
+    template <typename Fn>
+    void visit(Fn&& fn) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fn(sites_, counters_, buffers_);
+    }
+
+private:
+    void release(ThreadBuffer* buffer) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.push_back(buffer);
+    }
+
+    std::mutex mutex_;
+    std::vector<Site*> sites_;
+    std::vector<Counter*> counters_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+    std::vector<ThreadBuffer*> free_;  // 所属线程已退出、可复用的缓冲
+};
+
+// 一个计时调用点的累计值
+struct Site {
+    const char* name;
+    std::atomic<uint64_t> count{0}, total_ns{0}, min_ns{UINT64_MAX}, max_ns{0};
+
+    explicit Site(const char* n) : name(n) { Registry::instance().add(this); }
+
+    void add(uint64_t ns) {
+        count.fetch_add(1, std::memory_order_relaxed);
+        total_ns.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t cur = min_ns.load(std::memory_order_relaxed);
+        while (ns < cur && !min_ns.compare_exchange_weak(cur, ns, std::memory_order_relaxed)) {}
+        cur = max_ns.load(std::memory_order_relaxed);
+        while (ns > cur && !max_ns.compare_exchange_weak(cur, ns, std::memory_order_relaxed)) {}
+    }
+};
+
+struct Counter {
+    const char* name;
+    std::atomic<uint64_t> value{0};
+
+    explicit Counter(const char* n) : name(n) { Registry::instance().add(this); }
+
+    void add(uint64_t n) { value.fetch_add(n, std::memory_order_relaxed); }
+};
+
+class Zone {
+public:
+    explicit Zone(Site& site) : site_(site), start_(now_ns()) {}
+    ~Zone() {
+        uint64_t end = now_ns();
+        site_.add(end - start_);
+        if (Registry::instance().tracing.load(std::memory_order_relaxed)) {
+            Registry::instance().record({site_.name, start_, end - start_, -1});
+        }
+    }
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+
+private:
+    Site& site_;
+    uint64_t start_;
+};
+
+inline void sample_memory() {
+#if PERF_ENABLED
+    Registry& r = Registry::instance();
+    if (r.tracing.load(std::memory_order_relaxed)) r.record({"rss_kb", now_ns(), 0, current_rss_kb()});
+#endif
+}
+
+// ========== 导出 ==========
+
+inline void write_json_string(FILE* f, const char* s) {
+    std::fputc('"', f);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') std::fprintf(f, "\\%c", c);
+        else if (c < 0x20) std::fprintf(f, "\\u%04x", c);
+        else std::fputc(c, f);  // UTF-8 原样输出
+    }
+    std::fputc('"', f);
+}
+
+// 汇总：每个 zone 的次数与耗时、计数器、峰值内存。同名的多个调用点合并
+inline bool write_summary(const std::string& path, const std::string& project) {
+    FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+    struct ZoneTotal { std::string name; uint64_t count = 0, total = 0, min = UINT64_MAX, max = 0; };
+    std::vector<ZoneTotal> zones;
+    std::vector<std::pair<std::string, uint64_t>> counters;
+    Registry::instance().visit([&](const std::vector<Site*>& sites, const std::vector<Counter*>& cs,
+                                   const std::vector<std::unique_ptr<ThreadBuffer>>&) {
+        for (const Site* s : sites) {
+            auto it = std::find_if(zones.begin(), zones.end(), [&](const ZoneTotal& z) { return z.name == s->name; });
+            if (it == zones.end()) it = zones.insert(zones.end(), ZoneTotal{s->name});
+            it->count += s->count.load();
+            it->total += s->total_ns.load();
+            it->min = std::min(it->min, s->min_ns.load());
+            it->max = std::max(it->max, s->max_ns.load());
+        }
+        for (const Counter* c : cs) {
+            auto it = std::find_if(counters.begin(), counters.end(), [&](const auto& p) { return p.first == c->name; });
+            if (it == counters.end()) counters.push_back({c->name, c->value.load()});
+            else it->second += c->value.load();
+        }
+    });
+    std::sort(zones.begin(), zones.end(), [](const ZoneTotal& a, const ZoneTotal& b) { return a.name < b.name; });
+    std::sort(counters.begin(), counters.end());
+
+    std::fprintf(f, "{\n  \"project\": ");
+    write_json_string(f, project.c_str());
+    std::fprintf(f, ",\n  \"timestamp\": %lld,\n  \"wall_ms\": %.3f,\n  \"peak_rss_kb\": %ld,\n  \"zones\": {",
+                 (long long)std::time(nullptr), now_ns() * 1e-6, peak_rss_kb());
+    for (size_t i = 0; i < zones.size(); i++) {
+        const ZoneTotal& z = zones[i];
+        std::fprintf(f, "%s\n    ", i ? "," : "");
+        write_json_string(f, z.name.c_str());
+        std::fprintf(f, ": {\"count\": %llu, \"total_ms\": %.3f, \"mean_ms\": %.4f, \"min_ms\": %.4f, \"max_ms\": %.4f}",
+                     (unsigned long long)z.count, z.total * 1e-6, z.count ? z.total * 1e-6 / z.count : 0.0,
+                     z.count ? z.min * 1e-6 : 0.0, z.max * 1e-6);
+    }
+    std::fprintf(f, "%s},\n  \"counters\": {", zones.empty() ? "" : "\n  ");
+    for (size_t i = 0; i < counters.size(); i++) {
+        std::fprintf(f, "%s\n    ", i ? "," : "");
+        write_json_string(f, counters[i].first.c_str());
+        std::fprintf(f, ": %llu", (unsigned long long)counters[i].second);
+    }
+    std::fprintf(f, "%s}\n}\n", counters.empty() ? "" : "\n  ");
+    return std::fclose(f) == 0;
+}
+
+// Chrome trace 事件格式：区间为 "X"（完整事件），内存为 "C"（计数曲线），时间单位微秒
+inline bool write_chrome_trace(const std::string& path) {
+    FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+    std::fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    bool first = true;
+    uint64_t dropped = 0;
+    Registry::instance().visit([&](const std::vector<Site*>&, const std::vector<Counter*>&,
+                                   const std::vector<std::unique_ptr<ThreadBuffer>>& buffers) {
+        for (const auto& b : buffers) {
+            dropped += b->dropped;
+            std::fprintf(f, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+                         "\"args\": {\"name\": \"thread %d\"}}", first ? "" : ",\n", b->tid, b->tid);
+            first = false;
+            for (const Event& e : b->events) {
+                std::fprintf(f, ",\n{\"name\": ");
+                write_json_string(f, e.name);
+                if (e.value < 0) {
+                    std::fprintf(f, ", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}", b->tid,
+                                 e.start_ns * 1e-3, e.dur_ns * 1e-3);
+                } else {
+                    std::fprintf(f, ", \"ph\": \"C\", \"pid\": 1, \"ts\": %.3f, \"args\": {\"kb\": %ld}}",
+                                 e.start_ns * 1e-3, e.value);
+                }
+            }
+        }
+    });
+    std::fprintf(f, "\n]}\n");
+    if (dropped) std::fprintf(stderr, "perf: trace 缓冲已满，丢弃 %llu 个事件\n", (unsigned long long)dropped);
+    return std::fclose(f) == 0;
+}
+
+inline void print_summary(FILE* out) {
+    Registry::instance().visit([&](const std::vector<Site*>& sites, const std::vector<Counter*>& counters,
+                                   const std::vector<std::unique_ptr<ThreadBuffer>>&) {
+        std::fprintf(out, "%-32s %10s %12s %12s %12s\n", "zone", "次数", "累计 ms", "平均 ms", "最大 ms");
+        for (const Site* s : sites) {
+            uint64_t n = s->count.load();
+            if (!n) continue;
+            std::fprintf(out, "%-32s %10llu %12.3f %12.4f %12.4f\n", s->name, (unsigned long long)n,
+                         s->total_ns.load() * 1e-6, s->total_ns.load() * 1e-6 / n, s->max_ns.load() * 1e-6);
+        }
+        for (const Counter* c : counters) {
+            std::fprintf(out, "%-32s %10llu\n", c->name, (unsigned long long)c->value.load());
+        }
+    });
+    std::fprintf(out, "峰值 RSS: %ld KB\n", peak_rss_kb());
+}
+
+// main 开头构造一个：记下起点，析构（main 返回）时按环境变量导出
+class Session {
+public:
+    explicit Session(std::string project) : project_(std::move(project)) {
+#if PERF_ENABLED
+        now_ns();  // 固定时间原点
+        if (const char* trace = std::getenv("PERF_TRACE")) {
+            trace_ = trace;
+            Registry::instance().tracing = true;
+        }
+        sample_memory();
+#endif
+    }
+
+    ~Session() {
+#if PERF_ENABLED
+        sample_memory();
+        if (const char* summary = std::getenv("PERF_SUMMARY")) {
+            if (!write_summary(summary, project_)) std::fprintf(stderr, "perf: 无法写入 %s\n", summary);
+        }
+        if (!trace_.empty() && !write_chrome_trace(trace_)) std::fprintf(stderr, "perf: 无法写入 %s\n", trace_.c_str());
+        if (std::getenv("PERF_PRINT")) print_summary(stderr);
+#endif
+    }
+
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+
+private:
+    std::string project_;
+    std::string trace_;
+};
+
+}  // namespace perf
+
+#define PERF_CONCAT_(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_(a, b)
+
+#if PERF_ENABLED
+#define PERF_ZONE(name)                                               \
+    static perf::Site PERF_CONCAT(perf_site_, __LINE__){name};        \
+    perf::Zone PERF_CONCAT(perf_zone_, __LINE__) { PERF_CONCAT(perf_site_, __LINE__) }
+#define PERF_COUNT(name, n)                                           \
+    do {                                                              \
+        static perf::Counter perf_counter_{name};                     \
+        perf_counter_.add((uint64_t)(n));                             \
+    } while (0)
+#else
+#define PERF_ZONE(name) ((void)0)
+#define PERF_COUNT(name, n) ((void)sizeof(n))  // 不求值，只避免参数未使用的警告
+#endif
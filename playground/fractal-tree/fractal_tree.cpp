@@ -4,6 +4,13 @@
 #include <vector>
 #include <random>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
 
 const double PI = 3.14159265358979323846;
 
@@ -147,89 +154,419 @@ void drawRandomTree(Canvas& canvas, double x, double y, double length, double an
     }
 }
 
-int main() {
-    std::random_device rd;
-    std::mt19937 rng(42);  // 固定种子以便重现
-    
+// ========== 两阶段管线：生成图元 → 批量光栅化 ==========
+// 第一阶段只生成图元（树枝线段、叶子圆）到扁平的 SoA 缓冲，不碰画布；
+// 随机数不再来自共享的 mt19937，而是由"种子 + 树枝路径"哈希出来的计数器式 RNG，
+// 所以任意子树都可以在任意线程、以任意顺序生成，结果完全确定。
+// 第二阶段按生成顺序（与递归画法相同的先序）一次画完，可以按画布行带分给多个线程
+
+inline uint64_t splitmix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// 子节点路径 = 父路径与分支序号的哈希（深度不受限制）
+inline uint64_t childPath(uint64_t path, int child) { return splitmix64(path ^ (0x100000001b3ull * (child + 1))); }
+
+// 计数器式 RNG：第 k 个数是 hash(key, k)，不依赖任何调用顺序
+struct PathRng {
+    uint64_t key;
+    uint64_t counter = 0;
+
+    PathRng(uint64_t seed, uint64_t path) : key(splitmix64(seed ^ splitmix64(path))) {}
+
+    uint64_t next() { return splitmix64(key + 0xd1b54a32d192ed03ull * ++counter); }
+    double uniform(double lo, double hi) { return lo + (hi - lo) * ((next() >> 11) * (1.0 / 9007199254740992.0)); }
+    int uniformInt(int lo, int hi) { return lo + (int)(next() % (uint64_t)(hi - lo + 1)); }
+};
+
+inline uint32_t packColor(Color c) { return c.r | (c.g << 8) | (c.b << 16); }
+inline Color unpackColor(uint32_t c) { return Color(c & 255, (c >> 8) & 255, (c >> 16) & 255); }
+
+// 图元缓冲（SoA）。kind: 线段 (x0,y0)-(x1,y1) 粗 size；圆心 (x0,y0) 半径 size；
+// 子批次占位（x0 = 子批次下标），光栅化时在这个位置展开，保持先序
+struct PrimitiveBatch {
+    enum Kind : uint8_t { Line, Circle, Sub };
+    std::vector<uint8_t> kind;
+    std::vector<int> x0, y0, x1, y1;
+    std::vector<int> size;
+    std::vector<uint32_t> color;
+    int minY = INT32_MAX, maxY = INT32_MIN;  // 本批次线段/圆覆盖的行范围（不含子批次），光栅化时整批跳过
+
+    size_t count() const { return kind.size(); }
+
+    void push(Kind k, int ax, int ay, int bx, int by, int sz, uint32_t c) {
+        if (k == Line) {
+            minY = std::min(minY, std::min(ay, by) - sz / 2);
+            maxY = std::max(maxY, std::max(ay, by) + sz / 2);
+        } else if (k == Circle) {
+            minY = std::min(minY, ay - sz);
+            maxY = std::max(maxY, ay + sz);
+        }
+        kind.push_back(k);
+        x0.push_back(ax);
+        y0.push_back(ay);
+        x1.push_back(bx);
+        y1.push_back(by);
+        size.push_back(sz);
+        color.push_back(c);
+    }
+    void line(int ax, int ay, int bx, int by, int thickness, Color c) { push(Line, ax, ay, bx, by, thickness, packColor(c)); }
+    void circle(int cx, int cy, int radius, Color c) { push(Circle, cx, cy, 0, 0, radius, packColor(c)); }
+    void sub(int index) { push(Sub, index, 0, 0, 0, 0, 0); }
+};
+
+// 树的样式参数：symmetric = drawTree 的对称二叉树，否则是 drawRandomTree 的随机多分支树
+struct TreeSpec {
+    bool symmetric = true;
+    double branchAngle = PI / 6;
+    double scaleFactor = 0.75;
+    bool addLeaves = false;
+    Color leafColor = Color(0, 200, 0);
+    uint64_t seed = 42;
+};
+
+// 一个待生长的节点（也是可以单独交给某个线程的子树）
+struct TreeNode {
+    double x, y, length, angle;
+    int depth;
+    uint64_t path;
+};
+
+// 生成一棵（子）树的图元。splitDepth > 0 时，剩余深度等于 splitDepth 的节点不展开，
+// 记进 tasks 并在缓冲里留一个占位，之后并行生成
+void growTree(const TreeSpec& spec, const TreeNode& n, PrimitiveBatch& out, int splitDepth = 0,
+              std::vector<TreeNode>* tasks = nullptr) {
+    if (tasks && n.depth == splitDepth && n.depth > 0) {
+        out.sub((int)tasks->size());
+        tasks->push_back(n);
+        return;
+    }
+    PathRng rng(spec.seed, n.path);
+    if (n.depth == 0) {
+        if (spec.symmetric) {
+            if (spec.addLeaves) out.circle((int)n.x, (int)n.y, 3 + (int)(rng.next() % 3), spec.leafColor);
+        } else {
+            static const Color leafColors[] = {Color(34, 139, 34), Color(0, 200, 0), Color(50, 205, 50)};
+            out.circle((int)n.x, (int)n.y, 3, leafColors[rng.uniformInt(0, 2)]);
+        }
+        return;
+    }
+
+    double endX = n.x + n.length * cos(n.angle);
+    double endY = n.y - n.length * sin(n.angle);
+    int thickness = std::max(1, n.depth / 2);
+
+    if (spec.symmetric) {
+        int brown = std::max(50, std::min(139, 139 - (12 - n.depth) * 10));
+        out.line((int)n.x, (int)n.y, (int)endX, (int)endY, thickness, Color(brown, brown / 2, 0));
+        double len = n.length * spec.scaleFactor;
+        growTree(spec, {endX, endY, len, n.angle + spec.branchAngle, n.depth - 1, childPath(n.path, 0)}, out,
+                 splitDepth, tasks);
+        growTree(spec, {endX, endY, len, n.angle - spec.branchAngle, n.depth - 1, childPath(n.path, 1)}, out,
+                 splitDepth, tasks);
+    } else {
+        int brown = std::max(40, std::min(120, 100 - (10 - n.depth) * 8));
+        out.line((int)n.x, (int)n.y, (int)endX, (int)endY, thickness, Color(brown, brown / 2, 10));
+        int numBranches = rng.uniformInt(2, 3);
+        for (int i = 0; i < numBranches; i++) {
+            double newAngle = n.angle + (i - numBranches / 2.0) * rng.uniform(0.3, 0.6);
+            double len = n.length * rng.uniform(0.65, 0.8);
+            growTree(spec, {endX, endY, len, newAngle, n.depth - 1, childPath(n.path, i)}, out, splitDepth, tasks);
+        }
+    }
+}
+
+int defaultThreads() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// 用原子计数器把 [0, count) 分给多个线程
+template <typename Fn>
+void parallelFor(int count, int threads, Fn&& fn) {
+    std::atomic<int> next{0};
+    auto worker = [&] {
+        for (int i; (i = next.fetch_add(1)) < count;) fn(i);
+    };
+    threads = std::max(1, std::min(threads, count));
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+}
+
+// 一幅场景的全部图元：根批次 + 若干子批次（根批次里的占位按下标引用）
+struct Scene {
+    PrimitiveBatch root;
+    std::vector<PrimitiveBatch> subs;
+
+    size_t primitives() const {
+        size_t n = root.count();
+        for (const PrimitiveBatch& b : subs) n += b.count();
+        return n;
+    }
+};
+
+// 一棵树：上面几层单线程展开，剩余深度为 splitDepth 的子树并行生成
+void buildTree(Scene& scene, const TreeSpec& spec, const TreeNode& rootNode, int threads, int splitDepth) {
+    std::vector<TreeNode> tasks;
+    size_t base = scene.subs.size();
+    PrimitiveBatch top;
+    growTree(spec, rootNode, top, splitDepth, &tasks);
+    scene.subs.resize(base + tasks.size());
+    parallelFor((int)tasks.size(), threads, [&](int i) { growTree(spec, tasks[i], scene.subs[base + i]); });
+    // 占位下标换成场景里的全局下标，再接到根批次后面
+    for (size_t i = 0; i < top.count(); i++) {
+        if (top.kind[i] == PrimitiveBatch::Sub) top.x0[i] += (int)base;
+        scene.root.push((PrimitiveBatch::Kind)top.kind[i], top.x0[i], top.y0[i], top.x1[i], top.y1[i], top.size[i],
+                        top.color[i]);
+    }
+}
+
+// 森林：每棵树一个任务（各自的种子路径），绘制顺序按树的编号，与线程数无关
+struct ForestTree {
+    TreeSpec spec;
+    TreeNode root;
+};
+
+void buildForest(Scene& scene, const std::vector<ForestTree>& trees, int threads) {
+    size_t base = scene.subs.size();
+    scene.subs.resize(base + trees.size());
+    parallelFor((int)trees.size(), threads, [&](int i) { growTree(trees[i].spec, trees[i].root, scene.subs[base + i]); });
+    for (size_t i = 0; i < trees.size(); i++) scene.root.sub((int)(base + i));
+}
+
+// 只在 [bandY0, bandY1) 的行内写像素，其余与 Canvas::setPixel 相同
+struct BandCanvas {
+    Canvas& canvas;
+    int bandY0, bandY1;
+
+    void setPixel(int x, int y, uint32_t c) {
+        if (x < 0 || x >= canvas.width || y < bandY0 || y >= bandY1) return;
+        unsigned char* p = &canvas.pixels[((size_t)y * canvas.width + x) * 3];
+        p[0] = c & 255;
+        p[1] = (c >> 8) & 255;
+        p[2] = (c >> 16) & 255;
+    }
+
+    // 与 Canvas::drawLine 相同的 Bresenham 步进
+    void drawLine(int x0, int y0, int x1, int y1, uint32_t c, int thickness) {
+        int half = thickness / 2;
+        if (std::max(y0, y1) + half < bandY0 || std::min(y0, y1) - half >= bandY1) return;
+        int dx = abs(x1 - x0);
+        int dy = abs(y1 - y0);
+        int sx = (x0 < x1) ? 1 : -1;
+        int sy = (y0 < y1) ? 1 : -1;
+        int err = dx - dy;
+        while (true) {
+            if (y0 + half >= bandY0 && y0 - half < bandY1)
+                for (int oy = -half; oy <= half; oy++)
+                    for (int ox = -half; ox <= half; ox++) setPixel(x0 + ox, y0 + oy, c);
+            if (x0 == x1 && y0 == y1) break;
+            int e2 = 2 * err;
+            if (e2 > -dy) { err -= dy; x0 += sx; }
+            if (e2 < dx) { err += dx; y0 += sy; }
+        }
+    }
+
+    void drawCircle(int cx, int cy, int radius, uint32_t c) {
+        for (int y = std::max(-radius, bandY0 - cy); y <= radius && cy + y < bandY1; y++)
+            for (int x = -radius; x <= radius; x++)
+                if (x * x + y * y <= radius * radius) setPixel(cx + x, cy + y, c);
+    }
+
+    void draw(const Scene& scene, const PrimitiveBatch& b) {
+        bool bodyVisible = b.maxY >= bandY0 && b.minY < bandY1;
+        for (size_t i = 0; i < b.count(); i++) {
+            if (!bodyVisible && b.kind[i] != PrimitiveBatch::Sub) continue;
+            switch (b.kind[i]) {
+                case PrimitiveBatch::Line: drawLine(b.x0[i], b.y0[i], b.x1[i], b.y1[i], b.color[i], b.size[i]); break;
+                case PrimitiveBatch::Circle: drawCircle(b.x0[i], b.y0[i], b.size[i], b.color[i]); break;
+                case PrimitiveBatch::Sub: draw(scene, scene.subs[b.x0[i]]); break;
+            }
+        }
+    }
+};
+
+// 第二阶段：画布按行带分给多个线程，每个线程按完整的先序把所有图元画进自己的行带。
+// 行带互不重叠、带内顺序与单线程相同，结果与线程数无关
+void rasterize(Canvas& canvas, const Scene& scene, int threads) {
+    // 单线程时整张画布一个条带，省掉每条线段在多个条带里重复走 Bresenham
+    const int kBand = threads > 1 ? 32 : canvas.height;
+    int bands = (canvas.height + kBand - 1) / kBand;
+    parallelFor(bands, threads, [&](int b) {
+        BandCanvas band{canvas, b * kBand, std::min(canvas.height, (b + 1) * kBand)};
+        band.draw(scene, scene.root);
+    });
+}
+
+// ========== 演示与基准 ==========
+
+using Clock = std::chrono::steady_clock;
+
+static double msSince(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+// 森林：树根沿地平线附近随机分布，远处（靠上）的树小、先画
+std::vector<ForestTree> makeForest(int count, int width, int height, uint64_t seed) {
+    std::vector<ForestTree> trees(count);
+    for (int i = 0; i < count; i++) {
+        PathRng rng(seed, 0x466f72657374ull + i);
+        double y = rng.uniform(height * 0.45, height - 10.0);
+        double near = (y - height * 0.45) / (height * 0.55);  // 0 远 .. 1 近
+        trees[i].spec.symmetric = false;
+        trees[i].spec.seed = seed + i;
+        trees[i].root = {rng.uniform(0, width), y, 12 + 40 * near, PI / 2 + rng.uniform(-0.15, 0.15),
+                         5 + (int)(3 * near), 0};
+    }
+    std::sort(trees.begin(), trees.end(), [](const ForestTree& a, const ForestTree& b) { return a.root.y < b.root.y; });
+    return trees;
+}
+
+static void runBenchmark(int treeCount, int threads) {
+    const int W = 1600, H = 900;
+    std::vector<ForestTree> trees = makeForest(treeCount, W, H, 7);
+
+    // 原版：递归边生成边画，所有树共用一个 mt19937
+    Canvas direct(W, H, Color(135, 206, 235));
+    std::mt19937 rng(7);
+    auto t0 = Clock::now();
+    for (const ForestTree& t : trees)
+        drawRandomTree(direct, t.root.x, t.root.y, t.root.length, t.root.angle, t.root.depth, rng);
+    double directMs = msSince(t0);
+
+    printf("森林 %d 棵树 %dx%d\n", treeCount, W, H);
+    printf("原版递归绘制（共享 mt19937）: %.1f ms\n", directMs);
+    std::vector<unsigned char> reference;
+    for (int n : {1, threads}) {
+        Scene scene;
+        t0 = Clock::now();
+        buildForest(scene, trees, n);
+        double genMs = msSince(t0);
+        Canvas canvas(W, H, Color(135, 206, 235));
+        t0 = Clock::now();
+        rasterize(canvas, scene, n);
+        double rasterMs = msSince(t0);
+        if (reference.empty()) reference = canvas.pixels;
+        printf("两阶段 %d 线程: 生成 %.1f ms（%zu 个图元）+ 光栅化 %.1f ms，与 1 线程结果%s\n", n, genMs,
+               scene.primitives(), rasterMs, canvas.pixels == reference ? "一致" : "不一致");
+    }
+
+    // 对称树不用随机数，两阶段的结果应与 drawTree 逐像素相同；单棵大树按子树拆分
+    Canvas a(800, 800, Color(240, 248, 255)), b(800, 800, Color(240, 248, 255));
+    std::mt19937 unused(42);
+    t0 = Clock::now();
+    drawTree(a, 400, 750, 150, PI / 2, 16, PI / 6, 0.75, unused, false);
+    double treeDirectMs = msSince(t0);
+    Scene scene;
+    TreeSpec spec;
+    t0 = Clock::now();
+    buildTree(scene, spec, {400, 750, 150, PI / 2, 16, 0}, threads, 10);
+    rasterize(b, scene, threads);
+    double treePipeMs = msSince(t0);
+    printf("\n对称树 16 层: drawTree %.1f ms，两阶段（10 层以下的子树并行）%.1f ms，%zu 个子任务，结果%s\n",
+           treeDirectMs, treePipeMs, scene.subs.size(), a.pixels == b.pixels ? "一致" : "不一致");
+}
+
+int main(int argc, char** argv) {
+    int threads = defaultThreads();
+    int benchTrees = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            threads = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--bench")) {
+            benchTrees = 4000;
+            if (i + 1 < argc && argv[i + 1][0] != '-') benchTrees = std::max(1, atoi(argv[++i]));
+        } else {
+            fprintf(stderr, "用法: %s [--threads N] [--bench [树的数量]]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (benchTrees > 0) {
+        runBenchmark(benchTrees, threads);
+        return 0;
+    }
+
     const int W = 800, H = 800;
     
     // 1. 对称二叉树
     {
         Canvas canvas(W, H, Color(240, 248, 255));  // 淡蓝背景
-        double startX = W / 2;
-        double startY = H - 50;
-        double initialLength = 150;
-        double angle = PI / 2;  // 向上
-        int depth = 11;
-        double branchAngle = PI / 6;  // 30度
-        double scale = 0.75;
-        
-        drawTree(canvas, startX, startY, initialLength, angle, depth, 
-                branchAngle, scale, rng, false);
+        TreeSpec spec;
+        spec.branchAngle = PI / 6;  // 30度
+        spec.scaleFactor = 0.75;
+        Scene scene;
+        buildTree(scene, spec, {W / 2.0, H - 50.0, 150, PI / 2, 11, 0}, threads, 6);
+        rasterize(canvas, scene, threads);
         canvas.save("tree_symmetric.png");
     }
     
     // 2. 随机树
     {
         Canvas canvas(W, H, Color(135, 206, 235));  // 天蓝色
-        double startX = W / 2;
-        double startY = H - 50;
-        
-        drawRandomTree(canvas, startX, startY, 120, PI / 2, 9, rng);
+        TreeSpec spec;
+        spec.symmetric = false;
+        Scene scene;
+        buildTree(scene, spec, {W / 2.0, H - 50.0, 120, PI / 2, 9, 0}, threads, 5);
+        rasterize(canvas, scene, threads);
         canvas.save("tree_random.png");
     }
     
     // 3. 樱花树
     {
         Canvas canvas(W, H, Color(255, 240, 245));  // 淡粉背景
-        double startX = W / 2;
-        double startY = H - 50;
-        double initialLength = 140;
-        double angle = PI / 2;
-        int depth = 10;
-        double branchAngle = PI / 5;  // 36度
-        double scale = 0.72;
-        
-        Color cherryBlossomPink(255, 182, 193);
-        drawTree(canvas, startX, startY, initialLength, angle, depth, 
-                branchAngle, scale, rng, true, cherryBlossomPink);
+        TreeSpec spec;
+        spec.branchAngle = PI / 5;  // 36度
+        spec.scaleFactor = 0.72;
+        spec.addLeaves = true;
+        spec.leafColor = Color(255, 182, 193);
+        Scene scene;
+        buildTree(scene, spec, {W / 2.0, H - 50.0, 140, PI / 2, 10, 0}, threads, 5);
+        rasterize(canvas, scene, threads);
         canvas.save("tree_cherry.png");
     }
     
     // 4. 秋天树（橙黄叶子）
     {
         Canvas canvas(W, H, Color(255, 250, 240));  // 花白色
-        double startX = W / 2;
-        double startY = H - 50;
-        double initialLength = 130;
-        double angle = PI / 2;
-        int depth = 10;
-        double branchAngle = PI / 7;  // 约25度
-        double scale = 0.7;
+        TreeSpec spec;
+        spec.branchAngle = PI / 7;  // 约25度
+        spec.scaleFactor = 0.7;
+        Scene scene;
+        buildTree(scene, spec, {W / 2.0, H - 50.0, 130, PI / 2, 10, 0}, threads, 5);
         
         // 秋天的颜色
-        std::vector<Color> autumnColors = {
+        const Color autumnColors[] = {
             Color(255, 140, 0),   // 深橙
             Color(255, 165, 0),   // 橙色
             Color(255, 215, 0),   // 金色
             Color(218, 165, 32)   // 金棕色
         };
         
-        // 绘制主树
-        drawTree(canvas, startX, startY, initialLength, angle, depth, 
-                branchAngle, scale, rng, false);
-        
-        // 手动添加秋叶（在枝头随机位置）
-        std::uniform_int_distribution<> colorDist(0, 3);
+        // 手动添加秋叶（在枝头随机位置），每片叶子用自己的路径取随机数
         for (int i = 0; i < 150; i++) {
-            std::uniform_real_distribution<> xDist(W/2 - 200, W/2 + 200);
-            std::uniform_real_distribution<> yDist(100, H/2);
-            canvas.drawCircle((int)xDist(rng), (int)yDist(rng), 
-                            2 + rng() % 3, autumnColors[colorDist(rng)]);
+            PathRng rng(spec.seed, 0x6c656166ull + i);
+            double x = rng.uniform(W / 2 - 200, W / 2 + 200);
+            double y = rng.uniform(100, H / 2);
+            int radius = 2 + (int)(rng.next() % 3);
+            scene.root.circle((int)x, (int)y, radius, autumnColors[rng.uniformInt(0, 3)]);
         }
-        
+        rasterize(canvas, scene, threads);
         canvas.save("tree_autumn.png");
     }
     
+    // 5. 森林：2000 棵随机树，每棵树在自己的任务里生成
+    {
+        const int FW = 1600, FH = 900;
+        Canvas canvas(FW, FH, Color(135, 206, 235));
+        Scene scene;
+        buildForest(scene, makeForest(2000, FW, FH, 7), threads);
+        rasterize(canvas, scene, threads);
+        canvas.save("tree_forest.png");
+    }
+    
     return 0;
 }
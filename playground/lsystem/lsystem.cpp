@@ -4,7 +4,10 @@
 #include <vector>
 #include <cmath>
 #include <stack>
-#include <map>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
 
 const double PI = 3.14159265358979323846;
 
@@ -63,26 +66,35 @@ struct Canvas {
     }
 };
 
+// 规则表：下标就是符号本身（256 项），查规则不需要任何比较
+struct RuleTable {
+    std::string rhs[256];
+    bool has[256] = {};
+};
+
 // L-System 生成器
 class LSystem {
 public:
     std::string axiom;
-    std::map<char, std::string> rules;
+    RuleTable rules;
     
     LSystem(const std::string& ax) : axiom(ax) {}
     
     void addRule(char from, const std::string& to) {
-        rules[from] = to;
+        rules.rhs[(unsigned char)from] = to;
+        rules.has[(unsigned char)from] = true;
     }
     
-    std::string generate(int iterations) {
+    // 逐代重写出完整的字符串（长度随迭代次数指数增长）
+    std::string generate(int iterations) const {
         std::string current = axiom;
         
         for (int iter = 0; iter < iterations; iter++) {
-            std::string next = "";
+            std::string next;
             for (char c : current) {
-                if (rules.find(c) != rules.end()) {
-                    next += rules[c];
+                unsigned char u = (unsigned char)c;
+                if (rules.has[u]) {
+                    next += rules.rhs[u];
                 } else {
                     next += c;
                 }
@@ -92,6 +104,38 @@ public:
         
         return current;
     }
+    
+    // 流式展开：深度优先地把第 iterations 代的符号依次交给 emit，不生成中间字符串。
+    // 栈里每层只记录"正在展开哪条规则、读到第几个字符"，内存 O(iterations)；
+    // 输出顺序与 generate(iterations) 的字符串完全相同。返回输出的符号数
+    template <typename Emit>
+    size_t expand(int iterations, Emit&& emit) const {
+        struct Frame {
+            const char* p;
+            const char* end;
+        };
+        std::vector<Frame> stack;
+        stack.reserve(iterations + 1);
+        stack.push_back({axiom.data(), axiom.data() + axiom.size()});
+        size_t emitted = 0;
+        while (!stack.empty()) {
+            Frame& f = stack.back();
+            if (f.p == f.end) {
+                stack.pop_back();
+                continue;
+            }
+            unsigned char c = (unsigned char)*f.p++;
+            // stack.size() - 1 = 这个符号已经被重写过的次数
+            if ((int)stack.size() - 1 < iterations && rules.has[c]) {
+                const std::string& r = rules.rhs[c];
+                stack.push_back({r.data(), r.data() + r.size()});
+            } else {
+                emit((char)c);
+                emitted++;
+            }
+        }
+        return emitted;
+    }
 };
 
 // 状态结构
@@ -99,6 +143,100 @@ struct TurtleState {
     double x, y, angle;
 };
 
+// 流式海龟：逐个接收符号。朝向只可能是 startAngle + k * angleStep，
+// 若 k * angleStep 有周期（n * angleStep 是 360 的整数倍，n <= 3600），cos/sin 预先按 k mod n 查表
+class Turtle {
+public:
+    Turtle(Canvas& canvas, double startX, double startY, double startAngle, double stepLength, double angleStep,
+           Color color, int thickness = 1)
+        : canvas(canvas), x(startX), y(startY), startAngle(startAngle), angleStep(angleStep),
+          stepLength(stepLength), color(color), thickness(thickness) {
+        for (int n = 1; n <= 3600; n++) {
+            if (fmod(n * angleStep, 360.0) == 0) {
+                period = n;
+                break;
+            }
+        }
+        for (int k = 0; k < period; k++) {
+            double a = (startAngle + k * angleStep) * PI / 180.0;
+            dxTable.push_back(stepLength * cos(a));
+            dyTable.push_back(stepLength * sin(a));
+        }
+    }
+
+    void operator()(char cmd) {
+        if (cmd == 'F' || cmd == 'G') {
+            // 画线
+            double dx, dy;
+            step(dx, dy);
+            canvas.drawLine(x, y, x + dx, y - dy, color, thickness);
+            x += dx;
+            y -= dy;
+        } else if (cmd == 'f') {
+            // 移动不画线
+            double dx, dy;
+            step(dx, dy);
+            x += dx;
+            y -= dy;
+        } else if (cmd == '+') {
+            turns++;
+        } else if (cmd == '-') {
+            turns--;
+        } else if (cmd == '[') {
+            stack.push_back({x, y, turns});
+        } else if (cmd == ']') {
+            if (!stack.empty()) {
+                x = stack.back().x;
+                y = stack.back().y;
+                turns = stack.back().turns;
+                stack.pop_back();
+            }
+        }
+        maxDepth = std::max(maxDepth, stack.size());
+    }
+
+    size_t maxStackDepth() const { return maxDepth; }
+    bool usesTable() const { return period > 0; }
+
+private:
+    struct State {
+        double x, y;
+        long long turns;
+    };
+
+    Canvas& canvas;
+    double x, y;
+    long long turns = 0;  // 累计转了几个 angleStep（左正右负）
+    double startAngle, angleStep, stepLength;
+    Color color;
+    int thickness;
+    int period = 0;  // 0 表示没有周期，退回直接调用 cos/sin
+    std::vector<double> dxTable, dyTable;
+    std::vector<State> stack;
+    size_t maxDepth = 0;
+
+    void step(double& dx, double& dy) const {
+        if (period > 0) {
+            long long k = turns % period;
+            if (k < 0) k += period;
+            dx = dxTable[k];
+            dy = dyTable[k];
+        } else {
+            double a = (startAngle + turns * angleStep) * PI / 180.0;
+            dx = stepLength * cos(a);
+            dy = stepLength * sin(a);
+        }
+    }
+};
+
+// 不生成字符串，直接把展开的符号交给海龟，返回画出的符号数
+size_t renderLSystemStreaming(Canvas& canvas, const LSystem& lsys, int iterations,
+                              double startX, double startY, double startAngle,
+                              double stepLength, double angleStep, Color color, int thickness = 1) {
+    Turtle turtle(canvas, startX, startY, startAngle, stepLength, angleStep, color, thickness);
+    return lsys.expand(iterations, turtle);
+}
+
 // 渲染 L-System
 void renderLSystem(Canvas& canvas, const std::string& commands, 
                    double startX, double startY, double startAngle,
@@ -139,17 +277,82 @@ void renderLSystem(Canvas& canvas, const std::string& commands,
     }
 }
 
-int main() {
+// ========== 基准：整串生成 vs 流式展开 ==========
+
+using Clock = std::chrono::steady_clock;
+
+static double msSince(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+// 每个文法跑一组迭代次数：整串版本超过 kMaxString 字节就跳过（上一代 + 当前代同时在内存里）
+static void runBenchmark() {
+    const size_t kMaxString = 1u << 30;
+    struct Case {
+        const char* name;
+        LSystem lsys;
+        std::vector<int> iterations;
+        double angle;
+    };
+    LSystem plant("X"), dragon("FX"), hilbert("L");
+    plant.addRule('X', "F+[[X]-X]-F[-FX]+X");
+    plant.addRule('F', "FF");
+    dragon.addRule('X', "X+YF+");
+    dragon.addRule('Y', "-FX-Y");
+    hilbert.addRule('L', "+RF-LFL-FR+");
+    hilbert.addRule('R', "-LF+RFR+FL-");
+    std::vector<Case> cases = {
+        {"植物", plant, {6, 8, 10, 11}, 25},
+        {"龙形", dragon, {12, 18, 24, 27}, 90},
+        {"希尔伯特", hilbert, {6, 9, 12, 13}, 90},
+    };
+
+    printf("%-10s %4s %14s %12s %12s %12s %8s\n", "文法", "代", "符号数", "整串 (ms)", "整串内存", "流式 (ms)",
+           "栈深");
+    for (Case& c : cases) {
+        for (int n : c.iterations) {
+            // 先数出长度，决定整串版本是否可行
+            size_t symbols = c.lsys.expand(n, [](char) {});
+
+            char fullMs[32] = "跳过", fullMem[32] = "-";
+            if (symbols * 2 <= kMaxString) {
+                Canvas canvas(500, 500);
+                auto t0 = Clock::now();
+                std::string commands = c.lsys.generate(n);
+                renderLSystem(canvas, commands, 250, 250, 90, 1, c.angle, Color(0, 0, 0));
+                snprintf(fullMs, sizeof(fullMs), "%.1f", msSince(t0));
+                snprintf(fullMem, sizeof(fullMem), "%.1f MB", commands.size() / 1048576.0);
+            }
+
+            Canvas canvas(500, 500);
+            auto t0 = Clock::now();
+            Turtle turtle(canvas, 250, 250, 90, 1, c.angle, Color(0, 0, 0));
+            c.lsys.expand(n, turtle);
+            double streamMs = msSince(t0);
+            printf("%-10s %4d %14zu %12s %12s %12.1f %8zu\n", c.name, n, symbols, fullMs, fullMem, streamMs,
+                   turtle.maxStackDepth());
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && !strcmp(argv[1], "--bench")) {
+        runBenchmark();
+        return 0;
+    }
+    if (argc > 1) {
+        fprintf(stderr, "用法: %s [--bench]\n", argv[0]);
+        return 1;
+    }
+
     const int W = 1000, H = 1000;
     
     // 1. 科赫雪花 (Koch Snowflake)
     {
         LSystem koch("F--F--F");
         koch.addRule('F', "F+F--F+F");
-        std::string commands = koch.generate(4);
-        
         Canvas canvas(W, H, Color(240, 248, 255));
-        renderLSystem(canvas, commands, W/2 - 300, H/2 + 200, 0, 2, 60, Color(0, 0, 139), 1);
+        renderLSystemStreaming(canvas, koch, 4, W/2 - 300, H/2 + 200, 0, 2, 60, Color(0, 0, 139), 1);
         canvas.save("lsystem_koch_snowflake.png");
     }
     
@@ -158,10 +361,8 @@ int main() {
         LSystem dragon("FX");
         dragon.addRule('X', "X+YF+");
         dragon.addRule('Y', "-FX-Y");
-        std::string commands = dragon.generate(12);
-        
         Canvas canvas(W, H, Color(255, 250, 240));
-        renderLSystem(canvas, commands, W/2 - 200, H/2, 0, 3, 90, Color(220, 20, 60), 1);
+        renderLSystemStreaming(canvas, dragon, 12, W/2 - 200, H/2, 0, 3, 90, Color(220, 20, 60), 1);
         canvas.save("lsystem_dragon_curve.png");
     }
     
@@ -170,10 +371,8 @@ int main() {
         LSystem plant("X");
         plant.addRule('X', "F+[[X]-X]-F[-FX]+X");
         plant.addRule('F', "FF");
-        std::string commands = plant.generate(6);
-        
         Canvas canvas(W, H, Color(240, 255, 240));
-        renderLSystem(canvas, commands, W/2, H - 50, 90, 3, 25, Color(34, 139, 34), 1);
+        renderLSystemStreaming(canvas, plant, 6, W/2, H - 50, 90, 3, 25, Color(34, 139, 34), 1);
         canvas.save("lsystem_fractal_plant.png");
     }
     
@@ -181,10 +380,8 @@ int main() {
     {
         LSystem bush("F");
         bush.addRule('F', "FF+[+F-F-F]-[-F+F+F]");
-        std::string commands = bush.generate(4);
-        
         Canvas canvas(W, H, Color(245, 245, 220));
-        renderLSystem(canvas, commands, W/2, H - 50, 90, 4, 22.5, Color(107, 142, 35), 2);
+        renderLSystemStreaming(canvas, bush, 4, W/2, H - 50, 90, 4, 22.5, Color(107, 142, 35), 2);
         canvas.save("lsystem_bush.png");
     }
     
@@ -193,10 +390,8 @@ int main() {
         LSystem sierpinski("F-G-G");
         sierpinski.addRule('F', "F-G+F+G-F");
         sierpinski.addRule('G', "GG");
-        std::string commands = sierpinski.generate(6);
-        
         Canvas canvas(W, H, Color(255, 245, 238));
-        renderLSystem(canvas, commands, W/2 - 400, H/2 + 300, 0, 2, 120, Color(255, 140, 0), 1);
+        renderLSystemStreaming(canvas, sierpinski, 6, W/2 - 400, H/2 + 300, 0, 2, 120, Color(255, 140, 0), 1);
         canvas.save("lsystem_sierpinski.png");
     }
     
@@ -205,10 +400,8 @@ int main() {
         LSystem hilbert("L");
         hilbert.addRule('L', "+RF-LFL-FR+");
         hilbert.addRule('R', "-LF+RFR+FL-");
-        std::string commands = hilbert.generate(6);
-        
         Canvas canvas(W, H, Color(250, 250, 250));
-        renderLSystem(canvas, commands, 50, H - 50, 0, 4, 90, Color(138, 43, 226), 2);
+        renderLSystemStreaming(canvas, hilbert, 6, 50, H - 50, 0, 4, 90, Color(138, 43, 226), 2);
         canvas.save("lsystem_hilbert_curve.png");
     }
     
@@ -3,6 +3,21 @@
 #include <cmath>
 #include <vector>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <complex>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <thread>
+#include <unordered_map>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MANDEL_X86 1
+#endif
 
 struct Color {
     unsigned char r, g, b;
@@ -41,94 +56,929 @@ int mandelbrotIterations(double cr, double ci, int maxIter) {
     return iter;
 }
 
-// 生成曼德勃罗集图像
-void generateMandelbrot(const char* filename, int width, int height,
-                       double centerX, double centerY, double zoom,
-                       int maxIter, int colorScheme = 0) {
-    
-    std::vector<unsigned char> pixels(width * height * 3);
-    
-    double rangeX = 3.5 / zoom;
-    double rangeY = 2.0 / zoom;
-    
-    for (int py = 0; py < height; py++) {
-        for (int px = 0; px < width; px++) {
-            // 映射到复平面
-            double cr = centerX + (px - width / 2.0) / width * rangeX;
-            double ci = centerY + (py - height / 2.0) / height * rangeY;
-            
-            int iter = mandelbrotIterations(cr, ci, maxIter);
-            
-            Color color;
-            if (iter == maxIter) {
-                // 属于集合 → 黑色
-                color = Color(0, 0, 0);
-            } else {
-                // 不属于集合 → 根据迭代次数着色
-                switch (colorScheme) {
-                    case 0: {
-                        // 蓝色渐变
-                        int intensity = (iter * 255) / maxIter;
-                        color = Color(0, intensity / 2, intensity);
-                        break;
-                    }
-                    case 1: {
-                        // 火焰色
-                        double t = (double)iter / maxIter;
-                        if (t < 0.5) {
-                            color = Color(255 * (t * 2), 0, 0);
-                        } else {
-                            color = Color(255, 255 * (t - 0.5) * 2, 0);
-                        }
-                        break;
-                    }
-                    case 2: {
-                        // 彩虹色（HSV）
-                        double hue = (360.0 * iter) / maxIter;
-                        color = hsvToRgb(hue, 1.0, 1.0);
-                        break;
-                    }
-                    case 3: {
-                        // 紫-粉色
-                        double t = (double)iter / maxIter;
-                        color = Color(255 * t, 50, 255 * (1 - t));
-                        break;
+// ========== 快速迭代内核 ==========
+
+// 主心形和周期 2 圆盘内部的点永远不会逃逸，直接返回 maxIter
+inline bool inMainCardioidOrBulb(double cr, double ci) {
+    double xq = cr - 0.25;
+    double q = xq * xq + ci * ci;
+    if (q * (q + xq) <= 0.25 * ci * ci) return true;
+    double xb = cr + 1.0;
+    return xb * xb + ci * ci <= 0.0625;
+}
+
+// 与 mandelbrotIterations 结果完全相同，但内部点提前结束：
+// - 心形/圆盘测试直接判定
+// - 周期检测（Brent）：每隔 2^k 次迭代记下 z，之后 z 与记录逐位相等说明浮点轨道已经进入循环，
+//   原来的循环同样只会跑到 maxIter
+int mandelbrotIterationsFast(double cr, double ci, int maxIter) {
+    if (inMainCardioidOrBulb(cr, ci)) return maxIter;
+    double zr = 0, zi = 0;
+    double sr = 0, si = 0;
+    int window = 1, step = 0;
+    int iter = 0;
+
+    while (zr * zr + zi * zi <= 4.0 && iter < maxIter) {
+        double temp = zr * zr - zi * zi + cr;
+        zi = 2 * zr * zi + ci;
+        zr = temp;
+        iter++;
+        if (zr == sr && zi == si) return maxIter;
+        if (++step == window) {
+            step = 0;
+            window *= 2;
+            sr = zr;
+            si = zi;
+        }
+    }
+    return iter;
+}
+
+// 运行时检测 AVX，--scalar 可以关掉
+inline bool& simdEnabled() {
+#ifdef MANDEL_X86
+    static bool enabled = __builtin_cpu_supports("avx");
+#else
+    static bool enabled = false;
+#endif
+    return enabled;
+}
+
+#ifdef MANDEL_X86
+// 一次 4 个相邻像素（同一行），运算顺序与标量版一致、不用 FMA，迭代次数逐位相同。
+// 每条车道各自的逃逸/周期状态用掩码记录，4 条都结束就退出
+__attribute__((target("avx")))
+void iterateRow4(const double* cr, double ci, int maxIter, int* out) {
+    __m256d cr4 = _mm256_loadu_pd(cr), ci4 = _mm256_set1_pd(ci);
+    __m256d zr = _mm256_setzero_pd(), zi = _mm256_setzero_pd();
+    __m256d sr = zr, si = zi;
+    __m256d count = _mm256_setzero_pd();
+    __m256d four = _mm256_set1_pd(4.0), one = _mm256_set1_pd(1.0), two = _mm256_set1_pd(2.0);
+
+    // 心形/圆盘内部的车道一开始就标记为周期（结果 maxIter）
+    alignas(32) double inside[4];
+    for (int k = 0; k < 4; k++) inside[k] = inMainCardioidOrBulb(cr[k], ci) ? 1.0 : 0.0;
+    __m256d periodic = _mm256_cmp_pd(_mm256_load_pd(inside), _mm256_setzero_pd(), _CMP_NEQ_UQ);
+    __m256d active = _mm256_andnot_pd(periodic, _mm256_castsi256_pd(_mm256_set1_epi64x(-1)));
+
+    int window = 1, step = 0;
+    for (int iter = 0; iter < maxIter; iter++) {
+        __m256d zr2 = _mm256_mul_pd(zr, zr), zi2 = _mm256_mul_pd(zi, zi);
+        active = _mm256_and_pd(active, _mm256_cmp_pd(_mm256_add_pd(zr2, zi2), four, _CMP_LE_OQ));
+        if (_mm256_movemask_pd(active) == 0) break;
+
+        __m256d temp = _mm256_add_pd(_mm256_sub_pd(zr2, zi2), cr4);
+        zi = _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(two, zr), zi), ci4);
+        zr = temp;
+        count = _mm256_add_pd(count, _mm256_and_pd(active, one));
+
+        __m256d same = _mm256_and_pd(_mm256_cmp_pd(zr, sr, _CMP_EQ_OQ), _mm256_cmp_pd(zi, si, _CMP_EQ_OQ));
+        same = _mm256_and_pd(same, active);
+        periodic = _mm256_or_pd(periodic, same);
+        active = _mm256_andnot_pd(same, active);
+        if (++step == window) {
+            step = 0;
+            window *= 2;
+            sr = zr;
+            si = zi;
+        }
+    }
+
+    count = _mm256_blendv_pd(count, _mm256_set1_pd((double)maxIter), periodic);
+    __m128i c = _mm256_cvttpd_epi32(count);
+    _mm_storeu_si128((__m128i*)out, c);
+}
+#endif
+
+int defaultThreads() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// 按行分给多个线程：每次用原子计数器领取 kRowBlock 行，fn(y0, y1) 处理 [y0, y1)
+template <typename Fn>
+void parallelRows(int height, int threads, Fn&& fn) {
+    const int kRowBlock = 4;
+    std::atomic<int> next{0};
+    auto worker = [&] {
+        for (int y0; (y0 = next.fetch_add(kRowBlock)) < height;) fn(y0, std::min(height, y0 + kRowBlock));
+    };
+    threads = std::max(1, std::min(threads, (height + kRowBlock - 1) / kRowBlock));
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+}
+
+// 视口：与 generateMandelbrot 相同的映射（宽 3.5 / zoom，高 2.0 / zoom）
+struct View {
+    double centerX, centerY, zoom;
+    int maxIter;
+};
+
+// 整幅图的迭代次数（行优先）。每行的 cr 先按原公式算好，再 4 个一组交给 SIMD 内核
+void computeIterations(int width, int height, const View& v, int threads, std::vector<int>& iters) {
+    iters.resize((size_t)width * height);
+    double rangeX = 3.5 / v.zoom;
+    double rangeY = 2.0 / v.zoom;
+    parallelRows(height, threads, [&](int y0, int y1) {
+        std::vector<double> crs(width);
+        for (int px = 0; px < width; px++) crs[px] = v.centerX + (px - width / 2.0) / width * rangeX;
+        for (int py = y0; py < y1; py++) {
+            double ci = v.centerY + (py - height / 2.0) / height * rangeY;
+            int* row = &iters[(size_t)py * width];
+            int px = 0;
+#ifdef MANDEL_X86
+            if (simdEnabled())
+                for (; px + 4 <= width; px += 4) iterateRow4(&crs[px], ci, v.maxIter, row + px);
+#endif
+            for (; px < width; px++) row[px] = mandelbrotIterationsFast(crs[px], ci, v.maxIter);
+        }
+    });
+}
+
+// ========== Mariani-Silver 边界细分 ==========
+// 集合内部和大片同一逃逸次数的区域是连通的：矩形边框上所有像素迭代次数相同时，直接填充内部。
+// 否则沿长边对半分开（两半共用中间那条线，已算过的像素不重算），小到一定程度就逐个算。
+// 边框全是 maxIter 时填充是精确的（曼德勃罗集单连通）；其它值是启发式，细丝穿过矩形时会漏掉
+
+struct SubdivisionStats {
+    size_t iterated = 0;  // 实际迭代的像素
+    size_t filled = 0;    // 直接填充的像素
+};
+
+// 像素到复平面的映射是可分离的：cr 只取决于列，ci 只取决于行
+struct PixelGrid {
+    const double* cr;
+    const double* ci;
+    int maxIter;
+};
+
+// 计算一行 [x0, x1] 中尚未计算（-1）的像素；整组 4 个都未计算时走 AVX 内核
+inline void iterateSpan(const PixelGrid& g, int x0, int x1, int y, int* row, SubdivisionStats& st) {
+    int x = x0;
+#ifdef MANDEL_X86
+    if (simdEnabled()) {
+        for (; x + 3 <= x1; x += 4) {
+            if (row[x] >= 0 || row[x + 1] >= 0 || row[x + 2] >= 0 || row[x + 3] >= 0) break;
+            iterateRow4(&g.cr[x], g.ci[y], g.maxIter, row + x);
+            st.iterated += 4;
+        }
+    }
+#endif
+    for (; x <= x1; x++) {
+        if (row[x] < 0) {
+            row[x] = mandelbrotIterationsFast(g.cr[x], g.ci[y], g.maxIter);
+            st.iterated++;
+        }
+    }
+}
+
+// buf 中 -1 表示未计算；处理闭区间 [x0, x1] x [y0, y1]
+void marianiSilver(int x0, int y0, int x1, int y1, int* buf, int stride, const PixelGrid& g, SubdivisionStats& st) {
+    const int kMinSide = 8;
+    auto row = [&](int y) { return buf + (size_t)y * stride; };
+    auto value = [&](int x, int y) {
+        int& v = row(y)[x];
+        if (v < 0) {
+            v = mandelbrotIterationsFast(g.cr[x], g.ci[y], g.maxIter);
+            st.iterated++;
+        }
+        return v;
+    };
+
+    iterateSpan(g, x0, x1, y0, row(y0), st);
+    iterateSpan(g, x0, x1, y1, row(y1), st);
+    int first = row(y0)[x0];
+    bool uniform = true;
+    for (int x = x0; x <= x1; x++) uniform &= (row(y0)[x] == first) & (row(y1)[x] == first);
+    for (int y = y0 + 1; y < y1; y++) uniform &= (value(x0, y) == first) & (value(x1, y) == first);
+    if (x1 - x0 < 2 || y1 - y0 < 2) return;
+
+    if (uniform) {
+        for (int y = y0 + 1; y < y1; y++) std::fill(row(y) + x0 + 1, row(y) + x1, first);
+        st.filled += (size_t)(x1 - x0 - 1) * (y1 - y0 - 1);
+        return;
+    }
+    if (x1 - x0 <= kMinSide && y1 - y0 <= kMinSide) {
+        for (int y = y0 + 1; y < y1; y++) iterateSpan(g, x0 + 1, x1 - 1, y, row(y), st);
+        return;
+    }
+    if (x1 - x0 >= y1 - y0) {
+        int mid = (x0 + x1) / 2;
+        marianiSilver(x0, y0, mid, y1, buf, stride, g, st);
+        marianiSilver(mid, y0, x1, y1, buf, stride, g, st);
+    } else {
+        int mid = (y0 + y1) / 2;
+        marianiSilver(x0, y0, x1, mid, buf, stride, g, st);
+        marianiSilver(x0, mid, x1, y1, buf, stride, g, st);
+    }
+}
+
+// 与 computeIterations 同样的映射，整幅图切成 64x64 的块由多个线程领取，每块内部做边界细分
+SubdivisionStats computeIterationsSubdivided(int width, int height, const View& v, int threads,
+                                             std::vector<int>& iters) {
+    const int kBlock = 64;
+    iters.assign((size_t)width * height, -1);
+    double rangeX = 3.5 / v.zoom;
+    double rangeY = 2.0 / v.zoom;
+    std::vector<double> crs(width), cis(height);
+    for (int px = 0; px < width; px++) crs[px] = v.centerX + (px - width / 2.0) / width * rangeX;
+    for (int py = 0; py < height; py++) cis[py] = v.centerY + (py - height / 2.0) / height * rangeY;
+    PixelGrid grid{crs.data(), cis.data(), v.maxIter};
+
+    int bx = (width + kBlock - 1) / kBlock, by = (height + kBlock - 1) / kBlock;
+    std::vector<SubdivisionStats> perBlock((size_t)bx * by);
+    parallelRows(bx * by, threads, [&](int b0, int b1) {
+        for (int b = b0; b < b1; b++) {
+            int x0 = (b % bx) * kBlock, y0 = (b / bx) * kBlock;
+            marianiSilver(x0, y0, std::min(width, x0 + kBlock) - 1, std::min(height, y0 + kBlock) - 1, iters.data(),
+                          width, grid, perBlock[b]);
+        }
+    });
+    SubdivisionStats total;
+    for (const SubdivisionStats& st : perBlock) {
+        total.iterated += st.iterated;
+        total.filled += st.filled;
+    }
+    return total;
+}
+
+// ========== 迭代次数瓦片缓存 ==========
+// 交互式缩放/平移：复平面按层级切成 64x64 的采样瓦片，第 level 层采样间隔 2^-(6+level)，
+// 瓦片按 (tx, ty, level, maxIter) 缓存，瓦片内每个采样点都逐点迭代（不做边界细分的填充）。
+// 只有视口的像素网格与某一层的采样网格重合时才用瓦片：像素间距正好是 2^-(6+level)，
+// 且像素坐标（按 generateMandelbrot 的公式算出的 double）恰好落在采样点上，这时取到的
+// 迭代次数与整幅逐点计算逐位相同。对齐的视口平移整数个像素、缩放 2 的幂次时，只需补算新露出来的瓦片；
+// 换配色完全不需要重算（迭代次数和颜色是分开的）。
+// 像素网格对不上的视口（缩放倍数不是 2 的幂、平移不是整像素、3.5/width 与 2/height 不是 2 的幂）
+// 直接整幅计算；对齐视口里个别因舍入没有落在采样点上的像素单独迭代，不拿最近的采样点顶替。
+// 层级上限 kMaxLevel：采样间隔 2^-(6+kMaxLevel) 仍比 |c| <= 2 处 double 的精度粗几位，采样下标也远在 int64 内；
+// 更深的视口不走瓦片，直接整幅计算
+
+class IterationTileCache {
+public:
+    static constexpr int kTile = 64;
+    static constexpr int kMaxLevel = 42;
+
+    struct Stats {
+        size_t hits = 0;
+        size_t computed = 0;
+        size_t evicted = 0;
+        size_t direct = 0;    // 未对齐或超过 kMaxLevel、直接整幅计算的帧
+        size_t patched = 0;   // 对齐视口中没落在采样点上、单独迭代的像素
+    };
+
+    explicit IterationTileCache(size_t maxTiles = 4096, int threads = 0)
+        : maxTiles(maxTiles), threads(threads > 0 ? threads : defaultThreads()) {}
+
+    const Stats& stats() const { return stats_; }
+
+    // 按 generateMandelbrot 的映射渲染视口，结果与 computeIterations 逐位相同；缺失的瓦片并行计算。
+    // computeMissing = false 时不计算，每个像素取已缓存的最近采样点，缺失处退回更粗层级（渐进预览，
+    // 是近似值，之后应当再用 computeMissing = true 渲染一次），都没有的像素为 -1
+    size_t render(int width, int height, const View& v, std::vector<int>& iters, bool computeMissing = true) {
+        frame++;
+        double rangeX = 3.5 / v.zoom, rangeY = 2.0 / v.zoom;
+        double spacing = std::min(rangeX / width, rangeY / height);
+        int level = std::max(0, (int)ceil(-log2(spacing) - 6));
+        if (computeMissing && (level > kMaxLevel || !aligned(width, height, v, level))) {
+            stats_.direct++;
+            computeIterations(width, height, v, threads, iters);
+            return 0;
+        }
+        level = std::min(level, kMaxLevel);  // 预览只用缓存里最细的层级
+
+        // 视口覆盖的瓦片范围
+        auto tileOf = [](int64_t s) { return s >= 0 ? s / kTile : (s - kTile + 1) / kTile; };
+        double crMin = v.centerX - 0.5 * rangeX, crMax = v.centerX + 0.5 * rangeX;
+        double ciMin = v.centerY - 0.5 * rangeY, ciMax = v.centerY + 0.5 * rangeY;
+        if (computeMissing) {
+            std::vector<Key> missing;
+            for (int64_t ty = tileOf(sampleIndex(ciMin, level)); ty <= tileOf(sampleIndex(ciMax, level)); ty++) {
+                for (int64_t tx = tileOf(sampleIndex(crMin, level)); tx <= tileOf(sampleIndex(crMax, level)); tx++) {
+                    Key k{tx, ty, level, v.maxIter};
+                    if (!tiles.count(k)) missing.push_back(k);
+                }
+            }
+            computeTiles(missing);
+        }
+
+        // 取值：同一行的像素大多落在同一瓦片，缓存上一次找到的瓦片
+        iters.resize((size_t)width * height);
+        double step = 1.0 / stepInverse(level);
+        size_t unresolved = 0;
+        for (int py = 0; py < height; py++) {
+            double ci = v.centerY + (py - height / 2.0) / height * rangeY;
+            const Tile* tile = nullptr;
+            Key tileKey{};
+            auto lookup = [&](int64_t sx, int64_t sy, int lvl) {
+                Key k{tileOf(sx), tileOf(sy), lvl, v.maxIter};
+                if (!tile || !(k == tileKey)) {
+                    tile = find(k);
+                    tileKey = k;
+                }
+                return tile ? tile->iters[(sy - k.ty * kTile) * kTile + (sx - k.tx * kTile)] : -1;
+            };
+            for (int px = 0; px < width; px++) {
+                double cr = v.centerX + (px - width / 2.0) / width * rangeX;
+                int value = -1;
+                if (computeMissing) {
+                    int64_t sx = sampleIndex(cr, level), sy = sampleIndex(ci, level);
+                    if ((double)sx * step == cr && (double)sy * step == ci) {
+                        value = lookup(sx, sy, level);
+                    } else {
+                        value = mandelbrotIterationsFast(cr, ci, v.maxIter);
+                        stats_.patched++;
                     }
+                } else {
+                    for (int lvl = level; lvl >= 0 && value < 0; lvl--)
+                        value = lookup(sampleIndex(cr, lvl), sampleIndex(ci, lvl), lvl);
                 }
+                unresolved += value < 0;
+                iters[(size_t)py * width + px] = value;
             }
-            
-            int idx = (py * width + px) * 3;
-            pixels[idx] = color.r;
-            pixels[idx + 1] = color.g;
-            pixels[idx + 2] = color.b;
         }
+        evict();
+        return unresolved;
+    }
+
+private:
+    struct Key {
+        int64_t tx, ty;
+        int level, maxIter;
+        bool operator==(const Key& o) const {
+            return tx == o.tx && ty == o.ty && level == o.level && maxIter == o.maxIter;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            uint64_t h = (uint64_t)k.tx * 0x9e3779b97f4a7c15ull ^ (uint64_t)k.ty * 0xc2b2ae3d27d4eb4full ^
+                         (uint64_t)(uint32_t)(k.level * 65599 + k.maxIter) * 0x165667b19e3779f9ull;
+            return (size_t)(h ^ (h >> 29));
+        }
+    };
+    struct Tile {
+        std::vector<int> iters;  // kTile x kTile
+        std::list<Key>::iterator lru;
+        size_t lastFrame = 0;
+    };
+
+    size_t maxTiles;
+    int threads;
+    size_t frame = 0;
+    std::unordered_map<Key, Tile, KeyHash> tiles;
+    std::list<Key> lruList;  // 前面最近使用
+    Stats stats_;
+
+    static double stepInverse(int level) { return std::ldexp(1.0, 6 + level); }
+    static int64_t sampleIndex(double c, int level) { return (int64_t)floor(c * stepInverse(level) + 0.5); }
+
+    // 像素间距正好是这一层的采样间隔，且左上角像素落在采样点上。其余像素的坐标由舍入决定，
+    // render 里逐个再核对一遍
+    static bool aligned(int width, int height, const View& v, int level) {
+        double step = 1.0 / stepInverse(level);
+        double rangeX = 3.5 / v.zoom, rangeY = 2.0 / v.zoom;
+        if (rangeX / width != step || rangeY / height != step) return false;
+        double cr = v.centerX + (0 - width / 2.0) / width * rangeX;
+        double ci = v.centerY + (0 - height / 2.0) / height * rangeY;
+        return (double)sampleIndex(cr, level) * step == cr && (double)sampleIndex(ci, level) * step == ci;
+    }
+
+    const Tile* find(const Key& k) {
+        auto it = tiles.find(k);
+        if (it == tiles.end()) return nullptr;
+        Tile& t = it->second;
+        if (t.lastFrame != frame) {
+            t.lastFrame = frame;
+            stats_.hits++;
+            lruList.splice(lruList.begin(), lruList, t.lru);
+        }
+        return &t;
+    }
+
+    // 采样点 c = (瓦片起点 + i) * 2^-(6+level)，步长是 2 的幂，乘法是精确的。
+    // 逐点迭代（整组 4 个走 AVX 内核），不用边界细分的填充：瓦片里的值要与整幅逐点计算一致
+    void computeTiles(const std::vector<Key>& keys) {
+        std::vector<std::vector<int>> results(keys.size());
+        parallelRows((int)keys.size(), threads, [&](int k0, int k1) {
+            for (int k = k0; k < k1; k++) {
+                const Key& key = keys[k];
+                double step = 1.0 / stepInverse(key.level);
+                double crs[kTile], cis[kTile];
+                for (int i = 0; i < kTile; i++) {
+                    crs[i] = ((double)key.tx * kTile + i) * step;
+                    cis[i] = ((double)key.ty * kTile + i) * step;
+                }
+                results[k].assign(kTile * kTile, -1);
+                PixelGrid grid{crs, cis, key.maxIter};
+                SubdivisionStats st;
+                for (int y = 0; y < kTile; y++)
+                    iterateSpan(grid, 0, kTile - 1, y, results[k].data() + (size_t)y * kTile, st);
+            }
+        });
+        for (size_t k = 0; k < keys.size(); k++) {
+            lruList.push_front(keys[k]);
+            Tile& t = tiles[keys[k]];
+            t.iters = std::move(results[k]);
+            t.lru = lruList.begin();
+            t.lastFrame = frame;
+            stats_.computed++;
+        }
+    }
+
+    // 超出上限时从最久未用的一端淘汰，当前帧用到的瓦片不淘汰
+    void evict() {
+        while (tiles.size() > maxTiles) {
+            auto it = tiles.find(lruList.back());
+            if (it->second.lastFrame == frame) break;
+            tiles.erase(it);
+            lruList.pop_back();
+            stats_.evicted++;
+        }
+    }
+};
+
+// ========== 着色 ==========
+
+Color colorize(int iter, int maxIter, int colorScheme) {
+    if (iter == maxIter) {
+        // 属于集合 → 黑色
+        return Color(0, 0, 0);
+    }
+    // 不属于集合 → 根据迭代次数着色
+    Color color;
+    switch (colorScheme) {
+        case 0: {
+            // 蓝色渐变
+            int intensity = (iter * 255) / maxIter;
+            color = Color(0, intensity / 2, intensity);
+            break;
+        }
+        case 1: {
+            // 火焰色
+            double t = (double)iter / maxIter;
+            if (t < 0.5) {
+                color = Color(255 * (t * 2), 0, 0);
+            } else {
+                color = Color(255, 255 * (t - 0.5) * 2, 0);
+            }
+            break;
+        }
+        case 2: {
+            // 彩虹色（HSV）
+            double hue = (360.0 * iter) / maxIter;
+            color = hsvToRgb(hue, 1.0, 1.0);
+            break;
+        }
+        case 3: {
+            // 紫-粉色
+            double t = (double)iter / maxIter;
+            color = Color(255 * t, 50, 255 * (1 - t));
+            break;
+        }
+    }
+    return color;
+}
+
+void writeImage(const char* filename, int width, int height, const std::vector<int>& iters, int maxIter,
+                int colorScheme) {
+    std::vector<unsigned char> pixels(width * height * 3);
+    for (size_t i = 0; i < iters.size(); i++) {
+        Color color = colorize(iters[i], maxIter, colorScheme);
+        pixels[i * 3] = color.r;
+        pixels[i * 3 + 1] = color.g;
+        pixels[i * 3 + 2] = color.b;
     }
-    
     stbi_write_png(filename, width, height, 3, pixels.data(), width * 3);
 }
 
-int main() {
+// 生成曼德勃罗集图像
+void generateMandelbrot(const char* filename, int width, int height,
+                       double centerX, double centerY, double zoom,
+                       int maxIter, int colorScheme = 0, int threads = 0) {
+    std::vector<int> iters;
+    computeIterations(width, height, {centerX, centerY, zoom, maxIter}, threads > 0 ? threads : defaultThreads(),
+                      iters);
+    writeImage(filename, width, height, iters, maxIter, colorScheme);
+}
+
+// ========== 微扰深度放大 ==========
+// 放大到 ~1e13 以后，相邻像素的 c 在 double 里已经无法区分。
+// 这里只用高精度算一条参考轨道 Z_n（视口中心），每个像素迭代与参考点的差 δz（double）：
+//   δz_{n+1} = (2 Z_n + δz_n) δz_n + δc
+// 实际的 z = Z_n + δz_n。|z| < |δz| 或参考轨道已经用完时"换基"：δz ← z，n ← 0（Zhuoran 的方法），
+// 不需要额外的 glitch 检测。
+// 级数近似：δz_n ≈ A_n δc + B_n δc² + C_n δc³，系数沿参考轨道递推；三次项相对一次项
+// 仍可忽略之前的迭代对所有像素整体跳过
+
+#if defined(__SIZEOF_FLOAT128__)
+using RefReal = __float128;  // 113 位尾数，可以放大到 ~1e30
+#else
+using RefReal = long double;
+#endif
+
+// 十进制字符串 → RefReal（strtod 只有 double 精度）
+RefReal parseReal(const char* s) {
+    bool neg = false;
+    if (*s == '-' || *s == '+') neg = *s++ == '-';
+    RefReal value = 0, scale = 1;
+    bool fraction = false;
+    for (; *s; s++) {
+        if (*s == '.') {
+            fraction = true;
+        } else if (*s >= '0' && *s <= '9') {
+            value = value * 10 + (*s - '0');
+            if (fraction) scale *= 10;
+        } else if (*s == 'e' || *s == 'E') {
+            int e = atoi(s + 1);
+            for (; e > 0; e--) scale /= 10;
+            for (; e < 0; e++) scale *= 10;
+            break;
+        } else {
+            break;
+        }
+    }
+    value /= scale;
+    return neg ? -value : value;
+}
+
+struct DeepView {
+    RefReal centerX, centerY;
+    double zoom;
+    int maxIter;
+};
+
+struct ReferenceOrbit {
+    std::vector<double> zr, zi;  // Z_0 .. Z_last（Z_last 为逃逸点或第 maxIter 项）
+    int last = 0;
+};
+
+ReferenceOrbit computeReference(const DeepView& v) {
+    ReferenceOrbit ref;
+    RefReal zr = 0, zi = 0;
+    for (int n = 0;; n++) {
+        ref.zr.push_back((double)zr);
+        ref.zi.push_back((double)zi);
+        ref.last = n;
+        if (n == v.maxIter || zr * zr + zi * zi > 4) break;
+        RefReal t = zr * zr - zi * zi + v.centerX;
+        zi = 2 * zr * zi + v.centerY;
+        zr = t;
+    }
+    return ref;
+}
+
+struct SeriesApprox {
+    int skip = 0;
+    std::complex<double> a, b, c;  // 第 skip 次迭代的系数
+};
+
+// 沿参考轨道递推 A, B, C，直到三次项相对一次项超过容差（视口角点的 |δc| 代入）
+SeriesApprox computeSeries(const ReferenceOrbit& ref, double radius, int maxIter) {
+    const double kTolerance = 1e-9;
+    SeriesApprox sa;
+    std::complex<double> a(0), b(0), c(0);
+    double r2 = radius * radius;
+    for (int n = 0; n < ref.last && n < maxIter; n++) {
+        std::complex<double> z2(2 * ref.zr[n], 2 * ref.zi[n]);
+        std::complex<double> na = z2 * a + 1.0;
+        std::complex<double> nb = z2 * b + a * a;
+        std::complex<double> nc = z2 * c + 2.0 * a * b;
+        if (!(std::abs(nc) * r2 <= kTolerance * std::abs(na))) break;
+        a = na;
+        b = nb;
+        c = nc;
+        sa = {n + 1, a, b, c};
+    }
+    return sa;
+}
+
+int perturbedIterations(const ReferenceOrbit& ref, const SeriesApprox& sa, double dcr, double dci, int maxIter) {
+    std::complex<double> dc(dcr, dci);
+    std::complex<double> dz = sa.skip > 0 ? ((sa.c * dc + sa.b) * dc + sa.a) * dc : 0.0;
+    double dzr = dz.real(), dzi = dz.imag();
+    int n = sa.skip;
+    int iter = sa.skip;
+    while (iter < maxIter) {
+        double zr = ref.zr[n] + dzr, zi = ref.zi[n] + dzi;
+        double mag = zr * zr + zi * zi;
+        if (mag > 4.0) break;
+        if (mag < dzr * dzr + dzi * dzi || n == ref.last) {
+            dzr = zr;
+            dzi = zi;
+            n = 0;
+        }
+        double ar = 2 * ref.zr[n] + dzr, ai = 2 * ref.zi[n] + dzi;
+        double t = ar * dzr - ai * dzi + dcr;
+        dzi = ar * dzi + ai * dzr + dci;
+        dzr = t;
+        n++;
+        iter++;
+    }
+    return iter;
+}
+
+// 深度放大渲染：useSeries 关闭时从 δz = 0 逐次迭代（用于校验级数跳过的结果）
+void computeIterationsDeep(int width, int height, const DeepView& v, int threads, bool useSeries,
+                           std::vector<int>& iters, int* skipped = nullptr) {
+    iters.resize((size_t)width * height);
+    double rangeX = 3.5 / v.zoom;
+    double rangeY = 2.0 / v.zoom;
+    ReferenceOrbit ref = computeReference(v);
+    SeriesApprox sa;
+    if (useSeries) sa = computeSeries(ref, std::hypot(rangeX, rangeY) * 0.5, v.maxIter);
+    if (skipped) *skipped = sa.skip;
+    parallelRows(height, threads, [&](int y0, int y1) {
+        for (int py = y0; py < y1; py++) {
+            double dci = (py - height / 2.0) / height * rangeY;
+            for (int px = 0; px < width; px++) {
+                double dcr = (px - width / 2.0) / width * rangeX;
+                iters[(size_t)py * width + px] = perturbedIterations(ref, sa, dcr, dci, v.maxIter);
+            }
+        }
+    });
+}
+
+// ========== 基准 ==========
+
+using Clock = std::chrono::steady_clock;
+
+static double msSince(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+static size_t countDiffs(const std::vector<int>& a, const std::vector<int>& b) {
+    size_t d = 0;
+    for (size_t i = 0; i < a.size(); i++) d += a[i] != b[i];
+    return d;
+}
+
+static void runBenchmark(int width, int height, int threads) {
+    struct Preset {
+        const char* name;
+        View view;
+    };
+    const Preset presets[] = {
+        {"全景", {-0.5, 0.0, 1.0, 256}},
+        {"海马谷", {-0.75, 0.1, 8.0, 512}},
+        {"螺旋", {-0.7269, 0.1889, 200.0, 1000}},
+        {"象谷", {0.3, 0.0, 3.0, 400}},
+        {"全景 5000 次", {-0.5, 0.0, 1.0, 5000}},
+    };
+    printf("%d x %d，%d 线程，SIMD: %s\n", width, height, threads, simdEnabled() ? "AVX" : "关");
+    printf("%-14s %12s %12s %12s %8s %8s\n", "视口", "原版 (ms)", "内部检测", "AVX+线程", "加速", "校验");
+    for (const Preset& p : presets) {
+        const View& v = p.view;
+        std::vector<int> ref((size_t)width * height), fast((size_t)width * height), simd;
+        double rangeX = 3.5 / v.zoom, rangeY = 2.0 / v.zoom;
+
+        auto t0 = Clock::now();
+        for (int py = 0; py < height; py++)
+            for (int px = 0; px < width; px++)
+                ref[(size_t)py * width + px] =
+                    mandelbrotIterations(v.centerX + (px - width / 2.0) / width * rangeX,
+                                         v.centerY + (py - height / 2.0) / height * rangeY, v.maxIter);
+        double refMs = msSince(t0);
+
+        t0 = Clock::now();
+        for (int py = 0; py < height; py++)
+            for (int px = 0; px < width; px++)
+                fast[(size_t)py * width + px] =
+                    mandelbrotIterationsFast(v.centerX + (px - width / 2.0) / width * rangeX,
+                                             v.centerY + (py - height / 2.0) / height * rangeY, v.maxIter);
+        double fastMs = msSince(t0);
+
+        t0 = Clock::now();
+        computeIterations(width, height, v, threads, simd);
+        double simdMs = msSince(t0);
+
+        bool exact = ref == fast && ref == simd;
+        printf("%-14s %12.1f %12.1f %12.1f %7.1fx %8s\n", p.name, refMs, fastMs, simdMs, refMs / simdMs,
+               exact ? "一致" : "不一致");
+    }
+
+    // 边界细分：与逐像素结果对照
+    printf("\n%-14s %12s %12s %12s\n", "视口", "细分 (ms)", "迭代像素", "不同像素");
+    for (const Preset& p : presets) {
+        std::vector<int> full, sub;
+        computeIterations(width, height, p.view, threads, full);
+        auto t0 = Clock::now();
+        SubdivisionStats st = computeIterationsSubdivided(width, height, p.view, threads, sub);
+        double ms = msSince(t0);
+        printf("%-14s %12.1f %11.1f%% %12zu\n", p.name, ms, 100.0 * st.iterated / full.size(), countDiffs(full, sub));
+    }
+
+    // 微扰：中等放大倍数下与直接 double 迭代对照
+    DeepView dv{parseReal("-0.7269"), parseReal("0.1889"), 1e5, 2000};
+    View direct{-0.7269, 0.1889, 1e5, 2000};
+    std::vector<int> a, b, c;
+    computeIterations(width, height, direct, threads, a);
+    int skipped = 0;
+    auto t0 = Clock::now();
+    computeIterationsDeep(width, height, dv, threads, false, b);
+    double plainMs = msSince(t0);
+    t0 = Clock::now();
+    computeIterationsDeep(width, height, dv, threads, true, c, &skipped);
+    double seriesMs = msSince(t0);
+    printf("\n微扰（zoom 1e5，2000 次）: 直接 double 对照 %zu 个像素不同（%.3f%%）\n", countDiffs(a, b),
+           100.0 * countDiffs(a, b) / a.size());
+    printf("  逐次 %.1f ms，级数跳过 %d 次 %.1f ms，两者 %zu 个像素不同\n", plainMs, skipped, seriesMs,
+           countDiffs(b, c));
+}
+
+// 深度放大：默认是 c = i（Misiurewicz 点，树枝状分叉的一个端点）放大 1e20 倍，
+// 此时相邻像素的 c 在 double 里完全相同，直接迭代整幅图只剩一种颜色
+static void renderDeep(const char* re, const char* im, double zoom, int maxIter, int threads) {
+    const int W = 1200, H = 800;
+    DeepView dv{parseReal(re), parseReal(im), zoom, maxIter};
+    std::vector<int> plain, series;
+    int skipped = 0;
+    auto t0 = Clock::now();
+    computeIterationsDeep(W, H, dv, threads, true, series, &skipped);
+    double seriesMs = msSince(t0);
+    t0 = Clock::now();
+    computeIterationsDeep(W, H, dv, threads, false, plain);
+    double plainMs = msSince(t0);
+    writeImage("mandelbrot_deep.png", W, H, series, maxIter, 2);
+    printf("深度放大 %s + %si，zoom %.3g，%d 次迭代\n", re, im, zoom, maxIter);
+    printf("  级数跳过 %d 次: %.1f ms；逐次微扰: %.1f ms；%zu 个像素不同\n", skipped, seriesMs, plainMs,
+           countDiffs(series, plain));
+}
+
+// 把视口中心吸附到像素网格上：平移整数个像素后，像素坐标仍落在瓦片采样点上
+static View snapToPixelGrid(View v, int width) {
+    double spacing = 3.5 / v.zoom / width;
+    v.centerX = std::round(v.centerX / spacing) * spacing;
+    v.centerY = std::round(v.centerY / spacing) * spacing;
+    return v;
+}
+
+// 模拟一次交互式浏览：896x512（3.5/896 = 2/512 = 2^-8，像素网格与瓦片采样网格对齐），
+// 从全景逐帧按整像素平移向螺旋区域，每 15 帧放大 2 倍，再平移回去；最后 10 帧按 1.06 倍连续放大，
+// 像素网格对不上，走整幅计算。中途换几次配色。
+// 每帧对比"整幅逐点计算（AVX + 多线程）"和"瓦片缓存"的耗时，两者必须逐像素相同
+static void runZoomSession(int threads) {
+    const int W = 896, H = 512, maxIter = 512;
+    IterationTileCache cache(4096, threads);
+    std::vector<int> cached, full;
+    std::vector<View> frames;
+    View v{-0.5, 0.0, 1.0, maxIter};
+    for (int f = 0; f < 90; f++) {
+        frames.push_back(v);
+        double spacing = 3.5 / v.zoom / W;
+        auto pan = [&](double from, double to) { return std::max(-16.0, std::min(16.0, std::round((to - from) / spacing * 0.15))); };
+        v.centerX += pan(v.centerX, -0.7269) * spacing;
+        v.centerY += pan(v.centerY, 0.1889) * spacing;
+        if (f % 15 == 14) v.zoom *= 2;
+    }
+    for (int f = 0; f < 30; f++) {
+        v.centerX += 8 * 3.5 / v.zoom / W;
+        frames.push_back(v);
+    }
+    for (int f = 0; f < 10; f++) {
+        v.zoom *= 1.06;
+        frames.push_back(v);
+    }
+
+    double cachedMs = 0, fullMs = 0, recolorMs = 0;
+    size_t diffs = 0;
+    for (size_t f = 0; f < frames.size(); f++) {
+        auto t0 = Clock::now();
+        cache.render(W, H, frames[f], cached);
+        cachedMs += msSince(t0);
+
+        t0 = Clock::now();
+        computeIterations(W, H, frames[f], threads, full);
+        fullMs += msSince(t0);
+        diffs += countDiffs(cached, full);
+
+        // 每 30 帧换一次配色：只重新着色，不重算迭代次数
+        if (f % 30 == 29) {
+            t0 = Clock::now();
+            for (int scheme = 0; scheme < 4; scheme++)
+                for (size_t i = 0; i < cached.size(); i++) {
+                    Color c = colorize(cached[i], maxIter, scheme);
+                    full[i] = c.r + c.g + c.b;  // 防止着色被优化掉
+                }
+            recolorMs += msSince(t0);
+        }
+    }
+    writeImage("mandelbrot_session.png", W, H, cached, maxIter, 2);
+
+    // 渐进预览：放大一级后不计算，直接用更粗层级的缓存瓦片顶上（近似值）
+    View next = frames[119];
+    next.zoom *= 2;
+    size_t unresolved = cache.render(W, H, next, cached, false);
+
+    const IterationTileCache::Stats& st = cache.stats();
+    printf("交互浏览 %zu 帧 %dx%d，maxIter %d\n", frames.size(), W, H, maxIter);
+    printf("  整幅逐点计算 %.1f ms/帧；瓦片缓存 %.1f ms/帧；两者 %zu 个像素不同\n", fullMs / frames.size(),
+           cachedMs / frames.size(), diffs);
+    printf("  瓦片: 复用 %zu 次，计算 %zu 个，淘汰 %zu 个；%zu 帧未对齐、整幅计算；对齐帧中 %zu 个像素单独迭代\n",
+           st.hits, st.computed, st.evicted, st.direct, st.patched);
+    printf("  换配色 4 次 x %zu 次: 共 %.1f ms（不重算）\n", frames.size() / 30, recolorMs);
+    printf("  再放大 2 倍的渐进预览: %zu 个像素没有可用的粗层级瓦片\n", unresolved);
+}
+
+// 深度放大自检：螺旋视口从 zoom 1 每次放大 8 倍到 1e15，中心吸附到像素网格（448x256，对齐），
+// 另一个视口再放大 1.5 倍（不对齐）；两者的瓦片缓存结果都必须与整幅逐点计算逐像素相同。
+// 采样下标超出 int、层级超过 kMaxLevel 后改为直接计算，这几段都要覆盖到；
+// 缓存结果里不允许有未解析（-1）或越界的值。返回失败的帧数
+static int runDeepZoomCheck(int threads) {
+    const int W = 448, H = 256, maxIter = 1000;
+    IterationTileCache cache(4096, threads);
+    std::vector<int> cached, full;
+    int failures = 0;
+    printf("深度放大自检 %dx%d，maxIter %d\n", W, H, maxIter);
+    for (double zoom = 1; zoom <= 1e15; zoom *= 8) {
+        View aligned = snapToPixelGrid({-0.743643887037151, 0.131825904205330, zoom, maxIter}, W);
+        View scaled = aligned;
+        scaled.zoom *= 1.5;
+        size_t diff[2];
+        for (int k = 0; k < 2; k++) {
+            const View& v = k ? scaled : aligned;
+            size_t unresolved = cache.render(W, H, v, cached);
+            computeIterations(W, H, v, threads, full);
+            diff[k] = countDiffs(cached, full);
+            bool valid = unresolved == 0 && cached.size() == full.size() && diff[k] == 0 &&
+                         std::all_of(cached.begin(), cached.end(), [&](int n) { return n >= 0 && n <= maxIter; });
+            failures += !valid;
+        }
+        printf("  zoom %-8.2e 与整幅计算不同的像素: 对齐 %zu，放大 1.5 倍 %zu%s\n", zoom, diff[0], diff[1],
+               diff[0] || diff[1] ? "  [失败]" : "");
+    }
+    printf("  %zu 帧未对齐或超过瓦片层级上限，直接计算；对齐帧中 %zu 个像素单独迭代；%s\n", cache.stats().direct,
+           cache.stats().patched, failures ? "有失败" : "全部通过");
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    int threads = defaultThreads();
+    bool bench = false, deep = false, session = false, checkDeep = false;
+    const char* deepRe = "0";
+    const char* deepIm = "1";
+    double deepZoom = 1e20;
+    int deepIter = 200;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--scalar")) {
+            simdEnabled() = false;
+        } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            threads = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--bench")) {
+            bench = true;
+        } else if (!strcmp(argv[i], "--session")) {
+            session = true;
+        } else if (!strcmp(argv[i], "--check-deep")) {
+            checkDeep = true;
+        } else if (!strcmp(argv[i], "--deep")) {
+            deep = true;
+            if (i + 4 < argc && strncmp(argv[i + 1], "--", 2) != 0) {
+                deepRe = argv[++i];
+                deepIm = argv[++i];
+                deepZoom = atof(argv[++i]);
+                deepIter = atoi(argv[++i]);
+            }
+        } else {
+            fprintf(stderr, "用法: %s [--scalar] [--threads N] [--bench] [--session] [--check-deep] [--deep [实部 虚部 zoom 迭代次数]]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (bench) {
+        runBenchmark(1200, 800, threads);
+        return 0;
+    }
+    if (deep) {
+        renderDeep(deepRe, deepIm, deepZoom, deepIter, threads);
+        return 0;
+    }
+    if (session) {
+        runZoomSession(threads);
+        return 0;
+    }
+    if (checkDeep) return runDeepZoomCheck(threads) ? 1 : 0;
+
     const int W = 1200, H = 800;
     
     // 1. 基础全景
     generateMandelbrot("mandelbrot_basic.png", W, H, 
-                       -0.5, 0.0, 1.0, 256, 0);
+                       -0.5, 0.0, 1.0, 256, 0, threads);
     
     // 2. 放大 "海马谷" (Seahorse Valley)
     generateMandelbrot("mandelbrot_zoom1.png", W, H,
-                       -0.75, 0.1, 8.0, 512, 1);
+                       -0.75, 0.1, 8.0, 512, 1, threads);
     
     // 3. 深度放大 - 螺旋区域
     generateMandelbrot("mandelbrot_zoom2.png", W, H,
-                       -0.7269, 0.1889, 200.0, 1000, 2);
+                       -0.7269, 0.1889, 200.0, 1000, 2, threads);
     
     // 4. 彩虹配色全景
     generateMandelbrot("mandelbrot_rainbow.png", W, H,
-                       -0.5, 0.0, 1.0, 256, 2);
+                       -0.5, 0.0, 1.0, 256, 2, threads);
     
     // 5. 经典"象谷"区域
     generateMandelbrot("mandelbrot_elephant.png", W, H,
-                       0.3, 0.0, 3.0, 400, 3);
+                       0.3, 0.0, 3.0, 400, 3, threads);
     
     return 0;
 }
@@ -5,16 +5,46 @@
 #include <random>
 #include <algorithm>
 #include <functional>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "../common/perf.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NOISE_X86 1
+#endif
+
+// 批量接口是否走 SIMD：启动时按 CPU 检测，--scalar 可以关掉
+inline bool& simdEnabled() {
+#ifdef NOISE_X86
+    static bool enabled = __builtin_cpu_supports("avx2");
+#else
+    static bool enabled = false;
+#endif
+    return enabled;
+}
 
 // ========== Perlin 噪声 ==========
 class PerlinNoise {
 private:
     std::vector<int> p;
     
-    double fade(double t) { return t * t * t * (t * (t * 6 - 15) + 10); }
-    double lerp(double t, double a, double b) { return a + t * (b - a); }
+    double fade(double t) const { return t * t * t * (t * (t * 6 - 15) + 10); }
+    double lerp(double t, double a, double b) const { return a + t * (b - a); }
     
-    double grad(int hash, double x, double y, double z) {
+    double grad(int hash, double x, double y, double z) const {
         int h = hash & 15;
         double u = h < 8 ? x : y;
         double v = h < 4 ? y : h == 12 || h == 14 ? x : z;
@@ -34,7 +64,7 @@ public:
             p[i] = permutation[i % 256];
     }
     
-    double noise(double x, double y, double z) {
+    double noise(double x, double y, double z) const {
         int X = (int)floor(x) & 255;
         int Y = (int)floor(y) & 255;
         int Z = (int)floor(z) & 255;
@@ -61,7 +91,7 @@ public:
     }
     
     // 分形布朗运动
-    double fbm(double x, double y, double z, int octaves, double persistence) {
+    double fbm(double x, double y, double z, int octaves, double persistence) const {
         double total = 0;
         double frequency = 1;
         double amplitude = 1;
@@ -76,6 +106,13 @@ public:
         
         return total / maxValue;
     }
+
+    // 批量求值：xs/ys/zs 是 SoA 坐标数组（zs 为 nullptr 表示 z = 0），结果写进 out[0, n)。
+    // 支持 AVX2 时每次 8 个点，结果与逐点调用 noise / fbm 逐位相同
+    void noiseBatch(const double* xs, const double* ys, const double* zs, double* out, size_t n) const;
+    // 8 个像素一组，组内把所有倍频程累加完再写回（累加器始终在寄存器里）
+    void fbmBatch(const double* xs, const double* ys, const double* zs, double* out, size_t n,
+                  int octaves, double persistence) const;
 };
 
 // ========== Simplex 噪声 ==========
@@ -85,7 +122,7 @@ private:
     
     static const int grad3[12][3];
     
-    double dot(const int g[3], double x, double y, double z) {
+    double dot(const int g[3], double x, double y, double z) const {
         return g[0] * x + g[1] * y + g[2] * z;
     }
     
@@ -102,7 +139,7 @@ public:
             perm[i] = p[i % 256];
     }
     
-    double noise(double xin, double yin, double zin) {
+    double noise(double xin, double yin, double zin) const {
         double n0, n1, n2, n3;
         const double F3 = 1.0 / 3.0;
         const double G3 = 1.0 / 6.0;
@@ -180,6 +217,9 @@ public:
         
         return 32.0 * (n0 + n1 + n2 + n3);
     }
+
+    // 批量求值，约定同 PerlinNoise::noiseBatch
+    void noiseBatch(const double* xs, const double* ys, const double* zs, double* out, size_t n) const;
 };
 
 const int SimplexNoise::grad3[12][3] = {
@@ -188,44 +228,655 @@ const int SimplexNoise::grad3[12][3] = {
     {0,1,1}, {0,-1,1}, {0,1,-1}, {0,-1,-1}
 };
 
+// ========== 批量 SIMD 求值 ==========
+// 8 条车道：排列表下标放在一个 __m256i 里用 gather 查表，double 运算拆成高低两个 __m256d。
+// 运算顺序与标量版本完全一致、不引入 FMA（avx2 目标不含 FMA），所以结果逐位相同
+
+#ifdef NOISE_X86
+#define NOISE_AVX2 __attribute__((target("avx2")))
+
+namespace simd {
+
+struct D8 {
+    __m256d lo, hi;
+};
+
+NOISE_AVX2 inline D8 set8(double v) { return {_mm256_set1_pd(v), _mm256_set1_pd(v)}; }
+NOISE_AVX2 inline D8 load8(const double* p) { return {_mm256_loadu_pd(p), _mm256_loadu_pd(p + 4)}; }
+NOISE_AVX2 inline void store8(double* p, D8 v) {
+    _mm256_storeu_pd(p, v.lo);
+    _mm256_storeu_pd(p + 4, v.hi);
+}
+NOISE_AVX2 inline D8 operator+(D8 a, D8 b) { return {_mm256_add_pd(a.lo, b.lo), _mm256_add_pd(a.hi, b.hi)}; }
+NOISE_AVX2 inline D8 operator-(D8 a, D8 b) { return {_mm256_sub_pd(a.lo, b.lo), _mm256_sub_pd(a.hi, b.hi)}; }
+NOISE_AVX2 inline D8 operator*(D8 a, D8 b) { return {_mm256_mul_pd(a.lo, b.lo), _mm256_mul_pd(a.hi, b.hi)}; }
+NOISE_AVX2 inline D8 operator/(D8 a, D8 b) { return {_mm256_div_pd(a.lo, b.lo), _mm256_div_pd(a.hi, b.hi)}; }
+NOISE_AVX2 inline D8 operator&(D8 a, D8 b) { return {_mm256_and_pd(a.lo, b.lo), _mm256_and_pd(a.hi, b.hi)}; }
+NOISE_AVX2 inline D8 operator|(D8 a, D8 b) { return {_mm256_or_pd(a.lo, b.lo), _mm256_or_pd(a.hi, b.hi)}; }
+// ~a & b
+NOISE_AVX2 inline D8 andNot(D8 a, D8 b) { return {_mm256_andnot_pd(a.lo, b.lo), _mm256_andnot_pd(a.hi, b.hi)}; }
+NOISE_AVX2 inline D8 negate(D8 a) { return {_mm256_xor_pd(a.lo, _mm256_set1_pd(-0.0)), _mm256_xor_pd(a.hi, _mm256_set1_pd(-0.0))}; }
+NOISE_AVX2 inline D8 floor8(D8 a) { return {_mm256_floor_pd(a.lo), _mm256_floor_pd(a.hi)}; }
+// mask 车道全 1 时取 b，否则取 a
+NOISE_AVX2 inline D8 select(D8 mask, D8 a, D8 b) {
+    return {_mm256_blendv_pd(a.lo, b.lo, mask.lo), _mm256_blendv_pd(a.hi, b.hi, mask.hi)};
+}
+NOISE_AVX2 inline D8 greaterEq(D8 a, D8 b) {
+    return {_mm256_cmp_pd(a.lo, b.lo, _CMP_GE_OQ), _mm256_cmp_pd(a.hi, b.hi, _CMP_GE_OQ)};
+}
+NOISE_AVX2 inline D8 less(D8 a, D8 b) {
+    return {_mm256_cmp_pd(a.lo, b.lo, _CMP_LT_OQ), _mm256_cmp_pd(a.hi, b.hi, _CMP_LT_OQ)};
+}
+// 已是整数的 double 转 int32（对应标量版的 (int)floor(x)）
+NOISE_AVX2 inline __m256i toInt(D8 a) {
+    return _mm256_set_m128i(_mm256_cvttpd_epi32(a.hi), _mm256_cvttpd_epi32(a.lo));
+}
+NOISE_AVX2 inline D8 toDouble(__m256i v) {
+    return {_mm256_cvtepi32_pd(_mm256_castsi256_si128(v)), _mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1))};
+}
+// int32 车道掩码（0 / -1）扩展成 64 位车道掩码
+NOISE_AVX2 inline D8 widenMask(__m256i m) {
+    return {_mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm256_castsi256_si128(m))),
+            _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm256_extracti128_si256(m, 1)))};
+}
+NOISE_AVX2 inline __m256i gather(const int* table, __m256i idx) { return _mm256_i32gather_epi32(table, idx, 4); }
+// 带掩码的形式显式给出初值（无掩码版本在 GCC 12 下会报未初始化的误警）
+NOISE_AVX2 inline D8 gatherDouble(const double* table, __m256i idx) {
+    __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    return {_mm256_mask_i32gather_pd(_mm256_setzero_pd(), table, _mm256_castsi256_si128(idx), all, 8),
+            _mm256_mask_i32gather_pd(_mm256_setzero_pd(), table, _mm256_extracti128_si256(idx, 1), all, 8)};
+}
+NOISE_AVX2 inline __m256i addInt(__m256i a, int b) { return _mm256_add_epi32(a, _mm256_set1_epi32(b)); }
+NOISE_AVX2 inline __m256i equal(__m256i a, int b) { return _mm256_cmpeq_epi32(a, _mm256_set1_epi32(b)); }
+NOISE_AVX2 inline __m256i addInt(__m256i a, __m256i b) { return _mm256_add_epi32(a, b); }
+NOISE_AVX2 inline __m256i and255(__m256i a) { return _mm256_and_si256(a, _mm256_set1_epi32(255)); }
+
+// ---------- Perlin ----------
+
+NOISE_AVX2 inline D8 fade(D8 t) { return t * t * t * (t * (t * set8(6) - set8(15)) + set8(10)); }
+NOISE_AVX2 inline D8 lerp(D8 t, D8 a, D8 b) { return a + t * (b - a); }
+
+NOISE_AVX2 inline D8 grad(__m256i hash, D8 x, D8 y, D8 z) {
+    __m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(15));
+    D8 u = select(widenMask(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), h)), y, x);               // h < 8 ? x : y
+    D8 xz = select(widenMask(_mm256_or_si256(equal(h, 12), equal(h, 14))), z, x);                   // h == 12 || h == 14 ? x : z
+    D8 v = select(widenMask(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h)), xz, y);             // h < 4 ? y : ...
+    __m256i one = _mm256_set1_epi32(1), two = _mm256_set1_epi32(2);
+    u = select(widenMask(_mm256_cmpeq_epi32(_mm256_and_si256(h, one), one)), u, negate(u));
+    v = select(widenMask(_mm256_cmpeq_epi32(_mm256_and_si256(h, two), two)), v, negate(v));
+    return u + v;
+}
+
+NOISE_AVX2 inline D8 perlin8(const int* p, D8 x, D8 y, D8 z) {
+    D8 fx = floor8(x), fy = floor8(y), fz = floor8(z);
+    __m256i X = and255(toInt(fx)), Y = and255(toInt(fy)), Z = and255(toInt(fz));
+    x = x - fx;
+    y = y - fy;
+    z = z - fz;
+    D8 u = fade(x), v = fade(y), w = fade(z);
+
+    __m256i A = addInt(gather(p, X), Y), AA = addInt(gather(p, A), Z), AB = addInt(gather(p, addInt(A, 1)), Z);
+    __m256i B = addInt(gather(p, addInt(X, 1)), Y), BA = addInt(gather(p, B), Z), BB = addInt(gather(p, addInt(B, 1)), Z);
+    D8 one = set8(1);
+    D8 x1 = x - one, y1 = y - one, z1 = z - one;
+
+    return lerp(w, lerp(v, lerp(u, grad(gather(p, AA), x, y, z), grad(gather(p, BA), x1, y, z)),
+                           lerp(u, grad(gather(p, AB), x, y1, z), grad(gather(p, BB), x1, y1, z))),
+                   lerp(v, lerp(u, grad(gather(p, addInt(AA, 1)), x, y, z1), grad(gather(p, addInt(BA, 1)), x1, y, z1)),
+                           lerp(u, grad(gather(p, addInt(AB, 1)), x, y1, z1), grad(gather(p, addInt(BB, 1)), x1, y1, z1))));
+}
+
+NOISE_AVX2 inline D8 loadZ(const double* zs, size_t i) { return zs ? load8(zs + i) : set8(0); }
+
+// 处理 n 向下取整到 8 的倍数的部分，返回处理的个数；剩下的由调用方逐点补齐
+NOISE_AVX2 inline size_t perlinBatch(const int* p, const double* xs, const double* ys, const double* zs,
+                                     double* out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) store8(out + i, perlin8(p, load8(xs + i), load8(ys + i), loadZ(zs, i)));
+    return i;
+}
+
+NOISE_AVX2 inline size_t fbmBatch(const int* p, const double* xs, const double* ys, const double* zs, double* out,
+                                  size_t n, int octaves, double persistence) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        D8 x = load8(xs + i), y = load8(ys + i), z = loadZ(zs, i);
+        D8 total = set8(0);
+        double frequency = 1, amplitude = 1, maxValue = 0;
+        for (int o = 0; o < octaves; o++) {
+            D8 f = set8(frequency);
+            total = total + perlin8(p, x * f, y * f, z * f) * set8(amplitude);
+            maxValue += amplitude;
+            amplitude *= persistence;
+            frequency *= 2;
+        }
+        store8(out + i, total / set8(maxValue));
+    }
+    return i;
+}
+
+// ---------- Simplex ----------
+
+// 12 个梯度方向的 x / y / z 分量（与 SimplexNoise::grad3 相同）
+alignas(32) static const double kGrad3X[12] = {1, -1, 1, -1, 1, -1, 1, -1, 0, 0, 0, 0};
+alignas(32) static const double kGrad3Y[12] = {1, 1, -1, -1, 0, 0, 0, 0, 1, -1, 1, -1};
+alignas(32) static const double kGrad3Z[12] = {0, 0, 0, 0, 1, 1, -1, -1, 1, 1, -1, -1};
+
+// h % 12（0 <= h < 1024 时 h * 0xAAAB >> 19 恰好等于 h / 12）
+NOISE_AVX2 inline __m256i mod12(__m256i h) {
+    __m256i q = _mm256_srli_epi32(_mm256_mullo_epi32(h, _mm256_set1_epi32(0xAAAB)), 19);
+    return _mm256_sub_epi32(h, _mm256_mullo_epi32(q, _mm256_set1_epi32(12)));
+}
+
+// perm[ii + di + perm[jj + dj + perm[kk + dk]]] % 12
+NOISE_AVX2 inline __m256i simplexHash(const int* perm, __m256i ii, __m256i jj, __m256i kk,
+                                      __m256i di, __m256i dj, __m256i dk) {
+    __m256i h = gather(perm, addInt(kk, dk));
+    h = gather(perm, addInt(addInt(jj, dj), h));
+    return mod12(gather(perm, addInt(addInt(ii, di), h)));
+}
+
+NOISE_AVX2 inline D8 simplexCorner(__m256i gi, D8 x, D8 y, D8 z) {
+    D8 t = set8(0.6) - x * x - y * y - z * z;
+    D8 dot = gatherDouble(kGrad3X, gi) * x + gatherDouble(kGrad3Y, gi) * y + gatherDouble(kGrad3Z, gi) * z;
+    D8 t2 = t * t;
+    return select(less(t, set8(0)), t2 * t2 * dot, set8(0));
+}
+
+NOISE_AVX2 inline D8 simplex8(const int* perm, D8 xin, D8 yin, D8 zin) {
+    const double F3 = 1.0 / 3.0;
+    const double G3 = 1.0 / 6.0;
+    D8 s = (xin + yin + zin) * set8(F3);
+    D8 fi = floor8(xin + s), fj = floor8(yin + s), fk = floor8(zin + s);
+    __m256i i = toInt(fi), j = toInt(fj), k = toInt(fk);
+    D8 t = toDouble(addInt(addInt(i, j), k)) * set8(G3);
+    D8 x0 = xin - (fi - t), y0 = yin - (fj - t), z0 = zin - (fk - t);
+
+    // 单纯形内的遍历顺序：与标量版的 if/else 分支逐一对应
+    D8 xy = greaterEq(x0, y0), yz = greaterEq(y0, z0), xz = greaterEq(x0, z0);
+    D8 one = set8(1);
+    D8 i1 = xy & (yz | xz) & one;
+    D8 j1 = andNot(xy, yz) & one;
+    D8 k1 = ((andNot(yz, andNot(xz, xy))) | andNot(xy, andNot(yz, one))) & one;
+    D8 i2 = (xy | (yz & xz)) & one;
+    D8 j2 = ((xy & yz) | andNot(xy, one)) & one;
+    D8 k2 = (andNot(yz, xy) | andNot(xy, andNot(yz & xz, one))) & one;
+
+    D8 g3 = set8(G3), g3x2 = set8(2.0 * G3), g3x3 = set8(3.0 * G3);
+    D8 x1 = x0 - i1 + g3, y1 = y0 - j1 + g3, z1 = z0 - k1 + g3;
+    D8 x2 = x0 - i2 + g3x2, y2 = y0 - j2 + g3x2, z2 = z0 - k2 + g3x2;
+    D8 x3 = x0 - one + g3x3, y3 = y0 - one + g3x3, z3 = z0 - one + g3x3;
+
+    __m256i ii = and255(i), jj = and255(j), kk = and255(k);
+    __m256i zero = _mm256_setzero_si256(), ones = _mm256_set1_epi32(1);
+    __m256i gi0 = simplexHash(perm, ii, jj, kk, zero, zero, zero);
+    __m256i gi1 = simplexHash(perm, ii, jj, kk, toInt(i1), toInt(j1), toInt(k1));
+    __m256i gi2 = simplexHash(perm, ii, jj, kk, toInt(i2), toInt(j2), toInt(k2));
+    __m256i gi3 = simplexHash(perm, ii, jj, kk, ones, ones, ones);
+
+    D8 n0 = simplexCorner(gi0, x0, y0, z0);
+    D8 n1 = simplexCorner(gi1, x1, y1, z1);
+    D8 n2 = simplexCorner(gi2, x2, y2, z2);
+    D8 n3 = simplexCorner(gi3, x3, y3, z3);
+    return set8(32.0) * (n0 + n1 + n2 + n3);
+}
+
+NOISE_AVX2 inline size_t simplexBatch(const int* perm, const double* xs, const double* ys, const double* zs,
+                                      double* out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) store8(out + i, simplex8(perm, load8(xs + i), load8(ys + i), loadZ(zs, i)));
+    return i;
+}
+
+} // namespace simd
+#endif
+
+void PerlinNoise::noiseBatch(const double* xs, const double* ys, const double* zs, double* out, size_t n) const {
+    size_t i = 0;
+#ifdef NOISE_X86
+    if (simdEnabled()) i = simd::perlinBatch(p.data(), xs, ys, zs, out, n);
+#endif
+    for (; i < n; i++) out[i] = noise(xs[i], ys[i], zs ? zs[i] : 0.0);
+}
+
+void PerlinNoise::fbmBatch(const double* xs, const double* ys, const double* zs, double* out, size_t n,
+                           int octaves, double persistence) const {
+    size_t i = 0;
+#ifdef NOISE_X86
+    if (simdEnabled()) i = simd::fbmBatch(p.data(), xs, ys, zs, out, n, octaves, persistence);
+#endif
+    for (; i < n; i++) out[i] = fbm(xs[i], ys[i], zs ? zs[i] : 0.0, octaves, persistence);
+}
+
+void SimplexNoise::noiseBatch(const double* xs, const double* ys, const double* zs, double* out, size_t n) const {
+    size_t i = 0;
+#ifdef NOISE_X86
+    if (simdEnabled()) i = simd::simplexBatch(perm.data(), xs, ys, zs, out, n);
+#endif
+    for (; i < n; i++) out[i] = noise(xs[i], ys[i], zs ? zs[i] : 0.0);
+}
+
 // ========== Worley 噪声 (Cellular/Voronoi) ==========
+// 一次采样的全部结果（距离都已开方，单位是格子边长）
+struct CellularSample {
+    double f1 = 0;        // 到最近特征点的距离
+    double f2 = 0;        // 到次近特征点的距离
+    double edge = 0;      // 到最近 Voronoi 边（最近点与其它点的中垂线）的距离；
+                          // cellular(..., withEdge = false) 时只是近似值 (F2 - F1) / 2，是精确值的下界
+    uint32_t cellId = 0;  // 最近特征点所在格子的哈希，可用来给胞元上色
+};
+
+// 特征点由 (格子坐标, 种子, 点序号) 的整数哈希直接算出，没有可变状态：
+// 同一个对象可以被多个线程同时采样
 class WorleyNoise {
 private:
-    std::mt19937 rng;
-    
-    double distance(double x1, double y1, double x2, double y2) {
-        double dx = x2 - x1;
-        double dy = y2 - y1;
-        return sqrt(dx * dx + dy * dy);
+    uint32_t seed;
+
+    // lowbias32 整数哈希（雪崩性好，两次乘法）
+    static uint32_t mix(uint32_t h) {
+        h ^= h >> 16;
+        h *= 0x7feb352du;
+        h ^= h >> 15;
+        h *= 0x846ca68bu;
+        h ^= h >> 16;
+        return h;
     }
-    
+
+    uint32_t cellHash(int cx, int cy) const {
+        return mix((uint32_t)cx * 0x8da6b343u ^ (uint32_t)cy * 0xd8163841u ^ seed * 0xcb1ab31fu);
+    }
+
+    // 格子内第 k 个特征点的位置，分量在 [0, 1)（16 位精度）
+    static void featurePoint(uint32_t cell, int k, double& fx, double& fy) {
+        uint32_t h = mix(cell + (uint32_t)k * 0x9e3779b9u);
+        fx = (h & 0xffff) * (1.0 / 65536);
+        fy = (h >> 16) * (1.0 / 65536);
+    }
+
+    // 点到格子 [cx, cx+1) x [cy, cy+1) 的最小平方距离，点在格内时为 0
+    static double cellDistance2(double x, double y, int cx, int cy) {
+        double dx = std::max({cx - x, 0.0, x - (cx + 1)});
+        double dy = std::max({cy - y, 0.0, y - (cy + 1)});
+        return dx * dx + dy * dy;
+    }
+
+    // 以 (cx, cy) 为中心、切比雪夫半径为 r 的一圈格子
+    template <typename Fn>
+    static void forRing(int cx, int cy, int r, Fn&& fn) {
+        if (r == 0) {
+            fn(cx, cy);
+            return;
+        }
+        for (int d = -r; d <= r; d++) {
+            fn(cx + d, cy - r);
+            fn(cx + d, cy + r);
+        }
+        for (int d = -r + 1; d < r; d++) {
+            fn(cx - r, cy + d);
+            fn(cx + r, cy + d);
+        }
+    }
+
 public:
-    WorleyNoise(unsigned int seed = 0) : rng(seed) {}
-    
-    double noise(double x, double y, int numPoints = 10) {
+    WorleyNoise(unsigned int seed = 0) : seed(seed) {}
+
+    // F1 / F2 / 边距离。由内向外一圈圈搜索，比较的都是平方距离：
+    // 整格的最小距离已经不小于当前 F2 的格子直接跳过，某一圈整体不可能更近时停止，
+    // 所以结果是精确的（不局限于 3x3 邻域）。withEdge = false 省掉求边距离的第二遍，
+    // edge 改填精确边距离的下界 (F2 - F1) / 2（三角不等式：任一中垂线距离 ≥ (D - F1) / 2 ≥ (F2 - F1) / 2）
+    CellularSample cellular(double x, double y, int numPoints = 1, bool withEdge = true) const {
+        const double inf = std::numeric_limits<double>::infinity();
         int cellX = (int)floor(x);
         int cellY = (int)floor(y);
-        
-        double minDist = 999999;
-        
-        for (int dx = -1; dx <= 1; dx++) {
-            for (int dy = -1; dy <= 1; dy++) {
-                int nx = cellX + dx;
-                int ny = cellY + dy;
-                
-                rng.seed(nx * 374761393 + ny * 668265263);
-                std::uniform_real_distribution<double> dist(0, 1);
-                
-                for (int p = 0; p < numPoints; p++) {
-                    double px = nx + dist(rng);
-                    double py = ny + dist(rng);
-                    double d = distance(x, y, px, py);
-                    minDist = std::min(minDist, d);
+
+        double f1 = inf, f2 = inf;
+        double p1x = 0, p1y = 0;
+        uint32_t id = 0;
+        // 半径 r 这一圈到采样点的距离至少是 r - 1
+        for (int r = 0; r == 0 || (r - 1) * (r - 1) < f2; r++) {
+            forRing(cellX, cellY, r, [&](int cx, int cy) {
+                if (cellDistance2(x, y, cx, cy) >= f2) return;
+                uint32_t h = cellHash(cx, cy);
+                for (int k = 0; k < numPoints; k++) {
+                    double fx, fy;
+                    featurePoint(h, k, fx, fy);
+                    double dx = cx + fx - x, dy = cy + fy - y;
+                    double d = dx * dx + dy * dy;
+                    if (d < f1) {
+                        f2 = f1;
+                        f1 = d;
+                        p1x = cx + fx;
+                        p1y = cy + fy;
+                        id = h;
+                    } else if (d < f2) {
+                        f2 = d;
+                    }
                 }
+            });
+        }
+
+        CellularSample out;
+        out.f1 = sqrt(f1);
+        out.f2 = sqrt(f2);
+        out.cellId = id;
+        if (!withEdge) {
+            out.edge = (out.f2 - out.f1) * 0.5;
+            return out;
+        }
+
+        // 第二遍：到最近点与其它每个点中垂线的距离取最小。
+        // 距采样点 D 处的点给出的边距离不小于 (D - F1) / 2，据此同样可以按格子剔除
+        double edge = inf;
+        for (int r = 0; r <= 1 || r - 1 < out.f1 + 2 * edge; r++) {
+            forRing(cellX, cellY, r, [&](int cx, int cy) {
+                double bound = sqrt(cellDistance2(x, y, cx, cy));
+                if (bound >= out.f1 + 2 * edge) return;
+                uint32_t h = cellHash(cx, cy);
+                for (int k = 0; k < numPoints; k++) {
+                    double fx, fy;
+                    featurePoint(h, k, fx, fy);
+                    double nx = cx + fx - p1x, ny = cy + fy - p1y;
+                    double len2 = nx * nx + ny * ny;
+                    if (len2 == 0) continue;  // 最近点自己
+                    double mx = (cx + fx + p1x) * 0.5 - x, my = (cy + fy + p1y) * 0.5 - y;
+                    edge = std::min(edge, (mx * nx + my * ny) / sqrt(len2));
+                }
+            });
+        }
+        out.edge = edge;
+        return out;
+    }
+
+    // F1 距离
+    double noise(double x, double y, int numPoints = 10) const {
+        return cellular(x, y, numPoints, false).f1;
+    }
+};
+
+// ========== 地形瓦片缓存（按需生成 + LRU 淘汰） ==========
+// 无限地形 = PerlinNoise::fbm 的高度场，按 (瓦片 x, 瓦片 y, LOD) 切成 tileSize² 的瓦片。
+// LOD L 的瓦片采样间隔是 2^L 个基础采样点，并少算 L 个倍频程（更细的细节小于一个采样点）。
+// 瓦片在后台线程生成：get() 的请求优先，prefetch() 的排在后面；
+// 常驻瓦片超出内存上限时淘汰最久未用的
+
+struct TileKey {
+    int x = 0, y = 0, lod = 0;
+    bool operator==(const TileKey& o) const { return x == o.x && y == o.y && lod == o.lod; }
+};
+
+struct TileKeyHash {
+    size_t operator()(const TileKey& k) const {
+        uint64_t h = (uint64_t)(uint32_t)k.x * 0x9e3779b97f4a7c15ull ^ (uint64_t)(uint32_t)k.y * 0xc2b2ae3d27d4eb4full ^
+                     (uint64_t)(uint32_t)k.lod * 0x165667b19e3779f9ull;
+        return (size_t)(h ^ (h >> 29));
+    }
+};
+
+struct TerrainTile {
+    TileKey key;
+    int size = 0;
+    std::vector<float> heights;  // size x size，行优先
+
+    float at(int x, int y) const { return heights[(size_t)y * size + x]; }
+};
+
+// 视口：左上角和宽高都以 LOD 0 的采样点为单位，按 lod 的采样间隔取样
+struct TerrainView {
+    double x = 0, y = 0;
+    int width = 0, height = 0;  // 像素
+    int lod = 0;
+};
+
+class TerrainTileCache {
+public:
+    struct Config {
+        int tileSize = 128;
+        double scale = 0.005;       // LOD 0 相邻采样点在噪声空间中的间距
+        int octaves = 8;
+        double persistence = 0.5;
+        size_t memoryCap = 64 << 20;  // 常驻瓦片的字节上限
+        int threads = 0;              // 0 = 硬件线程数
+        size_t maxPrefetch = 256;     // 预取队列上限，满了丢弃最早的
+    };
+
+    struct Stats {
+        size_t hits = 0;          // get() / tryGet() 时已就绪
+        size_t waits = 0;         // get() 时还没就绪，需要等待
+        size_t prefetchHits = 0;  // 命中中，瓦片由预取生成且是第一次被用到
+        size_t generated = 0;
+        size_t evicted = 0;
+        size_t droppedPrefetch = 0;
+        size_t residentBytes = 0;
+        size_t peakBytes = 0;
+        size_t residentTiles = 0;
+    };
+
+    TerrainTileCache(const PerlinNoise& noise, const Config& config) : noise(noise), cfg(config) {
+        int n = cfg.threads > 0 ? cfg.threads : (int)std::max(1u, std::thread::hardware_concurrency());
+        for (int i = 0; i < n; i++) workers.emplace_back([this] { workerLoop(); });
+    }
+
+    ~TerrainTileCache() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        workAvailable.notify_all();
+        for (std::thread& t : workers) t.join();
+    }
+
+    TerrainTileCache(const TerrainTileCache&) = delete;
+    TerrainTileCache& operator=(const TerrainTileCache&) = delete;
+
+    const Config& config() const { return cfg; }
+
+    // 阻塞获取：未就绪时插到需求队列最前面并等待。返回的瓦片即使随后被淘汰也仍然有效
+    std::shared_ptr<const TerrainTile> get(const TileKey& key) {
+        std::unique_lock<std::mutex> lock(mutex);
+        Entry& e = request(key, true);
+        if (e.state == State::Ready) {
+            hit(e);
+        } else {
+            // 等待期间钉住条目，防止它刚就绪就被别的瓦片挤出去
+            stats_.waits++;
+            e.pins++;
+            tileReady.wait(lock, [&] { return e.state == State::Ready; });
+            e.pins--;
+            touch(e);
+        }
+        return e.tile;
+    }
+
+    // 非阻塞：就绪则返回，否则发起生成请求并返回 nullptr（之后再 get() 等它）
+    std::shared_ptr<const TerrainTile> tryGet(const TileKey& key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry& e = request(key, true);
+        if (e.state != State::Ready) return nullptr;
+        hit(e);
+        return e.tile;
+    }
+
+    // 低优先级请求：已缓存或已在队列中的瓦片不会重复生成
+    void prefetch(const TileKey& key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        request(key, false);
+    }
+
+    // 视口覆盖的瓦片（含部分覆盖的）
+    void tilesInView(const TerrainView& v, std::vector<TileKey>& out) const {
+        out.clear();
+        double span = (double)cfg.tileSize * (1 << v.lod);  // 一个瓦片覆盖的 LOD 0 采样点数
+        double step = (double)(1 << v.lod);
+        int tx0 = (int)floor(v.x / span), tx1 = (int)floor((v.x + (v.width - 1) * step) / span);
+        int ty0 = (int)floor(v.y / span), ty1 = (int)floor((v.y + (v.height - 1) * step) / span);
+        for (int ty = ty0; ty <= ty1; ty++)
+            for (int tx = tx0; tx <= tx1; tx++) out.push_back({tx, ty, v.lod});
+    }
+
+    // 沿相机轨迹预取：视口按每帧 (vx, vy) 移动，把未来 steps 帧要进入的瓦片排进预取队列（近的先排）
+    void prefetchPath(const TerrainView& v, double vx, double vy, int steps) {
+        std::vector<TileKey> keys;
+        for (int s = 1; s <= steps; s++) {
+            TerrainView ahead = v;
+            ahead.x += vx * s;
+            ahead.y += vy * s;
+            tilesInView(ahead, keys);
+            for (const TileKey& k : keys) prefetch(k);
+        }
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats_;
+    }
+
+    // 单个瓦片的生成（也供测试直接比对）：每行用 fbmBatch 一次算完
+    void generate(const TileKey& key, TerrainTile& tile) const {
+        PERF_ZONE("noise.terrain_tile");
+        int n = cfg.tileSize;
+        double step = cfg.scale * (1 << key.lod);
+        int octaves = std::max(1, cfg.octaves - key.lod);
+        tile.key = key;
+        tile.size = n;
+        tile.heights.resize((size_t)n * n);
+        std::vector<double> xs(n), ys(n), row(n);
+        for (int i = 0; i < n; i++) xs[i] = ((double)key.x * n + i) * step;
+        for (int j = 0; j < n; j++) {
+            std::fill(ys.begin(), ys.end(), ((double)key.y * n + j) * step);
+            noise.fbmBatch(xs.data(), ys.data(), nullptr, row.data(), n, octaves, cfg.persistence);
+            for (int i = 0; i < n; i++) tile.heights[(size_t)j * n + i] = (float)row[i];
+        }
+        PERF_COUNT("noise.samples", (uint64_t)n * n);  // 与其他调用点同一单位：输出的采样点数
+    }
+
+    size_t tileBytes() const { return sizeof(TerrainTile) + sizeof(float) * (size_t)cfg.tileSize * cfg.tileSize; }
+
+private:
+    enum class State { Queued, Generating, Ready };
+
+    struct Entry {
+        State state = State::Queued;
+        bool demanded = false;    // 已进入需求队列
+        bool prefetched = false;  // 由预取生成、还没被 get() 用过
+        int pins = 0;             // 正在 get() 里等待它的线程数，非零时不淘汰
+        std::shared_ptr<const TerrainTile> tile;
+        std::list<TileKey>::iterator lru;  // 只对 Ready 有效
+    };
+
+    const PerlinNoise& noise;
+    Config cfg;
+
+    mutable std::mutex mutex;
+    std::condition_variable workAvailable, tileReady;
+    std::unordered_map<TileKey, Entry, TileKeyHash> entries;
+    std::list<TileKey> lruList;  // 前面最近使用
+    std::deque<TileKey> demandQueue, prefetchQueue;
+    Stats stats_;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+
+    // 调用方持有锁。找到或创建条目，必要时放进相应队列
+    Entry& request(const TileKey& key, bool demand) {
+        auto [it, inserted] = entries.try_emplace(key);
+        Entry& e = it->second;
+        if (inserted) {
+            if (demand) {
+                e.demanded = true;
+                demandQueue.push_back(key);
+            } else {
+                e.prefetched = true;
+                prefetchQueue.push_back(key);
+                if (prefetchQueue.size() > cfg.maxPrefetch) dropOldestPrefetch();
             }
+            workAvailable.notify_one();
+        } else if (demand && e.state == State::Queued && !e.demanded) {
+            // 已在预取队列里：提到需求队列前面，预取队列里的旧记录由工作线程跳过
+            e.demanded = true;
+            e.prefetched = false;
+            demandQueue.push_front(key);
+            workAvailable.notify_one();
+        }
+        return e;
+    }
+
+    void dropOldestPrefetch() {
+        while (!prefetchQueue.empty()) {
+            TileKey old = prefetchQueue.front();
+            prefetchQueue.pop_front();
+            auto it = entries.find(old);
+            if (it != entries.end() && it->second.state == State::Queued && !it->second.demanded) {
+                entries.erase(it);
+                stats_.droppedPrefetch++;
+                return;
+            }
+        }
+    }
+
+    void touch(Entry& e) { lruList.splice(lruList.begin(), lruList, e.lru); }
+
+    void hit(Entry& e) {
+        stats_.hits++;
+        if (e.prefetched) stats_.prefetchHits++;
+        e.prefetched = false;
+        touch(e);
+    }
+
+    // 调用方持有锁。新瓦片就绪后把常驻内存压回上限以内；
+    // 刚生成的瓦片（链表头）和被钉住的瓦片不淘汰，全被钉住时允许暂时超出上限
+    void evictToCap() {
+        size_t bytes = tileBytes();
+        auto it = lruList.end();
+        while (stats_.residentBytes > cfg.memoryCap && it != lruList.begin() && std::prev(it) != lruList.begin()) {
+            --it;
+            auto victim = entries.find(*it);
+            if (victim->second.pins > 0) continue;
+            entries.erase(victim);
+            it = lruList.erase(it);
+            stats_.residentBytes -= bytes;
+            stats_.residentTiles--;
+            stats_.evicted++;
+        }
+    }
+
+    bool popWork(TileKey& key) {
+        for (std::deque<TileKey>* q : {&demandQueue, &prefetchQueue}) {
+            while (!q->empty()) {
+                key = q->front();
+                q->pop_front();
+                auto it = entries.find(key);
+                // 跳过已被丢弃、已提升到需求队列或已在生成的重复记录
+                if (it == entries.end() || it->second.state != State::Queued) continue;
+                it->second.state = State::Generating;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            TileKey key;
+            workAvailable.wait(lock, [&] { return stopping || popWork(key); });
+            if (stopping) return;
+
+            lock.unlock();
+            auto tile = std::make_shared<TerrainTile>();
+            generate(key, *tile);
+            lock.lock();
+
+            Entry& e = entries.at(key);  // Generating 状态的条目不会被删除
+            e.tile = std::move(tile);
+            e.state = State::Ready;
+            lruList.push_front(key);
+            e.lru = lruList.begin();
+            stats_.generated++;
+            stats_.residentTiles++;
+            stats_.residentBytes += tileBytes();
+            stats_.peakBytes = std::max(stats_.peakBytes, stats_.residentBytes);
+            evictToCap();
+            tileReady.notify_all();
         }
-        
-        return minDist;
     }
 };
 
@@ -236,24 +887,282 @@ void renderNoise(const char* filename, int width, int height,
     
     std::vector<unsigned char> pixels(width * height * 3);
     
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            double value = noiseFn(x * scale, y * scale);
-            value = (value + 1.0) * 0.5;  // [-1,1] → [0,1]
-            value = std::clamp(value, 0.0, 1.0);
-            
-            unsigned char gray = (unsigned char)(value * 255);
-            int idx = (y * width + x) * 3;
-            pixels[idx] = gray;
-            pixels[idx + 1] = gray;
-            pixels[idx + 2] = gray;
+    {
+        PERF_ZONE("noise.eval_points");
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                double value = noiseFn(x * scale, y * scale);
+                value = (value + 1.0) * 0.5;  // [-1,1] → [0,1]
+                value = std::clamp(value, 0.0, 1.0);
+
+                unsigned char gray = (unsigned char)(value * 255);
+                int idx = (y * width + x) * 3;
+                pixels[idx] = gray;
+                pixels[idx + 1] = gray;
+                pixels[idx + 2] = gray;
+            }
         }
     }
+    PERF_COUNT("noise.samples", (uint64_t)width * height);
     
+    PERF_ZONE("noise.write_png");
     stbi_write_png(filename, width, height, 3, pixels.data(), width * 3);
 }
 
-int main() {
+// 按行批量求值：每行先填好 SoA 坐标，fill(xs, ys, out, n) 一次算完一整行
+using RowFn = std::function<void(const double* xs, const double* ys, double* out, size_t n)>;
+
+void evalNoiseRows(int width, int height, const RowFn& fill, double scale, std::vector<double>& values) {
+    PERF_ZONE("noise.eval_rows");
+    values.resize((size_t)width * height);
+    std::vector<double> xs(width), ys(width);
+    for (int x = 0; x < width; x++) xs[x] = x * scale;
+    for (int y = 0; y < height; y++) {
+        std::fill(ys.begin(), ys.end(), y * scale);
+        fill(xs.data(), ys.data(), values.data() + (size_t)y * width, width);
+    }
+    PERF_COUNT("noise.samples", (uint64_t)width * height);
+}
+
+void renderNoiseRows(const char* filename, int width, int height, const RowFn& fill, double scale = 0.01) {
+    std::vector<double> values;
+    evalNoiseRows(width, height, fill, scale, values);
+
+    std::vector<unsigned char> pixels(width * height * 3);
+    for (size_t i = 0; i < values.size(); i++) {
+        double value = (values[i] + 1.0) * 0.5;  // [-1,1] → [0,1]
+        value = std::clamp(value, 0.0, 1.0);
+        unsigned char gray = (unsigned char)(value * 255);
+        pixels[i * 3] = pixels[i * 3 + 1] = pixels[i * 3 + 2] = gray;
+    }
+    PERF_ZONE("noise.write_png");
+    stbi_write_png(filename, width, height, 3, pixels.data(), width * 3);
+}
+
+// ========== 基准：逐点 vs 批量 ==========
+
+using Clock = std::chrono::steady_clock;
+
+static double msSince(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+// 同一张 size x size 的图分别逐点和批量求值，比较耗时并逐位校验
+static void runBenchmark(int size) {
+    PerlinNoise perlin(42);
+    SimplexNoise simplex(42);
+    const double scale = 0.01;
+
+    struct Case {
+        const char* name;
+        std::function<double(double, double)> point;
+        RowFn rows;
+    };
+    std::vector<Case> cases = {
+        {"perlin", [&](double x, double y) { return perlin.noise(x, y, 0); },
+         [&](const double* xs, const double* ys, double* out, size_t n) { perlin.noiseBatch(xs, ys, nullptr, out, n); }},
+        {"fbm x8", [&](double x, double y) { return perlin.fbm(x, y, 0, 8, 0.5); },
+         [&](const double* xs, const double* ys, double* out, size_t n) {
+             perlin.fbmBatch(xs, ys, nullptr, out, n, 8, 0.5);
+         }},
+        {"simplex", [&](double x, double y) { return simplex.noise(x, y, 0); },
+         [&](const double* xs, const double* ys, double* out, size_t n) { simplex.noiseBatch(xs, ys, nullptr, out, n); }},
+    };
+
+    printf("%d x %d, 批量路径: %s\n", size, size, simdEnabled() ? "AVX2" : "标量");
+    printf("%-8s %12s %12s %8s %8s\n", "噪声", "逐点 (ms)", "批量 (ms)", "加速", "校验");
+    for (const Case& c : cases) {
+        std::vector<double> ref((size_t)size * size), batch;
+        auto t0 = Clock::now();
+        for (int y = 0; y < size; y++)
+            for (int x = 0; x < size; x++) ref[(size_t)y * size + x] = c.point(x * scale, y * scale);
+        double pointMs = msSince(t0);
+
+        t0 = Clock::now();
+        evalNoiseRows(size, size, c.rows, scale, batch);
+        double batchMs = msSince(t0);
+
+        bool exact = std::memcmp(ref.data(), batch.data(), ref.size() * sizeof(double)) == 0;
+        printf("%-8s %12.1f %12.1f %7.2fx %8s\n", c.name, pointMs, batchMs, pointMs / batchMs,
+               exact ? "一致" : "不一致");
+    }
+
+    // Worley：旧实现对 3x3 邻域的每个格子重设一次 mt19937（初始化 624 个字）
+    WorleyNoise worley(42);
+    std::mt19937 rng;
+    auto reseedF1 = [&](double x, double y, int numPoints) {
+        int cellX = (int)floor(x), cellY = (int)floor(y);
+        double minDist = 999999;
+        for (int dx = -1; dx <= 1; dx++) {
+            for (int dy = -1; dy <= 1; dy++) {
+                int nx = cellX + dx, ny = cellY + dy;
+                rng.seed((uint32_t)nx * 374761393u + (uint32_t)ny * 668265263u);
+                std::uniform_real_distribution<double> dist(0, 1);
+                for (int p = 0; p < numPoints; p++) {
+                    double px = nx + dist(rng) - x, py = ny + dist(rng) - y;
+                    minDist = std::min(minDist, sqrt(px * px + py * py));
+                }
+            }
+        }
+        return minDist;
+    };
+    double sink = 0;
+    const double cellScale = 0.05;
+    printf("\n%-16s %12s %12s %8s\n", "worley", "重设 RNG (ms)", "哈希 (ms)", "加速");
+    for (int numPoints : {1, 10}) {
+        auto t0 = Clock::now();
+        for (int y = 0; y < size; y++)
+            for (int x = 0; x < size; x++) sink += reseedF1(x * cellScale, y * cellScale, numPoints);
+        double reseedMs = msSince(t0);
+        t0 = Clock::now();
+        for (int y = 0; y < size; y++)
+            for (int x = 0; x < size; x++) sink += worley.noise(x * cellScale, y * cellScale, numPoints);
+        double hashMs = msSince(t0);
+        char name[32];
+        snprintf(name, sizeof(name), "F1, %d 点/格", numPoints);
+        printf("%-16s %12.1f %12.1f %7.1fx\n", name, reseedMs, hashMs, reseedMs / hashMs);
+    }
+    auto t0 = Clock::now();
+    for (int y = 0; y < size; y++)
+        for (int x = 0; x < size; x++) sink += worley.cellular(x * cellScale, y * cellScale).edge;
+    printf("%-16s %12s %12.1f\n", "F1+F2+边, 1 点/格", "-", msSince(t0));
+    if (sink == 42) printf("\n");  // 防止计时循环被优化掉
+}
+
+
+// ========== 地形漫游演示 ==========
+
+// 视口一个方向上每个像素落在哪个瓦片的哪个采样点（最近采样点）
+static void mapAxis(double origin, int count, double step, int tileSize, std::vector<int>& tile, std::vector<int>& idx) {
+    double span = tileSize * step;
+    tile.resize(count);
+    idx.resize(count);
+    for (int i = 0; i < count; i++) {
+        double w = origin + i * step;
+        tile[i] = (int)floor(w / span);
+        idx[i] = std::min(tileSize - 1, (int)((w - tile[i] * span) / step));
+    }
+}
+
+// 瓦片下标沿一个方向单调，切成连续的段：第 k 段是 [runs[k], runs[k+1])
+static void tileRuns(const std::vector<int>& tile, std::vector<int>& runs) {
+    runs.clear();
+    for (int i = 0; i < (int)tile.size(); i++)
+        if (i == 0 || tile[i] != tile[i - 1]) runs.push_back(i);
+    runs.push_back((int)tile.size());
+}
+
+// 从瓦片缓存取视口内的高度拼出一帧。先对视口内所有瓦片 tryGet()：就绪的直接拿到，
+// 缺失的一次性全部进入需求队列，由工作线程并行生成；之后按行段 x 列段逐块拷贝，
+// 只有第一遍缺失的瓦片才 get() 阻塞等待（此时往往已经生成好了）
+static void composeFrame(TerrainTileCache& cache, const TerrainView& v, std::vector<float>& frame) {
+    PERF_ZONE("noise.terrain_frame");
+    int ts = cache.config().tileSize;
+    double step = (double)(1 << v.lod);
+    std::vector<int> colTile, colIdx, rowTile, rowIdx, colRuns, rowRuns;
+    mapAxis(v.x, v.width, step, ts, colTile, colIdx);
+    mapAxis(v.y, v.height, step, ts, rowTile, rowIdx);
+    tileRuns(colTile, colRuns);
+    tileRuns(rowTile, rowRuns);
+    frame.resize((size_t)v.width * v.height);
+
+    int nc = (int)colRuns.size() - 1, nr = (int)rowRuns.size() - 1;
+    std::vector<std::shared_ptr<const TerrainTile>> tiles((size_t)nc * nr);
+    for (int r = 0; r < nr; r++)
+        for (int c = 0; c < nc; c++)
+            tiles[(size_t)r * nc + c] = cache.tryGet({colTile[colRuns[c]], rowTile[rowRuns[r]], v.lod});
+
+    for (int r = 0; r < nr; r++) {
+        for (int c = 0; c < nc; c++) {
+            auto& tile = tiles[(size_t)r * nc + c];
+            if (!tile) tile = cache.get({colTile[colRuns[c]], rowTile[rowRuns[r]], v.lod});
+            for (int py = rowRuns[r]; py < rowRuns[r + 1]; py++)
+                for (int px = colRuns[c]; px < colRuns[c + 1]; px++)
+                    frame[(size_t)py * v.width + px] = tile->at(colIdx[px], rowIdx[py]);
+        }
+    }
+}
+
+// 相机沿对角线平移，中途拉远到 LOD 1 再拉回；统计每帧取瓦片的耗时和缓存行为
+static void runTerrainDemo(int frames, size_t capMB, int threads, bool prefetch) {
+    PerlinNoise perlin(42);
+    TerrainTileCache::Config cfg;
+    cfg.memoryCap = capMB << 20;
+    cfg.threads = threads;
+    TerrainTileCache cache(perlin, cfg);
+
+    std::vector<float> frame;
+    TerrainView view;
+    view.width = view.height = 512;
+    const double vx = 24, vy = 10;  // 每帧移动的 LOD 0 采样点数
+    double worst = 0, total = 0;
+    for (int f = 0; f < frames; f++) {
+        view.lod = (f / 60) % 2;
+        if (prefetch) cache.prefetchPath(view, vx, vy, 8);
+        auto t0 = Clock::now();
+        composeFrame(cache, view, frame);
+        double ms = msSince(t0);
+        worst = std::max(worst, ms);
+        total += ms;
+        view.x += vx;
+        view.y += vy;
+        // 模拟每帧其余的工作（渲染等），预取线程在这段时间里跑
+        std::this_thread::sleep_for(std::chrono::milliseconds(8));
+        perf::sample_memory();
+    }
+
+    std::vector<unsigned char> pixels(frame.size() * 3);
+    for (size_t i = 0; i < frame.size(); i++) {
+        unsigned char gray = (unsigned char)(std::clamp((frame[i] + 1.0) * 0.5, 0.0, 1.0) * 255);
+        pixels[i * 3] = pixels[i * 3 + 1] = pixels[i * 3 + 2] = gray;
+    }
+    stbi_write_png("noise_terrain.png", view.width, view.height, 3, pixels.data(), view.width * 3);
+
+    TerrainTileCache::Stats st = cache.stats();
+    printf("地形漫游: %d 帧 %dx%d，瓦片 %d², 内存上限 %zu MB，预取 %s\n", frames, view.width, view.height,
+           cfg.tileSize, capMB, prefetch ? "开" : "关");
+    printf("  取瓦片耗时: 平均 %.2f ms/帧，最差 %.2f ms\n", total / frames, worst);
+    printf("  命中 %zu（其中预取 %zu），等待 %zu，生成 %zu，淘汰 %zu，丢弃预取 %zu\n", st.hits, st.prefetchHits,
+           st.waits, st.generated, st.evicted, st.droppedPrefetch);
+    printf("  常驻 %zu 个瓦片 %.1f MB，峰值 %.1f MB\n", st.residentTiles, st.residentBytes / 1048576.0,
+           st.peakBytes / 1048576.0);
+}
+
+int main(int argc, char** argv) {
+    perf::Session session("noise");
+    int benchSize = 0, terrainFrames = 0, threads = 0;
+    size_t capMB = 16;
+    bool prefetch = true;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--scalar")) {
+            simdEnabled() = false;
+        } else if (!strcmp(argv[i], "--bench")) {
+            benchSize = 2048;
+            if (i + 1 < argc && argv[i + 1][0] != '-') benchSize = std::max(8, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--terrain")) {
+            terrainFrames = 240;
+            if (i + 1 < argc && argv[i + 1][0] != '-') terrainFrames = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--cache-mb") && i + 1 < argc) {
+            capMB = (size_t)std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            threads = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--no-prefetch")) {
+            prefetch = false;
+        } else {
+            fprintf(stderr, "用法: %s [--scalar] [--bench [尺寸]] [--terrain [帧数] [--cache-mb N] [--threads N] [--no-prefetch]]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (benchSize > 0) {
+        runBenchmark(benchSize);
+        return 0;
+    }
+    if (terrainFrames > 0) {
+        runTerrainDemo(terrainFrames, capMB, threads, prefetch);
+        return 0;
+    }
+
     const int W = 800, H = 800;
     
     PerlinNoise perlin(42);
@@ -261,41 +1170,75 @@ int main() {
     WorleyNoise worley(42);
     
     // 1. Perlin 噪声
-    renderNoise("noise_perlin.png", W, H, [&](double x, double y) {
-        return perlin.noise(x, y, 0);
-    }, 0.01);
+    {
+        PERF_ZONE("noise.perlin");
+        renderNoiseRows("noise_perlin.png", W, H, [&](const double* xs, const double* ys, double* out, size_t n) {
+            perlin.noiseBatch(xs, ys, nullptr, out, n);
+        }, 0.01);
+    }
     
     // 2. Perlin FBM (分形布朗运动)
-    renderNoise("noise_perlin_fbm.png", W, H, [&](double x, double y) {
-        return perlin.fbm(x, y, 0, 8, 0.5);
-    }, 0.005);
+    {
+        PERF_ZONE("noise.perlin_fbm");
+        renderNoiseRows("noise_perlin_fbm.png", W, H, [&](const double* xs, const double* ys, double* out, size_t n) {
+            perlin.fbmBatch(xs, ys, nullptr, out, n, 8, 0.5);
+        }, 0.005);
+    }
     
     // 3. Simplex 噪声
-    renderNoise("noise_simplex.png", W, H, [&](double x, double y) {
-        return simplex.noise(x, y, 0);
-    }, 0.01);
+    {
+        PERF_ZONE("noise.simplex");
+        renderNoiseRows("noise_simplex.png", W, H, [&](const double* xs, const double* ys, double* out, size_t n) {
+            simplex.noiseBatch(xs, ys, nullptr, out, n);
+        }, 0.01);
+    }
     
     // 4. Worley 噪声（细胞纹理）
-    renderNoise("noise_worley.png", W, H, [&](double x, double y) {
-        return worley.noise(x * 0.05, y * 0.05, 1) * 10 - 1;
-    }, 1.0);
+    {
+        PERF_ZONE("noise.worley");
+        renderNoise("noise_worley.png", W, H, [&](double x, double y) {
+            return worley.noise(x * 0.05, y * 0.05, 1) * 10 - 1;
+        }, 1.0);
+    }
     
-    // 5. Turbulence（湍流）
-    renderNoise("noise_turbulence.png", W, H, [&](double x, double y) {
-        double t = 0;
-        double scale = 0.01;
-        for (int i = 0; i < 6; i++) {
-            t += fabs(perlin.noise(x * scale, y * scale, 0)) / scale;
-            scale *= 2;
-        }
-        return t * 0.01 - 1;
-    }, 1.0);
+    // 4b. 胞元边界：到最近 Voronoi 边的距离，每个胞元按 cellId 给一个底色
+    {
+        PERF_ZONE("noise.worley_edges");
+        renderNoise("noise_worley_edges.png", W, H, [&](double x, double y) {
+            CellularSample c = worley.cellular(x * 0.02, y * 0.02);
+            double shade = (c.cellId >> 24) / 255.0 * 0.6;
+            return std::min(1.0, c.edge * 20) * (0.4 + shade) * 2 - 1;
+        }, 1.0);
+    }
+    
+    // 5. Turbulence（湍流）：每个倍频程整行求一次，再按行累加
+    std::vector<double> sx(W), sy(W), octave(W);
+    {
+        PERF_ZONE("noise.turbulence");
+        renderNoiseRows("noise_turbulence.png", W, H, [&](const double* xs, const double* ys, double* out, size_t n) {
+            std::fill(out, out + n, 0.0);
+            double scale = 0.01;
+            for (int i = 0; i < 6; i++) {
+                for (size_t k = 0; k < n; k++) {
+                    sx[k] = xs[k] * scale;
+                    sy[k] = ys[k] * scale;
+                }
+                perlin.noiseBatch(sx.data(), sy.data(), nullptr, octave.data(), n);
+                for (size_t k = 0; k < n; k++) out[k] += fabs(octave[k]) / scale;
+                scale *= 2;
+            }
+            for (size_t k = 0; k < n; k++) out[k] = out[k] * 0.01 - 1;
+        }, 1.0);
+    }
     
     // 6. 大理石纹理
-    renderNoise("noise_marble.png", W, H, [&](double x, double y) {
-        double n = perlin.fbm(x, y, 0, 6, 0.5);
-        return sin(x * 0.05 + n * 5);
-    }, 1.0);
+    {
+        PERF_ZONE("noise.marble");
+        renderNoiseRows("noise_marble.png", W, H, [&](const double* xs, const double* ys, double* out, size_t n) {
+            perlin.fbmBatch(xs, ys, nullptr, out, n, 6, 0.5);
+            for (size_t k = 0; k < n; k++) out[k] = sin(xs[k] * 0.05 + out[k] * 5);
+        }, 1.0);
+    }
     
     return 0;
 }
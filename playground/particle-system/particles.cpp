@@ -1,9 +1,17 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
+#include "../common/frame_output.h"
+#include "../common/perf.h"
 #include <vector>
 #include <cmath>
 #include <random>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
 
 struct Vec2 {
     double x, y;
@@ -19,85 +27,378 @@ struct Particle {
     Vec2 pos, vel;
     double mass;
     unsigned char r, g, b;
+    int life;  // 剩余帧数，-1 表示永久存活
     
-    Particle(Vec2 p, Vec2 v, double m, int r, int g, int b) 
-        : pos(p), vel(v), mass(m), r(r), g(g), b(b) {}
+    Particle(Vec2 p, Vec2 v, double m, int r, int g, int b, int life = -1) 
+        : pos(p), vel(v), mass(m), r(r), g(g), b(b), life(life) {}
 };
 
+int defaultThreads() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// 模拟/绘制的线程数，--sim-threads 修改（--threads 是帧编码线程）
+inline int& simThreads() {
+    static int n = defaultThreads();
+    return n;
+}
+
+// 用原子计数器把 [0, count) 分给多个线程
+template <typename Fn>
+void parallelFor(int count, int threads, Fn&& fn) {
+    std::atomic<int> next{0};
+    auto worker = [&] {
+        for (int i; (i = next.fetch_add(1)) < count;) fn(i);
+    };
+    threads = std::max(1, std::min(threads, count));
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+}
+
+// ========== SoA 粒子池 ==========
+// 每个属性一个连续数组，积分时 4 个 double 一组装进 AVX 寄存器；
+// 死亡粒子的槽位进空闲链表，下次 spawn 优先复用，数组不会因为持续发射而无限增长
+
+struct ParticlePool {
+    std::vector<double> px, py, vx, vy, mass;
+    std::vector<unsigned char> r, g, b;
+    std::vector<unsigned char> alive;
+    std::vector<int> life;
+    std::vector<uint32_t> freeSlots;
+    size_t liveCount = 0;
+    size_t mortalCount = 0;  // life >= 0 的存活粒子数，为 0 时跳过寿命扫描
+
+    size_t capacity() const { return px.size(); }
+
+    uint32_t spawn(const Particle& p) {
+        uint32_t i;
+        if (!freeSlots.empty()) {
+            i = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            i = (uint32_t)capacity();
+            for (auto* v : {&px, &py, &vx, &vy, &mass}) v->push_back(0);
+            for (auto* v : {&r, &g, &b, &alive}) v->push_back(0);
+            life.push_back(-1);
+        }
+        px[i] = p.pos.x; py[i] = p.pos.y;
+        vx[i] = p.vel.x; vy[i] = p.vel.y;
+        mass[i] = p.mass;
+        r[i] = p.r; g[i] = p.g; b[i] = p.b;
+        alive[i] = 1;
+        life[i] = p.life;
+        liveCount++;
+        if (p.life >= 0) mortalCount++;
+        return i;
+    }
+
+    // 死亡槽位的速度清零，积分照常跑（省掉分支），渲染按 alive 跳过
+    void kill(uint32_t i) {
+        if (!alive[i]) return;
+        alive[i] = 0;
+        if (life[i] >= 0) mortalCount--;
+        vx[i] = vy[i] = 0;
+        liveCount--;
+        freeSlots.push_back(i);
+    }
+
+    void reserve(size_t n) {
+        for (auto* v : {&px, &py, &vx, &vy, &mass}) v->reserve(n);
+        for (auto* v : {&r, &g, &b, &alive}) v->reserve(n);
+        life.reserve(n);
+    }
+};
+
+// ========== 积分内核 ==========
+// 运算顺序与标量版相同且不用 FMA，两条路径逐位一致
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PARTICLES_X86 1
+#endif
+
+inline bool& simdEnabled() {
+#ifdef PARTICLES_X86
+    static bool enabled = __builtin_cpu_supports("avx");
+#else
+    static bool enabled = false;
+#endif
+    return enabled;
+}
+
+struct IntegrateParams {
+    double gravityDt, damping, dt;
+    double maxX, maxY;  // width, height
+};
+
+inline void integrateScalar(ParticlePool& pool, size_t begin, size_t end, const IntegrateParams& k) {
+    double* px = pool.px.data();
+    double* py = pool.py.data();
+    double* vx = pool.vx.data();
+    double* vy = pool.vy.data();
+    for (size_t i = begin; i < end; i++) {
+        // 简单重力 + 阻尼
+        vy[i] += k.gravityDt;
+        vx[i] = vx[i] * k.damping;
+        vy[i] = vy[i] * k.damping;
+        
+        // 更新位置
+        px[i] = px[i] + vx[i] * k.dt;
+        py[i] = py[i] + vy[i] * k.dt;
+        
+        // 边界碰撞（简单反弹）
+        if (px[i] < 0 || px[i] >= k.maxX) {
+            vx[i] *= -0.8;
+            px[i] = std::max(0.0, std::min(k.maxX - 1, px[i]));
+        }
+        if (py[i] < 0 || py[i] >= k.maxY) {
+            vy[i] *= -0.8;
+            py[i] = std::max(0.0, std::min(k.maxY - 1, py[i]));
+        }
+    }
+}
+
+#ifdef PARTICLES_X86
+namespace simd {
+
+// 一个轴的速度/位置 + 反弹，4 个粒子一组
+__attribute__((target("avx"))) inline void bounceAxis(__m256d& p, __m256d& v, __m256d maxV) {
+    const __m256d zero = _mm256_setzero_pd();
+    __m256d out = _mm256_or_pd(_mm256_cmp_pd(p, zero, _CMP_LT_OQ), _mm256_cmp_pd(p, maxV, _CMP_GE_OQ));
+    if (_mm256_movemask_pd(out) == 0) return;
+    __m256d flipped = _mm256_mul_pd(v, _mm256_set1_pd(-0.8));
+    // std::min(max-1, p) 在相等时取前者；两者相等时值也相同，用 min_pd(p, max-1) 逐位一致
+    __m256d clamped = _mm256_max_pd(zero, _mm256_min_pd(p, _mm256_sub_pd(maxV, _mm256_set1_pd(1.0))));
+    v = _mm256_blendv_pd(v, flipped, out);
+    p = _mm256_blendv_pd(p, clamped, out);
+}
+
+__attribute__((target("avx"))) size_t integrate(ParticlePool& pool, size_t begin, size_t end,
+                                                const IntegrateParams& k) {
+    double* px = pool.px.data();
+    double* py = pool.py.data();
+    double* vx = pool.vx.data();
+    double* vy = pool.vy.data();
+    const __m256d g = _mm256_set1_pd(k.gravityDt), damp = _mm256_set1_pd(k.damping), dt = _mm256_set1_pd(k.dt);
+    const __m256d maxX = _mm256_set1_pd(k.maxX), maxY = _mm256_set1_pd(k.maxY);
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m256d x = _mm256_loadu_pd(px + i), y = _mm256_loadu_pd(py + i);
+        __m256d u = _mm256_loadu_pd(vx + i), v = _mm256_loadu_pd(vy + i);
+        v = _mm256_add_pd(v, g);
+        u = _mm256_mul_pd(u, damp);
+        v = _mm256_mul_pd(v, damp);
+        x = _mm256_add_pd(x, _mm256_mul_pd(u, dt));
+        y = _mm256_add_pd(y, _mm256_mul_pd(v, dt));
+        bounceAxis(x, u, maxX);
+        bounceAxis(y, v, maxY);
+        _mm256_storeu_pd(px + i, x);
+        _mm256_storeu_pd(py + i, y);
+        _mm256_storeu_pd(vx + i, u);
+        _mm256_storeu_pd(vy + i, v);
+    }
+    return i;
+}
+
+}  // namespace simd
+#endif
+
+// ========== 渐隐与分块绘制 ==========
+
+// 原来每个字节一次 double 乘法，换成 256 项查表，结果相同
+struct FadeTable {
+    unsigned char v[256];
+    explicit FadeTable(double factor) {
+        for (int i = 0; i < 256; i++) v[i] = (unsigned char)(i * factor);
+    }
+};
+
+// 一个 uint32 里 4 个字节分别做饱和加法（SWAR）：低 7 位相加，最高位单独判断进位，溢出的字节置 255
+inline uint32_t addSaturate4(uint32_t a, uint32_t b) {
+    const uint32_t high = 0x80808080u;
+    uint32_t sum = (a & ~high) + (b & ~high);
+    uint32_t carry = ((a & b) | ((a | b) & sum)) & high;
+    return (sum ^ ((a ^ b) & high)) | ((carry >> 7) * 0xffu);
+}
+
+inline uint32_t packRgb(unsigned char r, unsigned char g, unsigned char b) {
+    return r | (uint32_t)g << 8 | (uint32_t)b << 16;
+}
+
 class ParticleSystem {
 public:
-    std::vector<Particle> particles;
+    ParticlePool pool;
     int width, height;
     double gravity;
     double damping;
+    int threads = simThreads();
+    
+    // 饱和加法只涉及非负数，结果 = min(255, 总和)，与绘制顺序无关，
+    // 所以按块并行、块内任意顺序都和原来逐个粒子绘制逐字节一致
+    static constexpr int kTile = 64;
+    static constexpr int kMargin = 4;  // 与块相交的圆，圆心离块边不超过 2，圆本身不超过 4
+    static constexpr size_t kChunk = 16384;  // 积分和分箱时每个任务处理的槽位数
     
-    ParticleSystem(int w, int h) : width(w), height(h), gravity(0.5), damping(0.99) {}
+    ParticleSystem(int w, int h) : width(w), height(h), gravity(0.5), damping(0.99) {
+        tilesX = (w + kTile - 1) / kTile;
+        tilesY = (h + kTile - 1) / kTile;
+    }
     
-    void addParticle(Particle p) {
-        particles.push_back(p);
+    uint32_t addParticle(const Particle& p) {
+        return pool.spawn(p);
     }
     
+    void removeParticle(uint32_t i) { pool.kill(i); }
+    
+    size_t size() const { return pool.liveCount; }
+    
     void update(double dt) {
-        // 更新速度和位置
-        for (auto& p : particles) {
-            // 简单重力
-            p.vel.y += gravity * dt;
-            
-            // 阻尼
-            p.vel = p.vel * damping;
-            
-            // 更新位置
-            p.pos = p.pos + p.vel * dt;
-            
-            // 边界碰撞（简单反弹）
-            if (p.pos.x < 0 || p.pos.x >= width) {
-                p.vel.x *= -0.8;
-                p.pos.x = std::max(0.0, std::min((double)width - 1, p.pos.x));
-            }
-            if (p.pos.y < 0 || p.pos.y >= height) {
-                p.vel.y *= -0.8;
-                p.pos.y = std::max(0.0, std::min((double)height - 1, p.pos.y));
+        PERF_ZONE("particles.update");
+        PERF_COUNT("particles.steps", pool.liveCount);
+        IntegrateParams k{gravity * dt, damping, dt, (double)width, (double)height};
+        int chunks = chunkCount();
+        parallelFor(chunks, threads, [&](int c) {
+            size_t begin = c * kChunk, end = std::min(pool.capacity(), begin + kChunk);
+            size_t i = begin;
+#ifdef PARTICLES_X86
+            if (simdEnabled()) i = simd::integrate(pool, begin, end, k);
+#endif
+            integrateScalar(pool, i, end, k);
+        });
+        
+        // 寿命：到 0 的粒子回收槽位（串行，保证空闲链表顺序确定）
+        if (pool.mortalCount > 0) {
+            for (size_t i = 0; i < pool.capacity(); i++) {
+                if (pool.alive[i] && pool.life[i] >= 0 && --pool.life[i] <= 0) pool.kill((uint32_t)i);
             }
         }
     }
     
     void render(std::vector<unsigned char>& pixels, bool trails = false) {
-        if (!trails) {
-            // 清空画布（黑色背景）
-            std::fill(pixels.begin(), pixels.end(), 0);
-        } else {
-            // 渐隐效果
-            for (size_t i = 0; i < pixels.size(); i++) {
-                pixels[i] = pixels[i] * 0.95;
+        PERF_ZONE("particles.render");
+        binParticles();
+        PERF_COUNT("particles.splats", binned.size());
+        static const FadeTable fade(0.95);
+        parallelFor(tilesX * tilesY, threads, [&](int t) {
+            int tx = t % tilesX, ty = t / tilesX;
+            int x0 = tx * kTile, y0 = ty * kTile;
+            int x1 = std::min(width, x0 + kTile), y1 = std::min(height, y0 + kTile);
+            
+            // 块连同 kMargin 宽的边框拷进线程私有的打包缓冲，跨块的圆整个画进来，只写回块内部，
+            // 这样每个圆都不用做边界判断
+            thread_local std::vector<uint32_t> local;
+            const int stride = kTile + 2 * kMargin;
+            local.assign((size_t)stride * stride, 0);
+            for (int y = y0; y < y1; y++) {
+                const unsigned char* src = pixels.data() + ((size_t)y * width + x0) * 3;
+                uint32_t* dst = local.data() + (size_t)(y - y0 + kMargin) * stride + kMargin;
+                if (!trails) continue;  // 清空画布（黑色背景）
+                for (int x = 0; x < x1 - x0; x++, src += 3) {
+                    dst[x] = packRgb(fade.v[src[0]], fade.v[src[1]], fade.v[src[2]]);  // 渐隐效果
+                }
             }
-        }
-        
-        // 绘制粒子
-        for (const auto& p : particles) {
-            int px = (int)p.pos.x;
-            int py = (int)p.pos.y;
             
-            // 画一个小圆
-            for (int dy = -2; dy <= 2; dy++) {
-                for (int dx = -2; dx <= 2; dx++) {
-                    if (dx*dx + dy*dy <= 4) {
-                        int x = px + dx;
-                        int y = py + dy;
-                        if (x >= 0 && x < width && y >= 0 && y < height) {
-                            int idx = (y * width + x) * 3;
-                            pixels[idx] = std::min(255, pixels[idx] + p.r);
-                            pixels[idx + 1] = std::min(255, pixels[idx + 1] + p.g);
-                            pixels[idx + 2] = std::min(255, pixels[idx + 2] + p.b);
-                        }
-                    }
+            uint32_t* origin = local.data() + (size_t)kMargin * stride + kMargin;
+            for (uint32_t k = binStart[t]; k < binStart[t + 1]; k++) {
+                const SplatItem& item = binned[k];
+                // 半径 2 的小圆（dx² + dy² <= 4）：5 行，宽 1、3、5、3、1
+                uint32_t* c = origin + (ptrdiff_t)(item.y - y0) * stride + (item.x - x0);
+                c[-2 * stride] = addSaturate4(c[-2 * stride], item.color);
+                for (int dx = -1; dx <= 1; dx++) c[dx - stride] = addSaturate4(c[dx - stride], item.color);
+                for (int dx = -2; dx <= 2; dx++) c[dx] = addSaturate4(c[dx], item.color);
+                for (int dx = -1; dx <= 1; dx++) c[dx + stride] = addSaturate4(c[dx + stride], item.color);
+                c[2 * stride] = addSaturate4(c[2 * stride], item.color);
+            }
+            
+            for (int y = y0; y < y1; y++) {
+                unsigned char* dst = pixels.data() + ((size_t)y * width + x0) * 3;
+                const uint32_t* src = origin + (size_t)(y - y0) * stride;
+                for (int x = 0; x < x1 - x0; x++, dst += 3) {
+                    dst[0] = (unsigned char)src[x];
+                    dst[1] = (unsigned char)(src[x] >> 8);
+                    dst[2] = (unsigned char)(src[x] >> 16);
                 }
             }
+        });
+    }
+    
+private:
+    // 分箱时把绘制要用的数据拷出来：块内顺序读取，不再随机访问 SoA 数组
+    struct SplatItem {
+        int16_t x, y;  // 圆心像素；与画布相交的圆圆心在 [-2, 宽/高 + 2) 内
+        uint32_t color;  // packRgb
+    };
+    
+    int tilesX, tilesY;
+    std::vector<uint32_t> binStart;     // 每块在 binned 中的起点，长度 = 块数 + 1
+    std::vector<SplatItem> binned;      // 按块排好的绘制项；跨块的圆在每个相交块里各有一项
+    std::vector<uint32_t> chunkCounts;  // [块 × 分段] 计数，分段内各自累加，不需要原子操作
+    
+    int chunkCount() const { return (int)((pool.capacity() + kChunk - 1) / kChunk); }
+    
+    // 粒子的圆（先截断成整数像素，与原来的绘制相同）与哪些块相交；完全在画布外返回 false
+    bool tileRange(size_t i, int& tx0, int& ty0, int& tx1, int& ty1) const {
+        int px = (int)pool.px[i], py = (int)pool.py[i];
+        int xa = std::max(0, px - 2), xb = std::min(width - 1, px + 2);
+        int ya = std::max(0, py - 2), yb = std::min(height - 1, py + 2);
+        if (xa > xb || ya > yb) return false;
+        tx0 = xa / kTile; tx1 = xb / kTile;
+        ty0 = ya / kTile; ty1 = yb / kTile;
+        return true;
+    }
+    
+    // 对粒子的圆相交的每一块调用 fn(块号)，死亡或在画布外的粒子不调用
+    template <typename Fn>
+    void forEachTile(size_t i, Fn&& fn) const {
+        int tx0, ty0, tx1, ty1;
+        if (!pool.alive[i] || !tileRange(i, tx0, ty0, tx1, ty1)) return;
+        for (int ty = ty0; ty <= ty1; ty++)
+            for (int tx = tx0; tx <= tx1; tx++) fn(ty * tilesX + tx);
+    }
+    
+    // 计数排序：各分段并行统计每块的绘制项数，前缀和后再各自写到自己的区间
+    void binParticles() {
+        PERF_ZONE("particles.bin");
+        int tiles = tilesX * tilesY, chunks = chunkCount();
+        chunkCounts.assign((size_t)tiles * chunks, 0);
+        parallelFor(chunks, threads, [&](int c) {
+            size_t begin = c * kChunk, end = std::min(pool.capacity(), begin + kChunk);
+            for (size_t i = begin; i < end; i++) forEachTile(i, [&](int t) { chunkCounts[(size_t)t * chunks + c]++; });
+        });
+        binStart.assign(tiles + 1, 0);
+        uint32_t offset = 0;
+        for (int t = 0; t < tiles; t++) {
+            binStart[t] = offset;
+            for (int c = 0; c < chunks; c++) {
+                uint32_t n = chunkCounts[(size_t)t * chunks + c];
+                chunkCounts[(size_t)t * chunks + c] = offset;
+                offset += n;
+            }
         }
+        binStart[tiles] = offset;
+        binned.resize(offset);
+        parallelFor(chunks, threads, [&](int c) {
+            size_t begin = c * kChunk, end = std::min(pool.capacity(), begin + kChunk);
+            for (size_t i = begin; i < end; i++) {
+                SplatItem item{(int16_t)(int)pool.px[i], (int16_t)(int)pool.py[i], packRgb(pool.r[i], pool.g[i], pool.b[i])};
+                forEachTile(i, [&](int t) { binned[chunkCounts[(size_t)t * chunks + c]++] = item; });
+            }
+        });
     }
 };
 
+// 中间帧以 <stem>_<帧号> 命名提交给后台编码
+void submitSequenceFrame(frame_output::FrameWriter& writer, const char* stem, int frame,
+                         int width, int height, const std::vector<unsigned char>& pixels) {
+    char name[128];
+    snprintf(name, sizeof(name), "%s_%03d", stem, frame);
+    writer.submit(name, width, height, 3, pixels.data());
+}
+
 // 爆炸效果
-void generateExplosion(const char* filename, int width, int height) {
+void generateExplosion(frame_output::FrameWriter& writer, const char* stem, int width, int height, int every) {
     std::vector<unsigned char> pixels(width * height * 3, 0);
     ParticleSystem ps(width, height);
     ps.gravity = 0.2;
@@ -125,13 +426,14 @@ void generateExplosion(const char* filename, int width, int height) {
     for (int frame = 0; frame < 60; frame++) {
         ps.update(1.0);
         ps.render(pixels, true);  // 拖尾效果
+        if (every && frame % every == 0) submitSequenceFrame(writer, stem, frame, width, height, pixels);
     }
     
-    stbi_write_png(filename, width, height, 3, pixels.data(), width * 3);
+    writer.submit(stem, width, height, 3, pixels.data());
 }
 
 // 喷泉效果
-void generateFountain(const char* filename, int width, int height) {
+void generateFountain(frame_output::FrameWriter& writer, const char* stem, int width, int height, int every) {
     std::vector<unsigned char> pixels(width * height * 3, 0);
     ParticleSystem ps(width, height);
     ps.gravity = 0.3;
@@ -158,13 +460,14 @@ void generateFountain(const char* filename, int width, int height) {
         
         ps.update(1.0);
         ps.render(pixels, true);
+        if (every && frame % every == 0) submitSequenceFrame(writer, stem, frame, width, height, pixels);
     }
     
-    stbi_write_png(filename, width, height, 3, pixels.data(), width * 3);
+    writer.submit(stem, width, height, 3, pixels.data());
 }
 
 // 螺旋星系
-void generateSpiral(const char* filename, int width, int height) {
+void generateSpiral(frame_output::FrameWriter& writer, const char* stem, int width, int height) {
     std::vector<unsigned char> pixels(width * height * 3, 0);
     ParticleSystem ps(width, height);
     ps.gravity = 0;
@@ -197,15 +500,114 @@ void generateSpiral(const char* filename, int width, int height) {
     
     // 渲染静态场景
     ps.render(pixels, false);
-    stbi_write_png(filename, width, height, 3, pixels.data(), width * 3);
+    writer.submit(stem, width, height, 3, pixels.data());
+}
+
+// ========== 基准：百万粒子持续发射 ==========
+
+using Clock = std::chrono::steady_clock;
+
+// 全屏随机发射、寿命 60~180 帧，每帧把死掉的粒子补回来，存活数稳定在 count
+static double runSteadyState(int count, int frames, int simThreads, bool simd, std::vector<unsigned char>& pixels,
+                             double& updateMs, double& renderMs) {
+    const int W = 1920, H = 1080;
+    bool& enabled = simdEnabled();
+    bool saved = enabled;
+    enabled = enabled && simd;
+    
+    ParticleSystem ps(W, H);
+    ps.gravity = 0.1;
+    ps.threads = simThreads;
+    ps.pool.reserve(count);
+    std::mt19937 rng(2024);
+    std::uniform_real_distribution<> xDist(0, W), yDist(0, H), vDist(-3, 3);
+    auto emit = [&] {
+        int life = 60 + rng() % 121;
+        unsigned char c = 40 + rng() % 60;
+        ps.addParticle(Particle(Vec2(xDist(rng), yDist(rng)), Vec2(vDist(rng), vDist(rng)), 1.0, c, c / 2, 80, life));
+    };
+    for (int i = 0; i < count; i++) emit();
+    
+    pixels.assign((size_t)W * H * 3, 0);
+    updateMs = renderMs = 0;
+    for (int f = 0; f < frames; f++) {
+        while ((int)ps.size() < count) emit();
+        auto t0 = Clock::now();
+        ps.update(1.0);
+        auto t1 = Clock::now();
+        ps.render(pixels, true);
+        auto t2 = Clock::now();
+        updateMs += std::chrono::duration<double, std::milli>(t1 - t0).count();
+        renderMs += std::chrono::duration<double, std::milli>(t2 - t1).count();
+    }
+    enabled = saved;
+    
+    // 位置校验和：不同实现必须逐位一致
+    double sum = 0;
+    for (size_t i = 0; i < ps.pool.capacity(); i++) sum += ps.pool.px[i] * 3 + ps.pool.py[i];
+    return sum;
+}
+
+static void runBenchmark(int count, int simThreads) {
+    const int frames = 30;
+    printf("粒子基准: %d 个存活粒子, 1920x1080, %d 帧（拖尾）, AVX %s\n", count, frames,
+           simdEnabled() ? "可用" : "不可用");
+    struct Mode { const char* name; int threads; bool simd; };
+    const Mode modes[] = {{"标量 1 线程", 1, false}, {"AVX 1 线程", 1, true}, {"AVX 多线程", simThreads, true}};
+    std::vector<unsigned char> reference, pixels;
+    double refSum = 0;
+    for (const Mode& m : modes) {
+        double updateMs, renderMs;
+        double sum = runSteadyState(count, frames, m.threads, m.simd, pixels, updateMs, renderMs);
+        if (reference.empty()) {
+            reference = pixels;
+            refSum = sum;
+        }
+        printf("%-12s (%d 线程): 更新 %.2f ms/帧, 绘制 %.2f ms/帧, 结果%s\n", m.name, m.threads, updateMs / frames,
+               renderMs / frames, pixels == reference && sum == refSum ? "一致" : "不一致");
+    }
 }
 
-int main() {
+int main(int argc, char** argv) {
+    perf::Session session("particle_system");
+    // 本程序自己的参数先取出来，其余交给共用的帧输出参数解析
+    int benchCount = 0;
+    bool scalar = false;
+    std::vector<char*> rest = {argv[0]};
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--bench")) {
+            benchCount = 1000000;
+            if (i + 1 < argc && argv[i + 1][0] != '-') benchCount = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--sim-threads") && i + 1 < argc) {
+            simThreads() = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--scalar")) {
+            scalar = true;
+        } else {
+            rest.push_back(argv[i]);
+        }
+    }
+    if (scalar) simdEnabled() = false;
+    if (benchCount > 0) {
+        runBenchmark(benchCount, simThreads());
+        return 0;
+    }
+    
+    frame_output::Options options;
+    if (!options.parse((int)rest.size(), rest.data())) {
+        frame_output::Options::usage(argv[0]);
+        fprintf(stderr, "       [--sim-threads N] [--scalar] [--bench [粒子数]]\n");
+        return 1;
+    }
     const int W = 800, H = 600;
     
-    generateExplosion("particles_explosion.png", W, H);
-    generateFountain("particles_fountain.png", W, H);
-    generateSpiral("particles_spiral.png", W, H);
+    // 三个效果依次模拟，前一个的编码与后一个的模拟重叠；--every N 额外输出中间帧序列
+    frame_output::FrameWriter writer(options.format, options.threads);
+    generateExplosion(writer, "particles_explosion", W, H, options.every);
+    generateFountain(writer, "particles_fountain", W, H, options.every);
+    generateSpiral(writer, "particles_spiral", W, H);
+    
+    writer.finish();
+    writer.print_stats("帧输出");
     
     return 0;
 }
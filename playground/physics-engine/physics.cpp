@@ -1,9 +1,17 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
+#include "../common/frame_output.h"
+#include "../common/perf.h"
 #include <vector>
 #include <cmath>
 #include <random>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
 
 struct Vec2 {
     double x, y;
@@ -71,8 +79,9 @@ void resolveCollision(RigidBody& a, RigidBody& b) {
         
         // 分离物体
         Vec2 correction = normal * (penetration / (a.invMass + b.invMass));
-        a.pos = a.pos - correction * a.invMass;
-        b.pos = b.pos + correction * b.invMass;
+        // 静止物体（invMass = 0）不写：结果不变，并行求解时多个岛可以同时读它
+        if (a.invMass > 0) a.pos = a.pos - correction * a.invMass;
+        if (b.invMass > 0) b.pos = b.pos + correction * b.invMass;
         
         // 相对速度
         Vec2 relativeVel = b.vel - a.vel;
@@ -86,8 +95,8 @@ void resolveCollision(RigidBody& a, RigidBody& b) {
         j /= a.invMass + b.invMass;
         
         Vec2 impulse = normal * j;
-        a.applyImpulse(impulse * -1, Vec2(0,0));
-        b.applyImpulse(impulse, Vec2(0,0));
+        if (a.invMass > 0) a.applyImpulse(impulse * -1, Vec2(0,0));
+        if (b.invMass > 0) b.applyImpulse(impulse, Vec2(0,0));
     }
 }
 
@@ -111,9 +120,313 @@ void applyBoundaryConstraints(RigidBody& body, double width, double height) {
     }
 }
 
+// ========== 宽相：增量哈希网格 ==========
+// 格子边长不小于最大直径 + 接触裕量，裕量内的两个物体一定在彼此的 3x3 邻格内。
+// 只有醒着的物体会移动，所以每帧只更新醒着物体的格子；睡眠物体和静止物体完全不花时间
+
+class HashGrid {
+public:
+    explicit HashGrid(double cellSize = 1) : cellSize_(cellSize) {}
+    
+    double cellSize() const { return cellSize_; }
+    
+    uint64_t keyOf(Vec2 p) const {
+        int64_t cx = (int64_t)std::floor(p.x / cellSize_), cy = (int64_t)std::floor(p.y / cellSize_);
+        return key(cx, cy);
+    }
+    
+    static uint64_t key(int64_t cx, int64_t cy) {
+        return (uint64_t)(uint32_t)cx << 32 | (uint32_t)cy;
+    }
+    
+    void insert(int body, Vec2 p) {
+        if ((size_t)body >= slots_.size()) slots_.resize(body + 1);
+        Slot& s = slots_[body];
+        s.key = keyOf(p);
+        std::vector<int>& cell = cells_[s.key];
+        s.index = (int)cell.size();
+        cell.push_back(body);
+    }
+    
+    // 物体离开原格子时才改动；从格子里删除用末尾元素补位
+    void move(int body, Vec2 p) {
+        uint64_t k = keyOf(p);
+        if (k == slots_[body].key) return;
+        remove(body);
+        insert(body, p);
+    }
+    
+    template <typename Fn>
+    void forEachNear(Vec2 p, Fn&& fn) const {
+        int64_t cx = (int64_t)std::floor(p.x / cellSize_), cy = (int64_t)std::floor(p.y / cellSize_);
+        for (int64_t y = cy - 1; y <= cy + 1; y++) {
+            for (int64_t x = cx - 1; x <= cx + 1; x++) {
+                auto it = cells_.find(key(x, y));
+                if (it == cells_.end()) continue;
+                for (int body : it->second) fn(body);
+            }
+        }
+    }
+    
+private:
+    struct Slot {
+        uint64_t key = 0;
+        int index = -1;
+    };
+    
+    void remove(int body) {
+        Slot& s = slots_[body];
+        auto it = cells_.find(s.key);
+        std::vector<int>& cell = it->second;
+        int last = cell.back();
+        cell[s.index] = last;
+        slots_[last].index = s.index;
+        cell.pop_back();
+        if (cell.empty()) cells_.erase(it);
+        s.index = -1;
+    }
+    
+    double cellSize_;
+    std::unordered_map<uint64_t, std::vector<int>> cells_;
+    std::vector<Slot> slots_;
+};
+
+int defaultThreads() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// 用原子计数器把 [0, count) 分给多个线程
+template <typename Fn>
+void parallelFor(int count, int threads, Fn&& fn) {
+    std::atomic<int> next{0};
+    auto worker = [&] {
+        for (int i; (i = next.fetch_add(1)) < count;) fn(i);
+    };
+    threads = std::max(1, std::min(threads, count));
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+}
+
+// ========== 物理世界：候选对 → 接触岛 → 并行求解 → 睡眠 ==========
+
+struct SleepParams {
+    bool enabled = true;
+    double linearThreshold = 5.0;    // 速度低于它（像素/秒）才开始计时
+    double angularThreshold = 0.1;   // 弧度/秒
+    double timeToSleep = 0.5;        // 整个岛都持续低速这么久后一起睡眠
+};
+
+struct StepStats {
+    size_t awake = 0;       // 本帧参与模拟的动态物体
+    size_t pairs = 0;       // 宽相候选对
+    size_t islands = 0;
+    size_t largestIsland = 0;
+};
+
+class PhysicsWorld {
+public:
+    std::vector<RigidBody> bodies;
+    double width, height;
+    Vec2 gravity;
+    SleepParams sleep;
+    int threads = 1;
+    StepStats stats;
+    
+    PhysicsWorld(double w, double h, Vec2 g) : width(w), height(h), gravity(g) {}
+    
+    int add(const RigidBody& body) {
+        int id = (int)bodies.size();
+        bodies.push_back(body);
+        awake_.push_back(body.invMass > 0);
+        sleepTimer_.push_back(0);
+        if (body.radius > margin_) {
+            margin_ = body.radius;
+            rebuildGrid(3 * margin_);
+        } else {
+            grid_.insert(id, body.pos);
+        }
+        if (awake_[id]) awakeList_.push_back(id);
+        return id;
+    }
+    
+    bool isAwake(int id) const { return awake_[id]; }
+    
+    void wake(int id) {
+        if (awake_[id] || bodies[id].invMass == 0) return;
+        awake_[id] = 1;
+        awakeList_.push_back(id);
+    }
+    
+    void step(double dt) {
+        PERF_ZONE("physics.step");
+        // 醒着的动态物体按下标排序，保证候选对和岛的顺序确定
+        std::sort(awakeList_.begin(), awakeList_.end());
+        PERF_COUNT("physics.body_steps", awakeList_.size());
+        
+        // 应用重力 + 更新物体
+        {
+            PERF_ZONE("physics.integrate");
+            for (int id : awakeList_) {
+                RigidBody& body = bodies[id];
+                body.applyForce(gravity * body.mass);
+                body.update(dt);
+                grid_.move(id, body.pos);
+            }
+        }
+        
+        findPairs();
+        buildIslands();
+        PERF_COUNT("physics.pairs", pairs_.size());
+        
+        // 岛之间不共享动态物体，静止物体只读（invMass = 0 时 resolveCollision 不改它），可以并行
+        {
+            PERF_ZONE("physics.solve");
+            parallelFor((int)islands_.size(), threads, [&](int k) {
+                for (size_t p = islandStart_[k]; p < islandStart_[k + 1]; p++) {
+                    resolveCollision(bodies[pairs_[p].first], bodies[pairs_[p].second]);
+                }
+            });
+        }
+        
+        // 边界约束（静止物体不动，不用再约束）
+        for (int id : awakeList_) {
+            applyBoundaryConstraints(bodies[id], width, height);
+            grid_.move(id, bodies[id].pos);
+        }
+        
+        updateSleep(dt);
+    }
+    
+private:
+    HashGrid grid_;
+    // 候选对的额外距离，取最大半径：同一帧内前面的碰撞修正可能把物体推进接触，
+    // 裕量内的对都交给窄相（resolveCollision 自己判断是否真的相交）。格子边长 = 最大直径 + 裕量
+    double margin_ = 0;
+    std::vector<unsigned char> awake_;
+    std::vector<double> sleepTimer_;
+    std::vector<int> awakeList_;
+    std::vector<std::pair<int, int>> pairs_;  // (小下标, 大下标)，与原来两重循环的参数顺序相同
+    std::vector<int> parent_;                 // 并查集，只对本帧醒着的物体有意义
+    std::vector<int> islands_;                // 每个岛的根
+    std::vector<size_t> islandStart_;         // 第 k 个岛的候选对是 pairs_[islandStart_[k], islandStart_[k + 1])
+    std::vector<int> pairIsland_;
+    
+    void rebuildGrid(double cellSize) {
+        grid_ = HashGrid(cellSize);
+        for (size_t i = 0; i < bodies.size(); i++) grid_.insert((int)i, bodies[i].pos);
+    }
+    
+    bool isSlow(int id) const {
+        const RigidBody& b = bodies[id];
+        return b.vel.dot(b.vel) < sleep.linearThreshold * sleep.linearThreshold &&
+               std::abs(b.angularVel) < sleep.angularThreshold;
+    }
+    
+    // 每个醒着的物体查 3x3 邻格；两端都醒着的对只在小下标一侧记录。
+    // 碰到睡眠物体就叫醒它：来者仍在运动时清零它的计时，否则两者本来就快要一起睡了
+    void findPairs() {
+        PERF_ZONE("physics.broadphase");
+        pairs_.clear();
+        for (size_t n = 0; n < awakeList_.size(); n++) {
+            int i = awakeList_[n];
+            const RigidBody& a = bodies[i];
+            grid_.forEachNear(a.pos, [&](int j) {
+                if (j == i || (awake_[j] && j < i)) return;
+                const RigidBody& b = bodies[j];
+                Vec2 d = b.pos - a.pos;
+                double reach = a.radius + b.radius + margin_;
+                if (d.dot(d) >= reach * reach) return;
+                if (!awake_[j] && b.invMass > 0) {
+                    wake(j);  // 追加到 awakeList_ 末尾，本循环稍后也会处理它的邻居
+                    if (!isSlow(i)) sleepTimer_[j] = 0;
+                }
+                pairs_.push_back({std::min(i, j), std::max(i, j)});
+            });
+        }
+        std::sort(pairs_.begin(), pairs_.end());
+        pairs_.erase(std::unique(pairs_.begin(), pairs_.end()), pairs_.end());
+        std::sort(awakeList_.begin(), awakeList_.end());
+        stats.pairs = pairs_.size();
+        stats.awake = awakeList_.size();
+    }
+    
+    int findRoot(int i) {
+        while (parent_[i] != i) i = parent_[i] = parent_[parent_[i]];
+        return i;
+    }
+    
+    // 动态物体经候选对连通的分量是一个岛；静止物体不连接岛
+    void buildIslands() {
+        PERF_ZONE("physics.islands");
+        if (parent_.size() < bodies.size()) parent_.resize(bodies.size());
+        for (int id : awakeList_) parent_[id] = id;
+        for (auto [i, j] : pairs_) {
+            if (bodies[i].invMass == 0 || bodies[j].invMass == 0) continue;
+            int ri = findRoot(i), rj = findRoot(j);
+            if (ri != rj) parent_[std::max(ri, rj)] = std::min(ri, rj);
+        }
+        
+        // 候选对按 (岛, 小下标, 大下标) 排序：每个岛内仍是原来两重循环的顺序
+        pairIsland_.resize(pairs_.size());
+        for (size_t p = 0; p < pairs_.size(); p++) {
+            auto [i, j] = pairs_[p];
+            pairIsland_[p] = findRoot(bodies[i].invMass > 0 ? i : j);
+        }
+        std::vector<uint32_t> order(pairs_.size());
+        for (size_t p = 0; p < order.size(); p++) order[p] = (uint32_t)p;
+        std::stable_sort(order.begin(), order.end(),
+                         [&](uint32_t x, uint32_t y) { return pairIsland_[x] < pairIsland_[y]; });
+        std::vector<std::pair<int, int>> sorted(pairs_.size());
+        islands_.clear();
+        islandStart_.clear();
+        stats.largestIsland = 0;
+        for (size_t p = 0; p < order.size(); p++) {
+            sorted[p] = pairs_[order[p]];
+            int island = pairIsland_[order[p]];
+            if (islands_.empty() || islands_.back() != island) {
+                islands_.push_back(island);
+                islandStart_.push_back(p);
+            }
+        }
+        islandStart_.push_back(order.size());
+        for (size_t k = 0; k < islands_.size(); k++)
+            stats.largestIsland = std::max(stats.largestIsland, islandStart_[k + 1] - islandStart_[k]);
+        pairs_.swap(sorted);
+        stats.islands = islands_.size();
+    }
+    
+    // 物体低速累计计时；岛内所有物体都超过 timeToSleep 时整岛入睡（速度清零、移出醒着列表）
+    void updateSleep(double dt) {
+        PERF_ZONE("physics.sleep");
+        if (!sleep.enabled) return;
+        std::unordered_map<int, double> islandMin;  // 岛根 → 岛内最小计时（含没有候选对的孤立物体）
+        for (int id : awakeList_) {
+            sleepTimer_[id] = isSlow(id) ? sleepTimer_[id] + dt : 0;
+            int root = findRoot(id);
+            auto it = islandMin.find(root);
+            if (it == islandMin.end()) islandMin.emplace(root, sleepTimer_[id]);
+            else it->second = std::min(it->second, sleepTimer_[id]);
+        }
+        size_t kept = 0;
+        for (int id : awakeList_) {
+            if (islandMin[findRoot(id)] >= sleep.timeToSleep) {
+                awake_[id] = 0;
+                bodies[id].vel = Vec2(0, 0);
+                bodies[id].angularVel = 0;
+            } else {
+                awakeList_[kept++] = id;
+            }
+        }
+        awakeList_.resize(kept);
+    }
+};
+
 // 渲染
 void render(const std::vector<RigidBody>& bodies, std::vector<unsigned char>& pixels, 
             int width, int height) {
+    PERF_ZONE("physics.render");
     
     std::fill(pixels.begin(), pixels.end(), 255);
     
@@ -172,7 +485,136 @@ void render(const std::vector<RigidBody>& bodies, std::vector<unsigned char>& pi
     }
 }
 
-int main() {
+// 原来的整帧流程：所有物体两两检测，作为宽相的对照
+void stepBruteForce(std::vector<RigidBody>& bodies, Vec2 gravity, double dt, double width, double height) {
+    PERF_ZONE("physics.step_brute_force");
+    // 应用重力
+    for (auto& body : bodies) {
+        body.applyForce(gravity * body.mass);
+    }
+    
+    // 更新物体
+    for (auto& body : bodies) {
+        body.update(dt);
+    }
+    
+    // 碰撞检测与响应
+    for (size_t i = 0; i < bodies.size(); i++) {
+        for (size_t j = i + 1; j < bodies.size(); j++) {
+            resolveCollision(bodies[i], bodies[j]);
+        }
+    }
+    
+    // 边界约束
+    for (auto& body : bodies) {
+        applyBoundaryConstraints(body, width, height);
+    }
+}
+
+// ========== 基准：大量静止物体 ==========
+
+using Clock = std::chrono::steady_clock;
+
+// 地面上每 8 个球一簇（簇内相距 1 像素，簇间留空），上方再落下若干醒着的球
+static std::vector<RigidBody> makeRestingScene(int count, int falling, double& width, double height) {
+    const double r = 3;
+    const int cluster = 8;
+    int clusters = (count - falling + cluster - 1) / cluster;
+    width = clusters * (cluster * (2 * r + 1) + 20);
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> xDist(r, width - r), yDist(20, height / 2);
+    std::vector<RigidBody> bodies;
+    for (int c = 0; c < clusters && (int)bodies.size() < count - falling; c++) {
+        double x0 = c * (cluster * (2 * r + 1) + 20) + 10 + r;
+        for (int k = 0; k < cluster && (int)bodies.size() < count - falling; k++) {
+            bodies.push_back(RigidBody(Vec2(x0 + k * (2 * r + 1), height - r), r, r * r * 0.1, 0.5));
+        }
+    }
+    for (int i = 0; i < falling; i++) bodies.push_back(RigidBody(Vec2(xDist(rng), yDist(rng)), r, r * r * 0.1, 0.5));
+    return bodies;
+}
+
+static void runBenchmark(int count, int threads) {
+    const double height = 200, dt = 0.016;
+    const Vec2 gravity(0, 200);
+    
+    // 1. 宽相与原来两两检测逐位一致（关闭睡眠，规模小到两两检测还能跑）
+    {
+        double width;
+        std::vector<RigidBody> brute = makeRestingScene(2000, 200, width, height);
+        PhysicsWorld world(width, height, gravity);
+        world.sleep.enabled = false;
+        world.threads = threads;
+        for (const RigidBody& b : brute) world.add(b);
+        auto t0 = Clock::now();
+        for (int f = 0; f < 60; f++) stepBruteForce(brute, gravity, dt, width, height);
+        double bruteMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count() / 60;
+        t0 = Clock::now();
+        for (int f = 0; f < 60; f++) world.step(dt);
+        double gridMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count() / 60;
+        bool same = true;
+        for (size_t i = 0; i < brute.size(); i++) {
+            same = same && brute[i].pos.x == world.bodies[i].pos.x && brute[i].pos.y == world.bodies[i].pos.y &&
+                   brute[i].vel.x == world.bodies[i].vel.x && brute[i].vel.y == world.bodies[i].vel.y;
+        }
+        printf("2000 个物体、无睡眠: 两两检测 %.2f ms/帧, 哈希网格 %.3f ms/帧, 结果%s\n", bruteMs, gridMs,
+               same ? "逐位一致" : "不一致");
+    }
+    
+    // 2. 大场景：地面簇逐渐入睡，落下的球叫醒局部
+    double width;
+    std::vector<RigidBody> scene = makeRestingScene(count, count / 500, width, height);
+    PhysicsWorld world(width, height, gravity);
+    world.threads = threads;
+    for (const RigidBody& b : scene) world.add(b);
+    printf("\n%d 个物体（%d 个从空中落下），场景 %.0fx%.0f，%d 线程\n", count, count / 500, width, height, threads);
+    printf("%-10s %10s %10s %10s %10s %10s\n", "帧", "ms/帧", "醒着", "候选对", "岛", "最大岛");
+    double total = 0;
+    for (int f = 0; f < 300; f++) {
+        auto t0 = Clock::now();
+        world.step(dt);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        total += ms;
+        if (f % 30 == 0 || f == 299) {
+            printf("%-10d %10.3f %10zu %10zu %10zu %10zu\n", f, ms, world.stats.awake, world.stats.pairs,
+                   world.stats.islands, world.stats.largestIsland);
+        }
+    }
+    printf("平均 %.3f ms/帧；两两检测每帧需要 %.2g 次测试\n", total / 300, (double)count * (count - 1) / 2);
+}
+
+int main(int argc, char** argv) {
+    perf::Session session("physics_engine");
+    // 本程序自己的参数先取出来，其余交给共用的帧输出参数解析
+    int simThreads = defaultThreads();
+    int benchCount = 0;
+    bool noSleep = false;
+    std::vector<char*> rest = {argv[0]};
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--sim-threads") && i + 1 < argc) {
+            simThreads = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--bench")) {
+            benchCount = 100000;
+            if (i + 1 < argc && argv[i + 1][0] != '-') benchCount = std::max(1000, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--no-sleep")) {
+            noSleep = true;
+        } else {
+            rest.push_back(argv[i]);
+        }
+    }
+    if (benchCount > 0) {
+        runBenchmark(benchCount, simThreads);
+        return 0;
+    }
+    
+    frame_output::Options options;
+    if (!options.parse((int)rest.size(), rest.data())) {
+        frame_output::Options::usage(argv[0]);
+        fprintf(stderr, "       [--sim-threads N] [--no-sleep] [--bench [物体数]]\n");
+        return 1;
+    }
+    const int saveEvery = options.every ? options.every : 30;
+    
     const int WIDTH = 800;
     const int HEIGHT = 600;
     
@@ -214,40 +656,29 @@ int main() {
     Vec2 gravity(0, 200);
     double dt = 0.016;  // ~60 FPS
     
+    PhysicsWorld world(WIDTH, HEIGHT, gravity);
+    world.threads = simThreads;
+    world.sleep.enabled = !noSleep;
+    for (const RigidBody& body : bodies) world.add(body);
+    
     // 模拟并保存关键帧
     int savedFrames = 0;
+    frame_output::FrameWriter writer(options.format, options.threads);
+    writer.set_print_saved(true);
     for (int frame = 0; frame < 300; frame++) {
-        // 应用重力
-        for (auto& body : bodies) {
-            body.applyForce(gravity * body.mass);
-        }
-        
-        // 更新物体
-        for (auto& body : bodies) {
-            body.update(dt);
-        }
-        
-        // 碰撞检测与响应
-        for (size_t i = 0; i < bodies.size(); i++) {
-            for (size_t j = i + 1; j < bodies.size(); j++) {
-                resolveCollision(bodies[i], bodies[j]);
-            }
-        }
-        
-        // 边界约束
-        for (auto& body : bodies) {
-            applyBoundaryConstraints(body, WIDTH, HEIGHT);
-        }
+        world.step(dt);
         
         // 保存关键帧
-        if (frame % 30 == 0 || frame == 299) {
-            render(bodies, pixels, WIDTH, HEIGHT);
-            char filename[100];
-            sprintf(filename, "physics_frame_%02d.png", savedFrames++);
-            stbi_write_png(filename, WIDTH, HEIGHT, 3, pixels.data(), WIDTH * 3);
-            printf("Saved: %s\n", filename);
+        if (frame % saveEvery == 0 || frame == 299) {
+            render(world.bodies, pixels, WIDTH, HEIGHT);
+            char stem[100];
+            snprintf(stem, sizeof(stem), "physics_frame_%02d", savedFrames++);
+            writer.submit(stem, WIDTH, HEIGHT, 3, pixels.data());
         }
     }
     
+    writer.finish();
+    writer.print_stats("帧输出");
+    
     return 0;
 }
@@ -1,11 +1,13 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
+#include "../../2026/03/03-01-BVH-Accelerated-Ray-Tracer/bvh.h"
 #include <vector>
 #include <cmath>
 #include <algorithm>
 #include <limits>
 #include <random>
 #include <memory>
+#include <cstdint>
 
 const double PI = 3.14159265358979323846;
 const double INF = std::numeric_limits<double>::infinity();
@@ -105,11 +107,78 @@ struct Sphere {
     }
 };
 
+// ========== 太阳光源 ==========
+// 天空中半角为 acos(cosMax) 的小圆锥，圆锥内辐亮度恒定；漫反射顶点对它做显式采样（NEE）
+struct SunLight {
+    Vec3 direction = Vec3(0, 1, 0);  // 指向太阳（单位向量）
+    double cosMax = 1.0;
+    Color radiance = Color(0, 0, 0);  // 全 0 表示没有太阳
+    
+    SunLight() = default;
+    SunLight(Vec3 dir, double halfAngleDeg, Color l)
+        : direction(dir.normalized()), cosMax(cos(halfAngleDeg * PI / 180.0)), radiance(l) {}
+    
+    bool enabled() const { return radiance.x > 0 || radiance.y > 0 || radiance.z > 0; }
+    bool contains(const Vec3& unitDir) const { return unitDir.dot(direction) >= cosMax; }
+    
+    // 圆锥内均匀采样，立体角 pdf 为常数
+    double pdf() const { return 1.0 / (2 * PI * (1 - cosMax)); }
+    Vec3 sample(double u1, double u2) const {
+        double cosT = 1 - u1 * (1 - cosMax);
+        double sinT = sqrt(fmax(0.0, 1 - cosT * cosT));
+        double phi = 2 * PI * u2;
+        Vec3 a = fabs(direction.x) > 0.9 ? Vec3(0, 1, 0) : Vec3(1, 0, 0);
+        Vec3 t = direction.cross(a).normalized();
+        Vec3 b = direction.cross(t);
+        return (t * (sinT * cos(phi)) + b * (sinT * sin(phi)) + direction * cosT).normalized();
+    }
+};
+
 // ========== 场景类 ==========
+// 球体数量较多（randomScene 约 488 个），求交走共享的 BVH（bvh.h），
+// 叶子中的球体仍用 Sphere::hit 精确求交
 struct Scene {
     std::vector<Sphere> spheres;
+    bvh::Tree accel;
+    SunLight sun;
+    
+    // 添加完球体后调用
+    void build() {
+        std::vector<bvh::AABB> boxes;
+        boxes.reserve(spheres.size());
+        for (const auto& s : spheres) {
+            boxes.emplace_back(s.center.x - s.radius, s.center.y - s.radius, s.center.z - s.radius,
+                               s.center.x + s.radius, s.center.y + s.radius, s.center.z + s.radius);
+        }
+        accel.build(boxes);
+    }
     
     bool hit(const Ray& r, double tMin, double tMax, HitRecord& rec) const {
+        bvh::Ray br(r.origin.x, r.origin.y, r.origin.z, r.direction.x, r.direction.y, r.direction.z);
+        HitRecord tempRec;
+        double closest = tMax;
+        int idx = accel.intersect(br, tMin, closest, [&](int i, double t0, double t1, double& t) {
+            if (!spheres[i].hit(r, t0, t1, tempRec)) return false;
+            t = tempRec.t;
+            rec = tempRec;
+            return true;
+        });
+        return idx >= 0;
+    }
+    
+    // 阴影光线：区间内有任意交点即返回（玻璃也视为不透明）
+    bool occluded(const Ray& r, double tMin, double tMax) const {
+        bvh::Ray br(r.origin.x, r.origin.y, r.origin.z, r.direction.x, r.direction.y, r.direction.z);
+        HitRecord tempRec;
+        return accel.occluded(br, tMin, tMax, [&](int i, double t0, double t1, double& t) {
+            if (!spheres[i].hit(r, t0, t1, tempRec)) return false;
+            t = tempRec.t;
+            return true;
+        });
+    }
+    
+    // 线性遍历（对照用）
+    bool hitLinear(const Ray& r, double tMin, double tMax, HitRecord& rec) const {
         HitRecord tempRec;
         bool hitAnything = false;
         double closest = tMax;
@@ -127,43 +196,223 @@ struct Scene {
 };
 
 // ========== 随机数工具 ==========
+// 场景生成用；渲染时的随机数由采样器提供
 std::mt19937 rng(12345);
 std::uniform_real_distribution<double> uniformDist(0.0, 1.0);
 
 double randomDouble() { return uniformDist(rng); }
 double randomDouble(double min, double max) { return min + (max - min) * randomDouble(); }
 
-Vec3 randomInUnitSphere() {
-    while (true) {
-        Vec3 p(randomDouble(-1, 1), randomDouble(-1, 1), randomDouble(-1, 1));
-        if (p.dot(p) < 1) return p;
-    }
+// ========== 采样器 ==========
+// 一个像素样本按固定顺序取维度：像素抖动(2D) → 镜头(2D) → 每次弹射 BSDF(2D + 1D)，
+// 每一维只在同一像素的各样本之间分层，不同维度彼此去相关
+struct Sample2 { double u, v; };
+
+class Sampler {
+public:
+    virtual ~Sampler() = default;
+    virtual void startPixelSample(int px, int py, int sampleIndex) = 0;
+    virtual double get1D() = 0;
+    virtual Sample2 get2D() = 0;
+};
+
+// 独立均匀随机数（原实现，对照用）
+class RandomSampler : public Sampler {
+public:
+    void startPixelSample(int, int, int) override {}
+    double get1D() override { return randomDouble(); }
+    Sample2 get2D() override { double u = randomDouble(); return {u, randomDouble()}; }
+};
+
+inline uint32_t reverseBits(uint32_t x) {
+    x = (x << 16) | (x >> 16);
+    x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+    x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+    x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+    x = ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+    return x;
+}
+
+// 整数哈希（lowbias32），给像素 / 维度生成互不相关的种子
+inline uint32_t hashBits(uint32_t x) {
+    x ^= x >> 16; x *= 0x7feb352du;
+    x ^= x >> 15; x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+inline uint32_t hashCombine(uint32_t seed, uint32_t v) {
+    return hashBits(seed ^ (v + 0x9e3779b9u + (seed << 6) + (seed >> 2)));
 }
 
-Vec3 randomUnitVector() {
-    return randomInUnitSphere().normalized();
+// 32 位定点小数 -> [0, 1)
+inline double bitsToUnit(uint32_t x) {
+    return std::min(x * (1.0 / 4294967296.0), 0x1.fffffffffffffp-1);
 }
 
-Vec3 randomInUnitDisk() {
-    while (true) {
-        Vec3 p(randomDouble(-1, 1), randomDouble(-1, 1), 0);
-        if (p.dot(p) < 1) return p;
+// Owen 扰乱的 Sobol（Burley 2020 "Practical Hash-based Owen Scrambling"）
+// - 每个 2D 请求都是一组 (0,2) 序列：Sobol 第 0/1 维，按 (像素, 维度) 哈希独立扰乱
+// - 样本下标先做一次嵌套均匀置换（打乱顺序），各维度之间不再相关
+// - 每像素样本数取 2 的幂时分层最好，其他数量仍然无偏
+class SobolSampler : public Sampler {
+public:
+    explicit SobolSampler(uint32_t seed = 0) : seed(seed) {}
+
+    void startPixelSample(int px, int py, int sampleIndex) override {
+        pixelSeed = hashCombine(hashCombine(seed, (uint32_t)px), (uint32_t)py);
+        index = (uint32_t)sampleIndex;
+        dimension = 0;
+    }
+
+    double get1D() override {
+        uint32_t dimSeed = hashCombine(pixelSeed, dimension++);
+        uint32_t i = nestedUniformScramble(index, dimSeed);
+        return bitsToUnit(nestedUniformScramble(reverseBits(i), hashCombine(dimSeed, 1)));
+    }
+
+    Sample2 get2D() override {
+        uint32_t dimSeed = hashCombine(pixelSeed, dimension++);
+        uint32_t i = nestedUniformScramble(index, dimSeed);
+        return {bitsToUnit(nestedUniformScramble(reverseBits(i), hashCombine(dimSeed, 1))),
+                bitsToUnit(nestedUniformScramble(sobolDim1(i), hashCombine(dimSeed, 2)))};
     }
+
+private:
+    uint32_t seed;
+    uint32_t pixelSeed = 0;
+    uint32_t index = 0;
+    uint32_t dimension = 0;
+
+    // Sobol 第 1 维（第 0 维即 reverseBits）
+    static uint32_t sobolDim1(uint32_t i) {
+        uint32_t v = 1u << 31, r = 0;
+        for (; i; i >>= 1, v ^= v >> 1) {
+            if (i & 1) r ^= v;
+        }
+        return r;
+    }
+
+    static uint32_t laineKarrasPermutation(uint32_t x, uint32_t s) {
+        x += s;
+        x ^= x * 0x6c50b47cu;
+        x ^= x * 0xb82f1e52u;
+        x ^= x * 0xc7afe638u;
+        x ^= x * 0x8d22f6e6u;
+        return x;
+    }
+
+    // 以二进制小数位为树的 Owen 扰乱：低位变换只受更高位影响
+    static uint32_t nestedUniformScramble(uint32_t x, uint32_t s) {
+        return reverseBits(laineKarrasPermutation(reverseBits(x), s));
+    }
+};
+
+// Halton：第 k 维用第 k 个素数为底的根式反演，每一位数字按 (像素, 维度, 位) 哈希随机平移
+// （随机数字扰乱），比 Sobol 便宜，高维与 Owen 扰乱 Sobol 相比分层略差
+class HaltonSampler : public Sampler {
+public:
+    static constexpr int NUM_PRIMES = 256;  // 维度超出时循环复用
+
+    explicit HaltonSampler(uint32_t seed = 0) : seed(seed) {
+        for (uint32_t n = 2, k = 0; k < NUM_PRIMES; n++) {
+            bool prime = true;
+            for (uint32_t d = 0; d < k && primes[d] * primes[d] <= n; d++) {
+                if (n % primes[d] == 0) { prime = false; break; }
+            }
+            if (prime) primes[k++] = n;
+        }
+    }
+
+    void startPixelSample(int px, int py, int sampleIndex) override {
+        pixelSeed = hashCombine(hashCombine(seed, (uint32_t)px), (uint32_t)py);
+        index = (uint32_t)sampleIndex;
+        dimension = 0;
+    }
+
+    double get1D() override { return scrambledRadicalInverse(dimension++); }
+
+    Sample2 get2D() override {
+        double u = scrambledRadicalInverse(dimension++);
+        return {u, scrambledRadicalInverse(dimension++)};
+    }
+
+private:
+    uint32_t seed;
+    uint32_t pixelSeed = 0;
+    uint32_t index = 0;
+    uint32_t dimension = 0;
+    uint32_t primes[NUM_PRIMES];
+
+    // 取到 32 位精度为止（高位数字为 0 的部分也要扰乱，否则样本聚在 0 附近）
+    double scrambledRadicalInverse(uint32_t dim) {
+        uint32_t base = primes[dim % NUM_PRIMES];
+        uint32_t dimSeed = hashCombine(pixelSeed, dim);
+        double invBase = 1.0 / base, f = invBase, r = 0;
+        uint32_t i = index;
+        for (uint32_t digit = 0; f > 0x1p-32; digit++, i /= base, f *= invBase) {
+            r += ((i % base + hashCombine(dimSeed, digit)) % base) * f;
+        }
+        return std::min(r, 0x1.fffffffffffffp-1);
+    }
+};
+
+// ========== 采样映射 ==========
+// 均为 [0,1)² 到目标域的直接映射（不做拒绝采样），保持低差异序列的分层
+
+// 单位圆盘：Shirley-Chiu 同心映射（面积保持，形变小）
+Vec3 sampleUniformDisk(Sample2 s) {
+    double a = 2 * s.u - 1, b = 2 * s.v - 1;
+    if (a == 0 && b == 0) return Vec3(0, 0, 0);
+    double r, phi;
+    if (fabs(a) > fabs(b)) {
+        r = a;
+        phi = (PI / 4) * (b / a);
+    } else {
+        r = b;
+        phi = (PI / 2) - (PI / 4) * (a / b);
+    }
+    return Vec3(r * cos(phi), r * sin(phi), 0);
+}
+
+// 单位球面均匀分布
+Vec3 sampleUniformSphere(Sample2 s) {
+    double z = 1 - 2 * s.u;
+    double r = sqrt(fmax(0.0, 1 - z * z));
+    double phi = 2 * PI * s.v;
+    return Vec3(r * cos(phi), r * sin(phi), z);
+}
+
+// 单位球内均匀分布：球面方向 × 半径 w^(1/3)
+Vec3 sampleUniformBall(Sample2 s, double w) {
+    return sampleUniformSphere(s) * cbrt(w);
+}
+
+// 以 n 为轴的余弦加权半球：圆盘点抬升到半球（Malley 方法）
+Vec3 sampleCosineHemisphere(Sample2 s, const Vec3& n) {
+    Vec3 d = sampleUniformDisk(s);
+    double z = sqrt(fmax(0.0, 1 - d.x * d.x - d.y * d.y));
+    // 由法线构造正交基（Duff et al. 2017）
+    double sign = n.z >= 0 ? 1.0 : -1.0;
+    double a = -1.0 / (sign + n.z);
+    double b = n.x * n.y * a;
+    Vec3 t(1 + sign * n.x * n.x * a, sign * b, -sign * n.x);
+    Vec3 bt(b, sign + n.y * n.y * a, -n.y);
+    return t * d.x + bt * d.y + n * z;
 }
 
 // ========== 材质散射 ==========
-bool scatter(const Ray& rIn, const HitRecord& rec, Color& attenuation, Ray& scattered) {
+// 每次调用固定消耗采样器的 2D + 1D 两个维度，路径各深度的维度编号与材质无关
+bool scatter(const Ray& rIn, const HitRecord& rec, Sampler& sampler, Color& attenuation, Ray& scattered) {
+    Sample2 s = sampler.get2D();
+    double w = sampler.get1D();
+    
     if (rec.material->type == LAMBERTIAN) {
-        Vec3 scatterDirection = rec.normal + randomUnitVector();
-        if (fabs(scatterDirection.x) < 1e-8 && fabs(scatterDirection.y) < 1e-8 && fabs(scatterDirection.z) < 1e-8)
-            scatterDirection = rec.normal;
-        scattered = Ray(rec.point, scatterDirection);
+        scattered = Ray(rec.point, sampleCosineHemisphere(s, rec.normal));
         attenuation = rec.material->albedo;
         return true;
         
     } else if (rec.material->type == METAL) {
         Vec3 reflected = rIn.direction - rec.normal * (2 * rIn.direction.dot(rec.normal));
-        reflected = reflected + randomInUnitSphere() * rec.material->fuzz;
+        reflected = reflected + sampleUniformBall(s, w) * rec.material->fuzz;
         scattered = Ray(rec.point, reflected);
         attenuation = rec.material->albedo;
         return scattered.direction.dot(rec.normal) > 0;
@@ -185,7 +434,7 @@ bool scatter(const Ray& rIn, const HitRecord& rec, Color& attenuation, Ray& scat
         };
         
         Vec3 direction;
-        if (cannotRefract || reflectance(cosTheta, refractionRatio) > randomDouble()) {
+        if (cannotRefract || reflectance(cosTheta, refractionRatio) > w) {
             direction = unitDirection - rec.normal * (2 * unitDirection.dot(rec.normal));
         } else {
             Vec3 rOutPerp = (unitDirection + rec.normal * cosTheta) * refractionRatio;
@@ -201,22 +450,72 @@ bool scatter(const Ray& rIn, const HitRecord& rec, Color& attenuation, Ray& scat
 }
 
 // ========== 光线追踪核心 ==========
-Color rayColor(const Ray& r, const Scene& scene, int depth) {
-    if (depth <= 0) return Color(0, 0, 0);
+// 迭代路径追踪，throughput 为路径到当前顶点的衰减乘积
+// - 漫反射顶点显式采样太阳（NEE），与散射方向恰好飞进太阳的情况按幂启发式（MIS）合并；
+//   金属与玻璃视为镜面，不做 NEE，之后打中太阳时全额计入
+// - RR_START_BOUNCE 次弹射之后做俄罗斯轮盘：按吞吐量决定存活概率，贡献小的路径提前结束
+const int RR_START_BOUNCE = 3;
+const double RR_MAX_SURVIVAL = 0.95;
+
+double powerHeuristic(double pdfA, double pdfB) {
+    return pdfA * pdfA / (pdfA * pdfA + pdfB * pdfB);
+}
+
+// 逃逸光线带回的辐亮度；bsdfPdf 为采样到该方向的 pdf，0 表示相机光线或镜面弹射
+Color skyRadiance(const Scene& scene, const Vec3& direction, double bsdfPdf) {
+    Vec3 unitDirection = direction.normalized();
+    double t = 0.5 * (unitDirection.y + 1.0);
+    Color color = Color(1, 1, 1) * (1.0 - t) + Color(0.5, 0.7, 1.0) * t;
+    if (scene.sun.enabled() && scene.sun.contains(unitDirection)) {
+        double w = bsdfPdf > 0 ? powerHeuristic(bsdfPdf, scene.sun.pdf()) : 1.0;
+        color = color + scene.sun.radiance * w;
+    }
+    return color;
+}
+
+Color rayColor(const Ray& r, const Scene& scene, Sampler& sampler, int maxDepth) {
+    Color radiance(0, 0, 0), throughput(1, 1, 1);
+    Ray ray = r;
+    double bsdfPdf = 0;
     
-    HitRecord rec;
-    if (scene.hit(r, 0.001, INF, rec)) {
+    for (int bounce = 0; bounce < maxDepth; bounce++) {
+        HitRecord rec;
+        if (!scene.hit(ray, 0.001, INF, rec)) {
+            radiance = radiance + throughput * skyRadiance(scene, ray.direction, bsdfPdf);
+            break;
+        }
+        
+        // 每次弹射固定消耗：太阳 2D、轮盘 1D、散射 2D + 1D
+        Sample2 lightSample = sampler.get2D();
+        double rrSample = sampler.get1D();
+        
+        if (rec.material->type == LAMBERTIAN && scene.sun.enabled()) {
+            Vec3 wi = scene.sun.sample(lightSample.u, lightSample.v);
+            double cosTheta = rec.normal.dot(wi);
+            if (cosTheta > 0 && !scene.occluded(Ray(rec.point, wi), 0.001, INF)) {
+                double lightPdf = scene.sun.pdf();
+                double w = powerHeuristic(lightPdf, cosTheta / PI);
+                // f·cos/pdf = (albedo/π)·cos / lightPdf
+                radiance = radiance + throughput * rec.material->albedo * scene.sun.radiance *
+                           (cosTheta / PI / lightPdf * w);
+            }
+        }
+        
         Ray scattered(Point3(0,0,0), Vec3(0,0,1));
         Color attenuation;
-        if (scatter(r, rec, attenuation, scattered)) {
-            return attenuation * rayColor(scattered, scene, depth - 1);
+        if (!scatter(ray, rec, sampler, attenuation, scattered)) break;
+        throughput = throughput * attenuation;
+        bsdfPdf = rec.material->type == LAMBERTIAN ? fmax(0.0, rec.normal.dot(scattered.direction)) / PI : 0;
+        
+        if (bounce >= RR_START_BOUNCE) {
+            double q = fmin(RR_MAX_SURVIVAL, fmax(throughput.x, fmax(throughput.y, throughput.z)));
+            if (rrSample >= q) break;
+            throughput = throughput / q;
         }
-        return Color(0, 0, 0);
+        ray = scattered;
     }
     
-    Vec3 unitDirection = r.direction.normalized();
-    double t = 0.5 * (unitDirection.y + 1.0);
-    return Color(1, 1, 1) * (1.0 - t) + Color(0.5, 0.7, 1.0) * t;
+    return radiance;
 }
 
 // ========== 带景深的相机 ==========
@@ -247,8 +546,8 @@ struct Camera {
         lensRadius = aperture / 2.0;
     }
     
-    Ray getRay(double s, double t) const {
-        Vec3 rd = randomInUnitDisk() * lensRadius;
+    Ray getRay(double s, double t, Sampler& sampler) const {
+        Vec3 rd = sampleUniformDisk(sampler.get2D()) * lensRadius;
         Vec3 offset = u * rd.x + v * rd.y;
         
         return Ray(origin + offset, 
@@ -258,7 +557,7 @@ struct Camera {
 
 // ========== 渲染函数 ==========
 void render(const char* filename, int width, int height, int samplesPerPixel, int maxDepth, 
-            const Scene& scene, const Camera& camera) {
+            const Scene& scene, const Camera& camera, Sampler& sampler) {
     
     std::vector<unsigned char> pixels(width * height * 3);
     
@@ -267,10 +566,12 @@ void render(const char* filename, int width, int height, int samplesPerPixel, in
             Color pixelColor(0, 0, 0);
             
             for (int s = 0; s < samplesPerPixel; s++) {
-                double u = (i + randomDouble()) / (width - 1);
-                double v = (j + randomDouble()) / (height - 1);
-                Ray r = camera.getRay(u, v);
-                pixelColor = pixelColor + rayColor(r, scene, maxDepth);
+                sampler.startPixelSample(i, j, s);
+                Sample2 jitter = sampler.get2D();
+                double u = (i + jitter.u) / (width - 1);
+                double v = (j + jitter.v) / (height - 1);
+                Ray r = camera.getRay(u, v, sampler);
+                pixelColor = pixelColor + rayColor(r, scene, sampler, maxDepth);
             }
             
             pixelColor = pixelColor / samplesPerPixel;
@@ -296,6 +597,7 @@ void render(const char* filename, int width, int height, int samplesPerPixel, in
 // ========== 随机场景生成 ==========
 Scene randomScene() {
     Scene scene;
+    scene.sun = SunLight(Vec3(-0.4, 1.0, 0.6), 1.5, Color(1.0, 0.9, 0.75) * 700.0);
     
     auto groundMaterial = std::make_shared<Material>(LAMBERTIAN, Color(0.5, 0.5, 0.5), 0, 0);
     scene.spheres.push_back(Sphere(Point3(0, -1000, 0), 1000, groundMaterial));
@@ -346,6 +648,7 @@ int main() {
     const int maxDepth = 50;
     
     Scene scene = randomScene();
+    scene.build();
     
     Point3 lookFrom(13, 2, 3);
     Point3 lookAt(0, 0, 0);
@@ -355,7 +658,8 @@ int main() {
     
     Camera camera(lookFrom, lookAt, vup, 20, aspectRatio, aperture, distToFocus);
     
-    render("phase3_dof_complex.png", imageWidth, imageHeight, samplesPerPixel, maxDepth, scene, camera);
+    SobolSampler sampler;
+    render("phase3_dof_complex.png", imageWidth, imageHeight, samplesPerPixel, maxDepth, scene, camera, sampler);
     
     return 0;
 }
@@ -0,0 +1,214 @@
+#!/usr/bin/env python3
+"""perf_regress.py - 编译并运行各 demo，读取 perf.h 导出的汇总 JSON，与基线比较，标出性能回归
+
+用法:
+    python3 scripts/perf_regress.py                  # 跑全部 demo，与 perf_baseline.json 比较
+    python3 scripts/perf_regress.py --runs 5         # 每个 demo 跑 5 次，zone 耗时取最小值（降低噪声，至少 3 次）
+    python3 scripts/perf_regress.py --only noise     # 只跑指定 demo（可重复）
+    python3 scripts/perf_regress.py --update         # 用本次结果覆盖基线
+    python3 scripts/perf_regress.py --threshold 0.2 --floor-ms 5 --floor-kb 4096
+
+判定规则：zone 累计耗时超过 基线 × (1 + threshold) 且绝对差超过 floor-ms 记为回归；
+峰值 RSS 超过 基线 × (1 + rss-threshold) 且绝对差超过 floor-kb 同样记为回归。计数器变化只作提示
+--runs 至少要 3（默认值）：只跑 1~2 次时毫秒级的 zone 受调度和缓存状态影响很大，
+没改动的代码也会报出 10%~50% 的"回归"（实测 --runs 1 时 cloth.solve +13%、physics.render +46%）
+（计数变了通常说明算法行为变了，耗时比较可能已经不是同一件事）。
+有回归时退出码为 1，可以直接挂到提交前检查里。
+
+基线与机器相关，默认放在仓库根目录的 perf_baseline.json，不存在时本次结果即写为基线。
+基线里同时记录每个 demo 的运行参数，参数变了（比较的已经不是同一条路径）或旧基线没有记录参数时，当作没有基线、重新记录。
+只依赖 Python 标准库和 g++。
+"""
+
+import argparse
+import json
+import os
+import platform
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+REPO = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+# name: 源文件（相对仓库根目录）、运行参数、运行时需要的相对路径输入（按 demo 里写死的相对路径映射回仓库）
+SUITE = [
+    {"name": "noise", "source": "playground/noise-library/noise.cpp", "args": []},
+    {"name": "particle_system", "source": "playground/particle-system/particles.cpp", "args": []},
+    {"name": "cloth_simulation", "source": "playground/cloth-simulation/cloth.cpp", "args": []},
+    # 原版按创建顺序逐条求解的路径，保留作对照
+    {"name": "cloth_sequential", "source": "playground/cloth-simulation/cloth.cpp", "args": ["--sequential"]},
+    {"name": "physics_engine", "source": "playground/physics-engine/physics.cpp", "args": []},
+    {"name": "triangle_rasterizer", "source": "2026/02/02-26-Triangle-Rasterization/rasterizer.cpp",
+     "args": ["--bench", "200000"]},
+    {"name": "bvh_tracer", "source": "2026/03/03-01-BVH-Accelerated-Ray-Tracer/main.cpp", "args": [],
+     "inputs": {"../../02/02-25-OBJ-Model-Loader": "2026/02/02-25-OBJ-Model-Loader"}},
+]
+
+CXX_FLAGS = ["-std=c++17", "-O2", "-pthread"]
+
+
+def compile_demo(entry, out_dir, cxx):
+    exe = os.path.join(out_dir, entry["name"])
+    cmd = [cxx] + CXX_FLAGS + [os.path.join(REPO, entry["source"]), "-o", exe]
+    result = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+    if result.returncode != 0:
+        raise RuntimeError("编译失败: %s\n%s" % (" ".join(cmd), result.stdout))
+    return exe
+
+
+def prepare_cwd(entry, out_dir):
+    """每次运行一个干净的工作目录（demo 会往当前目录写图片和缓存），并按需链接输入文件"""
+    root = tempfile.mkdtemp(prefix="run_", dir=out_dir)
+    cwd = os.path.join(root, "a", "b", "c")  # 留出几层，demo 里的 ../../xx 相对路径仍落在临时目录内
+    os.makedirs(cwd)
+    for rel, target in entry.get("inputs", {}).items():
+        link = os.path.normpath(os.path.join(cwd, rel))
+        if not link.startswith(root + os.sep):
+            raise RuntimeError("输入路径 %s 超出了临时目录" % rel)
+        os.makedirs(os.path.dirname(link), exist_ok=True)
+        os.symlink(os.path.join(REPO, target), link)
+    return root, cwd
+
+
+def run_demo(entry, exe, out_dir, timeout):
+    root, cwd = prepare_cwd(entry, out_dir)
+    summary = os.path.join(root, "perf_summary.json")
+    env = dict(os.environ, PERF_SUMMARY=summary)
+    env.pop("PERF_TRACE", None)
+    env.pop("PERF_PRINT", None)
+    start = time.time()
+    result = subprocess.run([exe] + entry["args"], cwd=cwd, env=env, stdout=subprocess.DEVNULL,
+                            stderr=subprocess.PIPE, universal_newlines=True, timeout=timeout)
+    elapsed = time.time() - start
+    if result.returncode != 0:
+        raise RuntimeError("%s 退出码 %d\n%s" % (entry["name"], result.returncode, result.stderr))
+    with open(summary) as f:
+        data = json.load(f)
+    shutil.rmtree(root, ignore_errors=True)
+    return data, elapsed
+
+
+def merge_runs(runs):
+    """多次运行合并：zone 累计耗时和峰值 RSS 取最小值（最少受干扰的一次），计数器取最后一次"""
+    merged = {"zones": {}, "peak_rss_kb": min(r["peak_rss_kb"] for r in runs),
+              "wall_ms": min(r["wall_ms"] for r in runs), "counters": runs[-1]["counters"]}
+    for name in runs[0]["zones"]:
+        totals = [r["zones"][name]["total_ms"] for r in runs if name in r["zones"]]
+        merged["zones"][name] = {"total_ms": min(totals), "count": runs[-1]["zones"].get(name, {}).get("count", 0)}
+    return merged
+
+
+def compare(name, base, cur, args):
+    """返回 (回归列表, 提示列表)，每项是一行可读文本"""
+    regressions, notes = [], []
+    for zone, z in sorted(cur["zones"].items()):
+        b = base["zones"].get(zone)
+        if b is None:
+            notes.append("新 zone %s: %.3f ms" % (zone, z["total_ms"]))
+            continue
+        old, new = b["total_ms"], z["total_ms"]
+        ratio = new / old if old > 0 else float("inf")
+        line = "%-34s %10.3f -> %10.3f ms  (%+.1f%%)" % (zone, old, new, (ratio - 1) * 100 if old > 0 else 0)
+        if new > old * (1 + args.threshold) and new - old > args.floor_ms:
+            regressions.append(line)
+        elif args.verbose:
+            notes.append(line)
+    for zone in sorted(set(base["zones"]) - set(cur["zones"])):
+        notes.append("zone %s 已不存在" % zone)
+
+    old_rss, new_rss = base.get("peak_rss_kb", 0), cur.get("peak_rss_kb", 0)
+    if old_rss > 0 and new_rss > old_rss * (1 + args.rss_threshold) and new_rss - old_rss > args.floor_kb:
+        regressions.append("%-34s %10d -> %10d KB" % ("peak_rss_kb", old_rss, new_rss))
+
+    for counter, value in sorted(cur["counters"].items()):
+        old = base.get("counters", {}).get(counter)
+        if old is not None and old != value:
+            notes.append("计数器 %s: %d -> %d" % (counter, old, value))
+    return regressions, notes
+
+
+def main():
+    parser = argparse.ArgumentParser(description="编译运行各 demo 并与性能基线比较")
+    parser.add_argument("--baseline", default=os.path.join(REPO, "perf_baseline.json"), help="基线文件路径")
+    parser.add_argument("--update", action="store_true", help="用本次结果覆盖基线")
+    parser.add_argument("--runs", type=int, default=3, help="每个 demo 的运行次数，取最小值（至少 3 次才可靠）")
+    parser.add_argument("--threshold", type=float, default=0.10, help="耗时相对阈值（默认 0.10 = 10%%）")
+    parser.add_argument("--floor-ms", type=float, default=2.0, help="耗时绝对差下限，小于它不算回归")
+    parser.add_argument("--rss-threshold", type=float, default=0.10, help="峰值 RSS 相对阈值")
+    parser.add_argument("--floor-kb", type=int, default=1024, help="峰值 RSS 绝对差下限（KB），小于它不算回归")
+    parser.add_argument("--only", action="append", default=[], help="只跑指定名字的 demo，可重复")
+    parser.add_argument("--timeout", type=float, default=600, help="单次运行超时（秒）")
+    parser.add_argument("--cxx", default=os.environ.get("CXX", "g++"), help="编译器")
+    parser.add_argument("--verbose", action="store_true", help="也列出未回归的 zone")
+    args = parser.parse_args()
+
+    suite = [e for e in SUITE if not args.only or e["name"] in args.only]
+    unknown = set(args.only) - {e["name"] for e in SUITE}
+    if unknown:
+        parser.error("未知 demo: %s（可选: %s）" % (", ".join(sorted(unknown)), ", ".join(e["name"] for e in SUITE)))
+
+    if args.runs < 3:
+        print("注意: --runs %d 小于 3，毫秒级 zone 的耗时噪声很大，报出的回归可能是误报" % args.runs)
+
+    baseline = {}
+    if os.path.exists(args.baseline):
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+    host = {"machine": platform.machine(), "node": platform.node(), "cpus": os.cpu_count()}
+    if baseline.get("host") and baseline["host"] != host:
+        print("注意: 基线来自另一台机器 %s，本机 %s，耗时比较仅供参考" % (baseline["host"], host))
+
+    results = {}
+    stale = []  # 没有可比基线的 demo
+    total_regressions = 0
+    with tempfile.TemporaryDirectory(prefix="perf_regress_") as out_dir:
+        for entry in suite:
+            name = entry["name"]
+            print("== %s" % name, flush=True)
+            exe = compile_demo(entry, out_dir, args.cxx)
+            runs = []
+            for _ in range(max(1, args.runs)):
+                data, elapsed = run_demo(entry, exe, out_dir, args.timeout)
+                runs.append(data)
+                print("   运行 %.2f s" % elapsed, flush=True)
+            cur = merge_runs(runs)
+            cur["args"] = entry["args"]
+            results[name] = cur
+
+            base = baseline.get("demos", {}).get(name)
+            if base is not None and base.get("args") != entry["args"]:
+                print("   基线的运行参数 %s 与本次 %s 不同，重新记录" % (base.get("args"), entry["args"]))
+                base = None
+            if base is None:
+                stale.append(name)
+                print("   没有基线，记录本次结果")
+                continue
+            regressions, notes = compare(name, base, cur, args)
+            for line in regressions:
+                print("   回归  " + line)
+            for line in notes:
+                print("   提示  " + line)
+            if not regressions:
+                print("   无回归")
+            total_regressions += len(regressions)
+
+    demos = dict(baseline.get("demos", {}))
+    if args.update or stale:
+        for name, cur in results.items():
+            if args.update or name in stale:
+                demos[name] = cur
+        with open(args.baseline, "w") as f:
+            json.dump({"host": host, "timestamp": int(time.time()), "demos": demos}, f, indent=2, ensure_ascii=False)
+            f.write("\n")
+        print("基线已写入 %s" % args.baseline)
+
+    if total_regressions:
+        print("共 %d 项回归" % total_regressions)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())